@@ -4,7 +4,7 @@
  * @file config/config/Network.h
  *
  * @brief Describes how to read and parse (using XMLProcessor) configuration
- * data for a neural network.
+ * data for a neural network, or how to load it from its binary format.
  */
 
 #ifndef CONFIG_NETWORK_H
@@ -20,14 +20,26 @@
 namespace config {
 
   /**
-   * Implements an interface to read data from XML configuration files
+   * Implements an interface to read data from XML configuration files.
+   *
+   * Networks can also be kept in a binary format, which is much faster to
+   * write and read back, because there is no document to build, validate
+   * and parse: after a fixed size header and the header strings, every
+   * property of the neurons (identifier, type, activation function, bias,
+   * normalisation) and of the synapses (identifier, ends, strategy,
+   * weight, strategy parameters and state) is stored as one array, in the
+   * order of the configuration. It holds the same information as the XML
+   * format and files are converted both ways by loading and saving them.
+   * Numbers are stored with the byte order of the program that wrote the
+   * file, which is checked at loading.
    */
   class Network {
     
   public: //< interface
 
     /**
-     * Builds a new interface from a configuration file
+     * Builds a new interface from a configuration file, in the XML or in the
+     * binary format, which is told by the start of the file
      *
      * @param filename The name of the file to parse with the configuration
      * @param reporter The reporter to give to the configuration system
@@ -68,7 +80,9 @@ namespace config {
     inline const std::vector<Neuron*>& neurons() const { return m_neuron; }
 
     /**
-     * Saves the configuration that represents this network.
+     * Saves the configuration that represents this network. It is saved in
+     * the binary format if the file name ends in <code>.bin</code>, and in
+     * XML otherwise.
      *
      * @param filename The name of the file where to save this network
      * configuration.
@@ -83,6 +97,24 @@ namespace config {
      */
     bool dot (const std::string& filename);
 
+  private: //binary format
+
+    /**
+     * Loads the header, neurons and synapses from a file in the binary
+     * format
+     *
+     * @param filename The name of the file to load
+     */
+    void load_binary (const std::string& filename);
+
+    /**
+     * Saves the configuration in the binary format
+     *
+     * @param filename The name of the file where to save this network
+     * configuration.
+     */
+    bool save_binary (const std::string& filename);
+
   private: //representation
 
     sys::Reporter* m_reporter; ///< if present, the reporter to use
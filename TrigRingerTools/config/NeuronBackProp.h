@@ -26,6 +26,13 @@ namespace config {
     
     typedef enum ActivationFunction ActivationFunction;
 
+  public: //how close to the C library tanh() and exp() activations must be
+    enum Accuracy { EXACT=0, ///< computed by the C library
+		    FINE=1, ///< within 1e-7 of the C library
+		    COARSE=2}; ///< within 1e-4 of the C library
+
+    typedef enum Accuracy Accuracy;
+
   public: //interface
     
     /**
@@ -39,8 +46,10 @@ namespace config {
      * How to start up from simple values
      *
      * @param af The activation function to use
+     * @param accuracy How accurately the activation function is computed
      */
-    NeuronBackProp(const ActivationFunction& af);
+    NeuronBackProp(const ActivationFunction& af,
+		   const Accuracy& accuracy=EXACT);
 
     /**
      * Copies these parameters in construction
@@ -66,6 +75,11 @@ namespace config {
      */
     const ActivationFunction& activation_function() const { return m_af; }
 
+    /**
+     * Returns how accurately the activation function is computed
+     */
+    const Accuracy& accuracy() const { return m_accuracy; }
+
     /**
      * Clones this object
      */
@@ -82,6 +96,7 @@ namespace config {
   private: //representation
 
     ActivationFunction m_af; ///< my activation function
+    Accuracy m_accuracy; ///< how accurately my activation is computed
 
   };
 
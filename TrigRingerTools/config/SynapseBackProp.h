@@ -35,10 +35,13 @@ namespace config {
      * @param momentum The optional value to give for the momentum
      * @param learning_rate_decay The optional value to express how learning
      * decays with the iterations. 
+     * @param previous_delta The optional weight change of the last training
+     * step, which the momentum carries over to the next one
      */
     SynapseBackProp(const double& learning_rate,
 		    const double& momentum=0,
-		    const double& learning_rate_decay=0);
+		    const double& learning_rate_decay=0,
+		    const double& previous_delta=0);
 
     /**
      * How to copy (construct) this set of parameters
@@ -74,6 +77,11 @@ namespace config {
      */
     double learning_rate_decay() const { return m_learn_rate_decay; }
 
+    /**
+     * Returns the weight change of the last training step
+     */
+    double previous_delta() const { return m_prev_delta; }
+
     /**
      * Clones this object
      */
@@ -92,6 +100,7 @@ namespace config {
     double m_learn_rate; ///< my learning rate
     double m_momentum; ///< my momentum
     double m_learn_rate_decay; ///< my learning rate decay
+    double m_prev_delta; ///< the last weight change, if training started
 
   };
 
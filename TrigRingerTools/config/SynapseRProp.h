@@ -33,8 +33,13 @@ namespace config {
      *
      * @param weight_update The value to be used as a start up weight
      * update. Normally should start at 0.1
+     * @param previous_delta The weight change of the last training step
+     * @param previous_derivative The error derivative of the last training
+     * step, whose sign tells if the weight update grows or shrinks
      */
-    SynapseRProp(const double& weight_update=0.1);
+    SynapseRProp(const double& weight_update=0.1,
+		 const double& previous_delta=0,
+		 const double& previous_derivative=0);
 
     /**
      * How to copy (construct) this set of parameters
@@ -60,6 +65,16 @@ namespace config {
      */
     double weight_update() const { return m_weight_update; }
 
+    /**
+     * Returns the weight change of the last training step
+     */
+    double previous_delta() const { return m_prev_delta; }
+
+    /**
+     * Returns the error derivative of the last training step
+     */
+    double previous_derivative() const { return m_prev_deriv; }
+
     /**
      * Clones this object
      */
@@ -76,6 +91,8 @@ namespace config {
   private: //representation
 
     double m_weight_update; ///< my weight update
+    double m_prev_delta; ///< the last weight change, if training started
+    double m_prev_deriv; ///< the last derivative, if training started
 
   };
 
@@ -0,0 +1,149 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/BalancedSampler.h
+ *
+ * @brief Declares a class-balanced, index based, pattern sampler.
+ */
+
+#ifndef DATA_BALANCEDSAMPLER_H
+#define DATA_BALANCEDSAMPLER_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include "TrigRingerTools/data/Database.h"
+#include "TrigRingerTools/data/RandomInteger.h"
+
+namespace data {
+
+  /**
+   * Draws class-balanced samples out of a merged Database.
+   *
+   * When a Database is merged with Database::merge(), the Pattern's of
+   * every class are concatenated, class after class, in a single
+   * PatternSet. This sampler remembers where each class starts and how many
+   * Pattern's it has in such a merged set and draws <b>positions</b> from
+   * it so that every class contributes with the same number of Pattern's to
+   * each sample, whatever its real size. This replaces the physical
+   * oversampling done by Database::normalise(), since the stored data is
+   * never duplicated.
+   */
+  class BalancedSampler {
+
+  public:
+
+    /**
+     * Builds a sampler for the set that will result of merging the given
+     * Database with Database::merge().
+     *
+     * @param db The database that will be sampled
+     */
+    template <class TSet>
+    BalancedSampler (const data::Database<TSet>& db);
+
+    /**
+     * Builds a sampler from the sizes of each class, in the order they are
+     * concatenated in the set to be sampled.
+     *
+     * @param class_size The number of Pattern's in each class
+     */
+    BalancedSampler (const std::vector<size_t>& class_size);
+
+    /**
+     * Builds a sampler from explicit lists of positions, one list per
+     * class. This is useful to sample only part of a merged set, like the
+     * training part of a data::KFold fold.
+     *
+     * @param class_index The positions of the Pattern's of each class
+     */
+    BalancedSampler (const std::vector<std::vector<size_t> >& class_index);
+
+    /**
+     * Destructor virtualisation
+     */
+    virtual ~BalancedSampler() {}
+
+    /**
+     * Returns the number of classes this sampler balances
+     */
+    inline size_t classes (void) const { return m_size.size(); }
+
+    /**
+     * Returns the total number of Pattern's being sampled
+     */
+    inline size_t size (void) const { return m_total; }
+
+    /**
+     * Returns the number of Pattern's in a certain class
+     *
+     * @param c The class index, in merging order
+     */
+    inline size_t class_size (const size_t& c) const { return m_size[c]; }
+
+
+    /**
+     * Fills the given container with positions drawn at random, with
+     * replacement, from the merged set. Classes are visited in turns, from
+     * a class chosen at random, so each one contributes with the same
+     * number of positions (up to one, if the container size is not a
+     * multiple of the number of classes). The number of draws is the size
+     * of the container. This uses the sampler's own generator, so the same
+     * sampler should not be drawn like this from several threads.
+     *
+     * @param pats The container where to put the positions drawn
+     */
+    void draw (std::vector<size_t>& pats) const;
+
+    /**
+     * Draws positions like above, from the given generator. The sampler
+     * itself is not changed, so use this with one generator stream per
+     * thread or epoch to sample reproducibly in parallel.
+     *
+     * @param pats The container where to put the positions drawn
+     * @param rnd The generator to draw from
+     */
+    void draw (std::vector<size_t>& pats,
+	       const data::RandomInteger& rnd) const;
+
+    /**
+     * Returns, for every Pattern in the merged set, the weight that makes
+     * each class count the same in a weighted average. The weights sum up
+     * to 1. Positions not being sampled get a null weight.
+     *
+     * @param w The container where to put the weights
+     */
+    void weights (std::vector<double>& w) const;
+
+  private: //representation
+
+    std::vector<size_t> m_start; ///< where each class starts
+    std::vector<size_t> m_size; ///< how many Pattern's each class has
+    std::vector<std::vector<size_t> > m_index; ///< explicit positions, if any
+    size_t m_total; ///< the total number of Pattern's
+    data::RandomInteger m_rnd; ///< my own generator, for draw(pats)
+
+  };
+
+}
+
+template <class TSet>
+data::BalancedSampler::BalancedSampler (const data::Database<TSet>& db)
+  : m_start(),
+    m_size(),
+    m_index(),
+    m_total(0),
+    m_rnd(data::RandomInteger::next_stream())
+{
+  for (typename std::map<std::string, TSet*>::const_iterator
+	 it = db.data().begin(); it != db.data().end(); ++it) {
+    m_start.push_back(m_total);
+    m_size.push_back(it->second->size());
+    m_total += it->second->size();
+    RINGER_DEBUG2("Balanced sampler class \"" << it->first << "\" starts at "
+		  << m_start.back() << " and has " << m_size.back()
+		  << " patterns.");
+  }
+}
+
+#endif /* DATA_BALANCEDSAMPLER_H */
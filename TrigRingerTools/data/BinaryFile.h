@@ -0,0 +1,155 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/BinaryFile.h
+ *
+ * @brief Declares the memory-mapped binary database file.
+ */
+
+#ifndef DATA_BINARYFILE_H
+#define DATA_BINARYFILE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "TrigRingerTools/data/Feature.h"
+#include "TrigRingerTools/data/Header.h"
+#include "TrigRingerTools/data/PatternSet.h"
+#include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/sys/Reporter.h"
+
+namespace data {
+
+  /**
+   * The RoI attributes of an entry, as stored in a binary database file.
+   */
+  typedef struct BinaryAttribute {
+    uint32_t lvl1_id; ///< The LVL1 Trigger global event identifier
+    uint32_t roi_id; ///< The LVL1 Trigger RoI identifier at this event
+    double eta; ///< The center of the RoI in eta
+    double phi; ///< The center of the RoI in phi
+  } BinaryAttribute;
+
+  /**
+   * Describes where a class lives inside a mapped binary database file. This
+   * is what the PatternSet's are built from, the same way they are built
+   * from a RootClassInfo with ROOT files.
+   */
+  typedef struct BinaryClassInfo {
+    std::string name; ///< The class name
+    data::Feature* data; ///< The features, row-major, inside the mapping
+    const BinaryAttribute* attr; ///< The attributes of each entry, or 0
+    size_t size; ///< The number of entries in the class
+    size_t pattern_size; ///< The number of features in each entry
+  } BinaryClassInfo;
+
+  /**
+   * A binary database file, opened with <code>mmap()</code>.
+   *
+   * The file contains a fixed size header, a table with one entry per
+   * class, a table of strings (header fields and class names), a 64-byte
+   * aligned block with the row-major features of every class, one class
+   * after the other in name order, and, optionally, an aligned block with
+   * the BinaryAttribute's of every class, in the same order. Since this is
+   * the order in which Database::merge() concatenates the classes, the
+   * whole merged set can be read in place too, see merged(). Everything is stored with
+   * the byte order and the Feature precision of the program that wrote the
+   * file, which are checked at opening: a file written with double's can
+   * only be mapped by a program built with double's too.
+   *
+   * The mapping is private and writable, so the PatternSet's built on top
+   * of it can be changed without affecting the file: only the pages touched
+   * get copied. Untouched pages are shared with every other process mapping
+   * the same file through the page cache.
+   */
+  class BinaryFile {
+
+  public:
+
+    /**
+     * Maps a binary database file in memory and checks its structure
+     *
+     * @param filename The name of the file to map
+     * @param reporter The reporter to inform about problems
+     */
+    BinaryFile (const std::string& filename, sys::Reporter* reporter);
+
+    /**
+     * Unmaps the file. PatternSet's built on top of it should be gone by
+     * then.
+     */
+    virtual ~BinaryFile();
+
+    /**
+     * Returns the database header found in the file
+     */
+    inline const data::Header* header (void) const { return m_header; }
+
+    /**
+     * Returns the number of classes in the file
+     */
+    inline size_t classes (void) const { return m_class.size(); }
+
+    /**
+     * Returns where a class lives inside the mapping
+     *
+     * @param c The class index, in file order
+     */
+    inline const BinaryClassInfo& info (const size_t& c) const
+    { return m_class[c]; }
+
+    /**
+     * Describes all classes as a single one, as Database::merge() would
+     * concatenate them. This only works if the classes are stored one after
+     * the other, in name order, like write() stores them.
+     *
+     * @param info Where to put the description of the merged classes
+     *
+     * @return <code>true</code> if the classes could be merged in place.
+     */
+    bool merged (BinaryClassInfo& info) const;
+
+    /**
+     * Tells if a file starts like a binary database file
+     *
+     * @param filename The name of the file to check
+     */
+    static bool is_binary (const std::string& filename);
+
+    /**
+     * Writes a binary database file.
+     *
+     * @param filename The name of the file to write
+     * @param header The database header
+     * @param name The name of every class
+     * @param set The PatternSet of every class
+     * @param attr The attributes of every class, or 0 for classes without
+     * attributes
+     *
+     * @return <code>true</code> if the file was written successfuly.
+     */
+    static bool write (const std::string& filename,
+		       const data::Header* header,
+		       const std::vector<std::string>& name,
+		       const std::vector<const data::PatternSet*>& set,
+		       const std::vector<const std::vector<data::RoIPatternSet::RoIAttribute>*>& attr);
+
+  private: //not allowed
+
+    BinaryFile (const BinaryFile& other);
+    BinaryFile& operator= (const BinaryFile& other);
+
+  private: //representation
+
+    std::string m_filename; ///< the mapped file
+    void* m_base; ///< where the file is mapped
+    size_t m_length; ///< the mapping length
+    data::Header* m_header; ///< the header read from the file
+    std::vector<BinaryClassInfo> m_class; ///< where each class is
+    sys::Reporter* m_reporter; ///< where to report problems
+
+  };
+
+}
+
+#endif /* DATA_BINARYFILE_H */
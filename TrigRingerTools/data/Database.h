@@ -124,6 +124,9 @@ namespace data {
      * process will calculate the number of Patterns in each class and will
      * concatenate each PatternSet (class) so each class has the same amount
      * of Pattern's.
+     *
+     * @warning This duplicates data physically. To balance classes during
+     * training without inflating the database, use a data::BalancedSampler.
      */
     void normalise (void);
 
@@ -0,0 +1,241 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/DatabaseBinary.h
+ *
+ * Loads a database from a binary file, by mapping it in memory. The
+ * PatternSet's of every class wrap the mapped features directly, so loading
+ * takes no time and several processes reading the same file share a single
+ * copy of it in the page cache. The classes are stored in the order
+ * merge() concatenates them, so the merged set is available in place as
+ * well, through merged(). See data::BinaryFile for the file layout.
+ */
+
+#ifndef DATA_DATABASEBINARY_H
+#define DATA_DATABASEBINARY_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "TrigRingerTools/data/Database.h"
+#include "TrigRingerTools/data/Header.h"
+#include "TrigRingerTools/data/BinaryFile.h"
+#include "TrigRingerTools/data/SimplePatternSet.h"
+#include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/sys/Reporter.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+
+namespace data {
+
+  /**
+   * Builds a new database from a binary file
+   */
+  template <class TSet> class DatabaseBinary : public Database<TSet> {
+
+  protected: //representation
+
+    data::BinaryFile* m_file; ///< The mapped file, if any
+    data::Header* m_header; ///< The header information for this database
+    TSet* m_merged; ///< All classes, wrapping the mapped file, if possible
+
+  public:
+
+    /**
+     * Builds an empty database
+     *
+     * @param reporter The reporter to give to the configuration system
+     */
+    DatabaseBinary (sys::Reporter *reporter);
+
+    /**
+     * Builds a new database by mapping a binary file
+     *
+     * @param filename The name of the binary file to map
+     * @param reporter The reporter to give to the configuration system
+     */
+    DatabaseBinary (const std::string& filename, sys::Reporter *reporter);
+
+    /**
+     * Builds a new database out of scratch parameters
+     *
+     * @param header This database header
+     * @param data The PatternSets for this database, classified
+     * @param reporter The reporter to give to the configuration system
+     */
+    DatabaseBinary (const data::Header* header,
+		    const std::map<std::string, TSet*>& data,
+		    sys::Reporter *reporter);
+
+    /**
+     * Destructor virtualisation. The PatternSet's are destroyed before the
+     * file is unmapped.
+     */
+    virtual ~DatabaseBinary();
+
+    /**
+     * Returns a class that represents the Header entity
+     */
+    inline const data::Header* header() const { return m_header; }
+
+    /**
+     * Returns the Pattern's of all classes, in the same order merge() would
+     * give them, but read in place from the mapped file. Returns 0 if the
+     * database was not read from a file, or if the file does not keep its
+     * classes in merging order.
+     */
+    inline const TSet* merged() const { return m_merged; }
+
+    /**
+     * Implements persistency functions.
+     */
+
+    bool read (const std::string& filename);
+    bool save (const std::string& filename);
+
+    /**
+     * Writes any set of classes as a binary database file, without copying
+     * them first. This is what save() uses.
+     *
+     * @param filename The name of the file to write
+     * @param header The database header
+     * @param data The PatternSets to write, classified
+     */
+    static bool write (const std::string& filename,
+		       const data::Header* header,
+		       const std::map<std::string, TSet*>& data);
+
+  private: //forbidden
+
+    /**
+     * Copy constructor
+     */
+    DatabaseBinary (const DatabaseBinary& other);
+
+    /**
+     * Assignment
+     */
+    DatabaseBinary& operator= (const DatabaseBinary& other);
+
+  };
+
+  /**
+   * Returns the attributes to save along a SimplePatternSet: none.
+   */
+  inline const std::vector<data::RoIPatternSet::RoIAttribute>*
+  binary_attributes (const data::SimplePatternSet&) { return 0; }
+
+  /**
+   * Returns the attributes to save along an RoIPatternSet
+   *
+   * @param set The set being saved
+   */
+  inline const std::vector<data::RoIPatternSet::RoIAttribute>*
+  binary_attributes (const data::RoIPatternSet& set)
+  { return &set.attributes(); }
+
+}
+
+//------------------------------
+// Template Implementation
+//------------------------------
+
+template <class TSet>
+data::DatabaseBinary<TSet>::DatabaseBinary (sys::Reporter *reporter)
+  : Database<TSet>(reporter),
+    m_file(0),
+    m_header(0),
+    m_merged(0)
+{
+}
+
+template <class TSet>
+data::DatabaseBinary<TSet>::DatabaseBinary (const std::string& filename,
+					    sys::Reporter *reporter)
+  : Database<TSet>(reporter),
+    m_file(0),
+    m_header(0),
+    m_merged(0)
+{
+  read(filename);
+}
+
+template <class TSet>
+data::DatabaseBinary<TSet>::DatabaseBinary
+(const data::Header* header, const std::map<std::string, TSet*>& data,
+ sys::Reporter *reporter)
+  : Database<TSet>(data, reporter),
+    m_file(0),
+    m_header(0),
+    m_merged(0)
+{
+  m_header = new data::Header(*header);
+}
+
+template <class TSet>
+data::DatabaseBinary<TSet>::~DatabaseBinary()
+{
+  for (typename std::map<std::string, TSet*>::const_iterator
+	 it = this->m_data.begin(); it != this->m_data.end(); ++it)
+    delete it->second;
+  this->m_data.clear();
+  delete m_merged;
+  delete m_header;
+  delete m_file;
+}
+
+template <class TSet>
+bool data::DatabaseBinary<TSet>::read (const std::string& filename)
+{
+  RINGER_DEBUG2("Trying to map " << filename);
+  m_file = new data::BinaryFile(filename, this->m_reporter);
+  m_header = new data::Header(*m_file->header());
+
+  //for all classes
+  for (size_t c=0; c<m_file->classes(); ++c) {
+    const data::BinaryClassInfo& info = m_file->info(c);
+    if (this->m_data.find(info.name) != this->m_data.end()) {
+      RINGER_DEBUG1("Error! Class name \"" << info.name << "\" already exists!"
+		    << " Exception thrown.");
+      throw RINGER_EXCEPTION("Repeated DB class names");
+    }
+    this->m_data[info.name] = new TSet(info);
+    RINGER_REPORT(this->m_reporter, "Database class \"" << info.name
+		  << "\" has " << this->m_data[info.name]->size()
+		  << " entries.");
+  }
+  if (this->m_data.size() != 0)
+    this->m_patsize = this->m_data.begin()->second->pattern_size();
+  data::BinaryClassInfo all;
+  if (m_file->merged(all)) m_merged = new TSet(all);
+
+  RINGER_DEBUG2("Database file \"" << filename << "\" has "
+		<< this->m_data.size() << " classes.");
+  return true;
+}
+
+template <class TSet>
+bool data::DatabaseBinary<TSet>::save (const std::string& filename)
+{
+  return write(filename, m_header, this->m_data);
+}
+
+template <class TSet>
+bool data::DatabaseBinary<TSet>::write
+(const std::string& filename, const data::Header* header,
+ const std::map<std::string, TSet*>& data)
+{
+  RINGER_DEBUG2("Trying to save binary database at \"" << filename << "\".");
+  std::vector<std::string> name;
+  std::vector<const data::PatternSet*> set;
+  std::vector<const std::vector<data::RoIPatternSet::RoIAttribute>*> attr;
+  for (typename std::map<std::string, TSet*>::const_iterator
+	 it = data.begin(); it != data.end(); ++it) {
+    name.push_back(it->first);
+    set.push_back(it->second);
+    attr.push_back(data::binary_attributes(*it->second));
+  }
+  return data::BinaryFile::write(filename, header, name, set, attr);
+}
+
+#endif /* DATA_DATABASEBINARY_H */
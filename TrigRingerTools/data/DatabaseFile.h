@@ -0,0 +1,139 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/DatabaseFile.h
+ *
+ * Opens and saves databases in either of the file formats, XML or binary,
+ * so programs can take both without caring which one they were given.
+ */
+
+#ifndef DATA_DATABASEFILE_H
+#define DATA_DATABASEFILE_H
+
+#include <string>
+#include <map>
+#include "TrigRingerTools/data/Database.h"
+#include "TrigRingerTools/data/DatabaseXml.h"
+#include "TrigRingerTools/data/DatabaseBinary.h"
+#include "TrigRingerTools/data/BinaryFile.h"
+#include "TrigRingerTools/data/Header.h"
+#include "TrigRingerTools/sys/Reporter.h"
+#include "TrigRingerTools/sys/debug.h"
+
+namespace data {
+
+  /**
+   * Opens a database file, mapping it with a DatabaseBinary if it starts
+   * like a binary database file, or reading it with a DatabaseXml
+   * otherwise. The caller owns the returned database.
+   *
+   * @param filename The name of the database file
+   * @param reporter The reporter to give to the database
+   */
+  template <class TSet>
+  data::Database<TSet>* open_database (const std::string& filename,
+				       sys::Reporter* reporter);
+
+  /**
+   * Returns the header of a database opened with open_database(), or 0 if
+   * it is neither a DatabaseXml nor a DatabaseBinary.
+   *
+   * @param db The database
+   */
+  template <class TSet>
+  const data::Header* database_header (const data::Database<TSet>& db);
+
+  /**
+   * Tells if a database should be saved in the binary format, by its name
+   *
+   * @param filename The name of the file to save
+   */
+  inline bool binary_name (const std::string& filename)
+  {
+    return filename.size() > 4 &&
+      filename.compare(filename.size()-4, 4, ".bin") == 0;
+  }
+
+  /**
+   * Writes a set of classes as a database file, in the binary format if
+   * the file name ends in ".bin" and as XML otherwise.
+   *
+   * @param filename The name of the file to write
+   * @param header The database header
+   * @param data The PatternSets to write, classified
+   * @param reporter The reporter to inform about problems
+   *
+   * @return <code>true</code> if the file was written successfuly.
+   */
+  template <class TSet>
+  bool save_database (const std::string& filename,
+		      const data::Header* header,
+		      const std::map<std::string, TSet*>& data,
+		      sys::Reporter* reporter);
+
+  /**
+   * Returns the Pattern's of every class of a database, concatenated in
+   * the order of Database::merge(). A binary database is read in place,
+   * when it is laid out in that order, so nothing is copied. Any other
+   * database is merged into the given buffer, which is then returned.
+   *
+   * @param db The database
+   * @param buffer Where to merge the database, if it cannot be read in place
+   */
+  template <class TSet>
+  const TSet& merged (const data::Database<TSet>& db, TSet& buffer);
+
+}
+
+//------------------------------
+// Template Implementation
+//------------------------------
+
+template <class TSet>
+data::Database<TSet>* data::open_database (const std::string& filename,
+					   sys::Reporter* reporter)
+{
+  if (data::BinaryFile::is_binary(filename)) {
+    RINGER_DEBUG2("Database \"" << filename << "\" is binary.");
+    return new data::DatabaseBinary<TSet>(filename, reporter);
+  }
+  return new data::DatabaseXml<TSet>(filename, reporter);
+}
+
+template <class TSet>
+const data::Header* data::database_header (const data::Database<TSet>& db)
+{
+  const data::DatabaseBinary<TSet>* bin =
+    dynamic_cast<const data::DatabaseBinary<TSet>*>(&db);
+  if (bin) return bin->header();
+  const data::DatabaseXml<TSet>* xml =
+    dynamic_cast<const data::DatabaseXml<TSet>*>(&db);
+  if (xml) return xml->header();
+  return 0;
+}
+
+template <class TSet>
+bool data::save_database (const std::string& filename,
+			  const data::Header* header,
+			  const std::map<std::string, TSet*>& data,
+			  sys::Reporter* reporter)
+{
+  if (data::binary_name(filename))
+    return data::DatabaseBinary<TSet>::write(filename, header, data);
+  return data::DatabaseXml<TSet>::write(filename, header, data, reporter);
+}
+
+template <class TSet>
+const TSet& data::merged (const data::Database<TSet>& db, TSet& buffer)
+{
+  const data::DatabaseBinary<TSet>* bin =
+    dynamic_cast<const data::DatabaseBinary<TSet>*>(&db);
+  if (bin && bin->merged()) {
+    RINGER_DEBUG2("Reading the merged database in place.");
+    return *bin->merged();
+  }
+  db.merge(buffer);
+  return buffer;
+}
+
+#endif /* DATA_DATABASEFILE_H */
@@ -24,6 +24,8 @@
 #include "TrigRingerTools/sys/XMLProcessor.h"
 #include "TrigRingerTools/data/Ensemble.h"
 #include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/data/XmlStreamReader.h"
+#include "TrigRingerTools/data/XmlStreamWriter.h"
 #include <cmath>
 
 namespace data {
@@ -89,6 +91,20 @@ namespace data {
     bool read (const std::string& filename);
     bool save (const std::string& filename);
 
+    /**
+     * Writes any set of classes as an XML database file, without copying
+     * them in a DatabaseXml first. This is what save() uses.
+     *
+     * @param filename The name of the file to write
+     * @param header The database header
+     * @param data The PatternSets to write, classified
+     * @param reporter The reporter to inform about problems
+     */
+    static bool write (const std::string& filename,
+		       const data::Header* header,
+		       const std::map<std::string, TSet*>& data,
+		       sys::Reporter* reporter);
+
   private: //forbidden
 
     /**
@@ -156,8 +172,29 @@ data::DatabaseXml<TSet>::~DatabaseXml()
 
 template <class TSet>
 bool data::DatabaseXml<TSet>::save (const std::string& filename)
+{
+  return write(filename, m_header, this->m_data, this->m_reporter);
+}
+
+template <class TSet>
+bool data::DatabaseXml<TSet>::write (const std::string& filename,
+				     const data::Header* header,
+				     const std::map<std::string, TSet*>& data,
+				     sys::Reporter* reporter)
 {
   RINGER_DEBUG2("Trying to save database at \"" << filename << "\".");
+#ifndef XERCES_XML_BACK_END
+  //streams class by class, so the DOM tree of the data is never built
+  data::XmlStreamWriter writer(filename, *header, reporter);
+  size_t index = 0;
+  for (typename std::map<std::string, TSet*>::const_iterator
+	 it = data.begin(); it != data.end(); ++it) {
+    RINGER_DEBUG2("Streaming class \"" << it->first << "\".");
+    it->second->dump(writer, it->first, index);
+    index += it->second->size();
+  }
+  return writer.close();
+#else
   std::string schema = sys::getenv("DATAPATH");
   if (schema.length() == 0) {
     RINGER_DEBUG1("I cannot find the standard schema path. Have you set"
@@ -171,23 +208,24 @@ bool data::DatabaseXml<TSet>::save (const std::string& filename)
     throw RINGER_EXCEPTION("Schema file database.xsd not found in DATAPATH!");
   }
 
-  sys::XMLProcessor xmlproc(schema, this->m_reporter);
+  sys::XMLProcessor xmlproc(schema, reporter);
   sys::xml_ptr root = xmlproc.new_document("database");
   sys::put_attribute_text(root, "version", "0.1");
-  sys::put_node(root, this->m_header->node(root));
-  sys::xml_ptr data = sys::put_element(root, "data");
+  sys::put_node(root, header->node(root));
+  sys::xml_ptr xml_data = sys::put_element(root, "data");
   size_t index = 0;
   for (typename std::map<std::string, TSet*>::const_iterator
-	 it = this->m_data.begin(); it != this->m_data.end(); ++it) {
+	 it = data.begin(); it != data.end(); ++it) {
     RINGER_DEBUG2("XML'ing class \"" << it->first << "\".");
-    sys::put_node(data, it->second->dump(root, it->first, index));
+    sys::put_node(xml_data, it->second->dump(root, it->first, index));
     index += it->second->size();
   }
-  sys::put_node(root, data);
+  sys::put_node(root, xml_data);
   RINGER_DEBUG2("Finally saving file...");
   if (!xmlproc.write(root, filename)) return false;
   RINGER_DEBUG2("File \"" << filename << "\" was saved.");
   return true;
+#endif /* XERCES_XML_BACK_END */
 }
 
 template <class TSet>
@@ -206,6 +244,26 @@ bool data::DatabaseXml<TSet>::read (const std::string& filename)
     throw RINGER_EXCEPTION("Schema file database.xsd not found in DATAPATH!");
   }
 
+#ifndef XERCES_XML_BACK_END
+  //streams the file, so the DOM tree of the data is never built
+  RINGER_DEBUG2("Trying to stream " << filename);
+  data::XmlStreamReader reader(filename, schema, this->m_reporter);
+  this->m_header = reader.header();
+
+  //for all classes
+  std::string name;
+  while (reader.next_class(name)) {
+    if (this->m_data.find(name) != this->m_data.end()) {
+      RINGER_DEBUG1("Error! Class name \"" << name << "\" already exists!"
+		    << " Exception thrown.");
+      throw RINGER_EXCEPTION("Repeated DB class names");
+    }
+    RINGER_REPORT(this->m_reporter, "Loading entries for class \"" << name << "\".");
+    this->m_data[name] = new TSet(reader);
+    RINGER_REPORT(this->m_reporter, "Database class \"" << name << "\" has "
+		  << this->m_data[name]->size() << " entries.");
+  }
+#else
   sys::XMLProcessor xmlproc(schema, this->m_reporter);
 
   RINGER_DEBUG2("Trying to parse " << filename);
@@ -239,6 +297,7 @@ bool data::DatabaseXml<TSet>::read (const std::string& filename)
     RINGER_REPORT(this->m_reporter, "Database class \"" << name << "\" has "
 		  << this->m_data[name]->size() << " entries.");
   }
+#endif /* XERCES_XML_BACK_END */
 
   //check pattern sizes (not a simple way to do it with libxml2 as 2.6.16...
   if (this->m_data.size() != 0) {
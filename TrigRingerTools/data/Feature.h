@@ -19,9 +19,18 @@ namespace data {
    * <i>real</i> value. A <i>Feature</i> number meets all these
    * requirements.
    *
+   * Features are double's by default. Building with
+   * <code>RINGER_SINGLE_PRECISION</code> defined makes them float's, which
+   * halves the memory taken by databases and networks. Sums over many
+   * Feature's should still be accumulated in a double.
+   *
    * @see Pattern
    */
+#ifdef RINGER_SINGLE_PRECISION
+  typedef float Feature;
+#else
   typedef double Feature;
+#endif
 
 }
 
@@ -38,7 +38,7 @@ namespace data {
      * @param p The vector to abuse
      * @return The internal representation of the Pattern
      */
-    inline const gsl_vector* abuse(const data::Pattern& p) const 
+    inline const data::FeatureVector* abuse(const data::Pattern& p) const 
     { return p.m_vector; }
 
   };
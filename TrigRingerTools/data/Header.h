@@ -67,7 +67,7 @@ namespace data {
      *
      * @param any Any node in the XML tree.
      */
-    sys::xml_ptr node (sys::xml_ptr any);
+    sys::xml_ptr node (sys::xml_ptr any) const;
 
     /**
      * Returns stuff for this node
@@ -0,0 +1,125 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/KFold.h
+ *
+ * @brief Declares a stratified k-fold splitter based on pattern positions.
+ */
+
+#ifndef DATA_KFOLD_H
+#define DATA_KFOLD_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include "TrigRingerTools/data/Database.h"
+#include "TrigRingerTools/data/BalancedSampler.h"
+
+namespace data {
+
+  /**
+   * Splits a merged Database in <i>k</i> folds for cross-validation.
+   *
+   * Contrary to Database::split(), no data is copied: each fold is just a
+   * list of positions inside the set produced by Database::merge() (and the
+   * targets produced by Database::merge_target()). The split is stratified,
+   * i.e., every class is distributed evenly among the folds. For fold
+   * <i>f</i>, the test part is fold <i>f</i> itself and the training part is
+   * made of all other folds.
+   */
+  class KFold {
+
+  public:
+
+    /**
+     * Builds the folds for the set that will result of merging the given
+     * Database with Database::merge().
+     *
+     * @param db The database that will be split
+     * @param k The number of folds, at least 2
+     * @param shuffle If the positions of each class should be shuffled
+     * before distributing them among the folds
+     */
+    template <class TSet>
+    KFold (const data::Database<TSet>& db, const size_t k,
+	   const bool shuffle=true);
+
+    /**
+     * Builds the folds from the sizes of each class, in the order they are
+     * concatenated in the set to be split.
+     *
+     * @param class_size The number of Pattern's in each class
+     * @param k The number of folds, at least 2
+     * @param shuffle If the positions of each class should be shuffled
+     * before distributing them among the folds
+     */
+    KFold (const std::vector<size_t>& class_size, const size_t k,
+	   const bool shuffle=true);
+
+    /**
+     * Destructor virtualisation
+     */
+    virtual ~KFold() {}
+
+    /**
+     * Returns the number of folds
+     */
+    inline size_t folds (void) const { return m_fold.size(); }
+
+    /**
+     * Returns the positions of the testing Pattern's for a fold
+     *
+     * @param f The fold number, starting from zero
+     * @param pats The container where to put the positions
+     */
+    void test (const size_t f, std::vector<size_t>& pats) const;
+
+    /**
+     * Returns the positions of the training Pattern's for a fold
+     *
+     * @param f The fold number, starting from zero
+     * @param pats The container where to put the positions
+     */
+    void train (const size_t f, std::vector<size_t>& pats) const;
+
+    /**
+     * Returns a class-balanced sampler over the training Pattern's of a fold
+     *
+     * @param f The fold number, starting from zero
+     */
+    data::BalancedSampler sampler (const size_t f) const;
+
+  private: //helpers
+
+    /**
+     * Distributes the positions of each class among the folds
+     *
+     * @param class_size The number of Pattern's in each class
+     * @param k The number of folds
+     * @param shuffle If the positions of each class should be shuffled
+     */
+    void build (const std::vector<size_t>& class_size, const size_t k,
+		const bool shuffle);
+
+  private: //representation
+
+    ///positions of each class (inner index) for each fold (outer index)
+    std::vector<std::vector<std::vector<size_t> > > m_fold;
+
+  };
+
+}
+
+template <class TSet>
+data::KFold::KFold (const data::Database<TSet>& db, const size_t k,
+		    const bool shuffle)
+  : m_fold()
+{
+  std::vector<size_t> class_size;
+  for (typename std::map<std::string, TSet*>::const_iterator
+	 it = db.data().begin(); it != db.data().end(); ++it)
+    class_size.push_back(it->second->size());
+  build(class_size, k, shuffle);
+}
+
+#endif /* DATA_KFOLD_H */
@@ -11,9 +11,11 @@
 
 #include "TrigRingerTools/data/PatternOperator.h"
 #include "TrigRingerTools/data/Database.h"
+#include "TrigRingerTools/data/StatsExtractor.h"
 #include "TrigRingerTools/sys/debug.h"
-#include <gsl/gsl_vector.h>
-#include <cmath>
+#include <vector>
+#include <map>
+#include <string>
 
 namespace data {
 
@@ -57,13 +59,16 @@ template <class TSet>
 data::NormaliseOperator::NormaliseOperator(const data::Database<TSet>& db)
   : m_max(db.pattern_size(),0)
 {
-  TSet ps(1,1);
-  db.merge(ps);
-  for (unsigned int i=0; i<ps.pattern_size(); ++i) { //for all ensembles
-    data::Ensemble e = ps.ensemble(i);
-    m_max[i] = fabs(gsl_vector_max(abuse(e)));
-    data::Feature min = fabs(gsl_vector_min(abuse(e)));
-    if (min > m_max[i]) m_max[i] = min;
+  //accumulates class by class, without concatenating the database
+  std::vector<data::StatsExtractor> all(db.pattern_size());
+  std::vector<data::StatsExtractor> stats;
+  for (typename std::map<std::string, TSet*>::const_iterator
+	 it=db.data().begin(); it!=db.data().end(); ++it) {
+    data::StatsExtractor::ensembles(*it->second, stats);
+    for (unsigned int i=0; i<all.size(); ++i) all[i].merge(stats[i]);
+  }
+  for (unsigned int i=0; i<all.size(); ++i) { //for all ensembles
+    m_max[i] = all[i].absmax();
     RINGER_DEBUG3("Database absolute maximum for ensemble[" 
 		<< i << "] is " << m_max[i]);
   }
@@ -11,8 +11,12 @@
 
 #include "TrigRingerTools/data/PatternOperator.h"
 #include "TrigRingerTools/data/Database.h"
+#include "TrigRingerTools/data/StatsExtractor.h"
 #include "TrigRingerTools/sys/debug.h"
-#include <gsl/gsl_statistics_double.h>
+#include "TrigRingerTools/data/gsl_feature.h"
+#include <vector>
+#include <map>
+#include <string>
 
 namespace data {
 
@@ -25,9 +29,33 @@ namespace data {
      * have to compute first the mean for all classes in a DB.
      *
      * @param db The database to extract the ensemble mean from
+     * @param balanced If <code>true</code>, every class in the database
+     * will count the same towards the mean and standard deviation, whatever
+     * its size. This is equivalent to computing them after
+     * Database::normalise(), without having to duplicate any data.
+     * @param nthreads How many threads to use when accumulating each class.
+     *
+     * The statistics are accumulated class by class, straight from the
+     * database storage, and then merged. The database is never concatenated
+     * into a single set.
      */
     template <class TSet>
-    NormalizationOperator(const data::Database<TSet>& db);
+    NormalizationOperator(const data::Database<TSet>& db,
+			  const bool balanced=false,
+			  const unsigned int nthreads=1);
+
+    /**
+     * Constructor. Computes the weighted mean and standard deviation of each
+     * ensemble in the given set. Pattern's with a null weight are not taken
+     * into consideration, what allows computing the normalisation for part
+     * of a set only, e.g. the training positions of a data::KFold fold.
+     *
+     * @param ps The set to extract the ensemble mean from
+     * @param w The weight of every Pattern in the set. If the container is
+     * shorter than the set, the remaining Pattern's get a null weight.
+     */
+    NormalizationOperator(const data::PatternSet& ps,
+			  const std::vector<double>& w);
 
     /**
      * Destructor virtualisation
@@ -55,6 +83,19 @@ namespace data {
      */
     inline const data::Pattern& stddev (void) const { return m_sd; }
 
+  private: //helpers
+
+    /**
+     * Sets the mean and standard deviation of every ensemble from the
+     * statistics of every class.
+     *
+     * @param stats The ensemble statistics of every class
+     * @param balanced If every class should count the same, whatever its
+     * size
+     */
+    void set (const std::vector<std::vector<data::StatsExtractor> >& stats,
+	      const bool balanced);
+
   private: //representation
 
     data::Pattern m_mean; ///< The mean for the DB in question
@@ -65,22 +106,17 @@ namespace data {
 }
 
 template <class TSet> data::NormalizationOperator::NormalizationOperator
-(const data::Database<TSet>& db)
+(const data::Database<TSet>& db, const bool balanced,
+ const unsigned int nthreads)
   : m_mean(db.pattern_size(),0),
     m_sd(db.pattern_size(),1)
 {
-  TSet ps(1,1);
-  db.merge(ps);
-  for (unsigned int i=0; i<ps.pattern_size(); ++i) { //for all ensembles
-    data::Ensemble e = ps.ensemble(i);
-    const gsl_vector* v = abuse(e);
-    m_mean[i] = gsl_stats_mean(v->data, v->stride, v->size);
-    m_sd[i] = gsl_stats_sd(v->data, v->stride, v->size);
-    if (m_sd[i] < 1e-5) m_sd[i] = 1; ///to prevent overflowing...
-    RINGER_DEBUG1("Database mean for ensemble[" << i << "] is " << m_mean[i]);
-    RINGER_DEBUG1("Database standard deviation for ensemble[" << i 
-		  << "] is " << m_sd[i]);
-  }
+  std::vector<std::vector<data::StatsExtractor> > stats(db.size());
+  size_t k = 0;
+  for (typename std::map<std::string, TSet*>::const_iterator
+	 it=db.data().begin(); it!=db.data().end(); ++it, ++k)
+    data::StatsExtractor::ensembles(*it->second, stats[k], nthreads);
+  set(stats, balanced);
 }
 
 #endif /* DATA_NORMALIZATIONOPERATOR_H */
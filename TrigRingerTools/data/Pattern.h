@@ -11,7 +11,7 @@
 
 #include "TrigRingerTools/data/Feature.h"
 #include <vector>
-#include <gsl/gsl_vector.h>
+#include "TrigRingerTools/data/gsl_feature.h"
 #include <iostream>
 #include "TrigRingerTools/sys/File.h"
 #include "TrigRingerTools/sys/Plain.h"
@@ -28,6 +28,7 @@ namespace data {
   class SimplePatternSet; ///< forward
   class PatternOperator; ///< forward
   class FeatureExtractor; ///< forward
+  class PatternArena; ///< forward
   
   /**
    * The Pattern is defined in terms of Feature's.
@@ -39,7 +40,10 @@ namespace data {
    * implementation relies on GSL matrix views of a data set.
    *
    * If a Pattern is created from a set of Feature's, a new block of data is
-   * allocated.
+   * allocated, unless the Pattern is small enough to fit the buffer every
+   * Pattern carries inside itself. Those, like the single Feature
+   * Ensemble's passed between neurons, never touch the heap. Larger
+   * temporaries can take their memory from a PatternArena instead.
    *
    * @see Feature
    * @see PatternSet
@@ -67,6 +71,17 @@ namespace data {
      */
     Pattern(const std::vector<Feature>& feat);
 
+    /**
+     * Contructs a Pattern with all the same entries, taking its memory from
+     * an arena if it does not fit my internal buffer. The Pattern must not
+     * outlive the arena, nor its next PatternArena::reset().
+     *
+     * @param s The number of Feature's in the Pattern
+     * @param arena Where to take the memory from
+     * @param v The value of each Feature in the Pattern
+     */
+    Pattern (const size_t& s, data::PatternArena& arena, const Feature v=0);
+
     /**
      * Constructs a Pattern from other Pattern (copy).
      *
@@ -304,7 +319,30 @@ namespace data {
     const Feature& operator[] (const size_t& pos) const;
 
     /**
-     * Appends the contents of the given Pattern to myself
+     * Returns a pointer to the first Feature of this Pattern, without any
+     * range checking. Consecutive Feature's are stride() positions apart in
+     * memory. This is meant for tight loops that would otherwise pay a range
+     * check per access through operator[].
+     */
+    inline const Feature* data (void) const { return m_vector->data; }
+
+    /**
+     * Returns a pointer to the first Feature of this Pattern, for changing
+     * it, with the same layout as above.
+     */
+    inline Feature* data (void) { return m_vector->data; }
+
+    /**
+     * Returns the distance, in Feature's, between two consecutive elements
+     * of this Pattern in memory. Patterns taken from a PatternSet have a
+     * stride of 1, Ensembles usually not.
+     */
+    inline size_t stride (void) const { return m_vector->stride; }
+
+    /**
+     * Appends the contents of the given Pattern to myself. Only a Pattern
+     * that owns its storage can grow: appending to a view of a PatternSet
+     * or of an arena throws.
      *
      * @param other The other Pattern to append to myself
      */
@@ -321,17 +359,46 @@ namespace data {
      *
      * @param vector_view The vector view to use as construction parameter
      */
-    Pattern (gsl_vector_view vector_view);
+    Pattern (data::FeatureVectorView vector_view);
 
     /**
      * My private friend
      */
     friend class data::SimplePatternSet;
 
+  private: //storage management
+
+    /**
+     * Points my vector to new memory for the given number of Feature's,
+     * inside myself if they fit, on the heap otherwise. The current memory
+     * should have been release()'d before.
+     *
+     * @param s The number of Feature's
+     */
+    void allocate (const size_t& s);
+
+    /**
+     * Frees my memory if it was allocated on the heap
+     */
+    void release (void);
+
+    /**
+     * Tells if my memory belongs to me, i.e., if I'm not a view nor built
+     * from an arena
+     */
+    bool owns_storage (void) const;
+
   private:
-    gsl_vector_view m_view; ///< an optional view that might be set
-    gsl_vector* m_vector; ///< the vector component of the "view"
-  	gsl_vector m_static_vector; ///< the vector that will be used in case a block of already allocated memory is passed.
+
+    /**
+     * How many Feature's fit inside a Pattern, without allocating memory
+     */
+    enum { INLINE_SIZE = 4 };
+
+    data::FeatureVectorView m_view; ///< an optional view that might be set
+    data::FeatureVector* m_vector; ///< the vector component of the "view"
+    data::FeatureVector m_static_vector; ///< describes inline or arena memory
+    Feature m_inline[INLINE_SIZE]; ///< the memory for small Pattern's
   };
 
 }
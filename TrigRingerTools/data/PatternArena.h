@@ -0,0 +1,78 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/PatternArena.h
+ *
+ * @brief Declares a pool of memory for transient Pattern's.
+ */
+
+#ifndef DATA_PATTERNARENA_H
+#define DATA_PATTERNARENA_H
+
+#include "TrigRingerTools/data/Feature.h"
+#include <cstddef>
+#include <vector>
+
+namespace data {
+
+  /**
+   * A PatternArena hands out memory for Pattern's that only live for a
+   * short while, like the temporaries of a single event. Memory is taken
+   * from large chunks by just moving a pointer, and is only given back all
+   * at once, by reset() or when the arena is destroyed. The chunks are kept
+   * across reset()'s, so an arena reused for every event stops allocating
+   * after the first one.
+   *
+   * Pattern's built from an arena do not own their memory: they must not
+   * outlive the arena, nor the next call to reset(). An arena is not meant
+   * to be shared between threads.
+   */
+  class PatternArena {
+
+  public:
+
+    /**
+     * Builds an empty arena. No memory is allocated before the first
+     * request.
+     *
+     * @param chunk The number of Feature's in each chunk of memory. Larger
+     * requests get a chunk of their own.
+     */
+    PatternArena (const size_t& chunk =1024);
+
+    /**
+     * Frees all the memory of this arena
+     */
+    virtual ~PatternArena();
+
+    /**
+     * Returns memory for a number of Feature's, uninitialised.
+     *
+     * @param n How many Feature's are needed
+     */
+    data::Feature* allocate (const size_t& n);
+
+    /**
+     * Gives back all the memory handed out so far, but keeps it allocated
+     * for the next requests.
+     */
+    void reset (void);
+
+  private: //not allowed
+
+    PatternArena (const PatternArena& other);
+    PatternArena& operator= (const PatternArena& other);
+
+  private: //representation
+
+    size_t m_chunk; ///< the default size of my chunks
+    std::vector<data::Feature*> m_data; ///< my chunks of memory
+    std::vector<size_t> m_size; ///< the size of each chunk
+    size_t m_current; ///< the chunk I'm taking memory from
+    size_t m_used; ///< how much of the current chunk is taken
+
+  };
+
+}
+
+#endif /* DATA_PATTERNARENA_H */
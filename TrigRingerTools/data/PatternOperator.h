@@ -10,7 +10,7 @@
 #define DATA_PATTERNOPERATOR_H
 
 #include "TrigRingerTools/data/Pattern.h"
-#include <gsl/gsl_vector.h>
+#include "TrigRingerTools/data/gsl_feature.h"
 
 namespace data {
 
@@ -43,7 +43,7 @@ namespace data {
      * @param p The vector to abuse
      * @return The internal representation of the Pattern
      */
-    inline const gsl_vector* abuse(const data::Pattern& p) const 
+    inline const data::FeatureVector* abuse(const data::Pattern& p) const 
     { return p.m_vector; }
 
   };
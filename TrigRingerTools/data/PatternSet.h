@@ -14,6 +14,7 @@
 #include "TrigRingerTools/data/Pattern.h"
 #include "TrigRingerTools/data/PatternOperator.h"
 #include "TrigRingerTools/data/Ensemble.h"
+#include "TrigRingerTools/data/RandomInteger.h"
 #include "TrigRingerTools/sys/Reporter.h"
 #include "TrigRingerTools/sys/File.h"
 #include "TrigRingerTools/sys/xmlutil.h"
@@ -143,10 +144,19 @@ namespace data {
     virtual PatternSet* clone (const std::vector<size_t>& pats) const = 0;
 
     /**
-     * Shuffles the order of data inside this PatternSet.
+     * Shuffles the order of data inside this PatternSet, drawing from a new
+     * stream of the process seed.
      */
     virtual void shuffle (void) = 0;
 
+    /**
+     * Shuffles the order of data inside this PatternSet, drawing from the
+     * given generator.
+     *
+     * @param rnd The generator to use
+     */
+    virtual void shuffle (const data::RandomInteger& rnd) = 0;
+
     /**
      * This method returns a constant reference of the data::Pattern required,
      * checking the range of the set before returning, by value, the required
@@ -10,41 +10,79 @@
 #define DATA_RANDOMINTEGER_H
 
 #include <cstddef>
+#include <stdint.h>
 #include <vector>
 
 namespace data {
-  
+
   /**
    * RandomInteger's abstracts random number genearation.
    *
    * The RandomInteger class abstracts random number genearations by
    * encapsulating a way to genearate random integers and arrays of
-   * those numbers. The seed may be set either at initialisation or
-   * during the existance of a RandomInteger variable.
+   * those numbers.
+   *
+   * The generator is counter-based: the n-th number of a sequence is a
+   * hash (SplitMix64's finaliser) of n and of a key, derived from a seed and
+   * a stream number. There is no hidden global state, so generators with
+   * the same seed and stream always produce the same sequence, and
+   * generators of different streams produce independent sequences. To
+   * parallelise something deterministically, derive one stream() per thread
+   * (or per epoch) from a single generator.
+   *
+   * A generator is not meant to be shared between threads without
+   * locking, since draw() moves its counter. Use stream() or next_stream()
+   * instead.
    */
   class RandomInteger {
-    
+
   public:
-    
+
     /**
      * A RandomInteger constructor.
      *
-     * The only constructor initialises the random genearator.
-     *
      * @param seed The seed to the random number genearator. If zero is given
-     * (the default parameter), the seed is initialized with
-     * <code>time(0)</code>, which is a second based machine counter. If you
-     * need to produce different sequences of numbers consecutively, it is
-     * recommended that you only instantiate 1 object of this class,
-     * statically.
+     * (the default parameter), the process seed is used instead (see
+     * set_seed()).
+     * @param stream The stream number. Different streams of the same seed
+     * produce independent sequences.
+     */
+    RandomInteger(const size_t& seed =0, const size_t& stream =0);
+
+    /**
+     * Returns a generator for one of my sub-streams. It starts from the
+     * beginning of its sequence, whatever the state of this generator.
+     *
+     * @param id The sub-stream number, like a thread or epoch number
+     */
+    RandomInteger stream (const size_t& id) const;
+
+    /**
+     * Sets the process seed, used by generators created with seed zero. If
+     * it is never set, <code>time(0)</code> is used. Call this before
+     * creating any generator, typically from the program options.
+     *
+     * @param seed The new process seed, which should not be zero
+     */
+    static void set_seed (const size_t& seed);
+
+    /**
+     * Returns the process seed, so it can be reported and reused
+     */
+    static size_t seed (void);
+
+    /**
+     * Returns a new stream of the process seed. Streams are numbered in
+     * the order of the calls, so the sequences are reproducible in a single
+     * threaded program. This is thread safe.
      */
-    RandomInteger(const size_t& seed =0);
+    static RandomInteger next_stream (void);
 
     /**
      * Returns a random integer between zero (included) and the
      * parameter value (excluded).
      *
-     * @warning If the maximum is <b>1</b>, the system always outputs 0. 
+     * @warning If the maximum is <b>1</b>, the system always outputs 0.
      *
      * @param max The maximum value that can be returned.
      */
@@ -56,9 +94,10 @@ namespace data {
      *
      * The result of this method is placed on the std::valarray given
      * as parameter. The number of draws will be the same as the size
-     * of the container.
+     * of the container. Each number only depends on its counter, so the
+     * loop has no dependencies between iterations and can be vectorised.
      *
-     * @warning If the maximum is <b>1</b>, the system always outputs 0. 
+     * @warning If the maximum is <b>1</b>, the system always outputs 0.
      *
      * @param max The maximum value that can be returned.
      * @param c   The container where to put the values drawn.
@@ -67,9 +106,11 @@ namespace data {
 
   private:
     size_t m_seed; ///< The seed is kept here, for debugging.
+    uint64_t m_key; ///< The key of my sequence, from the seed and stream
+    mutable uint64_t m_counter; ///< The position in my sequence
 
   };
 
 }
 
-#endif //DATA_RANDOMINTEGER_H 
+#endif //DATA_RANDOMINTEGER_H
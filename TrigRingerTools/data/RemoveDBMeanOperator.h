@@ -11,8 +11,11 @@
 
 #include "TrigRingerTools/data/PatternOperator.h"
 #include "TrigRingerTools/data/Database.h"
+#include "TrigRingerTools/data/StatsExtractor.h"
 #include "TrigRingerTools/sys/debug.h"
-#include <gsl/gsl_statistics_double.h>
+#include <vector>
+#include <map>
+#include <string>
 
 namespace data {
 
@@ -57,12 +60,16 @@ template <class TSet> data::RemoveDBMeanOperator::RemoveDBMeanOperator
 (const data::Database<TSet>& db)
   : m_mean(db.pattern_size(),0)
 {
-  TSet ps(1,1);
-  db.merge(ps);
-  for (unsigned int i=0; i<ps.pattern_size(); ++i) { //for all ensembles
-    data::Ensemble e = ps.ensemble(i);
-    const gsl_vector* v = abuse(e);
-    m_mean[i] = gsl_stats_mean(v->data, v->stride, v->size);
+  //accumulates class by class, without concatenating the database
+  std::vector<data::StatsExtractor> all(db.pattern_size());
+  std::vector<data::StatsExtractor> stats;
+  for (typename std::map<std::string, TSet*>::const_iterator
+	 it=db.data().begin(); it!=db.data().end(); ++it) {
+    data::StatsExtractor::ensembles(*it->second, stats);
+    for (unsigned int i=0; i<all.size(); ++i) all[i].merge(stats[i]);
+  }
+  for (unsigned int i=0; i<all.size(); ++i) { //for all ensembles
+    m_mean[i] = all[i].mean();
     RINGER_DEBUG3("Database mean for ensemble[" << i << "] is " << m_mean[i]);
   }
 }
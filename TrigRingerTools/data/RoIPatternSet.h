@@ -20,6 +20,10 @@
 
 namespace data {
 
+  class XmlStreamReader; ///< forward declaration
+  struct BinaryClassInfo; ///< forward declaration
+  class XmlStreamWriter; ///< forward declaration
+
   /**
    * This class represents a PatternSet that contains, for every Pattern, an
    * extra set of attributes that describe their RoI properties.
@@ -68,7 +72,27 @@ namespace data {
     RoIPatternSet(sys::xml_ptr_const node);
 
     /** 
-     * Reads an RoIPatternSet from an ROOT file
+     * Reads an RoIPatternSet from the current class of an XML database
+     * being streamed. The features are converted straight into my storage.
+     *
+     * @param reader The reader, positioned at the class to read
+     */
+    RoIPatternSet(data::XmlStreamReader& reader);
+
+    /** 
+     * Wraps a class of a mapped binary database file. The features are
+     * <b>not</b> copied, so the mapping must outlive this set. Only the
+     * attributes are copied.
+     *
+     * @param info Where the class lives inside the mapping
+     */
+    RoIPatternSet(const data::BinaryClassInfo& info);
+
+    /** 
+     * Reads an RoIPatternSet from an ROOT file. A first pass reads only
+     * <code>Ringer_NClusters</code> to size the set, so the patterns and
+     * their attributes are then filled in place, reading ahead just the
+     * branches that are needed.
      *
      * @param infoBranches  All information needed to access the ROOT file information.
      *                      See PatternSet.h
@@ -103,6 +127,9 @@ namespace data {
      * @param end The ending point of the interval
      * @param var The variable type to be used for the comparison. The default
      * comparision variable is `eta'.
+     *
+     * The Patterns are looked up with range(), so slicing the same set many
+     * times does not scan it every time.
      */
     RoIPatternSet(const RoIPatternSet& other, double start, double end,
 		  variable_t var=ETA);
@@ -231,6 +258,14 @@ namespace data {
      */
     virtual void shuffle (void);
 
+    /**
+     * Shuffles the order of data inside this PatternSet, drawing from the
+     * given generator.
+     *
+     * @param rnd The generator to use
+     */
+    virtual void shuffle (const data::RandomInteger& rnd);
+
     /**
      * Dumps the set as a set of XML nodes
      *
@@ -243,6 +278,18 @@ namespace data {
 			       const std::string& cname,
 			       const size_t start_id=0) const;
 
+    /**
+     * Dumps the set as a class of an XML database being streamed, without
+     * building XML nodes
+     *
+     * @param writer The writer of the database file
+     * @param cname The class name to use when dumping
+     * @param start_id The initial number to take in consideration when
+     * writing the entry identifiers.
+     */
+    void dump (data::XmlStreamWriter& writer, const std::string& cname,
+	       const size_t start_id=0) const;
+
     /**
      * Dumps the set to a ROOT file.
      *
@@ -369,9 +416,58 @@ namespace data {
     inline const data::SimplePatternSet& simple (void) const
     { return m_set; }
 
+    /**
+     * Finds the Patterns whose variable lies in the interval [start, end).
+     *
+     * The first query on a variable sorts the set positions by that
+     * variable and keeps this index until the set changes. Queries then
+     * take a binary search plus the number of Patterns found, instead of a
+     * scan of the whole set. The index is built on demand, so this is not
+     * thread safe before the first query on each variable.
+     *
+     * @param start The starting point of the interval
+     * @param end The ending point of the interval
+     * @param pats Where to put the positions of the Patterns found, in the
+     * order they have in the set
+     * @param var The variable type to be used for the comparison
+     */
+    void range (double start, double end, std::vector<size_t>& pats,
+		variable_t var=ETA) const;
+
+    /**
+     * Splits the set in consecutive bins of a variable, in a single pass.
+     * Bin <code>i</code> is the interval [edges[i], edges[i+1]), so there is
+     * one bin less than edges. Patterns outside all bins are left out.
+     *
+     * @param edges The bin edges, in increasing order
+     * @param bins Where to put the positions of the Patterns in each bin, in
+     * the order they have in the set
+     * @param var The variable type to be used for the comparison
+     */
+    void partition (const std::vector<double>& edges,
+		    std::vector<std::vector<size_t> >& bins,
+		    variable_t var=ETA) const;
+
+  private: //index management
+
+    /**
+     * Returns the set positions sorted by the given variable, building the
+     * index if needed.
+     *
+     * @param var The variable to sort by
+     */
+    const std::vector<size_t>& index (variable_t var) const;
+
+    /**
+     * Drops the sorted indexes, to be called whenever attributes change
+     */
+    void invalidate_index (void);
+
   private: //representation
     data::SimplePatternSet m_set; ///< My pattern related data
     std::vector<RoIAttribute> m_attr; ///< My attributes
+    mutable std::vector<size_t> m_eta_index; ///< positions sorted by eta
+    mutable std::vector<size_t> m_phi_index; ///< positions sorted by phi
 
   };
 
@@ -9,7 +9,7 @@
 #ifndef DATA_SIMPLEPATTERNSET_H
 #define DATA_SIMPLEPATTERNSET_H
 
-#include <gsl/gsl_matrix.h>
+#include "TrigRingerTools/data/gsl_feature.h"
 #include <iostream>
 #include "TrigRingerTools/data/Pattern.h"
 #include "TrigRingerTools/data/PatternOperator.h"
@@ -22,6 +22,11 @@
 
 namespace data {
 
+  class XmlStreamReader; ///< forward declaration
+  struct BinaryClassInfo; ///< forward declaration
+  class XmlStreamWriter; ///< forward declaration
+  class RoIPatternSet; ///< forward declaration
+
   /**
    * This class represents a set of data::Pattern's.
    *
@@ -45,6 +50,13 @@ namespace data {
    * All types developed to be used in conjunction with this class may be
    * derived types through the use of GSL's views of blocks, matrices and
    * vectors.
+   *
+   * Copies share the same matrix, with a reference count, until one of them
+   * is changed (copy-on-write). Copying a set, or a Database of them, is
+   * therefore cheap, and only sets that are really changed take extra
+   * memory. As a consequence, the data::Pattern's and data::Ensemble's
+   * returned by pattern() and ensemble() must only be read: use
+   * set_pattern() and set_ensemble() to change a set.
    */
   class SimplePatternSet : public PatternSet {
 
@@ -63,7 +75,7 @@ namespace data {
 
     /** 
      * Creates a SimplePatternSet from another SimplePatternSet. This is the
-     * copy constructor.
+     * copy constructor. No data is copied until one of the sets changes.
      *
      * @param other The SimplePatternSet to be cloned.
      */
@@ -76,6 +88,22 @@ namespace data {
      */
     SimplePatternSet(sys::xml_ptr_const node);
 
+    /** 
+     * Reads a SimplePatternSet from the current class of an XML database
+     * being streamed. The features are converted straight into my storage.
+     *
+     * @param reader The reader, positioned at the class to read
+     */
+    SimplePatternSet(data::XmlStreamReader& reader);
+
+    /** 
+     * Wraps a class of a mapped binary database file, <b>without</b>
+     * copying its features. The mapping must outlive this set.
+     *
+     * @param info Where the class lives inside the mapping
+     */
+    SimplePatternSet(const data::BinaryClassInfo& info);
+
     /**
      * Creates a SimplePatternSet from another SimplePatternSet, by selecting
      * a set of patterns of interest.
@@ -199,6 +227,14 @@ namespace data {
      */
     virtual void shuffle (void);
 
+    /**
+     * Shuffles the order of data inside this SimplePatternSet, drawing from
+     * the given generator.
+     *
+     * @param rnd The generator to use
+     */
+    virtual void shuffle (const data::RandomInteger& rnd);
+
     /**
      * Dumps the set as a set of XML nodes
      *
@@ -211,6 +247,18 @@ namespace data {
 			       const std::string& cname,
 			       const size_t start_id=0) const;
 
+    /**
+     * Dumps the set as a class of an XML database being streamed, without
+     * building XML nodes
+     *
+     * @param writer The writer of the database file
+     * @param cname The class name to use when dumping
+     * @param start_id The initial number to take in consideration when
+     * writing the entry identifiers.
+     */
+    void dump (data::XmlStreamWriter& writer, const std::string& cname,
+	       const size_t start_id=0) const;
+
     /**
      * Dump the set to a ROOT file
      *
@@ -271,7 +319,8 @@ namespace data {
 			     const std::vector<size_t>& pats);
 
     /**
-     * This method defines how to copy a SimplePatternSet.
+     * This method defines how to copy a SimplePatternSet. As with the copy
+     * constructor, the data is shared until one of the sets changes.
      *
      * @param other The SimplePatternSet to be copied.
      */
@@ -284,8 +333,46 @@ namespace data {
      */
     SimplePatternSet& operator-= (const SimplePatternSet& other);
 
+  private: //friends
+
+    friend class data::XmlStreamReader; ///< fills m_data when streaming
+    friend class data::RoIPatternSet; ///< fills m_data when reading ROOT
+
+  private: //copy-on-write
+
+    /**
+     * Tells if my matrix is shared with other sets
+     */
+    bool shared (void) const;
+
+    /**
+     * Makes sure my matrix is not shared with other sets, copying it if
+     * needed. Must be called before changing the matrix contents in place.
+     */
+    void detach (void);
+
+    /**
+     * Starts sharing the matrix of another set, dropping mine
+     *
+     * @param other The set to share the matrix with
+     */
+    void share (const SimplePatternSet& other);
+
+    /**
+     * Drops my matrix, freeing it if no other set uses it
+     */
+    void release (void);
+
+    /**
+     * Drops my matrix and takes the given one, that I will own alone
+     *
+     * @param m The new matrix
+     */
+    void reset (data::FeatureMatrix* m);
+
   private: //representation
-    gsl_matrix* m_data; ///< my internal data
+    data::FeatureMatrix* m_data; ///< my internal data
+    mutable size_t* m_refs; ///< how many sets share m_data, if ever shared
     
   };
   
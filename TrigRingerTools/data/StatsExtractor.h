@@ -0,0 +1,178 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/StatsExtractor.h
+ *
+ * @brief Calculates the sum, mean, variance and extrema of Pattern's in a
+ * single pass.
+ */
+
+#ifndef DATA_STATSEXTRACTOR_H
+#define DATA_STATSEXTRACTOR_H
+
+#include "TrigRingerTools/data/Pattern.h"
+#include "TrigRingerTools/data/PatternSet.h"
+#include <vector>
+
+namespace data {
+
+  /**
+   * Accumulates the statistics of a sequence of Feature's: the count, the
+   * sum, the mean, the unbiased variance, the minimum, the maximum and the
+   * absolute maximum. All of them are obtained from a single traversal of
+   * the data, instead of one traversal per statistic as with the
+   * FeatureExtractor's.
+   *
+   * The variance uses the updating formulas of Welford and of Chan et al.,
+   * with double precision accumulators whatever the precision of the
+   * Feature's. Accumulators of disjoint partitions of the data can be
+   * merge()'d, giving the same result as a single accumulator over the
+   * whole data (up to rounding), so the work can be split between threads.
+   */
+  class StatsExtractor {
+
+  public:
+
+    /**
+     * Builds an empty accumulator
+     */
+    StatsExtractor ();
+
+    /**
+     * Builds an accumulator with the statistics of a Pattern or of an
+     * Ensemble.
+     *
+     * @param in The Pattern to accumulate
+     */
+    StatsExtractor (const data::Pattern& in);
+
+    /**
+     * Builds an accumulator with the statistics of all the Feature's in a
+     * PatternSet.
+     *
+     * @param set The set to accumulate
+     */
+    StatsExtractor (const data::PatternSet& set);
+
+    /**
+     * Accumulates a Pattern or an Ensemble.
+     *
+     * @param in The Pattern to accumulate
+     */
+    void add (const data::Pattern& in);
+
+    /**
+     * Accumulates all the Feature's in a PatternSet, pattern by pattern.
+     *
+     * @param set The set to accumulate
+     */
+    void add (const data::PatternSet& set);
+
+    /**
+     * Accumulates a strided array of Feature's.
+     *
+     * @param x The first Feature
+     * @param n How many Feature's to accumulate
+     * @param stride The distance between two consecutive Feature's
+     */
+    void add (const data::Feature* x, const size_t n, const size_t stride=1);
+
+    /**
+     * Merges the statistics of another accumulator, computed on a different
+     * part of the data, into mine.
+     *
+     * @param other The accumulator to merge
+     */
+    void merge (const StatsExtractor& other);
+
+    /**
+     * Computes the statistics of every ensemble in a set at once. The set is
+     * traversed pattern by pattern, the way it is laid out in memory,
+     * updating the accumulators of all ensembles for each Pattern. This is
+     * much cheaper than going through every Ensemble, which visits the
+     * whole set once per ensemble.
+     *
+     * @param set The set to accumulate
+     * @param stats Where to put the statistics, one per ensemble
+     * @param nthreads How many threads to use. The set is split in that many
+     * consecutive chunks of patterns, whose statistics are merged at the
+     * end.
+     */
+    static void ensembles (const data::PatternSet& set,
+			   std::vector<StatsExtractor>& stats,
+			   const unsigned int nthreads=1);
+
+    /**
+     * Computes the statistics of every ensemble for a range of patterns in
+     * a set, as above, in the calling thread.
+     *
+     * @param set The set to accumulate
+     * @param start The first pattern to consider
+     * @param end One past the last pattern to consider
+     * @param stats Where to put the statistics, one per ensemble
+     */
+    static void ensembles (const data::PatternSet& set, const size_t start,
+			   const size_t end, std::vector<StatsExtractor>& stats);
+
+    /**
+     * Forgets everything accumulated so far
+     */
+    void reset (void);
+
+    /**
+     * Returns the number of Feature's accumulated
+     */
+    inline size_t count (void) const { return m_count; }
+
+    /**
+     * Returns the sum of the Feature's accumulated
+     */
+    inline double sum (void) const { return m_sum; }
+
+    /**
+     * Returns the mean of the Feature's accumulated, or zero if nothing
+     * was accumulated
+     */
+    inline double mean (void) const { return m_mean; }
+
+    /**
+     * Returns the "best unbiased estimate" of the variance, as in
+     * VarianceExtractor, or zero if less than two Feature's were
+     * accumulated.
+     */
+    double variance (void) const;
+
+    /**
+     * Returns the square root of variance()
+     */
+    double sd (void) const;
+
+    /**
+     * Returns the smallest Feature accumulated
+     */
+    inline data::Feature min (void) const { return m_min; }
+
+    /**
+     * Returns the largest Feature accumulated
+     */
+    inline data::Feature max (void) const { return m_max; }
+
+    /**
+     * Returns the largest absolute value of the Feature's accumulated
+     */
+    data::Feature absmax (void) const;
+
+  private: //representation
+
+    size_t m_count; ///< How many Feature's I have accumulated
+    double m_sum; ///< Their sum, accumulated as is
+    double m_mean; ///< Their mean
+    double m_m2; ///< The sum of their squared deviations from the mean
+    data::Feature m_min; ///< The smallest of them
+    data::Feature m_max; ///< The largest of them
+
+  };
+
+}
+
+#endif /* DATA_STATSEXTRACTOR_H */
@@ -0,0 +1,97 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/XmlStreamReader.h
+ *
+ * @brief Declares a streaming reader for XML database files.
+ */
+
+#ifndef DATA_XMLSTREAMREADER_H
+#define DATA_XMLSTREAMREADER_H
+
+#include <string>
+#include <vector>
+#include "TrigRingerTools/data/Header.h"
+#include "TrigRingerTools/data/SimplePatternSet.h"
+#include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/sys/Reporter.h"
+
+namespace data {
+
+  /**
+   * Reads an XML database file (see <code>database.xsd</code>) as a stream,
+   * without building its DOM tree in memory.
+   *
+   * The file is traversed once with libxml2's <code>xmlTextReader</code>,
+   * while it is validated against the schema. Feature text is converted
+   * straight into the storage that will become the data::SimplePatternSet
+   * matrix, so the peak memory needed to load a class is close to the size
+   * of the final data set. The reader is used by DatabaseXml::read(), in this
+   * order: header(), then next_class() and a data set constructor taking the
+   * reader for every class.
+   *
+   * @warning This class is only available with the libxml2 back-end. With
+   * Xerces, the constructor throws and DatabaseXml keeps using the DOM.
+   */
+  class XmlStreamReader {
+
+  public:
+
+    /**
+     * Opens a database file for reading
+     *
+     * @param filename The name of the database file
+     * @param schema The schema to validate the file with
+     * @param reporter The reporter to inform about problems
+     */
+    XmlStreamReader (const std::string& filename, const std::string& schema,
+		     sys::Reporter* reporter);
+
+    /**
+     * Closes the file and reports on its validity
+     */
+    virtual ~XmlStreamReader();
+
+    /**
+     * Reads the database header. This must be the first thing read. The
+     * returned object belongs to the caller.
+     */
+    data::Header* header (void);
+
+    /**
+     * Moves to the next class in the database.
+     *
+     * @param name The name of the class found
+     *
+     * @return <code>true</code> if a class was found, <code>false</code>
+     * if there are no more classes in the file.
+     */
+    bool next_class (std::string& name);
+
+    /**
+     * Reads all entries of the current class into a set. The set contents
+     * are replaced.
+     *
+     * @param set The set that will hold the features of every entry
+     * @param attr If not null, the RoI attributes of every entry are read
+     * into this container
+     */
+    void read (data::SimplePatternSet& set,
+	       std::vector<data::RoIPatternSet::RoIAttribute>* attr);
+
+  private: //not allowed
+
+    XmlStreamReader (const XmlStreamReader& other);
+    XmlStreamReader& operator= (const XmlStreamReader& other);
+
+  private: //representation
+
+    std::string m_filename; ///< the file being read
+    void* m_reader; ///< the libxml2 reader, opaque here
+    sys::Reporter* m_reporter; ///< where to report problems
+
+  };
+
+}
+
+#endif /* DATA_XMLSTREAMREADER_H */
@@ -0,0 +1,93 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/XmlStreamWriter.h
+ *
+ * @brief Declares a streaming writer for XML database files.
+ */
+
+#ifndef DATA_XMLSTREAMWRITER_H
+#define DATA_XMLSTREAMWRITER_H
+
+#include <string>
+#include <vector>
+#include "TrigRingerTools/data/Header.h"
+#include "TrigRingerTools/data/SimplePatternSet.h"
+#include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/sys/Reporter.h"
+
+namespace data {
+
+  /**
+   * Writes an XML database file (see <code>database.xsd</code>) as a
+   * stream, without building its DOM tree in memory.
+   *
+   * This is the counterpart of data::XmlStreamReader: the file is written
+   * with libxml2's <code>xmlTextWriter</code>, one entry at a time, so the
+   * memory needed to save a database does not depend on its size. Numbers
+   * are formatted with the same notation the DOM path uses.
+   *
+   * The header is written at construction. Then every class is written with
+   * the data set dump() methods taking a writer and, at last, close()
+   * finishes the document.
+   *
+   * @warning This class is only available with the libxml2 back-end. With
+   * Xerces, the constructor throws and DatabaseXml keeps using the DOM.
+   */
+  class XmlStreamWriter {
+
+  public:
+
+    /**
+     * Creates a database file and writes its header. An existing file is
+     * backed up first.
+     *
+     * @param filename The name of the database file
+     * @param header The database header
+     * @param reporter The reporter to inform about problems
+     */
+    XmlStreamWriter (const std::string& filename, const data::Header& header,
+		     sys::Reporter* reporter);
+
+    /**
+     * Closes the file, if that was not done yet
+     */
+    virtual ~XmlStreamWriter();
+
+    /**
+     * Writes a class of the database
+     *
+     * @param cname The class name
+     * @param set The features of every entry
+     * @param attr If not null, the RoI attributes of every entry, that are
+     * then written as <code>roientry</code>'s
+     * @param start_id The identifier of the first entry
+     */
+    void write (const std::string& cname, const data::SimplePatternSet& set,
+		const std::vector<data::RoIPatternSet::RoIAttribute>* attr,
+		const size_t start_id);
+
+    /**
+     * Finishes the document and closes the file.
+     *
+     * @return <code>true</code> if the whole file was written successfuly.
+     */
+    bool close (void);
+
+  private: //not allowed
+
+    XmlStreamWriter (const XmlStreamWriter& other);
+    XmlStreamWriter& operator= (const XmlStreamWriter& other);
+
+  private: //representation
+
+    std::string m_filename; ///< the file being written
+    void* m_writer; ///< the libxml2 writer, opaque here
+    std::string m_buffer; ///< where features are formatted
+    sys::Reporter* m_reporter; ///< where to report problems
+
+  };
+
+}
+
+#endif /* DATA_XMLSTREAMWRITER_H */
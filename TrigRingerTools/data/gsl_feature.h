@@ -0,0 +1,65 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/gsl_feature.h
+ *
+ * @brief Maps the GSL types and functions used to store Feature's to the
+ * ones with the same precision.
+ */
+
+#ifndef DATA_GSL_FEATURE_H
+#define DATA_GSL_FEATURE_H
+
+#include "TrigRingerTools/data/Feature.h"
+#include <gsl/gsl_block.h>
+#include <gsl/gsl_vector.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_statistics.h>
+
+/**
+ * GSL has one set of types and functions for every precision: gsl_vector
+ * and gsl_vector_alloc() work on double's, gsl_vector_float and
+ * gsl_vector_float_alloc() on float's. Code that stores Feature's should
+ * use the names bellow, that follow the precision chosen in Feature.h.
+ * Statistics are computed by GSL with (long) double accumulators, whatever
+ * the precision of the data. RINGER_GSL_BLAS() names the BLAS routines of
+ * the same precision (e.g. gsl_blas_dgemm()), declared in gsl/gsl_blas.h.
+ */
+#ifdef RINGER_SINGLE_PRECISION
+
+#define RINGER_GSL_BLOCK(f) gsl_block_float_##f
+#define RINGER_GSL_VECTOR(f) gsl_vector_float_##f
+#define RINGER_GSL_MATRIX(f) gsl_matrix_float_##f
+#define RINGER_GSL_STATS(f) gsl_stats_float_##f
+#define RINGER_GSL_BLAS(f) gsl_blas_s##f
+
+namespace data {
+  typedef gsl_block_float FeatureBlock; ///< A block of Feature's
+  typedef gsl_vector_float FeatureVector; ///< A GSL vector of Feature's
+  typedef gsl_matrix_float FeatureMatrix; ///< A GSL matrix of Feature's
+}
+
+#else /* RINGER_SINGLE_PRECISION */
+
+#define RINGER_GSL_BLOCK(f) gsl_block_##f
+#define RINGER_GSL_VECTOR(f) gsl_vector_##f
+#define RINGER_GSL_MATRIX(f) gsl_matrix_##f
+#define RINGER_GSL_STATS(f) gsl_stats_##f
+#define RINGER_GSL_BLAS(f) gsl_blas_d##f
+
+namespace data {
+  typedef gsl_block FeatureBlock; ///< A block of Feature's
+  typedef gsl_vector FeatureVector; ///< A GSL vector of Feature's
+  typedef gsl_matrix FeatureMatrix; ///< A GSL matrix of Feature's
+}
+
+#endif /* RINGER_SINGLE_PRECISION */
+
+namespace data {
+  typedef RINGER_GSL_VECTOR(view) FeatureVectorView; ///< A vector view
+  typedef RINGER_GSL_VECTOR(const_view) FeatureVectorConstView; ///< Idem
+  typedef RINGER_GSL_MATRIX(view) FeatureMatrixView; ///< A matrix view
+  typedef RINGER_GSL_MATRIX(const_view) FeatureMatrixConstView; ///< Idem
+}
+
+#endif /* DATA_GSL_FEATURE_H */
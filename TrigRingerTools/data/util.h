@@ -10,6 +10,7 @@
 #ifndef DATA_UTIL_H
 #define DATA_UTIL_H
 
+#include <vector>
 #include "TrigRingerTools/data/Feature.h"
 #include "TrigRingerTools/data/PatternSet.h"
 
@@ -57,22 +58,67 @@ namespace data {
    */
   data::Feature abs_mean (const data::PatternSet& p);
 
+  /**
+   * Calculates, in a single pass over the given output and target, the mean
+   * square error and the mean absolute error between them. No temporary
+   * sets or patterns are created. The work may be split among a number of
+   * threads, each of them taking care of a contiguous range of patterns.
+   *
+   * With <b>N</b> patterns of <b>P</b> features and errors <b>e</b>, the
+   * MSE is the mean_square() of the error set, @f$ \sum e^2 / (N P^2) @f$,
+   * as it has always been reported, while the mean absolute error is
+   * @f$ \sum |e| / (N P) @f$.
+   *
+   * @param output The output of the network
+   * @param target The target of the network
+   * @param mse The place where to put the mean square error
+   * @param mae The place where to put the mean absolute error
+   * @param nthreads The number of threads to use for the computation
+   */
+  void error (const data::PatternSet& output, const data::PatternSet& target,
+	      double& mse, double& mae, const unsigned int nthreads=1);
+
   /**
    * Given an output and a target, calculates the MSE for that amount of
    * patterns.
    *
    * @param output The output of the network
    * @param target The target of the network
+   * @param nthreads The number of threads to use for the computation
    */
-  template <class TSet>
-  double mse (const TSet& output, const TSet& target);
+  double mse (const data::PatternSet& output, const data::PatternSet& target,
+	      const unsigned int nthreads=1);
+
+  /**
+   * Given an output and a target, calculates the root of the MSE for that
+   * amount of patterns.
+   *
+   * @param output The output of the network
+   * @param target The target of the network
+   * @param nthreads The number of threads to use for the computation
+   */
+  double rmse (const data::PatternSet& output, const data::PatternSet& target,
+	       const unsigned int nthreads=1);
+
+  /**
+   * Given an output and a target, calculates the mean absolute error for
+   * that amount of patterns.
+   *
+   * @param output The output of the network
+   * @param target The target of the network
+   * @param nthreads The number of threads to use for the computation
+   */
+  double mae (const data::PatternSet& output, const data::PatternSet& target,
+	      const unsigned int nthreads=1);
 
   /**
    * Returns the maximum value of the SP product for the given output and
-   * targers. This procedure will pass a cut line from the min(target) to
-   * max(target) and will check which events are wrongly classified on both
-   * scenarios. This will determine the classification efficiency for both
-   * classes of data. This is used to compute:
+   * targers. The outputs are sorted once and every distinct output value is
+   * tried as a cut line, so the optimum found is exact and the cost is
+   * O(N log N). Events with a target above the middle of the target range
+   * belong to class 2 and are correctly classified if their output is
+   * greater or equal to the cut. This will determine the classification
+   * efficiency for both classes of data. This is used to compute:
    *
    * @f[
    * SP = max( (eff1 + eff2) \times (eff1 \times eff2) )
@@ -88,15 +134,24 @@ namespace data {
    */
   double sp (const data::PatternSet& output, const data::PatternSet& target,
 	     double& eff1, double& eff2, double& thres);
-  
-}
 
-template <class TSet>
-double data::mse (const TSet& output, const TSet& target)
-{
-  TSet error(target);
-  error -= output;
-  return data::mean_square(error);
+  /**
+   * Computes the Receiver Operating Characteristic (ROC) for the given
+   * output and targets. The same cut lines and class conventions used by
+   * data::sp() are applied and one entry is produced per distinct output
+   * value, in increasing threshold order. If one of the classes is empty,
+   * the returned vectors are empty.
+   *
+   * @param output The output of the network
+   * @param target The target of the network
+   * @param eff1 The efficiencies for the classification of class 1
+   * @param eff2 The efficiencies for the classification of class 2
+   * @param thres The thresholds that give the above efficiencies
+   */
+  void roc (const data::PatternSet& output, const data::PatternSet& target,
+	    std::vector<double>& eff1, std::vector<double>& eff2,
+	    std::vector<double>& thres);
+  
 }
 
 #endif /* DATA_UTIL_H */
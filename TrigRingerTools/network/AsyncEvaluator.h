@@ -0,0 +1,199 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/AsyncEvaluator.h
+ *
+ * @brief Defines an evaluator that measures the performance of a network
+ * being trained in a background thread, while the training goes on.
+ */
+
+#ifndef NETWORK_ASYNCEVALUATOR_H
+#define NETWORK_ASYNCEVALUATOR_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "TrigRingerTools/network/BatchTrainer.h"
+#include "TrigRingerTools/network/CompiledNetwork.h"
+#include "TrigRingerTools/data/SimplePatternSet.h"
+#include "TrigRingerTools/config/Header.h"
+#include "TrigRingerTools/config/Neuron.h"
+#include "TrigRingerTools/config/Synapse.h"
+#include "TrigRingerTools/sys/ThreadPool.h"
+#include "TrigRingerTools/sys/Reporter.h"
+
+namespace network {
+
+  /**
+   * The performance of a network at a given epoch, on the test and train
+   * sets. It is built from a snapshot of the weights (a copy of the
+   * CompiledNetwork layers) and of the configuration of the network, so
+   * it can be run() later, in another thread, and the network can still be
+   * save()'d as it was at that epoch.
+   */
+  class Evaluation : public sys::Task {
+
+  public: //interface
+
+    /**
+     * Takes a snapshot of a network being trained. The sets are not copied
+     * and must stay unchanged until the evaluation has run.
+     *
+     * @param net The network to evaluate
+     * @param epoch The epoch the network is at
+     * @param test The test set
+     * @param test_target The targets of the test set
+     * @param train The train set
+     * @param target The targets of the train set
+     * @param classify If the SP product should be computed too, for
+     * networks with one output
+     */
+    Evaluation (const network::BatchTrainer& net, const size_t epoch,
+		const data::SimplePatternSet& test,
+		const data::SimplePatternSet& test_target,
+		const data::SimplePatternSet& train,
+		const data::SimplePatternSet& target,
+		const bool classify);
+
+    /**
+     * Virtualises the destructor
+     */
+    virtual ~Evaluation ();
+
+    /**
+     * Runs both sets through the snapshot and computes the MSE and, if
+     * asked, the SP product of each. Errors are kept in error.
+     */
+    virtual void run (void);
+
+    /**
+     * Saves the network, as it was when the snapshot was taken. Throws if
+     * the file cannot be written.
+     *
+     * @param file The filename where to save the network state.
+     * @param header The header to save with the network
+     * @param reporter The reporter to inform about errors
+     */
+    void save (const std::string& file, const config::Header* header,
+	       sys::Reporter* reporter) const;
+
+  public: //results
+
+    size_t epoch; ///< the epoch of the snapshot
+    double test_mse; ///< the test set MSE
+    double test_sp; ///< the test set SP product, if computed
+    double test_eff1; ///< the test efficiency for the first class
+    double test_eff2; ///< the test efficiency for the second class
+    double test_thres; ///< the threshold for the best test SP
+    double train_mse; ///< the train set MSE
+    double train_sp; ///< the train set SP product, if computed
+    double train_eff1; ///< the train efficiency for the first class
+    double train_eff2; ///< the train efficiency for the second class
+    double train_thres; ///< the threshold for the best train SP
+    std::string error; ///< what went wrong, if anything
+
+  private: //not allowed
+
+    Evaluation (const Evaluation& other);
+    Evaluation& operator= (const Evaluation& other);
+
+  private: //representation
+
+    network::CompiledNetwork m_net; ///< the weights at my epoch
+    std::vector<config::Neuron> m_neuron; ///< the neurons at my epoch
+    std::vector<config::Synapse> m_synapse; ///< the synapses at my epoch
+    const data::SimplePatternSet& m_test; ///< the test set
+    const data::SimplePatternSet& m_test_target; ///< its targets
+    const data::SimplePatternSet& m_train; ///< the train set
+    const data::SimplePatternSet& m_target; ///< its targets
+    bool m_classify; ///< if the SP product is to be computed
+
+  };
+
+  /**
+   * An AsyncEvaluator runs Evaluation's of a network being trained in a
+   * background thread, so the training does not stop while the test and
+   * train sets go through the network. Evaluations are run, and handed
+   * back by next(), in the order they were submitted, each tagged with its
+   * epoch. The caller can then select the best network and save() it as it
+   * was at that epoch.
+   *
+   * A training loop that uses the results to decide when to stop will
+   * notice it a few epochs late. To bound this delay, and the memory taken
+   * by the snapshots, submit() waits when too many evaluations are still
+   * pending.
+   */
+  class AsyncEvaluator {
+
+  public: //interface
+
+    /**
+     * Builds an evaluator for the given sets. None of them are copied and
+     * they must stay unchanged while the evaluator lives.
+     *
+     * @param test The test set
+     * @param test_target The targets of the test set
+     * @param train The train set
+     * @param target The targets of the train set
+     * @param classify If the SP product should be computed too
+     * @param backlog How many evaluations can be pending before submit()
+     * waits for them
+     */
+    AsyncEvaluator (const data::SimplePatternSet& test,
+		    const data::SimplePatternSet& test_target,
+		    const data::SimplePatternSet& train,
+		    const data::SimplePatternSet& target,
+		    const bool classify, const size_t backlog=2);
+
+    /**
+     * Waits for the evaluations still running and discards the ones not
+     * handed back
+     */
+    virtual ~AsyncEvaluator ();
+
+    /**
+     * Takes a snapshot of the network and queues its evaluation.
+     *
+     * @param net The network being trained
+     * @param epoch The epoch the network is at
+     */
+    void submit (const network::BatchTrainer& net, const size_t epoch);
+
+    /**
+     * Hands back the oldest evaluation, if it has run. The caller owns the
+     * evaluation returned and should delete it.
+     *
+     * @param block If I should wait for the evaluation to run, if there is
+     * one pending
+     *
+     * @return The evaluation, or zero if there is none ready
+     */
+    network::Evaluation* next (const bool block=false);
+
+    /**
+     * Returns how many evaluations were not handed back yet
+     */
+    inline size_t pending (void) const { return m_pending.size(); }
+
+  private: //not allowed
+
+    AsyncEvaluator (const AsyncEvaluator& other);
+    AsyncEvaluator& operator= (const AsyncEvaluator& other);
+
+  private: //representation
+
+    const data::SimplePatternSet& m_test; ///< the test set
+    const data::SimplePatternSet& m_test_target; ///< its targets
+    const data::SimplePatternSet& m_train; ///< the train set
+    const data::SimplePatternSet& m_target; ///< its targets
+    bool m_classify; ///< if the SP product is to be computed
+    size_t m_backlog; ///< how many evaluations can be pending
+    sys::ThreadPool m_pool; ///< the background thread
+    std::deque<network::Evaluation*> m_pending; ///< in submission order
+
+  };
+
+}
+
+#endif /* NETWORK_ASYNCEVALUATOR_H */
@@ -0,0 +1,265 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/BatchTrainer.h
+ *
+ * @brief Defines a trainer that back-propagates whole mini-batches through
+ * the layers of a CompiledNetwork, using matrix products.
+ */
+
+#ifndef NETWORK_BATCHTRAINER_H
+#define NETWORK_BATCHTRAINER_H
+
+#include <string>
+#include <vector>
+
+#include "TrigRingerTools/network/CompiledNetwork.h"
+#include "TrigRingerTools/network/SynapseStrategy.h"
+#include "TrigRingerTools/data/RandomInteger.h"
+#include "TrigRingerTools/config/Header.h"
+#include "TrigRingerTools/sys/ThreadPool.h"
+
+namespace network {
+
+  /**
+   * A BatchTrainer trains a feed-forward network with back propagation,
+   * the same way Network::train() does, but layer by layer instead of
+   * synapse by synapse. For every block of patterns in a mini-batch, the
+   * activations of all neurons are computed as in CompiledNetwork. Then the
+   * local gradients of each layer, and their contribution to the gradients
+   * of the weights and to the errors of the layers before, are each one
+   * matrix product.
+   *
+   * The weights are then updated by the strategies of the synapses
+   * (strategy::SynapseBackProp or strategy::SynapseRProp), from the mean of
+   * the gradient over the mini-batch. The state of each strategy (e.g. its
+   * learning rate) evolves as it would in a Network. The trained network
+   * can be save()'d in the usual XML format, and loaded back by Network or
+   * CompiledNetwork.
+   *
+   * A mini-batch can be split between a number of threads. Each thread
+   * propagates a contiguous share of the patterns with its own buffers and
+   * accumulates its own partial gradients, at double precision whatever
+   * the precision of data::Feature. The partials are then summed in
+   * the order of the shares, so the training is reproducible for a given
+   * number of threads. With a single thread, the result is the one of
+   * Network::train(), up to rounding.
+   *
+   * Networks with two synapses between the same pair of neurons cannot be
+   * trained this way.
+   */
+  class BatchTrainer : public CompiledNetwork {
+
+  public: //interface
+
+    /**
+     * Loads the network to train from a file.
+     *
+     * @param config The filename of the network configuration
+     * @param reporter The reporter to inform about changes or errors.
+     * @param nthreads How many threads to split each mini-batch between
+     */
+    BatchTrainer (const std::string& config, sys::Reporter* reporter,
+		  const unsigned int nthreads=1);
+
+    /**
+     * Takes the network to train from the current state of a Network.
+     *
+     * @param net The network to train. It is not changed by the training.
+     * @param reporter The reporter to inform about changes or errors.
+     * @param nthreads How many threads to split each mini-batch between
+     */
+    BatchTrainer (const network::Network& net, sys::Reporter* reporter,
+		  const unsigned int nthreads=1);
+
+    /**
+     * Releases the synapse strategies and stops the threads
+     */
+    virtual ~BatchTrainer ();
+
+    /**
+     * Trains the network with the Pattern's from this PatternSet at the given
+     * positions, as one mini-batch. The same positions are taken from the
+     * targets.
+     *
+     * @param data The PatternSet to train the neural network with.
+     * @param target What is the network target for this supervisionised
+     * training system.
+     * @param pats The positions of the Pattern's to train with.
+     */
+    virtual void train (const data::SimplePatternSet& data,
+			const data::SimplePatternSet& target,
+			const std::vector<size_t>& pats);
+
+    /**
+     * Trains the network with a mini-batch of Pattern's chosen randomly, as
+     * in Network::train(). The positions are drawn from a new stream of the
+     * process seed.
+     *
+     * @param data The PatternSet to train the neural network with.
+     * @param target What is the network target for this supervisionised
+     * training system.
+     * @param epoch The number of patterns to train with
+     */
+    void train (const data::SimplePatternSet& data,
+		const data::SimplePatternSet& target,
+		unsigned int epoch);
+
+    /**
+     * Trains the network with a mini-batch of Pattern's chosen randomly,
+     * drawing the positions from the given generator.
+     *
+     * @param data The PatternSet to train the neural network with.
+     * @param target What is the network target for this supervisionised
+     * training system.
+     * @param epoch The number of patterns to train with
+     * @param rnd The generator to draw the positions from
+     */
+    void train (const data::SimplePatternSet& data,
+		const data::SimplePatternSet& target,
+		unsigned int epoch, const data::RandomInteger& rnd);
+
+    /**
+     * Dumps the configuration of the network, with the current weights and
+     * strategy parameters.
+     *
+     * @param neurons Where to put the neuron configurations
+     * @param synapses Where to put the synapse configurations
+     */
+    void dump (std::vector<config::Neuron>& neurons,
+	       std::vector<config::Synapse>& synapses) const;
+
+    /**
+     * Saves the current network state, as Network::save() does.
+     *
+     * @param file The filename where to save the network state.
+     * @param header An optional header to state information about this
+     * (possibly) modified network.
+     */
+    bool save (const std::string& file,
+	       const config::Header* header=0) const;
+
+    /**
+     * Returns how many threads a mini-batch is split between
+     */
+    inline unsigned int threads (void) const { return m_threads; }
+
+  protected: //for other training methods
+
+    /**
+     * Computes the gradients of the weights for a mini-batch, without
+     * changing the weights, and keeps them until the next call.
+     *
+     * @param data The PatternSet to train the neural network with.
+     * @param target What is the network target for this supervisionised
+     * training system.
+     * @param pats The positions of the Pattern's to train with.
+     *
+     * @return The sum, over the Pattern's and the outputs, of the squared
+     * errors
+     */
+    double gradient (const data::SimplePatternSet& data,
+		     const data::SimplePatternSet& target,
+		     const std::vector<size_t>& pats);
+
+    /**
+     * Computes the gradients of the weights for a mini-batch, like above,
+     * with the error of each Pattern multiplied by a weight.
+     *
+     * @param data The PatternSet to train the neural network with.
+     * @param target What is the network target for this supervisionised
+     * training system.
+     * @param pats The positions of the Pattern's to train with.
+     * @param weight The weight of each Pattern of the set, by position (as
+     * data::BalancedSampler::weights() gives them). If empty, every Pattern
+     * weighs 1.
+     *
+     * @return The weighted sum, over the Pattern's and the outputs, of the
+     * squared errors
+     */
+    double gradient (const data::SimplePatternSet& data,
+		     const data::SimplePatternSet& target,
+		     const std::vector<size_t>& pats,
+		     const std::vector<double>& weight);
+
+    /**
+     * Returns the mean, over the last gradient()'d mini-batch, of the error
+     * derivative of each synapse weight, with the sign the synapse
+     * strategies expect (the opposite of the gradient of the squared
+     * error), in the order of the synapse configurations.
+     *
+     * @param total The number of Pattern's in that mini-batch, or the sum
+     * of their weights if it was weighted
+     * @param deriv Where to put the derivatives
+     */
+    void derivatives (const double total,
+		      std::vector<data::Feature>& deriv) const;
+
+    /**
+     * Returns the weight of each synapse, in the order of the synapse
+     * configurations.
+     *
+     * @param weight Where to put the weights
+     */
+    void weights (std::vector<data::Feature>& weight) const;
+
+    /**
+     * Sets the weight of each synapse, in the order of the synapse
+     * configurations.
+     *
+     * @param weight The new weights
+     */
+    void set_weights (const std::vector<data::Feature>& weight);
+
+  private: //helpers
+
+    /**
+     * Compiles the neurons and synapses kept in m_neuron and
+     * m_synapse_config and sets up the training state
+     */
+    void setup (void);
+
+    class Share; ///< the part of a mini-batch trained by one thread
+    friend class Share;
+
+    /**
+     * Propagates the patterns of a share of the mini-batch and accumulates
+     * their weight gradients, in the share buffers.
+     *
+     * @param share The share to process
+     */
+    void accumulate (Share& share) const;
+
+    /**
+     * Back propagates the errors of a block of patterns, whose neuron values
+     * were just propagate()'d, and accumulates the weight gradients.
+     *
+     * @param share The share the block belongs to
+     * @param n The number of patterns in the block
+     */
+    void back_propagate (Share& share, const size_t n) const;
+
+  private: //not allowed
+
+    BatchTrainer (const BatchTrainer& other);
+    BatchTrainer& operator= (const BatchTrainer& other);
+
+  private: //representation
+
+    sys::Reporter* m_reporter; ///< where to report errors
+    config::Header* m_header; ///< the header of the network loaded, if any
+    std::vector<config::Neuron> m_neuron; ///< the neurons, as configured
+    std::vector<config::Synapse> m_synapse_config; ///< idem, for synapses
+    std::vector<strategy::SynapseStrategy*> m_teacher; ///< one per synapse
+    std::vector<data::Feature> m_bias_weight; ///< for bias synapses only
+    std::vector<std::vector<double> > m_gradient; ///< per layer
+    std::vector<std::vector<double> > m_delta_sum; ///< per layer
+    unsigned int m_threads; ///< how many threads to use
+    sys::ThreadPool* m_pool; ///< my threads, if more than one
+    std::vector<Share*> m_share; ///< the state of each thread
+
+  };
+
+}
+
+#endif /* NETWORK_BATCHTRAINER_H */
@@ -0,0 +1,208 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/CompiledNetwork.h
+ *
+ * @brief Defines a read-only version of a Network, organised in layers of
+ * dense weight matrices, for fast inference.
+ */
+
+#ifndef NETWORK_COMPILEDNETWORK_H
+#define NETWORK_COMPILEDNETWORK_H
+
+#include <string>
+#include <vector>
+
+#include "TrigRingerTools/data/Pattern.h"
+#include "TrigRingerTools/data/SimplePatternSet.h"
+#include "TrigRingerTools/config/Network.h"
+#include "TrigRingerTools/config/NeuronBackProp.h"
+#include "TrigRingerTools/network/Network.h"
+#include "TrigRingerTools/sys/Reporter.h"
+
+namespace network {
+
+  /**
+   * A CompiledNetwork runs Pattern's through a feed-forward network the same
+   * way Network::run() does, but without going through the graph of Neuron's
+   * and Synapse's. When compiled, neurons are sorted in layers, by their
+   * distance to the inputs, and the synapses arriving at each layer are
+   * gathered in a dense weight matrix. Bias neurons are folded into a bias
+   * vector per layer. Running a Pattern is then one matrix-vector product
+   * and one activation per layer; running a PatternSet is one
+   * matrix-matrix product per layer and block of patterns. Both use the GSL
+   * BLAS interface, so the CBLAS library linked in decides how fast this
+   * goes.
+   *
+   * Synapses may skip layers: a layer takes as input all the neurons between
+   * the first and the last it is connected to. A compiled network cannot be
+   * trained and does not follow later changes of the network it was built
+   * from. It is not meant to be shared between threads, because it keeps
+   * the intermediate results of run(): give each thread its own copy.
+   */
+  class CompiledNetwork {
+
+  public: //interface
+
+    /**
+     * Compiles the network saved in a file.
+     *
+     * @param config The filename of the network configuration
+     * @param reporter The reporter to inform about changes or errors.
+     */
+    CompiledNetwork (const std::string& config, sys::Reporter* reporter);
+
+    /**
+     * Compiles a network configuration
+     *
+     * @param config The network configuration
+     */
+    CompiledNetwork (const config::Network& config);
+
+    /**
+     * Compiles the current state of a network
+     *
+     * @param net The network to compile
+     */
+    CompiledNetwork (const network::Network& net);
+
+    /**
+     * Virtualises the destructor
+     */
+    virtual ~CompiledNetwork ();
+
+    /**
+     * Runs a Pattern over the network and gets the results.
+     *
+     * @param input The Pattern to run through the network
+     * @param output The output of this run. It is resized if it does not
+     * have output_size() positions.
+     */
+    void run (const data::Pattern& input, data::Pattern& output) const;
+
+    /**
+     * Runs a PatternSet over the network and gets the results.
+     *
+     * @param input The PatternSet to run through the network
+     * @param output The output of the network is placed at this PatternSet,
+     * which is resized if it does not have the right dimensions.
+     */
+    void run (const data::SimplePatternSet& input,
+	      data::SimplePatternSet& output) const;
+
+    /**
+     * Writes a self-contained C++ header that runs this network. It needs
+     * nothing but <code>&lt;cmath&gt;</code>: the weights and biases of each
+     * layer are constant arrays (<code>constexpr</code> with C++11), the
+     * input normalisation is folded into the weights and biases of the
+     * layers reading the inputs, and the computation of every neuron is
+     * written out, skipping the weights that are zero. The header declares a
+     * namespace with the given name, holding the constants
+     * <code>inputs</code> and <code>outputs</code> and the function
+     * <code>template &lt;typename T&gt; void run(const T* input, T*
+     * output)</code>, which computes in double precision.
+     *
+     * @param file The filename of the header to write
+     * @param name The namespace to place the network in, which should be a
+     * valid C++ identifier
+     */
+    bool cxx (const std::string& file, const std::string& name) const;
+
+    /**
+     * Returns the number of input neurons
+     */
+    inline size_t input_size (void) const { return m_subtract.size(); }
+
+    /**
+     * Returns the number of output neurons
+     */
+    inline size_t output_size (void) const { return m_output.size(); }
+
+    /**
+     * Returns the number of layers, not counting the inputs
+     */
+    inline size_t layers (void) const { return m_layer.size(); }
+
+  protected: //for trainers
+
+    /**
+     * Builds an empty network, to be compile()'d by children
+     */
+    CompiledNetwork ();
+
+    /**
+     * One layer of neurons, which only depends on neurons computed before
+     */
+    typedef struct layer_t {
+      size_t first; ///< where my outputs go, in the neuron values
+      size_t size; ///< how many neurons I have
+      size_t from; ///< the first neuron value I read from
+      size_t width; ///< how many neuron values I read
+      std::vector<data::Feature> weight; ///< size x width, row-major
+      std::vector<data::Feature> bias; ///< folded from the bias neurons
+      ///the activation function of each neuron
+      std::vector<config::NeuronBackProp::ActivationFunction> af;
+      ///how accurately the activation of each neuron is computed
+      std::vector<config::NeuronBackProp::Accuracy> accuracy;
+    } layer_t;
+
+    /**
+     * Where the weight of a synapse went when compiled
+     */
+    typedef struct synapse_t {
+      size_t layer; ///< the layer of the neuron the synapse ends at
+      size_t row; ///< the position of that neuron in the layer
+      size_t column; ///< the position of the input in the layer weights
+      bool bias; ///< if the synapse starts at a bias neuron
+      data::Feature value; ///< the value of the bias neuron, if any
+    } synapse_t;
+
+    /**
+     * Builds the layers from neuron and synapse configurations.
+     *
+     * @param neurons All the neurons of the network. The inputs and outputs
+     * are taken in the order they appear here.
+     * @param synapses All the synapses of the network. Where each of them
+     * went is recorded in m_synapse, in the same order.
+     */
+    void compile (const std::vector<const config::Neuron*>& neurons,
+		  const std::vector<const config::Synapse*>& synapses);
+
+    /**
+     * Computes all layers for a block of patterns, whose inputs are already
+     * normalised in the first columns of the block.
+     *
+     * @param values The neuron values, one pattern per row, m_values
+     * columns
+     * @param n The number of patterns in the block
+     */
+    void propagate (data::Feature* values, const size_t n) const;
+
+    /**
+     * Places the normalised inputs of a Pattern at the start of a row of
+     * neuron values.
+     *
+     * @param input The Pattern to run
+     * @param values The row of neuron values for this Pattern
+     */
+    void normalise (const data::Pattern& input, data::Feature* values) const;
+
+  protected: //representation
+
+    std::vector<data::Feature> m_subtract; ///< input normalisation
+    std::vector<data::Feature> m_divide; ///< input normalisation
+    std::vector<layer_t> m_layer; ///< my layers, in order
+    std::vector<size_t> m_output; ///< where my outputs are, in the values
+    std::vector<synapse_t> m_synapse; ///< where each synapse went
+    size_t m_values; ///< how many neuron values per pattern
+    mutable std::vector<data::Feature> m_work; ///< values of the last run
+
+  private: //friends
+
+    friend class QuantisedNetwork; ///< reads my layers to quantise them
+
+  };
+
+}
+
+#endif /* NETWORK_COMPILEDNETWORK_H */
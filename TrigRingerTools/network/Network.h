@@ -16,6 +16,7 @@
 #include <map>
 
 #include "TrigRingerTools/data/SimplePatternSet.h"
+#include "TrigRingerTools/data/RandomInteger.h"
 #include "TrigRingerTools/config/Network.h"
 #include "TrigRingerTools/network/Neuron.h"
 #include "TrigRingerTools/network/InputNeuron.h"
@@ -123,7 +124,8 @@ namespace network {
      * Trains the network with this PatternSet. The training data is chosen
      * from the "data" PatternSet randomly, a number of times it is enough to
      * fill in an epoch. The targets are selected accordingly to keep the
-     * system synchronised.
+     * system synchronised. The positions are drawn from a new stream of the
+     * process seed, see data::RandomInteger::next_stream().
      *
      * @param data The PatternSet to train the neural network with.
      * @param target What is the network target for this supervisionised
@@ -135,6 +137,49 @@ namespace network {
 			const data::SimplePatternSet& target,
 			unsigned int epoch);
 
+    /**
+     * Trains the network with an epoch chosen randomly, as above, drawing
+     * the positions from the given generator. Use one generator stream per
+     * epoch or thread to get reproducible parallel training.
+     *
+     * @param data The PatternSet to train the neural network with.
+     * @param target What is the network target for this supervisionised
+     * training system.
+     * @param epoch The epoch, number of patterns, with which the network
+     * must be trained.
+     * @param rnd The generator to draw the positions from
+     */
+    virtual void train (const data::SimplePatternSet& data,
+			const data::SimplePatternSet& target,
+			unsigned int epoch, const data::RandomInteger& rnd);
+
+    /**
+     * Trains the network with the Pattern's from this PatternSet at the given
+     * positions. The same positions are taken from the targets. This allows
+     * the caller to control how the training data is sampled, e.g. through a
+     * data::BalancedSampler, without copying the whole set.
+     *
+     * @param data The PatternSet to train the neural network with.
+     * @param target What is the network target for this supervisionised
+     * training system.
+     * @param pats The positions of the Pattern's to train with.
+     */
+    virtual void train (const data::SimplePatternSet& data,
+			const data::SimplePatternSet& target,
+			const std::vector<size_t>& pats);
+
+    /**
+     * Dumps the configuration of all my neurons and synapses. The neurons
+     * are given in the order run() feeds them: normalised inputs, inputs
+     * without normalisation, biases, hidden neurons and, at last, the
+     * outputs.
+     *
+     * @param neurons Where to put the neuron configurations
+     * @param synapses Where to put the synapse configurations
+     */
+    void dump (std::vector<config::Neuron>& neurons,
+	       std::vector<config::Synapse>& synapses) const;
+
     /**
      * Returns the number of input neurons
      */
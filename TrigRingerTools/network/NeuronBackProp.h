@@ -27,8 +27,11 @@ namespace strategy {
      * Constructs from initial parametrisation
      *
      * @param af The propagation function class to use.
+     * @param accuracy How accurately the propagation function is computed
      */
-    NeuronBackProp (const config::NeuronBackProp::ActivationFunction& af);
+    NeuronBackProp (const config::NeuronBackProp::ActivationFunction& af,
+		    const config::NeuronBackProp::Accuracy& accuracy=
+		    config::NeuronBackProp::EXACT);
 
     /**
      * Constructs from a configuration object
@@ -86,22 +89,9 @@ namespace strategy {
      */
     virtual std::string dot (void) const;
 
-  private: //function types
-
-    /**
-     * Apply operation <code>forward</code> over argument;
-     */
-    typedef data::Feature (*forward) (data::Feature);
-    
-    /**
-     * Apply operation <code>backward</code> over argument;
-     */
-    typedef data::Feature (*backward) (data::Feature);
-
   private:
     config::NeuronBackProp::ActivationFunction m_af; ///< function class
-    forward m_forward; ///< my forward activation function (run)
-    backward m_backward; ///< my backward activantion function (train)
+    config::NeuronBackProp::Accuracy m_accuracy; ///< how to compute it
   };
 
 }
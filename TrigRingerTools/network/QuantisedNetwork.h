@@ -0,0 +1,214 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/QuantisedNetwork.h
+ *
+ * @brief Defines a fixed-point version of a CompiledNetwork, with 8 or 16
+ * bit integer weights and neuron values.
+ */
+
+#ifndef NETWORK_QUANTISEDNETWORK_H
+#define NETWORK_QUANTISEDNETWORK_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "TrigRingerTools/network/CompiledNetwork.h"
+#include "TrigRingerTools/data/Pattern.h"
+#include "TrigRingerTools/data/SimplePatternSet.h"
+#include "TrigRingerTools/sys/Reporter.h"
+
+namespace network {
+
+  /**
+   * A QuantisedNetwork runs Pattern's through the layers of a
+   * CompiledNetwork using integers only, once the inputs are normalised. It
+   * is meant for targets where floating point is slow or unavailable: it is
+   * built from a trained network, save()'d to a small binary file and
+   * loaded back where it has to run.
+   *
+   * Every neuron value is an integer of 8 or 16 bits (the same number as
+   * the weights) times a scale shared by all neurons of the same layer. The
+   * inputs scale is chosen so that the largest normalised input seen in a
+   * calibration set is represented exactly, larger inputs saturate. The
+   * scale of a hidden or output layer is the range of its activation
+   * functions. The weights of each layer are rescaled to the scale of the
+   * values they multiply and then share a single scale per layer, chosen so
+   * that the largest weight takes the whole integer range.
+   *
+   * The weighted sums are accumulated in 32 bits for 8-bit networks and 64
+   * bits for 16-bit networks, so they never overflow. The sum and the bias
+   * are then turned, with one fixed point multiplication, into a position
+   * in a table of the activation function, sampled every 1/64 between -16
+   * and +16 and already expressed in the scale of the layer. Activations
+   * are interpolated linearly between table entries and saturate outside
+   * the table.
+   *
+   * Like CompiledNetwork, it keeps the intermediate results of run() and
+   * must not be shared between threads.
+   */
+  class QuantisedNetwork {
+
+  public: //interface
+
+    /**
+     * Quantises a compiled network.
+     *
+     * @param net The network to quantise
+     * @param bits How many bits weights and values have, either 8 or 16
+     * @param calibration Patterns representative of the inputs the network
+     * will see, to choose the input scale from. If empty, normalised inputs
+     * are expected between -1 and +1.
+     */
+    QuantisedNetwork (const network::CompiledNetwork& net,
+		      const unsigned int bits,
+		      const data::SimplePatternSet& calibration);
+
+    /**
+     * Loads a network that was previously save()'d.
+     *
+     * @param file The name of the file to load
+     * @param reporter The reporter to inform about changes or errors.
+     */
+    QuantisedNetwork (const std::string& file, sys::Reporter* reporter);
+
+    /**
+     * Virtualises the destructor
+     */
+    virtual ~QuantisedNetwork ();
+
+    /**
+     * Runs a Pattern over the network and gets the results.
+     *
+     * @param input The Pattern to run through the network
+     * @param output The output of this run. It is resized if it does not
+     * have output_size() positions.
+     */
+    void run (const data::Pattern& input, data::Pattern& output) const;
+
+    /**
+     * Runs a PatternSet over the network and gets the results.
+     *
+     * @param input The PatternSet to run through the network
+     * @param output The output of the network is placed at this PatternSet,
+     * which is resized if it does not have the right dimensions.
+     */
+    void run (const data::SimplePatternSet& input,
+	      data::SimplePatternSet& output) const;
+
+    /**
+     * Saves the quantised network in a binary file, with the byte order of
+     * this machine.
+     *
+     * @param file The name of the file to write
+     *
+     * @return <code>true</code> if the file was completely written
+     */
+    bool save (const std::string& file) const;
+
+    /**
+     * Returns the number of input neurons
+     */
+    inline size_t input_size (void) const { return m_subtract.size(); }
+
+    /**
+     * Returns the number of output neurons
+     */
+    inline size_t output_size (void) const { return m_output.size(); }
+
+    /**
+     * Returns the number of layers, not counting the inputs
+     */
+    inline size_t layers (void) const { return m_layer.size(); }
+
+    /**
+     * Returns how many bits weights and values have
+     */
+    inline unsigned int bits (void) const { return m_bits; }
+
+    /**
+     * Returns the value of one unit of the quantised inputs, after
+     * normalisation
+     */
+    inline double input_scale (void) const { return m_input_scale; }
+
+  private: //helpers
+
+    /**
+     * One layer of neurons, as in CompiledNetwork
+     */
+    typedef struct layer_t {
+      size_t first; ///< where my outputs go, in the neuron values
+      size_t size; ///< how many neurons I have
+      size_t from; ///< the first neuron value I read from
+      size_t width; ///< how many neuron values I read
+      std::vector<int8_t> weight8; ///< size x width, for 8-bit networks
+      std::vector<int16_t> weight16; ///< size x width, for 16-bit networks
+      int64_t multiplier; ///< weighted sum to table position, 32 bits fixed
+      std::vector<int64_t> offset; ///< bias as table position, per neuron
+      std::vector<uint32_t> table; ///< which of my tables each neuron uses
+      std::vector<std::vector<int16_t> > tables; ///< activations I use
+      double scale; ///< the value of one unit of my outputs
+      int64_t limit; ///< weighted sums saturate beyond this, not saved
+    } layer_t;
+
+    /**
+     * Sets the weighted sum limit of a layer, once its multiplier is known,
+     * and checks the accumulator cannot overflow.
+     *
+     * @param layer The layer to check
+     */
+    void check (layer_t& layer) const;
+
+    /**
+     * Computes all layers of one pattern, whose quantised inputs are
+     * already in the first values.
+     *
+     * @param weight Which weights of the layers to use
+     * @param values The neuron values
+     */
+    template <typename W, typename A, typename Acc>
+    void propagate (std::vector<W> layer_t::* weight, A* values) const;
+
+    /**
+     * Quantises the normalised inputs of a Pattern at the start of the
+     * neuron values.
+     *
+     * @param input The Pattern to run
+     * @param values The neuron values
+     */
+    template <typename A>
+    void quantise (const data::Pattern& input, A* values) const;
+
+    /**
+     * Runs one pattern and places the dequantised outputs in a Pattern
+     *
+     * @param input The Pattern to run
+     * @param output Where to place the outputs, with output_size() features
+     */
+    void evaluate (const data::Pattern& input, data::Pattern& output) const;
+
+  private: //not allowed
+
+    QuantisedNetwork (const QuantisedNetwork& other);
+    QuantisedNetwork& operator= (const QuantisedNetwork& other);
+
+  private: //representation
+
+    unsigned int m_bits; ///< 8 or 16
+    double m_input_scale; ///< the value of one unit of the inputs
+    std::vector<data::Feature> m_subtract; ///< input normalisation
+    std::vector<data::Feature> m_divide; ///< input normalisation
+    std::vector<layer_t> m_layer; ///< my layers, in order
+    std::vector<size_t> m_output; ///< where my outputs are, in the values
+    std::vector<double> m_output_scale; ///< the value of a unit of each
+    size_t m_values; ///< how many neuron values per pattern
+    mutable std::vector<int8_t> m_work8; ///< values of the last run, 8 bits
+    mutable std::vector<int16_t> m_work16; ///< idem, 16 bits
+
+  };
+
+}
+
+#endif /* NETWORK_QUANTISEDNETWORK_H */
@@ -0,0 +1,164 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/SCGTrainer.h
+ *
+ * @brief Defines a trainer that moves all the weights of a network at once,
+ * with the scaled conjugate gradient method.
+ */
+
+#ifndef NETWORK_SCGTRAINER_H
+#define NETWORK_SCGTRAINER_H
+
+#include <string>
+#include <vector>
+
+#include "TrigRingerTools/network/BatchTrainer.h"
+
+namespace network {
+
+  /**
+   * A SCGTrainer trains a feed-forward network with the Scaled Conjugate
+   * Gradient method, explained in: A Scaled Conjugate Gradient Algorithm
+   * for Fast Supervised Learning, by Martin F. Moller, published at Neural
+   * Networks, volume 6, pages 525-533, 1993.
+   *
+   * Instead of letting every synapse strategy change its own weight, the
+   * weights of all synapses are taken as a single vector, which is moved
+   * along directions conjugate to the previous ones. The size of each step
+   * comes from the curvature of the error along the direction, estimated
+   * from the gradients at two nearby points, so there is no line search and
+   * no learning rate to tune. The error minimised is the mean squared error
+   * over the Pattern's given to train(), possibly weighted, whose gradients
+   * are computed by BatchTrainer, layer by layer and split between its
+   * threads.
+   *
+   * Each call to train() is one iteration of the method, which takes two
+   * passes over the Pattern's (one if the last step was rejected). Since the
+   * directions are built for one error function, every call should be given
+   * the same Pattern's, usually the whole training set: the method starts
+   * over whenever the positions or the weights given change, or when
+   * reset() is called. The synapse strategies
+   * are not used, so the network is saved with the strategy parameters it
+   * was built with.
+   */
+  class SCGTrainer : public BatchTrainer {
+
+  public: //interface
+
+    /**
+     * Loads the network to train from a file.
+     *
+     * @param config The filename of the network configuration
+     * @param reporter The reporter to inform about changes or errors.
+     * @param nthreads How many threads to split each pass between
+     */
+    SCGTrainer (const std::string& config, sys::Reporter* reporter,
+		const unsigned int nthreads=1);
+
+    /**
+     * Takes the network to train from the current state of a Network.
+     *
+     * @param net The network to train. It is not changed by the training.
+     * @param reporter The reporter to inform about changes or errors.
+     * @param nthreads How many threads to split each pass between
+     */
+    SCGTrainer (const network::Network& net, sys::Reporter* reporter,
+		const unsigned int nthreads=1);
+
+    /**
+     * Virtualises the destructor
+     */
+    virtual ~SCGTrainer ();
+
+    using BatchTrainer::train;
+
+    /**
+     * Runs one iteration of the scaled conjugate gradient method over the
+     * Pattern's from this PatternSet at the given positions.
+     *
+     * @param data The PatternSet to train the neural network with.
+     * @param target What is the network target for this supervisionised
+     * training system.
+     * @param pats The positions of the Pattern's to train with.
+     */
+    virtual void train (const data::SimplePatternSet& data,
+			const data::SimplePatternSet& target,
+			const std::vector<size_t>& pats);
+
+    /**
+     * Runs one iteration of the scaled conjugate gradient method over the
+     * Pattern's from this PatternSet at the given positions, minimising
+     * their weighted mean squared error.
+     *
+     * @param data The PatternSet to train the neural network with.
+     * @param target What is the network target for this supervisionised
+     * training system.
+     * @param pats The positions of the Pattern's to train with.
+     * @param weight The weight of each Pattern of the set, by position, as
+     * data::BalancedSampler::weights() gives them. If empty, every Pattern
+     * counts the same.
+     */
+    void train (const data::SimplePatternSet& data,
+		const data::SimplePatternSet& target,
+		const std::vector<size_t>& pats,
+		const std::vector<double>& weight);
+
+    /**
+     * Forgets the directions followed so far, so the next train() starts
+     * over from the current weights.
+     */
+    void reset (void);
+
+    /**
+     * Returns half the mean squared error at the current weights, as found
+     * by the last train()
+     */
+    inline double error (void) const { return m_error; }
+
+  private: //helpers
+
+    /**
+     * Sets the weights and computes the error and its derivatives there.
+     *
+     * @param data The PatternSet to train the neural network with.
+     * @param target What is the network target for this supervisionised
+     * training system.
+     * @param pats The positions of the Pattern's to train with.
+     * @param weight The weights to evaluate the network at
+     * @param deriv Where to put the derivatives of the error (the opposite
+     * of its gradient)
+     *
+     * @return Half the mean squared error
+     */
+    double evaluate (const data::SimplePatternSet& data,
+		     const data::SimplePatternSet& target,
+		     const std::vector<size_t>& pats,
+		     const std::vector<double>& weight,
+		     std::vector<double>& deriv);
+
+  private: //not allowed
+
+    SCGTrainer (const SCGTrainer& other);
+    SCGTrainer& operator= (const SCGTrainer& other);
+
+  private: //representation
+
+    std::vector<size_t> m_pats; ///< positions of the current run, if any
+    std::vector<double> m_pattern_weight; ///< the weights of that run
+    double m_total; ///< the total weight of the positions of that run
+    std::vector<double> m_weight; ///< the weights, at double precision
+    std::vector<double> m_residual; ///< the error derivatives at m_weight
+    std::vector<double> m_direction; ///< the current search direction
+    double m_error; ///< half the mean squared error at m_weight
+    double m_delta; ///< the curvature along the direction, scaled
+    double m_lambda; ///< the scale, which makes the curvature positive
+    double m_lambda_bar; ///< the scale raise, when the curvature was not
+    bool m_success; ///< if the last step was taken
+    size_t m_iteration; ///< steps taken since the start
+
+  };
+
+}
+
+#endif /* NETWORK_SCGTRAINER_H */
@@ -84,6 +84,13 @@ namespace strategy {
     virtual data::Feature teach (const data::Ensemble& input,
 				 const data::Ensemble& lesson);
 
+    /**
+     * Implements the same rule, from the mean of <code>lesson * input</code>
+     *
+     * @param deriv The mean of the lesson times the input
+     */
+    virtual data::Feature teach (const data::Feature& deriv);
+
     /**
      * Dumps my configuration parameters on this configuration item
      */
@@ -49,6 +49,16 @@ namespace strategy {
      */
     virtual data::Feature teach (const data::Ensemble& input,
 				 const data::Ensemble& lesson) = 0;
+
+    /**
+     * Returns the adjustment for the weight, as above, when the mean of the
+     * product of the lesson and the input, over the training patterns, is
+     * already known. This is what trainers that compute the gradients of
+     * many synapses at once should call.
+     *
+     * @param deriv The mean of <code>lesson * input</code>
+     */
+    virtual data::Feature teach (const data::Feature& deriv) = 0;
     
   };
 
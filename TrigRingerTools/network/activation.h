@@ -0,0 +1,53 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/activation.h
+ *
+ * @brief Declares the activation functions of back propagation neurons,
+ * applied to whole arrays of values at once.
+ */
+
+#ifndef STRATEGY_ACTIVATION_H
+#define STRATEGY_ACTIVATION_H
+
+#include <cstddef>
+#include "TrigRingerTools/data/Feature.h"
+#include "TrigRingerTools/config/NeuronBackProp.h"
+
+namespace strategy {
+
+  /**
+   * Applies an activation function to consecutive values, in place. With
+   * config::NeuronBackProp::EXACT, <code>tanh()</code> and
+   * <code>exp()</code> from the C library are called for every value, as
+   * strategy::NeuronBackProp always did. The other accuracies replace them
+   * by a polynomial approximation of the exponential, without branches or
+   * calls, that the compiler can vectorise. The absolute error of the
+   * results is then below the one requested, for any input.
+   *
+   * @param af The activation function
+   * @param accuracy How accurately to compute it
+   * @param x The values to activate
+   * @param n How many values there are
+   */
+  void activate (const config::NeuronBackProp::ActivationFunction af,
+		 const config::NeuronBackProp::Accuracy accuracy,
+		 data::Feature* x, const size_t n);
+
+  /**
+   * Replaces consecutive outputs of an activation function by the
+   * derivative of that function at the same point, in place. For the
+   * functions available, the derivative is a polynomial of the output: @f$
+   * 1-y^2 @f$ for tanh, @f$ y(1-y) @f$ for the sigmoid and 1 for the linear
+   * function.
+   *
+   * @param af The activation function
+   * @param y The outputs of the function
+   * @param n How many values there are
+   */
+  void derive (const config::NeuronBackProp::ActivationFunction af,
+	       data::Feature* y, const size_t n);
+
+}
+
+#endif /* STRATEGY_ACTIVATION_H */
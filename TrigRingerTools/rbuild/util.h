@@ -10,6 +10,7 @@
 #define RBUILD_UTIL_H
 
 #include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/data/PatternArena.h"
 #include "TrigRingerTools/roiformat/RoI.h"
 #include "TrigRingerTools/rbuild/RingSet.h"
 
@@ -40,9 +41,12 @@ namespace rbuild {
    * @param rings The calculated ring values one wishes to normalise
    * @param stop_energy The threshold to judge when to stop this normalisation
    * strategy and start using the total layer energy instead, in MeV.
+   * @param arena Where to take the temporary normalisation vector from. If
+   * none is given, a private one is used.
    */
   void sequential (sys::Reporter* reporter, data::Pattern& rings, 
-		   const data::Feature& stop_energy=100.0);
+		   const data::Feature& stop_energy=100.0,
+		   data::PatternArena* arena=0);
 
   /**
    * Calculates the center of interation based on the second e.m. layer
@@ -85,9 +89,12 @@ namespace rbuild {
    *
    * @param reporter A system-wide reporter to use
    * @param rset The ring set configuration to use for creating the rings
+   * @param arena Where to take temporaries from. Reusing the same arena for
+   * all RoI's avoids allocating memory for every one of them.
    */
   void normalize_rings(sys::Reporter* reporter,
-		       std::vector<rbuild::RingSet>& rset);
+		       std::vector<rbuild::RingSet>& rset,
+		       data::PatternArena* arena=0);
 
 }
 
@@ -0,0 +1,111 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file sys/ThreadPool.h
+ *
+ * @brief Declares a fixed-size pool of POSIX threads that executes
+ * sys::Task's.
+ */
+
+#ifndef RINGER_SYS_THREADPOOL_H
+#define RINGER_SYS_THREADPOOL_H
+
+#include <deque>
+#include <vector>
+#include <pthread.h>
+
+namespace sys {
+
+  /**
+   * A unit of work to be executed by a sys::ThreadPool.
+   */
+  class Task {
+
+  public:
+
+    /**
+     * Destructor virtualisation
+     */
+    virtual ~Task() {}
+
+    /**
+     * Executes this task. Exceptions must not escape this method.
+     */
+    virtual void run (void) =0;
+
+  };
+
+  /**
+   * A fixed number of worker threads that take sys::Task's from a queue and
+   * run them, in submission order. The pool does not own the tasks given to
+   * it: they must live at least until wait() returns.
+   */
+  class ThreadPool {
+
+  public:
+
+    /**
+     * Starts the worker threads
+     *
+     * @param nthreads The number of worker threads to start. If zero is
+     * given, one thread is started.
+     */
+    ThreadPool (const unsigned int nthreads);
+
+    /**
+     * Waits for all queued tasks and stops the worker threads
+     */
+    virtual ~ThreadPool();
+
+    /**
+     * Queues a task for execution
+     *
+     * @param task The task to execute
+     */
+    void submit (sys::Task* task);
+
+    /**
+     * Blocks the caller until all submitted tasks have been executed
+     */
+    void wait (void);
+
+    /**
+     * Returns how many submitted tasks are still waiting or running. Tasks
+     * not counted here are finished and their results can be read.
+     */
+    size_t pending (void);
+
+    /**
+     * Returns the number of worker threads in this pool
+     */
+    inline size_t size (void) const { return m_thread.size(); }
+
+  private: //not allowed
+
+    ThreadPool (const ThreadPool& other);
+    ThreadPool& operator= (const ThreadPool& other);
+
+  private: //the worker loop
+
+    /**
+     * The entry point of every worker thread
+     *
+     * @param pool The ThreadPool the worker belongs to
+     */
+    static void* work (void* pool);
+
+  private: //representation
+
+    std::vector<pthread_t> m_thread; ///< my worker threads
+    std::deque<sys::Task*> m_queue; ///< tasks waiting for execution
+    size_t m_running; ///< tasks currently being executed
+    bool m_stop; ///< tells the workers to quit
+    pthread_mutex_t m_lock; ///< protects all the above
+    pthread_cond_t m_work; ///< signalled when there is work or on stop
+    pthread_cond_t m_done; ///< signalled when a task finishes
+
+  };
+
+}
+
+#endif /* RINGER_SYS_THREADPOOL_H */
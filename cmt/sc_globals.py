@@ -7,6 +7,8 @@ import platform
 NR_VERSION = "0.8.0"
 DEBUG_LVL = 0
 VERBOSE_LVL = 0
+#Set to 1 to store Features (databases and networks) as floats
+SINGLE_PRECISION = 0
 
 def getSourceFiles(sourcesDir):
 	srcFilter = re.compile('\.cxx\Z|\.cpp\Z|\.c\Z')
@@ -28,6 +30,8 @@ def getLibXMLPaths():
 genCPPFlags = ['-DNR_VERSION=\\"%s\\"' % NR_VERSION, \
               '-DRINGER_DEBUG=%d' % DEBUG_LVL, '-DRINGER_VERBOSE=%d' % VERBOSE_LVL, \
               '-Wno-long-long']
+if SINGLE_PRECISION:
+  genCPPFlags += ['-DRINGER_SINGLE_PRECISION']
 
 libXMLIncPath = "/usr/include/libxml2"
 poptPath = "/sw/include/"
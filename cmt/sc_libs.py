@@ -3,10 +3,10 @@ import sc_globals
 libs = {};
 
 libs['sys'] = {}
-libs['sys']['LIBS'] = ['popt', 'xml2'] + sc_globals.rootLibs
+libs['sys']['LIBS'] = ['popt', 'xml2', 'pthread'] + sc_globals.rootLibs
 
 libs['data'] = {}
-libs['data']['LIBS'] = ['sys', 'gsl', 'gslcblas'] + sc_globals.rootLibs
+libs['data']['LIBS'] = ['sys', 'gsl', 'gslcblas', 'pthread'] + sc_globals.rootLibs
 
 libs['config'] = {}
 libs['config']['LIBS'] = ['sys', 'data']
@@ -18,7 +18,7 @@ libs['lvl1'] = {}
 libs['lvl1']['LIBS'] = ['roiformat', 'sys'] + sc_globals.rootLibs
 
 libs['network'] = {}
-libs['network']['LIBS'] = ['data', 'sys', 'config']
+libs['network']['LIBS'] = ['data', 'sys', 'config', 'gsl', 'gslcblas']
 
 libs['rbuild'] = {}
 libs['rbuild']['LIBS'] = ['data', 'sys', 'roiformat'] + sc_globals.rootLibs
@@ -24,6 +24,14 @@ progs['filter']['LIBS'] = ['data', 'roiformat', 'sys'] + sc_globals.rootLibs
 progs['xml2text'] = {}
 progs['xml2text']['LIBS'] = ['data', 'popt', 'sys', 'roiformat']
 
+progs['xml2bin'] = {}
+progs['xml2bin']['source'] = ['../src/progs/xml2bin.cxx', '../src/progs/ConvertDatabase.cxx']
+progs['xml2bin']['LIBS'] = ['data', 'popt', 'sys', 'roiformat']
+
+progs['bin2xml'] = {}
+progs['bin2xml']['source'] = ['../src/progs/bin2xml.cxx', '../src/progs/ConvertDatabase.cxx']
+progs['bin2xml']['LIBS'] = ['data', 'popt', 'sys', 'roiformat']
+
 progs['mlp-train'] = {}
 progs['mlp-train']['LIBS'] = ['network', 'popt', 'config', 'sys', 'data', 'roiformat', 'gsl', 'gslcblas']
 
@@ -33,9 +41,18 @@ progs['mlp-bp-train']['LIBS'] = ['network', 'popt', 'sys', 'data', 'roiformat',
 progs['lms-train'] = {}
 progs['lms-train']['LIBS'] = ['network', 'popt', 'sys', 'data', 'roiformat', 'config', 'gsl', 'gslcblas']
 
+progs['mlp-kfold'] = {}
+progs['mlp-kfold']['LIBS'] = ['network', 'popt', 'config', 'sys', 'data', 'roiformat', 'gsl', 'gslcblas', 'pthread']
+
+progs['mlp-sweep'] = {}
+progs['mlp-sweep']['LIBS'] = ['network', 'popt', 'config', 'sys', 'data', 'roiformat', 'gsl', 'gslcblas', 'pthread']
+
 progs['mlp-run'] = {}
 progs['mlp-run']['LIBS'] = ['network', 'popt', 'sys', 'roiformat', 'data']
 
+progs['mlp-quantise'] = {}
+progs['mlp-quantise']['LIBS'] = ['network', 'popt', 'config', 'sys', 'data', 'roiformat', 'gsl', 'gslcblas']
+
 progs['mlp-relevance'] = {}
 progs['mlp-relevance']['LIBS'] = ['network', 'popt', 'sys', 'data', 'roiformat', 'config']
 
@@ -48,6 +65,12 @@ progs['relevance-filter']['LIBS'] = ['data', 'popt', 'sys', 'roiformat']
 progs['xml2dot'] = {}
 progs['xml2dot']['LIBS'] = ['network', 'sys', 'roiformat']
 
+progs['xml2cxx'] = {}
+progs['xml2cxx']['LIBS'] = ['network', 'config', 'sys', 'data', 'roiformat', 'gsl', 'gslcblas']
+
+progs['mlp-convert'] = {}
+progs['mlp-convert']['LIBS'] = ['config', 'sys', 'data', 'roiformat']
+
 progs['ringer-run'] = {}
 progs['ringer-run']['LIBS'] = ['network', 'rbuild', 'data', 'sys', 'roiformat'] + sc_globals.rootLibs
 
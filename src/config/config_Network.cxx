@@ -7,12 +7,134 @@
  */
 
 #include "TrigRingerTools/config/Network.h"
+#include "TrigRingerTools/config/NeuronBackProp.h"
+#include "TrigRingerTools/config/SynapseBackProp.h"
+#include "TrigRingerTools/config/SynapseRProp.h"
 #include "TrigRingerTools/sys/xmlutil.h"
 #include "TrigRingerTools/sys/XMLProcessor.h"
 #include "TrigRingerTools/sys/debug.h"
 #include "TrigRingerTools/sys/Exception.h"
 #include "TrigRingerTools/sys/util.h"
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <stdint.h>
+
+/**
+ * The magic string that starts every binary network file
+ */
+static const char s_magic[8] = { 'R', 'I', 'N', 'G', 'N', 'E', 'T', 0 };
+
+/**
+ * Written as is, so the reader can detect foreign byte orders
+ */
+static const uint32_t s_byte_order = 0x01020304;
+
+/**
+ * The current version of the binary file layout
+ */
+static const uint32_t s_version = 1;
+
+/**
+ * How many strategy parameters are kept for each synapse: learning rate,
+ * momentum, learning rate decay and previous delta for back propagation,
+ * or weight update, previous delta and previous derivative (and a zero)
+ * for resilient back propagation.
+ */
+static const size_t s_parameters = 4;
+
+/**
+ * The fixed size header at the start of a binary network file. It is
+ * followed by the header strings (author, name, version and comment, each
+ * terminated by a zero), the neuron arrays (identifiers, types, activation
+ * functions and accuracies as 32-bit integers, then bias, subtract and
+ * divide as doubles) and the synapse arrays (identifiers, start and end
+ * neurons and strategies as 32-bit integers, then weights and, per synapse,
+ * s_parameters strategy parameters, as doubles).
+ */
+typedef struct file_header_t {
+  char magic[8]; ///< s_magic
+  uint32_t byte_order; ///< s_byte_order, in the writer byte order
+  uint32_t version; ///< s_version
+  uint64_t neurons; ///< number of neurons
+  uint64_t synapses; ///< number of synapses
+  int64_t created; ///< network creation time
+  int64_t last_saved; ///< network last saving time
+  uint64_t strings_size; ///< the size of the header strings
+} file_header_t;
+
+/**
+ * Tells if a file starts like a binary network file
+ *
+ * @param filename The name of the file to check
+ */
+static bool is_binary (const std::string& filename)
+{
+  std::ifstream is(filename.c_str(), std::ios_base::in|std::ios_base::binary);
+  char magic[sizeof(s_magic)];
+  is.read(magic, sizeof(magic));
+  return is && !std::memcmp(magic, s_magic, sizeof(s_magic));
+}
+
+/**
+ * Tells if a file should be saved in the binary format, by its name
+ *
+ * @param filename The name of the file to save
+ */
+static bool binary_name (const std::string& filename)
+{
+  return filename.size() > 4 &&
+    filename.compare(filename.size()-4, 4, ".bin") == 0;
+}
+
+/**
+ * Deletes the neurons and synapses of a network being loaded
+ *
+ * @param neuron The neurons
+ * @param synapse The synapses
+ */
+static void release (std::vector<config::Neuron*>& neuron,
+		     std::vector<config::Synapse*>& synapse)
+{
+  for (size_t i=0; i<neuron.size(); ++i) delete neuron[i];
+  neuron.clear();
+  for (size_t k=0; k<synapse.size(); ++k) delete synapse[k];
+  synapse.clear();
+}
+
+/**
+ * Writes an array to a file, as is
+ *
+ * @param os The stream to write to
+ * @param v The array to write
+ */
+template <typename T>
+static void put (std::ostream& os, const std::vector<T>& v)
+{
+  if (v.size())
+    os.write(reinterpret_cast<const char*>(&v[0]), v.size()*sizeof(T));
+}
+
+/**
+ * Reads an array from a file, as is
+ *
+ * @param is The stream to read from
+ * @param v Where to put the array
+ * @param n How many elements to read
+ * @param length The length of the file, so garbage sizes are not allocated
+ *
+ * @return <code>true</code> if all elements were read
+ */
+template <typename T>
+static bool get (std::istream& is, std::vector<T>& v, const uint64_t n,
+		 const uint64_t length)
+{
+  if (n > length / sizeof(T)) return false;
+  v.resize(n);
+  if (n) is.read(reinterpret_cast<char*>(&v[0]), n*sizeof(T));
+  return is.good();
+}
 
 config::Network::Network(const std::string& filename,
 			 sys::Reporter* reporter)
@@ -21,6 +143,11 @@ config::Network::Network(const std::string& filename,
     m_synapse(),
     m_neuron()
 {
+  if (is_binary(filename)) {
+    load_binary(filename);
+    return;
+  }
+
   std::string schema = sys::getenv("DATAPATH");
   if (schema.length() == 0) {
     RINGER_DEBUG1("I cannot find the standard schema path. Have you set"
@@ -106,6 +233,7 @@ config::Network::~Network()
 
 bool config::Network::save (const std::string& filename)
 {
+  if (binary_name(filename)) return save_binary(filename);
   RINGER_DEBUG2("Trying to save parsed document at \"" << filename << "\".");
   std::string schema = sys::getenv("DATAPATH");
   if (schema.length() == 0) {
@@ -134,3 +262,213 @@ bool config::Network::save (const std::string& filename)
   RINGER_DEBUG2("File \"" << filename << "\" was saved.");
   return true;
 }
+
+void config::Network::load_binary (const std::string& filename)
+{
+  RINGER_DEBUG2("Trying to load binary network " << filename);
+  std::ifstream is(filename.c_str(), std::ios_base::in|std::ios_base::binary);
+  if (!is) {
+    RINGER_WARN(m_reporter, "Could not open file \"" << filename << "\"."
+		<< " Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot open binary network file");
+  }
+  is.seekg(0, std::ios_base::end);
+  const uint64_t length = is.tellg();
+  is.seekg(0, std::ios_base::beg);
+
+  file_header_t fh;
+  std::memset(&fh, 0, sizeof(fh));
+  is.read(reinterpret_cast<char*>(&fh), sizeof(fh));
+  std::string error;
+  if (!is || std::memcmp(fh.magic, s_magic, sizeof(s_magic)))
+    error = "Not a binary network file";
+  else if (fh.byte_order != s_byte_order)
+    error = "Binary network file written with a different byte order";
+  else if (fh.version != s_version)
+    error = "Unsupported binary network file version";
+
+  std::vector<char> strings;
+  std::vector<uint32_t> neuron_id, type, af, accuracy;
+  std::vector<double> bias, subtract, divide;
+  std::vector<uint32_t> synapse_id, from, to, strategy;
+  std::vector<double> weight, param;
+  if (error.empty() &&
+      (!get(is, strings, fh.strings_size, length) ||
+       !get(is, neuron_id, fh.neurons, length) ||
+       !get(is, type, fh.neurons, length) ||
+       !get(is, af, fh.neurons, length) ||
+       !get(is, accuracy, fh.neurons, length) ||
+       !get(is, bias, fh.neurons, length) ||
+       !get(is, subtract, fh.neurons, length) ||
+       !get(is, divide, fh.neurons, length) ||
+       !get(is, synapse_id, fh.synapses, length) ||
+       !get(is, from, fh.synapses, length) ||
+       !get(is, to, fh.synapses, length) ||
+       !get(is, strategy, fh.synapses, length) ||
+       !get(is, weight, fh.synapses, length) ||
+       fh.synapses > length / s_parameters ||
+       !get(is, param, s_parameters*fh.synapses, length)))
+    error = "Truncated binary network file";
+
+  //the header strings, author, name, version and comment
+  const char* field[4];
+  size_t pos = 0;
+  for (size_t i=0; i<4 && error.empty(); ++i) {
+    const void* end = (pos < strings.size())?
+      std::memchr(&strings[pos], 0, strings.size()-pos) : 0;
+    if (!end) {
+      error = "Corrupted binary network file";
+      break;
+    }
+    field[i] = &strings[pos];
+    pos = static_cast<const char*>(end) - &strings[0] + 1;
+  }
+
+  //built aside, so nothing is left behind if the file is bad
+  std::vector<Neuron*> neuron;
+  std::vector<Synapse*> synapse;
+  try {
+    for (size_t i=0; i<neuron_id.size() && error.empty(); ++i) {
+      if (type[i] > config::INPUTNONORM ||
+	  af[i] > config::NeuronBackProp::LINEAR ||
+	  accuracy[i] > config::NeuronBackProp::COARSE) {
+	error = "Corrupted binary network file";
+	break;
+      }
+      config::NeuronType nt = static_cast<config::NeuronType>(type[i]);
+      config::NeuronStrategyType ns = config::NEURON_BACKPROP;
+      config::NeuronBackProp np
+	(static_cast<config::NeuronBackProp::ActivationFunction>(af[i]),
+	 static_cast<config::NeuronBackProp::Accuracy>(accuracy[i]));
+      neuron.push_back(new Neuron(neuron_id[i], nt, &ns, &np, bias[i],
+				  subtract[i], divide[i]));
+    }
+
+    for (size_t k=0; k<synapse_id.size() && error.empty(); ++k) {
+      const double* p = &param[s_parameters*k];
+      if (strategy[k] == config::SYNAPSE_BACKPROP) {
+	config::SynapseBackProp sp(p[0], p[1], p[2], p[3]);
+	synapse.push_back(new Synapse(synapse_id[k], from[k], to[k],
+				      weight[k], config::SYNAPSE_BACKPROP, &sp));
+      }
+      else if (strategy[k] == config::SYNAPSE_RPROP) {
+	config::SynapseRProp sp(p[0], p[1], p[2]);
+	synapse.push_back(new Synapse(synapse_id[k], from[k], to[k],
+				      weight[k], config::SYNAPSE_RPROP, &sp));
+      }
+      else error = "Corrupted binary network file";
+    }
+  }
+  catch (...) {
+    release(neuron, synapse);
+    throw;
+  }
+
+  if (error.size()) {
+    release(neuron, synapse);
+    RINGER_DEBUG1("File \"" << filename << "\": " << error
+		  << ". Exception thrown.");
+    throw RINGER_EXCEPTION(error);
+  }
+
+  m_header = new config::Header(field[0], field[1], field[2], fh.created,
+				field[3]);
+  m_neuron.swap(neuron);
+  m_synapse.swap(synapse);
+  RINGER_DEBUG2("Binary network file \"" << filename << "\" has "
+		<< m_neuron.size() << " neuron(s) and " << m_synapse.size()
+		<< " synapse(s).");
+  RINGER_DEBUG3("Configuration created from file \"" << filename << "\".");
+}
+
+bool config::Network::save_binary (const std::string& filename)
+{
+  RINGER_DEBUG2("Trying to save binary network at \"" << filename << "\".");
+  std::string strings;
+  strings.append(m_header->author()).append(1, '\0');
+  strings.append(m_header->name()).append(1, '\0');
+  strings.append(m_header->version()).append(1, '\0');
+  strings.append(m_header->comment()).append(1, '\0');
+
+  file_header_t fh;
+  std::memset(&fh, 0, sizeof(fh));
+  std::memcpy(fh.magic, s_magic, sizeof(s_magic));
+  fh.byte_order = s_byte_order;
+  fh.version = s_version;
+  fh.neurons = m_neuron.size();
+  fh.synapses = m_synapse.size();
+  fh.created = m_header->created();
+  fh.last_saved = time(0);
+  fh.strings_size = strings.size();
+
+  std::vector<uint32_t> neuron_id, type, af, accuracy;
+  std::vector<double> bias, subtract, divide;
+  for (std::vector<Neuron*>::const_iterator it = m_neuron.begin();
+       it != m_neuron.end(); ++it) {
+    neuron_id.push_back((*it)->id());
+    type.push_back((*it)->type());
+    const config::NeuronBackProp* np =
+      dynamic_cast<const config::NeuronBackProp*>((*it)->parameters());
+    af.push_back(np? np->activation_function() : 0);
+    accuracy.push_back(np? np->accuracy() : 0);
+    bias.push_back((*it)->bias());
+    subtract.push_back((*it)->subtract());
+    divide.push_back((*it)->divide());
+  }
+
+  std::vector<uint32_t> synapse_id, from, to, strategy;
+  std::vector<double> weight, param(s_parameters*m_synapse.size(), 0);
+  for (size_t k=0; k<m_synapse.size(); ++k) {
+    const Synapse* syn = m_synapse[k];
+    synapse_id.push_back(syn->id());
+    from.push_back(syn->from());
+    to.push_back(syn->to());
+    strategy.push_back(syn->strategy());
+    weight.push_back(syn->weight());
+    double* p = &param[s_parameters*k];
+    if (syn->strategy() == config::SYNAPSE_BACKPROP) {
+      const config::SynapseBackProp* sp =
+	dynamic_cast<const config::SynapseBackProp*>(syn->parameters());
+      p[0] = sp->learning_rate();
+      p[1] = sp->momentum();
+      p[2] = sp->learning_rate_decay();
+      p[3] = sp->previous_delta();
+    }
+    else {
+      const config::SynapseRProp* sp =
+	dynamic_cast<const config::SynapseRProp*>(syn->parameters());
+      p[0] = sp->weight_update();
+      p[1] = sp->previous_delta();
+      p[2] = sp->previous_derivative();
+    }
+  }
+
+  if (!sys::backup(filename)) return false;
+  std::ofstream os(filename.c_str(), std::ios_base::out|
+		   std::ios_base::trunc|std::ios_base::binary);
+  if (!os) {
+    RINGER_DEBUG1("Cannot open \"" << filename << "\" for writing.");
+    return false;
+  }
+  os.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
+  os.write(strings.data(), strings.size());
+  put(os, neuron_id);
+  put(os, type);
+  put(os, af);
+  put(os, accuracy);
+  put(os, bias);
+  put(os, subtract);
+  put(os, divide);
+  put(os, synapse_id);
+  put(os, from);
+  put(os, to);
+  put(os, strategy);
+  put(os, weight);
+  put(os, param);
+  if (!os) {
+    RINGER_DEBUG1("Error while writing \"" << filename << "\".");
+    return false;
+  }
+  RINGER_DEBUG2("Binary network \"" << filename << "\" was saved.");
+  return true;
+}
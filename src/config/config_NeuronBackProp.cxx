@@ -11,6 +11,8 @@
 #include "TrigRingerTools/sys/Exception.h"
 
 config::NeuronBackProp::NeuronBackProp(sys::xml_ptr_const node)
+  : m_af(TANH),
+    m_accuracy(EXACT)
 {
   std::string funct = sys::get_attribute_string(node, "activationFunction");
   if (funct == "tanh") {
@@ -30,16 +32,32 @@ config::NeuronBackProp::NeuronBackProp(sys::xml_ptr_const node)
 		<< "\" is unknown to RINGER. Exception thrown.");
     throw RINGER_EXCEPTION("Unknown backprop activation function");
   }
+  std::string accuracy = sys::get_attribute_string(node, "accuracy");
+  if (accuracy == "" || accuracy == "exact") m_accuracy = EXACT;
+  else if (accuracy == "1e-7") {
+    RINGER_DEBUG2("I will approximate the activation function to 1e-7.");
+    m_accuracy = FINE;
+  }
+  else if (accuracy == "1e-4") {
+    RINGER_DEBUG2("I will approximate the activation function to 1e-4.");
+    m_accuracy = COARSE;
+  }
+  else {
+    RINGER_DEBUG1("Backpropagation activation accuracy \"" << accuracy
+		<< "\" is unknown to RINGER. Exception thrown.");
+    throw RINGER_EXCEPTION("Unknown backprop activation accuracy");
+  }
 }
 
 config::NeuronBackProp::NeuronBackProp
-(const ActivationFunction& af)
-  : m_af(af)
+(const ActivationFunction& af, const Accuracy& accuracy)
+  : m_af(af),
+    m_accuracy(accuracy)
 {
 }
 
 config::NeuronBackProp::NeuronBackProp(const NeuronBackProp& other)
-  : Parameter(), m_af(other.m_af)
+  : Parameter(), m_af(other.m_af), m_accuracy(other.m_accuracy)
 {
 }
 
@@ -47,12 +65,13 @@ config::NeuronBackProp& config::NeuronBackProp::operator=
 (const NeuronBackProp& other)
 {
   m_af = other.m_af;
+  m_accuracy = other.m_accuracy;
   return *this;
 }
 
 config::Parameter* config::NeuronBackProp::clone () const
 {
-  return new NeuronBackProp(m_af);
+  return new NeuronBackProp(m_af, m_accuracy);
 }
 
 sys::xml_ptr config::NeuronBackProp::node (sys::xml_ptr any)
@@ -69,6 +88,16 @@ sys::xml_ptr config::NeuronBackProp::node (sys::xml_ptr any)
     sys::put_attribute_text(root, "activationFunction", "linear");
     break;
   }
+  switch (m_accuracy) {
+  case EXACT: //the default, not written
+    break;
+  case FINE:
+    sys::put_attribute_text(root, "accuracy", "1e-7");
+    break;
+  case COARSE:
+    sys::put_attribute_text(root, "accuracy", "1e-4");
+    break;
+  }
   return root;
 }
 
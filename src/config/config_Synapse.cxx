@@ -13,8 +13,6 @@
 #include <string>
 #include <cstdlib>
 
-static data::RandomInteger static_rnd; //default initializer, do it once
-
 config::Synapse::Synapse(sys::xml_ptr_const node)
   : m_params(0)
 {
@@ -32,7 +30,7 @@ config::Synapse::Synapse(sys::xml_ptr_const node)
     c = sys::get_next_element(c);
   }
   else { //select it randomly between -1 and 1
-    m_weight = static_rnd.draw(RAND_MAX);
+    m_weight = data::RandomInteger::next_stream().draw(RAND_MAX);
     m_weight -= ((double)RAND_MAX)/2;
     m_weight /= ((double)RAND_MAX)/2;
     RINGER_DEBUG2("Selected random initial weight for synapse " << m_id
@@ -14,14 +14,16 @@ config::SynapseBackProp::SynapseBackProp(sys::xml_ptr_const node)
   m_learn_rate = sys::get_attribute_double(node, "learnRate");
   m_momentum = sys::get_attribute_double(node, "momentum");
   m_learn_rate_decay = sys::get_attribute_double(node, "learnRateDecay");
+  m_prev_delta = sys::get_attribute_double(node, "previousDelta");
 }
 
 config::SynapseBackProp::SynapseBackProp
 (const double& learning_rate, const double& momentum,
- const double& learning_rate_decay)
+ const double& learning_rate_decay, const double& previous_delta)
   : m_learn_rate(learning_rate),
     m_momentum(momentum),
-    m_learn_rate_decay(learning_rate_decay)
+    m_learn_rate_decay(learning_rate_decay),
+    m_prev_delta(previous_delta)
 {
 }
 
@@ -29,7 +31,8 @@ config::SynapseBackProp::SynapseBackProp (const SynapseBackProp& other)
   : Parameter(),
     m_learn_rate(other.m_learn_rate),
     m_momentum(other.m_momentum),
-    m_learn_rate_decay(other.m_learn_rate_decay)
+    m_learn_rate_decay(other.m_learn_rate_decay),
+    m_prev_delta(other.m_prev_delta)
 {
 }
 
@@ -39,12 +42,14 @@ config::SynapseBackProp& config::SynapseBackProp::operator=
   m_learn_rate = other.m_learn_rate;
   m_momentum = other.m_momentum;
   m_learn_rate_decay = other.m_learn_rate_decay;
+  m_prev_delta = other.m_prev_delta;
   return *this;
 }
 
 config::Parameter* config::SynapseBackProp::clone () const
 {
-  return new SynapseBackProp(m_learn_rate, m_momentum, m_learn_rate_decay);
+  return new SynapseBackProp(m_learn_rate, m_momentum, m_learn_rate_decay,
+			     m_prev_delta);
 }
 
 sys::xml_ptr config::SynapseBackProp::node (sys::xml_ptr any)
@@ -53,5 +58,7 @@ sys::xml_ptr config::SynapseBackProp::node (sys::xml_ptr any)
   sys::put_attribute_double(root, "learnRate", m_learn_rate);
   sys::put_attribute_double(root, "momentum", m_momentum);
   sys::put_attribute_double(root, "learnRateDecay", m_learn_rate_decay);
+  if (m_prev_delta) //only once trained
+    sys::put_attribute_double(root, "previousDelta", m_prev_delta);
   return root;
 }
@@ -12,16 +12,24 @@
 config::SynapseRProp::SynapseRProp(sys::xml_ptr_const node)
 {
   m_weight_update = sys::get_attribute_double(node, "weightUpdate");
+  m_prev_delta = sys::get_attribute_double(node, "previousDelta");
+  m_prev_deriv = sys::get_attribute_double(node, "previousDerivative");
 }
 
-config::SynapseRProp::SynapseRProp(const double& weight_update)
-  : m_weight_update(weight_update)
+config::SynapseRProp::SynapseRProp(const double& weight_update,
+				   const double& previous_delta,
+				   const double& previous_derivative)
+  : m_weight_update(weight_update),
+    m_prev_delta(previous_delta),
+    m_prev_deriv(previous_derivative)
 {
 }
 
 config::SynapseRProp::SynapseRProp (const SynapseRProp& other)
   : Parameter(),
-    m_weight_update(other.m_weight_update)
+    m_weight_update(other.m_weight_update),
+    m_prev_delta(other.m_prev_delta),
+    m_prev_deriv(other.m_prev_deriv)
 {
 }
 
@@ -29,17 +37,23 @@ config::SynapseRProp& config::SynapseRProp::operator=
   (const SynapseRProp& other)
 {
   m_weight_update = other.m_weight_update;
+  m_prev_delta = other.m_prev_delta;
+  m_prev_deriv = other.m_prev_deriv;
   return *this;
 }
 
 config::Parameter* config::SynapseRProp::clone () const
 {
-  return new SynapseRProp(m_weight_update);
+  return new SynapseRProp(m_weight_update, m_prev_delta, m_prev_deriv);
 }
 
 sys::xml_ptr config::SynapseRProp::node (sys::xml_ptr any)
 {
   sys::xml_ptr root = sys::make_node(any, "rBackPropagation");
   sys::put_attribute_double(root, "weightUpdate", m_weight_update);
+  if (m_prev_delta || m_prev_deriv) { //only once trained
+    sys::put_attribute_double(root, "previousDelta", m_prev_delta);
+    sys::put_attribute_double(root, "previousDerivative", m_prev_deriv);
+  }
   return root;
 }
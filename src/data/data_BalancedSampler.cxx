@@ -0,0 +1,91 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/src/BalancedSampler.cxx
+ *
+ * @brief Implements the class-balanced sampler.
+ */
+
+#include "TrigRingerTools/data/BalancedSampler.h"
+#include "TrigRingerTools/data/RandomInteger.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+
+data::BalancedSampler::BalancedSampler (const std::vector<size_t>& class_size)
+  : m_start(),
+    m_size(class_size),
+    m_index(),
+    m_total(0),
+    m_rnd(data::RandomInteger::next_stream())
+{
+  for (size_t c=0; c<m_size.size(); ++c) {
+    m_start.push_back(m_total);
+    m_total += m_size[c];
+  }
+}
+
+data::BalancedSampler::BalancedSampler
+(const std::vector<std::vector<size_t> >& class_index)
+  : m_start(class_index.size(), 0),
+    m_size(),
+    m_index(class_index),
+    m_total(0),
+    m_rnd(data::RandomInteger::next_stream())
+{
+  for (size_t c=0; c<m_index.size(); ++c) {
+    m_size.push_back(m_index[c].size());
+    m_total += m_index[c].size();
+  }
+}
+
+void data::BalancedSampler::draw (std::vector<size_t>& pats) const
+{
+  draw(pats, m_rnd);
+}
+
+void data::BalancedSampler::draw (std::vector<size_t>& pats,
+				  const data::RandomInteger& rnd) const
+{
+  if (!m_total) {
+    RINGER_DEBUG1("I cannot draw patterns from an empty set."
+		  << " Exception thrown.");
+    throw RINGER_EXCEPTION("Sampling an empty set");
+  }
+  //the first class comes from the stream, so no state is kept between draws
+  size_t c = rnd.draw(m_size.size());
+  if (c >= m_size.size()) c = m_size.size()-1;
+  for (size_t i=0; i<pats.size(); ++i) {
+    //skip empty classes, there is at least one non-empty
+    while (!m_size[c]) c = (c+1) % m_size.size();
+    size_t pos = rnd.draw(m_size[c]);
+    if (pos >= m_size[c]) pos = m_size[c]-1;
+    if (m_index.empty()) pats[i] = m_start[c] + pos;
+    else pats[i] = m_index[c][pos];
+    c = (c+1) % m_size.size();
+  }
+}
+
+void data::BalancedSampler::weights (std::vector<double>& w) const
+{
+  size_t nonempty = 0;
+  for (size_t c=0; c<m_size.size(); ++c) if (m_size[c]) ++nonempty;
+  if (m_index.empty()) {
+    w.resize(m_total);
+    for (size_t c=0; c<m_size.size(); ++c) {
+      if (!m_size[c]) continue;
+      double cw = 1.0/(nonempty*m_size[c]);
+      for (size_t i=m_start[c]; i<m_start[c]+m_size[c]; ++i) w[i] = cw;
+    }
+    return;
+  }
+  size_t last = 0;
+  for (size_t c=0; c<m_index.size(); ++c)
+    for (size_t i=0; i<m_index[c].size(); ++i)
+      if (m_index[c][i] >= last) last = m_index[c][i]+1;
+  w.assign(last, 0);
+  for (size_t c=0; c<m_index.size(); ++c) {
+    if (!m_size[c]) continue;
+    double cw = 1.0/(nonempty*m_size[c]);
+    for (size_t i=0; i<m_index[c].size(); ++i) w[m_index[c][i]] = cw;
+  }
+}
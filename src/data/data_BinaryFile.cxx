@@ -0,0 +1,323 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/src/BinaryFile.cxx
+ *
+ * @brief Implements the memory-mapped binary database file.
+ */
+
+#include "TrigRingerTools/data/BinaryFile.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/util.h"
+#include <fstream>
+#include <cstring>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * The magic string that starts every binary database file
+ */
+static const char s_magic[8] = { 'R', 'I', 'N', 'G', 'B', 'I', 'N', 0 };
+
+/**
+ * Written as is, so the reader can detect foreign byte orders
+ */
+static const uint32_t s_byte_order = 0x01020304;
+
+/**
+ * The current version of the file layout
+ */
+static const uint32_t s_version = 3;
+
+/**
+ * Alignment of the feature and attribute blocks, in bytes
+ */
+static const uint64_t s_align = 64;
+
+/**
+ * The fixed size header at the start of the file
+ */
+typedef struct file_header_t {
+  char magic[8]; ///< s_magic
+  uint32_t byte_order; ///< s_byte_order, in the writer byte order
+  uint32_t version; ///< s_version
+  uint32_t feature_size; ///< sizeof(data::Feature) in the writer
+  uint32_t reserved; ///< zero, keeps the rest aligned
+  uint64_t classes; ///< number of classes
+  uint64_t pattern_size; ///< number of features in each entry
+  int64_t created; ///< database creation time
+  int64_t last_saved; ///< database last saving time
+  uint64_t strings; ///< where the string table starts
+  uint64_t strings_size; ///< the string table size
+} file_header_t;
+
+/**
+ * One entry of the class table, just after the header
+ */
+typedef struct file_class_t {
+  uint64_t name; ///< the class name position in the string table
+  uint64_t size; ///< number of entries
+  uint64_t features; ///< where the features start
+  uint64_t attributes; ///< where the attributes start, or 0
+} file_class_t;
+
+/**
+ * Rounds an offset up to the feature block alignment
+ */
+static inline uint64_t align (uint64_t offset)
+{ return (offset + s_align - 1) / s_align * s_align; }
+
+data::BinaryFile::BinaryFile (const std::string& filename,
+			      sys::Reporter* reporter)
+  : m_filename(filename),
+    m_base(MAP_FAILED),
+    m_length(0),
+    m_header(0),
+    m_class(),
+    m_reporter(reporter)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    RINGER_WARN(m_reporter, "Could not open file \"" << filename << "\"."
+		<< " Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot open binary database file");
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    m_length = st.st_size;
+    m_base = mmap(0, m_length, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+  }
+  close(fd); //the mapping stays valid
+  if (m_base == MAP_FAILED) {
+    RINGER_WARN(m_reporter, "Could not map file \"" << filename << "\"."
+		<< " Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot map binary database file");
+  }
+
+  const char* base = static_cast<const char*>(m_base);
+  const file_header_t* fh = reinterpret_cast<const file_header_t*>(base);
+  std::string error;
+  if (m_length < sizeof(file_header_t) ||
+      std::memcmp(fh->magic, s_magic, sizeof(s_magic)))
+    error = "Not a binary database file";
+  else if (fh->byte_order != s_byte_order)
+    error = "Binary database file written with a different byte order";
+  else if (fh->version != s_version)
+    error = "Unsupported binary database file version";
+  else if (fh->feature_size != sizeof(data::Feature))
+    error = "Binary database file written with another Feature precision";
+  else if (sizeof(file_header_t) + fh->classes*sizeof(file_class_t) > m_length
+	   || fh->strings + fh->strings_size > m_length
+	   || fh->strings_size == 0
+	   || base[fh->strings + fh->strings_size - 1] != 0)
+    error = "Truncated binary database file";
+
+  //the header strings are the first 4 in the string table
+  const char* strings = error.size()? 0 : base + fh->strings;
+  const char* field[4];
+  size_t pos = 0;
+  for (size_t i=0; i<4 && !error.size(); ++i) {
+    if (pos >= fh->strings_size) {
+      error = "Truncated binary database file";
+      break;
+    }
+    field[i] = strings + pos;
+    pos += std::strlen(field[i]) + 1;
+  }
+
+  const file_class_t* table =
+    reinterpret_cast<const file_class_t*>(base + sizeof(file_header_t));
+  for (size_t c=0; !error.size() && c<fh->classes; ++c) {
+    uint64_t features =
+      table[c].size * fh->pattern_size * sizeof(data::Feature);
+    uint64_t attributes = table[c].size * sizeof(BinaryAttribute);
+    if (table[c].name >= fh->strings_size ||
+	table[c].features % sizeof(data::Feature) ||
+	table[c].features + features > m_length ||
+	(table[c].attributes &&
+	 table[c].attributes + attributes > m_length)) {
+      error = "Truncated binary database file";
+      break;
+    }
+    BinaryClassInfo info;
+    info.name = strings + table[c].name;
+    info.data = reinterpret_cast<data::Feature*>
+      (static_cast<char*>(m_base) + table[c].features);
+    info.attr = 0;
+    if (table[c].attributes)
+      info.attr = reinterpret_cast<const BinaryAttribute*>
+	(base + table[c].attributes);
+    info.size = table[c].size;
+    info.pattern_size = fh->pattern_size;
+    m_class.push_back(info);
+  }
+
+  if (error.size()) {
+    munmap(m_base, m_length);
+    RINGER_DEBUG1("File \"" << filename << "\": " << error
+		  << ". Exception thrown.");
+    throw RINGER_EXCEPTION(error);
+  }
+
+  m_header = new data::Header(field[0], field[1], field[2], fh->created,
+			      field[3]);
+  RINGER_DEBUG2("Mapped binary database \"" << filename << "\" with "
+		<< m_class.size() << " classes in " << m_length << " bytes.");
+}
+
+bool data::BinaryFile::merged (BinaryClassInfo& info) const
+{
+  if (m_class.empty()) return false;
+  for (size_t c=1; c<m_class.size(); ++c) {
+    const BinaryClassInfo& prev = m_class[c-1];
+    if (!(prev.name < m_class[c].name) ||
+	m_class[c].data != prev.data + prev.size*prev.pattern_size ||
+	(prev.attr == 0) != (m_class[c].attr == 0) ||
+	(prev.attr && m_class[c].attr != prev.attr + prev.size)) {
+      RINGER_DEBUG2("Classes of \"" << m_filename << "\" are not stored in"
+		    << " merging order.");
+      return false;
+    }
+  }
+  info = m_class[0];
+  info.name = "merged";
+  info.size = 0;
+  for (size_t c=0; c<m_class.size(); ++c) info.size += m_class[c].size;
+  return true;
+}
+
+bool data::BinaryFile::is_binary (const std::string& filename)
+{
+  std::ifstream is(filename.c_str(), std::ios_base::in|std::ios_base::binary);
+  char magic[sizeof(s_magic)];
+  is.read(magic, sizeof(magic));
+  return is && !std::memcmp(magic, s_magic, sizeof(s_magic));
+}
+
+data::BinaryFile::~BinaryFile()
+{
+  delete m_header;
+  munmap(m_base, m_length);
+  RINGER_DEBUG3("Unmapped binary database \"" << m_filename << "\".");
+}
+
+/**
+ * Writes zeros to a stream until it reaches a certain position
+ *
+ * @param os The stream to write to
+ * @param pos The current position, which is updated
+ * @param to Where to stop padding
+ */
+static void pad (std::ostream& os, uint64_t& pos, uint64_t to)
+{
+  for (; pos < to; ++pos) os.put(0);
+}
+
+bool data::BinaryFile::write
+(const std::string& filename, const data::Header* header,
+ const std::vector<std::string>& name,
+ const std::vector<const data::PatternSet*>& set,
+ const std::vector<const std::vector<data::RoIPatternSet::RoIAttribute>*>& attr)
+{
+  RINGER_DEBUG2("Checking existence of \"" << filename << "\" first.");
+  if (!sys::backup(filename)) return false;
+
+  //string table: the header fields, then the class names
+  std::string strings;
+  strings.append(header->author()).append(1, '\0');
+  strings.append(header->name()).append(1, '\0');
+  strings.append(header->version()).append(1, '\0');
+  strings.append(header->comment()).append(1, '\0');
+
+  file_header_t fh;
+  std::memset(&fh, 0, sizeof(fh));
+  std::memcpy(fh.magic, s_magic, sizeof(s_magic));
+  fh.byte_order = s_byte_order;
+  fh.version = s_version;
+  fh.feature_size = sizeof(data::Feature);
+  fh.classes = set.size();
+  fh.pattern_size = set.size()? set[0]->pattern_size() : 0;
+  fh.created = header->created();
+  fh.last_saved = time(0);
+
+  std::vector<file_class_t> table(set.size());
+  for (size_t c=0; c<set.size(); ++c) {
+    if (set[c]->pattern_size() != fh.pattern_size) {
+      RINGER_DEBUG1("Class \"" << name[c] << "\" has pattern size "
+		    << set[c]->pattern_size() << " instead of "
+		    << fh.pattern_size << ". Exception thrown.");
+      throw RINGER_EXCEPTION("Uncoherent database (different pattern sizes)");
+    }
+    table[c].name = strings.size();
+    strings.append(name[c]).append(1, '\0');
+    table[c].size = set[c]->size();
+  }
+  fh.strings = sizeof(file_header_t) + set.size()*sizeof(file_class_t);
+  fh.strings_size = strings.size();
+
+  //lays out the features of all classes, then their attributes
+  uint64_t offset = align(fh.strings + fh.strings_size);
+  for (size_t c=0; c<set.size(); ++c) {
+    table[c].features = offset;
+    offset += table[c].size*fh.pattern_size*sizeof(data::Feature);
+  }
+  offset = align(offset);
+  for (size_t c=0; c<set.size(); ++c) {
+    table[c].attributes = 0;
+    if (attr[c]) {
+      table[c].attributes = offset;
+      offset += table[c].size*sizeof(BinaryAttribute);
+    }
+  }
+
+  std::ofstream os(filename.c_str(), std::ios_base::out|
+		   std::ios_base::trunc|std::ios_base::binary);
+  if (!os) {
+    RINGER_DEBUG1("Cannot open \"" << filename << "\" for writing.");
+    return false;
+  }
+  os.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
+  if (table.size())
+    os.write(reinterpret_cast<const char*>(&table[0]),
+	     table.size()*sizeof(file_class_t));
+  os.write(strings.data(), strings.size());
+  uint64_t pos = fh.strings + fh.strings_size;
+
+  std::vector<data::Feature> row(fh.pattern_size);
+  for (size_t c=0; c<set.size(); ++c) {
+    pad(os, pos, table[c].features);
+    for (size_t i=0; i<set[c]->size(); ++i) {
+      const data::Pattern p = set[c]->pattern(i);
+      const data::Feature* f = p.data();
+      for (size_t j=0; j<row.size(); ++j) row[j] = f[j*p.stride()];
+      os.write(reinterpret_cast<const char*>(&row[0]),
+	       row.size()*sizeof(data::Feature));
+    }
+    pos += table[c].size*fh.pattern_size*sizeof(data::Feature);
+  }
+  for (size_t c=0; c<set.size(); ++c) {
+    if (attr[c]) {
+      pad(os, pos, table[c].attributes);
+      for (size_t i=0; i<attr[c]->size(); ++i) {
+	BinaryAttribute a;
+	a.lvl1_id = (*attr[c])[i].lvl1_id;
+	a.roi_id = (*attr[c])[i].roi_id;
+	a.eta = (*attr[c])[i].eta;
+	a.phi = (*attr[c])[i].phi;
+	os.write(reinterpret_cast<const char*>(&a), sizeof(a));
+      }
+      pos += table[c].size*sizeof(BinaryAttribute);
+    }
+  }
+  if (!os) {
+    RINGER_DEBUG1("Error while writing \"" << filename << "\".");
+    return false;
+  }
+  RINGER_DEBUG2("Binary database \"" << filename << "\" was saved.");
+  return true;
+}
@@ -7,14 +7,19 @@
  */
 
 #include "TrigRingerTools/data/EnergyNormaliseOperator.h"
-#include <gsl/gsl_blas.h>
+#include <cmath>
 
 void data::EnergyNormaliseOperator::operator() (const data::Pattern& in, 
 						data::Pattern& out) const
 {
   out = in;
-  const gsl_vector* v = abuse(in);
-  out /= gsl_blas_dnrm2(v);
+  const data::FeatureVector* v = abuse(in);
+  double energy = 0; //accumulated in double, whatever the Feature precision
+  for (size_t i=0; i<v->size; ++i) {
+    double f = v->data[i*v->stride];
+    energy += f*f;
+  }
+  out /= std::sqrt(energy);
 }
 
 
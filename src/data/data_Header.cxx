@@ -78,7 +78,7 @@ data::Header& data::Header::operator= (const Header& other)
   return *this;
 }
 
-sys::xml_ptr data::Header::node (sys::xml_ptr any)
+sys::xml_ptr data::Header::node (sys::xml_ptr any) const
 {
   sys::xml_ptr root = sys::make_node(any, "header");
   sys::put_element_text(root, "author", m_author);
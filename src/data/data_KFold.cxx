@@ -0,0 +1,96 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/src/KFold.cxx
+ *
+ * @brief Implements the stratified k-fold splitter.
+ */
+
+#include "TrigRingerTools/data/KFold.h"
+#include "TrigRingerTools/data/RandomInteger.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+#include <algorithm>
+
+data::KFold::KFold (const std::vector<size_t>& class_size, const size_t k,
+		    const bool shuffle)
+  : m_fold()
+{
+  build(class_size, k, shuffle);
+}
+
+void data::KFold::build (const std::vector<size_t>& class_size, 
+			 const size_t k, const bool shuffle)
+{
+  if (k < 2) {
+    RINGER_DEBUG1("I cannot split a set in " << k << " folds. Exception"
+		  << " thrown.");
+    throw RINGER_EXCEPTION("K-fold needs at least 2 folds");
+  }
+  m_fold.assign(k, std::vector<std::vector<size_t> >(class_size.size()));
+  data::RandomInteger rnd = data::RandomInteger::next_stream();
+  size_t start = 0;
+  for (size_t c=0; c<class_size.size(); ++c) {
+    if (class_size[c] < k) {
+      RINGER_DEBUG1("Class " << c << " has only " << class_size[c] 
+		    << " patterns, some of the " << k 
+		    << " folds will not test it.");
+    }
+    std::vector<size_t> pos(class_size[c]);
+    for (size_t i=0; i<pos.size(); ++i) pos[i] = start + i;
+    if (shuffle) { //Fisher-Yates
+      for (size_t i=pos.size(); i>1; --i) {
+	size_t j = rnd.draw(i);
+	if (j >= i) j = i-1;
+	std::swap(pos[i-1], pos[j]);
+      }
+    }
+    for (size_t i=0; i<pos.size(); ++i) m_fold[i%k][c].push_back(pos[i]);
+    start += class_size[c];
+  }
+  RINGER_DEBUG2("Split " << start << " patterns in " << k << " folds.");
+}
+
+void data::KFold::test (const size_t f, std::vector<size_t>& pats) const
+{
+  if (f >= m_fold.size()) {
+    RINGER_DEBUG1("There is no fold " << f << ", I only have " 
+		  << m_fold.size() << ". Exception thrown.");
+    throw RINGER_EXCEPTION("Unexisting fold");
+  }
+  pats.clear();
+  for (size_t c=0; c<m_fold[f].size(); ++c)
+    pats.insert(pats.end(), m_fold[f][c].begin(), m_fold[f][c].end());
+}
+
+void data::KFold::train (const size_t f, std::vector<size_t>& pats) const
+{
+  if (f >= m_fold.size()) {
+    RINGER_DEBUG1("There is no fold " << f << ", I only have " 
+		  << m_fold.size() << ". Exception thrown.");
+    throw RINGER_EXCEPTION("Unexisting fold");
+  }
+  pats.clear();
+  for (size_t c=0; c<m_fold[f].size(); ++c)
+    for (size_t g=0; g<m_fold.size(); ++g) {
+      if (g == f) continue;
+      pats.insert(pats.end(), m_fold[g][c].begin(), m_fold[g][c].end());
+    }
+}
+
+data::BalancedSampler data::KFold::sampler (const size_t f) const
+{
+  if (f >= m_fold.size()) {
+    RINGER_DEBUG1("There is no fold " << f << ", I only have " 
+		  << m_fold.size() << ". Exception thrown.");
+    throw RINGER_EXCEPTION("Unexisting fold");
+  }
+  std::vector<std::vector<size_t> > class_index(m_fold[f].size());
+  for (size_t c=0; c<m_fold[f].size(); ++c)
+    for (size_t g=0; g<m_fold.size(); ++g) {
+      if (g == f) continue;
+      class_index[c].insert(class_index[c].end(), m_fold[g][c].begin(),
+			    m_fold[g][c].end());
+    }
+  return data::BalancedSampler(class_index);
+}
@@ -14,7 +14,7 @@
 
 data::Feature data::MaxExtractor::operator() (const data::Pattern& in) const
 {
-  return gsl_vector_max(abuse(in));
+  return RINGER_GSL_VECTOR(max)(abuse(in));
 }
 
 
@@ -7,12 +7,12 @@
  */
 
 #include "TrigRingerTools/data/MeanExtractor.h"
-#include <gsl/gsl_statistics_double.h>
+#include "TrigRingerTools/data/gsl_feature.h"
 
 data::Feature data::MeanExtractor::operator() (const data::Pattern& in) const
 {
-  const gsl_vector* v = abuse(in);
-  return gsl_stats_mean(v->data, v->stride, v->size);
+  const data::FeatureVector* v = abuse(in);
+  return RINGER_GSL_STATS(mean)(v->data, v->stride, v->size);
 }
 
 
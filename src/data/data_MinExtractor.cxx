@@ -14,7 +14,7 @@
 
 data::Feature data::MinExtractor::operator() (const data::Pattern& in) const
 {
-  return gsl_vector_min(abuse(in));
+  return RINGER_GSL_VECTOR(min)(abuse(in));
 }
 
 
@@ -7,6 +7,74 @@
  */
 
 #include "TrigRingerTools/data/NormalizationOperator.h"
+#include <cmath>
+
+data::NormalizationOperator::NormalizationOperator
+(const data::PatternSet& ps, const std::vector<double>& w)
+  : m_mean(ps.pattern_size(),0),
+    m_sd(ps.pattern_size(),1)
+{
+  std::vector<data::Feature> weight(w.begin(), w.end()); //GSL precision
+  weight.resize(ps.size(), 0);
+  for (unsigned int i=0; i<ps.pattern_size(); ++i) { //for all ensembles
+    data::Ensemble e = ps.ensemble(i);
+    const data::FeatureVector* v = abuse(e);
+    m_mean[i] = RINGER_GSL_STATS(wmean)(&weight[0], 1, v->data, v->stride,
+					v->size);
+    m_sd[i] = RINGER_GSL_STATS(wsd_m)(&weight[0], 1, v->data, v->stride,
+				      v->size, m_mean[i]);
+    if (m_sd[i] < 1e-5) m_sd[i] = 1; ///to prevent overflowing...
+    RINGER_DEBUG1("Weighted mean for ensemble[" << i << "] is " 
+		  << m_mean[i]);
+    RINGER_DEBUG1("Weighted standard deviation for ensemble[" << i 
+		  << "] is " << m_sd[i]);
+  }
+}
+
+void data::NormalizationOperator::set
+(const std::vector<std::vector<data::StatsExtractor> >& stats,
+ const bool balanced)
+{
+  for (unsigned int i=0; i<m_mean.size(); ++i) { //for all ensembles
+    if (!balanced) { //the classes are just partitions of the database
+      data::StatsExtractor all;
+      for (size_t c=0; c<stats.size(); ++c) all.merge(stats[c][i]);
+      m_mean[i] = all.mean();
+      m_sd[i] = all.sd();
+    }
+    else {
+      //Every Pattern of a class with n Pattern's weights 1/(K*n), K being the
+      //number of non-empty classes (see BalancedSampler::weights()). The
+      //weighted mean is then the average of the class means, and the
+      //weighted variance (as in gsl_stats_wvariance()) can be written in
+      //terms of the class means and squared deviations.
+      double nonempty = 0;
+      double mean = 0;
+      for (size_t c=0; c<stats.size(); ++c) {
+	if (!stats[c][i].count()) continue;
+	nonempty += 1;
+	mean += stats[c][i].mean();
+      }
+      if (nonempty) mean /= nonempty;
+      double dev = 0;
+      double w2 = 0;
+      for (size_t c=0; c<stats.size(); ++c) {
+	const data::StatsExtractor& s = stats[c][i];
+	if (!s.count()) continue;
+	const double n = s.count();
+	const double d = s.mean() - mean;
+	dev += (s.variance()*(n-1)/n + d*d) / nonempty;
+	w2 += 1 / (nonempty*nonempty*n);
+      }
+      m_mean[i] = mean;
+      m_sd[i] = (w2 < 1)? std::sqrt(dev / (1 - w2)) : 0;
+    }
+    if (m_sd[i] < 1e-5) m_sd[i] = 1; ///to prevent overflowing...
+    RINGER_DEBUG1("Database mean for ensemble[" << i << "] is " << m_mean[i]);
+    RINGER_DEBUG1("Database standard deviation for ensemble[" << i 
+		  << "] is " << m_sd[i]);
+  }
+}
 
 void data::NormalizationOperator::operator() (const data::Pattern& in, 
 					      data::Pattern& out) const
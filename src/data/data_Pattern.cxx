@@ -7,10 +7,36 @@
  */
 
 #include "TrigRingerTools/data/Pattern.h"
+#include "TrigRingerTools/data/PatternArena.h"
 #include "TrigRingerTools/sys/Exception.h"
 #include "TrigRingerTools/sys/debug.h"
 #include "TrigRingerTools/sys/Plain.h"
 
+void data::Pattern::allocate (const size_t& s)
+{
+  if (s <= INLINE_SIZE) { //fits inside myself, no heap allocation
+    m_static_vector.size = s;
+    m_static_vector.stride = 1;
+    m_static_vector.data = m_inline;
+    m_static_vector.block = 0;
+    m_static_vector.owner = 0;
+    m_vector = &m_static_vector;
+  }
+  else m_vector = RINGER_GSL_VECTOR(alloc)(s);
+}
+
+void data::Pattern::release (void)
+{
+  if (m_vector && m_vector->owner) RINGER_GSL_VECTOR(free)(m_vector);
+  m_vector = 0;
+}
+
+bool data::Pattern::owns_storage (void) const
+{
+  if (m_vector->owner) return true;
+  return m_vector == &m_static_vector && m_static_vector.data == m_inline;
+}
+
 data::Pattern::Pattern (const size_t& s, const Feature v)
   : m_vector(0)
 {
@@ -18,26 +44,48 @@ data::Pattern::Pattern (const size_t& s, const Feature v)
     RINGER_DEBUG1("I cannot allocate a vector with size=0! Exception thrown.");
     throw RINGER_EXCEPTION("Size==0 not allowed for Patterns");
   }
-  m_vector = gsl_vector_alloc(s);
-  gsl_vector_set_all(m_vector, v);
+  allocate(s);
+  RINGER_GSL_VECTOR(set_all)(m_vector, v);
   RINGER_DEBUG3("Constructed pattern with size " << s 
 	      << " and initializer " << v);
 }
 
+data::Pattern::Pattern (const size_t& s, data::PatternArena& arena,
+			const Feature v)
+  : m_vector(0)
+{
+  if (!s) {
+    RINGER_DEBUG1("I cannot allocate a vector with size=0! Exception thrown.");
+    throw RINGER_EXCEPTION("Size==0 not allowed for Patterns");
+  }
+  if (s <= INLINE_SIZE) allocate(s);
+  else {
+    m_static_vector.size = s;
+    m_static_vector.stride = 1;
+    m_static_vector.data = arena.allocate(s);
+    m_static_vector.block = 0;
+    m_static_vector.owner = 0;
+    m_vector = &m_static_vector;
+  }
+  RINGER_GSL_VECTOR(set_all)(m_vector, v);
+  RINGER_DEBUG3("Constructed pattern with size " << s 
+	      << " and initializer " << v << " from arena");
+}
+
 data::Pattern::Pattern(const std::vector<data::Feature>& feat)
   : m_vector(0)
 {
-  m_vector = gsl_vector_alloc(feat.size());
+  allocate(feat.size());
   for (unsigned int i=0; i<feat.size(); ++i)
-    gsl_vector_set(m_vector, i, feat[i]);
+    RINGER_GSL_VECTOR(set)(m_vector, i, feat[i]);
   RINGER_DEBUG3("Constructed pattern from feature vector");
 }
 
 data::Pattern::Pattern(const Pattern& other)
   : m_vector(0)
 {
-  m_vector = gsl_vector_alloc(other.m_vector->size);
-  gsl_vector_memcpy(m_vector, other.m_vector);
+  allocate(other.m_vector->size);
+  RINGER_GSL_VECTOR(memcpy)(m_vector, other.m_vector);
   RINGER_DEBUG3("Constructed pattern from another pattern (copy construct)");
 }
 
@@ -49,7 +97,7 @@ data::Pattern::Pattern(Feature *pattern, size_t featSize)
 	m_vector->data = pattern;
 	m_vector->size = featSize;
 	m_vector->owner = 0;
-	m_vector->block = (gsl_block*) pattern;
+	m_vector->block = (data::FeatureBlock*) pattern;
   RINGER_DEBUG3("Constructed pattern from previously allocated memory");
 }
 */
@@ -60,15 +108,15 @@ data::Pattern::~Pattern()
 #if RINGER_DEBUG>2
   std::string message = "Destroying pattern ";
   if (m_vector->owner) message += "with private memory allocation.";
-  else message += "with a view (no memory allocation).";
+  else message += "with a view, inline or arena memory (no allocation).";
   RINGER_DEBUG3(message);
 #endif
   //this works because I cannot build a vector using another artifact than by
   //memory copying or through a view. Therefore, if I own the vector memory
   //allocated through the block underneath `m_vector', I should delete the
-  //vector, otherwise, it was created through a view and should not be
-  //deleted.
-  if (m_vector && m_vector->owner) gsl_vector_free(m_vector);
+  //vector, otherwise, it was created through a view, inside myself or in an
+  //arena and should not be deleted.
+  release();
 }
 
 data::Pattern& data::Pattern::apply
@@ -76,7 +124,7 @@ data::Pattern& data::Pattern::apply
 {
   RINGER_DEBUG3("Applying function to pattern features one-by-one.");
   for (unsigned int i=0; i<m_vector->size; ++i) {
-    Feature* tmp = gsl_vector_ptr(m_vector, i);
+    Feature* tmp = RINGER_GSL_VECTOR(ptr)(m_vector, i);
     *tmp = fct(*tmp);
   }
   return *this;
@@ -86,17 +134,17 @@ data::Pattern& data::Pattern::operator= (const Pattern& other)
 {
   RINGER_DEBUG3("Pattern assignment operator called (RHS=Pattern).");
   if (size() != other.size()) {
-    if (m_vector && m_vector->owner) gsl_vector_free(m_vector);
-    m_vector = gsl_vector_alloc(other.size());
+    release();
+    allocate(other.size());
   }
-  gsl_vector_memcpy(m_vector, other.m_vector);
+  RINGER_GSL_VECTOR(memcpy)(m_vector, other.m_vector);
   return *this;
 }
 
 data::Pattern& data::Pattern::operator= (const Feature& value)
 {
   RINGER_DEBUG3("Pattern assignment operator called (RHS=Feature).");
-  gsl_vector_set_all(m_vector, value);
+  RINGER_GSL_VECTOR(set_all)(m_vector, value);
   return *this;
 }
 
@@ -107,25 +155,25 @@ size_t data::Pattern::size () const
 
 data::Pattern& data::Pattern::operator+= (const Feature& val)
 {
-  gsl_vector_add_constant(m_vector, val);
+  RINGER_GSL_VECTOR(add_constant)(m_vector, val);
   return *this;
 }
 
 data::Pattern& data::Pattern::operator-= (const Feature& val)
 {
-  gsl_vector_add_constant(m_vector, -val);
+  RINGER_GSL_VECTOR(add_constant)(m_vector, -val);
   return *this;
 }
 
 data::Pattern& data::Pattern::operator*= (const Feature& val)
 {
-  gsl_vector_scale(m_vector, val);
+  RINGER_GSL_VECTOR(scale)(m_vector, val);
   return *this;
 }
 
 data::Pattern& data::Pattern::operator/= (const Feature& val)
 {
-  gsl_vector_scale(m_vector, 1/val);
+  RINGER_GSL_VECTOR(scale)(m_vector, 1/val);
   return *this;
 }
 
@@ -137,25 +185,25 @@ data::Pattern& data::Pattern::operator/= (const Feature& val)
  */
 data::Pattern& data::Pattern::operator+= (const data::Pattern& other)
 {
-  gsl_vector_add(m_vector, other.m_vector);
+  RINGER_GSL_VECTOR(add)(m_vector, other.m_vector);
   return *this;
 }
 
 data::Pattern& data::Pattern::operator-= (const data::Pattern& other)
 {
-  gsl_vector_sub(m_vector, other.m_vector);
+  RINGER_GSL_VECTOR(sub)(m_vector, other.m_vector);
   return *this;
 }
 
 data::Pattern& data::Pattern::operator*= (const data::Pattern& other)
 {
-  gsl_vector_mul(m_vector, other.m_vector);
+  RINGER_GSL_VECTOR(mul)(m_vector, other.m_vector);
   return *this;
 }
 
 data::Pattern& data::Pattern::operator/= (const data::Pattern& other)
 {
-  gsl_vector_div(m_vector, other.m_vector);
+  RINGER_GSL_VECTOR(div)(m_vector, other.m_vector);
   return *this;
 }
 
@@ -166,7 +214,7 @@ data::Feature& data::Pattern::operator[] (const size_t& pos)
 		<< " An exception is thrown.");
     throw RINGER_EXCEPTION("Invalid range");
   }
-  return *(gsl_vector_ptr(m_vector, pos));
+  return *(RINGER_GSL_VECTOR(ptr)(m_vector, pos));
 }
 
 const data::Feature& data::Pattern::operator[] (const size_t& pos) const
@@ -176,10 +224,10 @@ const data::Feature& data::Pattern::operator[] (const size_t& pos) const
 		<< " An exception is thrown.");
     throw RINGER_EXCEPTION("Invalid range");
   }
-  return *(gsl_vector_ptr(m_vector, pos));
+  return *(RINGER_GSL_VECTOR(ptr)(m_vector, pos));
 }
 
-data::Pattern::Pattern (gsl_vector_view vector_view)
+data::Pattern::Pattern (data::FeatureVectorView vector_view)
   : m_view(vector_view),
     m_vector(&m_view.vector)
 {
@@ -201,17 +249,23 @@ std::ostream& operator<< (std::ostream& os, const data::Pattern& p)
 void data::Pattern::append (const Pattern& other)
 {
   RINGER_DEBUG3("Appending contents to a Pattern.");
-  if (m_vector && m_vector->owner) {
-    gsl_vector* tmp = m_vector;
-    m_vector = gsl_vector_alloc(tmp->size + other.size());
-    gsl_vector_view view = gsl_vector_subvector(m_vector, 0, tmp->size);
-    gsl_vector_memcpy(&(view.vector), tmp);
-    view = gsl_vector_subvector(m_vector, tmp->size, other.size());
-    gsl_vector_free(tmp);
-    gsl_vector_memcpy(&(view.vector), other.m_vector);
+  if (owns_storage()) {
+    //keeps my contents aside while I move to a larger storage
+    std::vector<data::Feature> tmp(size());
+    for (size_t i=0; i<tmp.size(); ++i) 
+      tmp[i] = *RINGER_GSL_VECTOR(ptr)(m_vector, i);
+    release();
+    allocate(tmp.size() + other.size());
+    for (size_t i=0; i<tmp.size(); ++i)
+      RINGER_GSL_VECTOR(set)(m_vector, i, tmp[i]);
+    data::FeatureVectorView view =
+      RINGER_GSL_VECTOR(subvector)(m_vector, tmp.size(), other.size());
+    RINGER_GSL_VECTOR(memcpy)(&(view.vector), other.m_vector);
     return;
   }
-  RINGER_DEBUG1("I don't own the vector I have, I cannot append.");
+  RINGER_DEBUG1("I don't own the vector I have, I cannot append."
+		<< " Exception thrown.");
+  throw RINGER_EXCEPTION("Cannot append to a Pattern that is a view");
 }
 
 
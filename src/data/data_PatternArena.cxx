@@ -0,0 +1,51 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/src/PatternArena.cxx
+ *
+ * @brief Implements the pool of memory for transient Pattern's.
+ */
+
+#include "TrigRingerTools/data/PatternArena.h"
+#include "TrigRingerTools/sys/debug.h"
+
+data::PatternArena::PatternArena (const size_t& chunk)
+  : m_chunk(chunk? chunk : 1),
+    m_data(),
+    m_size(),
+    m_current(0),
+    m_used(0)
+{
+}
+
+data::PatternArena::~PatternArena()
+{
+  for (size_t i=0; i<m_data.size(); ++i) delete[] m_data[i];
+}
+
+data::Feature* data::PatternArena::allocate (const size_t& n)
+{
+  //look for room in the current chunk or in the ones kept from before
+  while (m_current < m_data.size()) {
+    if (m_size[m_current] - m_used >= n) {
+      data::Feature* retval = m_data[m_current] + m_used;
+      m_used += n;
+      return retval;
+    }
+    ++m_current;
+    m_used = 0;
+  }
+  const size_t size = (n > m_chunk)? n : m_chunk;
+  RINGER_DEBUG3("Arena allocating a new chunk of " << size << " Feature's.");
+  m_data.push_back(new data::Feature[size]);
+  m_size.push_back(size);
+  m_current = m_data.size() - 1;
+  m_used = n;
+  return m_data[m_current];
+}
+
+void data::PatternArena::reset (void)
+{
+  m_current = 0;
+  m_used = 0;
+}
@@ -8,29 +8,128 @@
 
 #include "TrigRingerTools/data/RandomInteger.h"
 #include <ctime>
-#include <cstdlib>
+#include <pthread.h>
 
 /**
- * Initialisation
+ * The process seed, zero until set or first used
  */
-static data::RandomInteger s_rnd(time(0));
+static uint64_t s_seed = 0;
 
-data::RandomInteger::RandomInteger (const size_t& seed)
-  : m_seed(seed)
+/**
+ * The last stream handed by next_stream()
+ */
+static uint64_t s_stream = 0;
+
+/**
+ * Protects the process seed and stream counter
+ */
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The golden ratio increment of SplitMix64
+ */
+static const uint64_t s_gamma = 0x9E3779B97F4A7C15ULL;
+
+/**
+ * SplitMix64's finaliser: a bijective hash of 64-bit integers with good
+ * avalanche, so consecutive counters give uncorrelated outputs.
+ *
+ * @param z The value to hash
+ */
+static inline uint64_t mix (uint64_t z)
+{
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * Maps a random 64-bit value to [0, max). For maximums that fit 32 bits,
+ * the upper half is scaled by a multiplication, which is faster and less
+ * biased than a modulo.
+ *
+ * @param x The random value
+ * @param max The maximum (excluded)
+ */
+static inline size_t scale (uint64_t x, uint64_t max)
 {
-  if (seed != 0) srand(seed);
-  else srand(time(0));
+  if (max <= 0xFFFFFFFFULL) return ((x >> 32) * max) >> 32;
+  return x % max;
+}
+
+/**
+ * Returns the process seed, initialising it if needed. Should be called
+ * with s_lock held.
+ */
+static uint64_t process_seed (void)
+{
+  if (!s_seed) s_seed = time(0);
+  return s_seed;
+}
+
+data::RandomInteger::RandomInteger (const size_t& seed, const size_t& stream)
+  : m_seed(seed),
+    m_key(0),
+    m_counter(0)
+{
+  if (!m_seed) {
+    pthread_mutex_lock(&s_lock);
+    m_seed = process_seed();
+    pthread_mutex_unlock(&s_lock);
+  }
+  m_key = mix(mix(m_seed) + (stream+1)*s_gamma);
+}
+
+data::RandomInteger data::RandomInteger::stream (const size_t& id) const
+{
+  data::RandomInteger retval(*this);
+  retval.m_key = mix(m_key + (id+1)*s_gamma);
+  retval.m_counter = 0;
+  return retval;
+}
+
+void data::RandomInteger::set_seed (const size_t& seed)
+{
+  pthread_mutex_lock(&s_lock);
+  s_seed = seed;
+  s_stream = 0;
+  pthread_mutex_unlock(&s_lock);
+}
+
+size_t data::RandomInteger::seed (void)
+{
+  pthread_mutex_lock(&s_lock);
+  size_t retval = process_seed();
+  pthread_mutex_unlock(&s_lock);
+  return retval;
+}
+
+data::RandomInteger data::RandomInteger::next_stream (void)
+{
+  pthread_mutex_lock(&s_lock);
+  size_t seed = process_seed();
+  size_t stream = ++s_stream;
+  pthread_mutex_unlock(&s_lock);
+  return data::RandomInteger(seed, stream);
 }
 
 size_t data::RandomInteger::draw (const size_t& max) const
 {
-  double cache = (static_cast<double>(rand())/RAND_MAX)*max;
-  return static_cast<size_t>(cache);
+  return scale(mix(m_key + (++m_counter)*s_gamma), max);
 }
 
-void data::RandomInteger::draw 
+void data::RandomInteger::draw
 (const size_t& max, std::vector<size_t>& c) const
 {
-  for (size_t i=0; i<c.size(); ++i) c[i] = draw(max);
+  const uint64_t key = m_key;
+  const uint64_t start = m_counter + 1;
+  const size_t n = c.size();
+  if (max <= 0xFFFFFFFFULL) { //the common case, w/o branches in the loop
+    for (size_t i=0; i<n; ++i)
+      c[i] = ((mix(key + (start+i)*s_gamma) >> 32) * max) >> 32;
+  }
+  else {
+    for (size_t i=0; i<n; ++i) c[i] = mix(key + (start+i)*s_gamma) % max;
+  }
+  m_counter += n;
 }
-
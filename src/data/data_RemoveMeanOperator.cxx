@@ -7,14 +7,14 @@
  */
 
 #include "TrigRingerTools/data/RemoveMeanOperator.h"
-#include <gsl/gsl_statistics_double.h>
+#include "TrigRingerTools/data/gsl_feature.h"
 
 void data::RemoveMeanOperator::operator() (const data::Pattern& in, 
 					   data::Pattern& out) const
 {
   out = in;
-  const gsl_vector* v = abuse(in);
-  out -= gsl_stats_mean(v->data, v->stride, v->size);
+  const data::FeatureVector* v = abuse(in);
+  out -= RINGER_GSL_STATS(mean)(v->data, v->stride, v->size);
 }
 
 
@@ -8,19 +8,27 @@
  */
 
 #include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/data/XmlStreamReader.h"
+#include "TrigRingerTools/data/BinaryFile.h"
+#include "TrigRingerTools/data/XmlStreamWriter.h"
 #include "TrigRingerTools/sys/Exception.h"
 #include "TrigRingerTools/sys/debug.h"
 #include "TrigRingerTools/sys/xmlutil.h"
 #include "TrigRingerTools/data/RandomInteger.h"
 #include "TFile.h"
 #include "TTree.h"
+#include "TBranch.h"
+#include "TrigRingerTools/data/gsl_feature.h"
 #include "TrigRingerTools/sys/Plain.h"
+#include <algorithm>
 
 data::RoIPatternSet::RoIPatternSet(const size_t& size,
 				   const size_t& p_size,
 				   const double& init)
   : m_set(size, p_size, init),
-    m_attr(size)
+    m_attr(size),
+    m_eta_index(),
+    m_phi_index()
 {
   RINGER_DEBUG1("Created RoIPatternSet with size=" << size 
 		<< " and pattern" << " size=" << p_size 
@@ -30,14 +38,18 @@ data::RoIPatternSet::RoIPatternSet(const size_t& size,
 data::RoIPatternSet::RoIPatternSet(const data::RoIPatternSet& other)
   : PatternSet(),
     m_set(other.m_set),
-    m_attr(other.m_attr)
+    m_attr(other.m_attr),
+    m_eta_index(),
+    m_phi_index()
 {
   RINGER_DEBUG1("Created RoIPatternSet by copying");
 }
 
 data::RoIPatternSet::RoIPatternSet(sys::xml_ptr_const node)
   : m_set(1, 1),
-    m_attr(0)
+    m_attr(0),
+    m_eta_index(),
+    m_phi_index()
 {
   std::vector<Pattern*> data;
   //for all entries in a class
@@ -53,7 +65,8 @@ data::RoIPatternSet::RoIPatternSet(sys::xml_ptr_const node)
     sys::xml_ptr_const feats = sys::get_first_child(it);
     if (!sys::is_element(feats)) feats = sys::get_next_element(feats);
     sys::get_element_doubles(feats, curr);
-    data.push_back(new data::Pattern(curr));
+    data.push_back(new data::Pattern(std::vector<data::Feature>(curr.begin(),
+								curr.end())));
     m_attr.push_back(attr);
   }
   //check all patterns first
@@ -72,9 +85,43 @@ data::RoIPatternSet::RoIPatternSet(sys::xml_ptr_const node)
   for (size_t i=0; i<data.size(); ++i) delete data[i];
 }
 
+data::RoIPatternSet::RoIPatternSet(data::XmlStreamReader& reader)
+  : m_set(1, 1),
+    m_attr(0),
+    m_eta_index(),
+    m_phi_index()
+{
+  reader.read(m_set, &m_attr);
+}
+
+data::RoIPatternSet::RoIPatternSet(const data::BinaryClassInfo& info)
+  : m_set(info),
+    m_attr(info.size),
+    m_eta_index(),
+    m_phi_index()
+{
+  if (info.attr) {
+    for (size_t i=0; i<info.size; ++i) {
+      m_attr[i].lvl1_id = info.attr[i].lvl1_id;
+      m_attr[i].roi_id = info.attr[i].roi_id;
+      m_attr[i].eta = info.attr[i].eta;
+      m_attr[i].phi = info.attr[i].phi;
+    }
+  }
+  RINGER_DEBUG1("Created RoIPatternSet from binary class \"" << info.name
+		<< "\"");
+}
+
+/**
+ * How many bytes ROOT should read ahead when loading a class
+ */
+static const Long64_t s_root_cache_size = 32*1024*1024;
+
 data::RoIPatternSet::RoIPatternSet (const data::RootClassInfo &infoBranches)
  : m_set(1, 1),
-   m_attr(0)
+   m_attr(0),
+    m_eta_index(),
+    m_phi_index()
 {  
   RINGER_DEBUG3("data::RoIPatternSet::RoIPatternSet(const data::RootClassInfo &)");
   TFile f(infoBranches.FileName.c_str());
@@ -89,16 +136,64 @@ data::RoIPatternSet::RoIPatternSet (const data::RootClassInfo &infoBranches)
     throw RINGER_EXCEPTION("TTree not found");
   }
   
-  std::vector<Pattern*> data;
-  //for all entries in a class
-
-  std::vector<Feature> curr;
+  UInt_t branchNClusters = 0;
   std::vector<Float_t> *branchData = 0;
   std::vector<unsigned int> *branchLvl1Id = 0;
   std::vector<unsigned int> *branchRoiId = 0;
   std::vector<Float_t> *branchEta = 0;
   std::vector<Float_t> *branchPhi = 0;
-  
+  const Long64_t entries = tree->GetEntries();
+
+  //1st pass: counts the clusters reading a single, small, branch
+  size_t total = 0;
+  TBranch* counter = tree->GetBranch("Ringer_NClusters");
+  if (counter) counter->SetAddress(&branchNClusters);
+  else { //older files: the cluster count is the size of any per-cluster branch
+    counter = tree->GetBranch("Ringer_LVL1_Id");
+    if (!counter) {
+      RINGER_DEBUG1("Error! No cluster information in TTree "
+		    << infoBranches.TreeName << ". Exception thrown.");
+      throw RINGER_EXCEPTION("TTree without cluster information");
+    }
+    tree->SetBranchAddress("Ringer_LVL1_Id", &branchLvl1Id);
+  }
+  Long64_t first = -1; ///< the first entry with clusters
+  for (Long64_t i = 0; i < entries; ++i) {
+    counter->GetEntry(i);
+    size_t nclusters = branchLvl1Id? branchLvl1Id->size() : branchNClusters;
+    if (nclusters && first < 0) first = i;
+    total += nclusters;
+  }
+  if (!total) {
+    RINGER_DEBUG1("Error! TTree " << infoBranches.TreeName
+		  << " has no clusters. Exception thrown.");
+    throw RINGER_EXCEPTION("TTree without clusters");
+  }
+
+  //the number of rings, from the first entry with clusters
+  TBranch* rings = tree->GetBranch("Ringer_Rings");
+  if (!rings) {
+    RINGER_DEBUG1("Error! No rings in TTree " << infoBranches.TreeName
+		  << ". Exception thrown.");
+    throw RINGER_EXCEPTION("TTree without rings");
+  }
+  tree->SetBranchAddress("Ringer_Rings", &branchData);
+  rings->GetEntry(first);
+  counter->GetEntry(first);
+  size_t nclusters = branchLvl1Id? branchLvl1Id->size() : branchNClusters;
+  const size_t nrings = branchData->size() / nclusters;
+  if (!nrings || branchData->size() % nclusters) {
+    RINGER_DEBUG1("Entry " << first << " has " << branchData->size()
+		  << " rings for " << nclusters << " clusters. Exception thrown.");
+    throw RINGER_EXCEPTION("Inconsistent number of rings in TTree");
+  }
+  RINGER_DEBUG2("TTree " << infoBranches.TreeName << " has " << total
+		<< " clusters with " << nrings << " rings each.");
+
+  //2nd pass: fills my storage in place, reading ahead the active branches
+  m_set.reset(RINGER_GSL_MATRIX(alloc)(total, nrings));
+  m_attr.resize(total);
+
   tree->SetBranchStatus("*", 0);
   tree->SetBranchStatus("Ringer_Rings", 1);
   tree->SetBranchStatus("Ringer_LVL1_Id", 1);
@@ -106,62 +201,62 @@ data::RoIPatternSet::RoIPatternSet (const data::RootClassInfo &infoBranches)
   tree->SetBranchStatus("Ringer_LVL2_Eta", 1);
   tree->SetBranchStatus("Ringer_LVL2_Phi", 1);
   
-  tree->SetBranchAddress("Ringer_Rings", &branchData);
   tree->SetBranchAddress("Ringer_LVL1_Id", &branchLvl1Id);
   tree->SetBranchAddress("Ringer_Roi_Id", &branchRoiId);
   tree->SetBranchAddress("Ringer_LVL2_Eta", &branchEta);
   tree->SetBranchAddress("Ringer_LVL2_Phi", &branchPhi);
+
+  tree->SetCacheSize(s_root_cache_size);
+  tree->AddBranchToCache("Ringer_Rings");
+  tree->AddBranchToCache("Ringer_LVL1_Id");
+  tree->AddBranchToCache("Ringer_Roi_Id");
+  tree->AddBranchToCache("Ringer_LVL2_Eta");
+  tree->AddBranchToCache("Ringer_LVL2_Phi");
   
-  // TODO: number of cluster information is not being used!
-  for (unsigned int i = 0; i < tree->GetEntries(); i++) {
+  size_t n = 0; ///< the next cluster to fill
+  for (Long64_t i = 0; i < entries; ++i) {
     tree->GetEntry(i);
-    RINGER_DEBUG3("Data size == "<<branchData->size());
-    RINGER_DEBUG3("LVL1ID size == "<<branchLvl1Id->size());
-    RINGER_DEBUG3("ROIID size == "<<branchRoiId->size());
-    RINGER_DEBUG3("Eta size == "<<branchEta->size());
-    RINGER_DEBUG3("Phi size == "<<branchPhi->size());
-    unsigned int dataCounter = 0;
-    for (unsigned int cluster = 0; cluster < branchLvl1Id->size(); cluster++) {
-      RoIAttribute attr;
-      attr.lvl1_id = branchLvl1Id->at(cluster);
-      attr.roi_id = branchRoiId->at(cluster);
-      attr.eta = branchEta->at(cluster);
-      attr.phi = branchPhi->at(cluster);
-      m_attr.push_back(attr);
-      
-      // Conversion from std::vector<float> to std::vector<double> (Feature == double)
-      curr.clear();
-      unsigned int dataEnd = dataCounter + m_set.pattern_size();
-      for (; dataCounter != dataEnd; dataCounter++) {
-        curr.push_back((Feature) branchData->at(dataCounter));
-      }
-      
-      data.push_back(new data::Pattern(curr));
+    nclusters = branchLvl1Id->size();
+    if (n + nclusters > total || branchRoiId->size() != nclusters ||
+	branchEta->size() != nclusters || branchPhi->size() != nclusters ||
+	branchData->size() != nclusters*nrings) {
+      RINGER_DEBUG1("Entry " << i << " of TTree " << infoBranches.TreeName
+		    << " does not match the cluster count. Exception thrown.");
+      throw RINGER_EXCEPTION("Inconsistent cluster information in TTree");
+    }
+    if (!nclusters) continue; //no clusters in this event
+    if (branchData->empty()) {
+      RINGER_DEBUG1("Entry " << i << " of TTree " << infoBranches.TreeName
+		    << " has clusters without rings. Exception thrown.");
+      throw RINGER_EXCEPTION("Clusters without rings in TTree");
+    }
+    const Float_t* ring = &(*branchData)[0];
+    for (size_t cluster = 0; cluster < nclusters; ++cluster, ++n) {
+      m_attr[n].lvl1_id = (*branchLvl1Id)[cluster];
+      m_attr[n].roi_id = (*branchRoiId)[cluster];
+      m_attr[n].eta = (*branchEta)[cluster];
+      m_attr[n].phi = (*branchPhi)[cluster];
+      Feature* row = RINGER_GSL_MATRIX(ptr)(m_set.m_data, n, 0);
+      for (size_t j = 0; j < nrings; ++j) row[j] = *ring++;
     }
   }
   f.Close();
 
-  //check all patterns first
-  size_t std_size = data[0]->size();
-  for (size_t i=0; i<data.size(); ++i) {
-    if (data[i]->size() != std_size) {
-      RINGER_DEBUG1("Pattern[" << i << "] has a different pattern than the"
-		    << " rest. Exception thrown");
-      throw RINGER_EXCEPTION
-	("Pattern has a different pattern than the rest. Exception thrown");
-    }
+  if (n != total) {
+    RINGER_DEBUG1("Read " << n << " clusters from TTree "
+		  << infoBranches.TreeName << " instead of " << total
+		  << ". Exception thrown.");
+    throw RINGER_EXCEPTION("Inconsistent cluster information in TTree");
   }
-  
-  //Build
-  RINGER_DEBUG2("Building SimplePatternSet from ROOT data.");
-  m_set = data::SimplePatternSet(data); //single-shot update
-  for (size_t i=0; i<data.size(); ++i) delete data[i];
+  RINGER_DEBUG2("Built RoIPatternSet with " << n << " patterns from ROOT data.");
 }
 
 data::RoIPatternSet::RoIPatternSet
 (const data::RoIPatternSet& other, const std::vector<size_t>& pats)
   : m_set(other.m_set, pats),
-    m_attr(pats.size())
+    m_attr(pats.size()),
+    m_eta_index(),
+    m_phi_index()
 {
   RINGER_DEBUG1("Building RoIPatternSet from partial copy...");
   for (size_t i=0; i<pats.size(); ++i) m_attr[i] = other.m_attr[pats[i]];
@@ -172,22 +267,13 @@ data::RoIPatternSet::RoIPatternSet(const data::RoIPatternSet& other,
 				   double start, double end,
 				   variable_t var)
   : m_set(1, 1),
-    m_attr()
+    m_attr(),
+    m_eta_index(),
+    m_phi_index()
 {
   RINGER_DEBUG1("Building RoIPatternSet from partial interval copy...");
   std::vector<size_t> pats;
-  for (size_t i=0; i<other.size(); ++i) {
-    double ref = 0;
-    switch(var) {
-    case ETA:
-      ref = other.m_attr[i].eta;
-      break;
-    case PHI:
-      ref = other.m_attr[i].phi;
-      break;
-    }
-    if (ref >= start && ref < end) pats.push_back(i);
-  }
+  other.range(start, end, pats, var);
   this->assign(other, pats);
   RINGER_DEBUG1("Building of RoIPatternSet from partial interval copy DONE!");
 }
@@ -196,7 +282,9 @@ data::RoIPatternSet::RoIPatternSet
 (const std::vector<Pattern*>& pats,
  const std::vector<data::RoIPatternSet::RoIAttribute>& attr)
   : m_set(pats),
-    m_attr(attr)
+    m_attr(attr),
+    m_eta_index(),
+    m_phi_index()
 {
   if (pats.size() != attr.size()) {
     RINGER_DEBUG1("Patterns (" << pats.size() << ") and attributes (" 
@@ -211,7 +299,9 @@ data::RoIPatternSet::RoIPatternSet
 (const data::SimplePatternSet& pset,
  const std::vector<data::RoIPatternSet::RoIAttribute>& attr)
   : m_set(pset),
-    m_attr(attr)
+    m_attr(attr),
+    m_eta_index(),
+    m_phi_index()
 {
   if (pset.size() != attr.size()) {
     RINGER_DEBUG1("SimplePatternSet (" << pset.size() << ") and attributes (" 
@@ -261,6 +351,7 @@ void data::RoIPatternSet::erase_pattern (const size_t& pos)
 {
   m_set.erase_pattern(pos);
   m_attr.erase(m_attr.begin() + pos);
+  invalidate_index();
 }
 
 void data::RoIPatternSet::erase_ensemble (const size_t& pos)
@@ -281,7 +372,11 @@ data::PatternSet* data::RoIPatternSet::clone
 
 void data::RoIPatternSet::shuffle (void)
 {
-  static data::RandomInteger rnd;
+  shuffle(data::RandomInteger::next_stream());
+}
+
+void data::RoIPatternSet::shuffle (const data::RandomInteger& rnd)
+{
   std::vector<size_t> pos(size());
   rnd.draw(size(), pos);
   data::RoIPatternSet new_order(*this, pos);
@@ -305,13 +400,20 @@ sys::xml_ptr data::RoIPatternSet::dump (sys::xml_ptr any,
     sys::put_attribute_double(entry, "eta", m_attr[i].eta);
     sys::put_attribute_double(entry, "phi", m_attr[i].phi);
     const Pattern pat = pattern(i);
-    std::vector<data::Feature> val(pat.size());
+    std::vector<double> val(pat.size());
     for (size_t j=0; j<pat.size(); ++j) val[j] = pat[j];
     sys::put_element_doubles(entry, "feature", val);
   }
   return node;
 }
 
+void data::RoIPatternSet::dump (data::XmlStreamWriter& writer,
+				const std::string& cname,
+				const size_t start_id) const
+{
+  writer.write(cname, m_set, &m_attr, start_id);
+}
+
 void data::RoIPatternSet::dump (const RootClassInfo &info) const {
   RINGER_DEBUG3("data::RoIPatternSet::dump(const data::RootClassInfo &) const");
   
@@ -448,6 +550,7 @@ void data::RoIPatternSet::set_attribute
     throw RINGER_EXCEPTION("Unexisting RoI pattern.");
   }
   m_attr[pos] = attr;
+  invalidate_index();
 }
 
 void data::RoIPatternSet::set_attribute 
@@ -474,6 +577,7 @@ void data::RoIPatternSet::set_pattern
   }
   m_set.set_pattern(pos, pat);
   m_attr[pos] = attr;
+  invalidate_index();
 }
 
 data::RoIPatternSet& data::RoIPatternSet::merge 
@@ -481,6 +585,7 @@ data::RoIPatternSet& data::RoIPatternSet::merge
 {
   m_set.merge(other.m_set);
   m_attr.insert(m_attr.end(), other.m_attr.begin(), other.m_attr.end());
+  invalidate_index();
   return *this;
 }
 	
@@ -488,8 +593,9 @@ data::RoIPatternSet& data::RoIPatternSet::assign
 (const data::RoIPatternSet& other, const std::vector<size_t>& pats)
 {
   m_set.assign(other.m_set, pats);
-  m_attr.resize(other.m_attr.size());
+  m_attr.resize(pats.size());
   for (size_t i=0; i<pats.size(); ++i) m_attr[i] = other.m_attr[pats[i]];
+  invalidate_index();
   return *this;
 }
 
@@ -498,9 +604,99 @@ data::RoIPatternSet::operator= (const data::RoIPatternSet& other)
 {
   m_set = other.m_set;
   m_attr = other.m_attr;
+  invalidate_index();
   return *this;
 }
 
+/**
+ * Returns the value of a variable in an RoI attribute
+ *
+ * @param attr The attribute to look at
+ * @param var The variable to return
+ */
+static inline double value (const data::RoIPatternSet::RoIAttribute& attr,
+			    data::RoIPatternSet::variable_t var)
+{
+  return (var == data::RoIPatternSet::PHI)? attr.phi : attr.eta;
+}
+
+/**
+ * Compares set positions, or a position and a value, by the value of a
+ * variable in the attributes of each position
+ */
+class ByVariable {
+
+public:
+
+  ByVariable (const std::vector<data::RoIPatternSet::RoIAttribute>& attr,
+	      data::RoIPatternSet::variable_t var)
+    : m_attr(attr), m_var(var) {}
+
+  bool operator() (size_t i, size_t j) const
+  { return value(m_attr[i], m_var) < value(m_attr[j], m_var); }
+
+  bool operator() (size_t i, double v) const
+  { return value(m_attr[i], m_var) < v; }
+
+private:
+
+  const std::vector<data::RoIPatternSet::RoIAttribute>& m_attr;
+  data::RoIPatternSet::variable_t m_var;
+
+};
+
+const std::vector<size_t>& data::RoIPatternSet::index (variable_t var) const
+{
+  std::vector<size_t>& retval = (var == PHI)? m_phi_index : m_eta_index;
+  if (retval.size() != m_attr.size()) {
+    RINGER_DEBUG2("Sorting " << m_attr.size() << " RoI attributes by "
+		  << ((var == PHI)? "phi" : "eta") << ".");
+    retval.resize(m_attr.size());
+    for (size_t i=0; i<retval.size(); ++i) retval[i] = i;
+    std::stable_sort(retval.begin(), retval.end(), ByVariable(m_attr, var));
+  }
+  return retval;
+}
+
+void data::RoIPatternSet::invalidate_index (void)
+{
+  m_eta_index.clear();
+  m_phi_index.clear();
+}
+
+void data::RoIPatternSet::range (double start, double end,
+				 std::vector<size_t>& pats,
+				 variable_t var) const
+{
+  pats.clear();
+  if (!(start < end)) return;
+  const std::vector<size_t>& idx = index(var);
+  ByVariable less(m_attr, var);
+  std::vector<size_t>::const_iterator first = 
+    std::lower_bound(idx.begin(), idx.end(), start, less);
+  std::vector<size_t>::const_iterator last = 
+    std::lower_bound(first, idx.end(), end, less);
+  pats.assign(first, last);
+  std::sort(pats.begin(), pats.end()); //back to the set order
+}
+
+void data::RoIPatternSet::partition (const std::vector<double>& edges,
+				     std::vector<std::vector<size_t> >& bins,
+				     variable_t var) const
+{
+  bins.clear();
+  if (edges.size() < 2) return;
+  bins.resize(edges.size()-1);
+  for (size_t i=0; i<m_attr.size(); ++i) {
+    const double v = value(m_attr[i], var);
+    if (!(v >= edges.front() && v < edges.back())) continue;
+    //the first edge above the value closes its bin
+    size_t b = std::upper_bound(edges.begin(), edges.end(), v) 
+      - edges.begin() - 1;
+    bins[b].push_back(i);
+  }
+}
+
 std::ostream& operator<< (std::ostream& os, 
 			  const data::RoIPatternSet::RoIAttribute& attr)
 {
@@ -8,33 +8,45 @@
 
 #include <iostream>
 #include <sstream>
-#include <gsl/gsl_matrix.h>
+#include "TrigRingerTools/data/gsl_feature.h"
 #include <gsl/gsl_errno.h>
 #include <cstdio>
+#include <cstdlib>
+#include <pthread.h>
 
 #include "TrigRingerTools/data/SimplePatternSet.h"
+#include "TrigRingerTools/data/XmlStreamReader.h"
+#include "TrigRingerTools/data/BinaryFile.h"
+#include "TrigRingerTools/data/XmlStreamWriter.h"
 #include "TrigRingerTools/data/RandomInteger.h"
 #include "TrigRingerTools/sys/Exception.h"
 #include "TrigRingerTools/sys/debug.h"
 #include "TrigRingerTools/sys/xmlutil.h"
 
+/**
+ * Protects the reference counts of all shared matrices
+ */
+static pthread_mutex_t s_refs_lock = PTHREAD_MUTEX_INITIALIZER;
+
 data::SimplePatternSet::SimplePatternSet(const size_t& size, 
 					 const size_t& p_size,
 					 const double& init)
-  : m_data(0) ///< initialize with a NULL pointer
+  : m_data(0), ///< initialize with a NULL pointer
+    m_refs(0)
 {
   RINGER_DEBUG1("Creating SimplePatternSet with size=" 
 		<< size << " and pattern"
 		<< " size=" << p_size << ", initializer is " << init);
   //try to allocate enough space with GSL
-  m_data = gsl_matrix_alloc (size, p_size);
+  m_data = RINGER_GSL_MATRIX(alloc)(size, p_size);
   //set all elements to the given value
-  gsl_matrix_set_all(m_data, init);
+  RINGER_GSL_MATRIX(set_all)(m_data, init);
   RINGER_DEBUG1("SimplePatternSet created and initialised.");
 }
 
 data::SimplePatternSet::SimplePatternSet(sys::xml_ptr_const node)
-  : m_data(0)
+  : m_data(0),
+    m_refs(0)
 {
   std::vector<Pattern*> data;
   //for all entries in a class
@@ -45,7 +57,8 @@ data::SimplePatternSet::SimplePatternSet(sys::xml_ptr_const node)
     sys::xml_ptr_const feats = sys::get_first_child(it);
     if (!sys::is_element(feats)) feats = sys::get_next_element(feats);
     sys::get_element_doubles(feats, curr);
-    data.push_back(new data::Pattern(curr));
+    data.push_back(new data::Pattern(std::vector<data::Feature>(curr.begin(),
+								curr.end())));
   }
   //check all patterns first
   size_t std_size = data[0]->size();
@@ -59,29 +72,49 @@ data::SimplePatternSet::SimplePatternSet(sys::xml_ptr_const node)
   }
   //Build
   RINGER_DEBUG2("Building SimplePatternSet from XML data.");
-  m_data = gsl_matrix_alloc(data.size(), std_size);
+  m_data = RINGER_GSL_MATRIX(alloc)(data.size(), std_size);
   for (unsigned int i=0; i<data.size(); ++i)
-    gsl_matrix_set_row(m_data, i, data[i]->m_vector);
+    RINGER_GSL_MATRIX(set_row)(m_data, i, data[i]->m_vector);
   RINGER_DEBUG2("The new SimplePatternSet has " <<data.size()<< " patterns.");
   for (size_t i=0; i<data.size(); ++i) delete data[i];
 }
 
+data::SimplePatternSet::SimplePatternSet(data::XmlStreamReader& reader)
+  : m_data(0),
+    m_refs(0)
+{
+  reader.read(*this, 0);
+}
+
+data::SimplePatternSet::SimplePatternSet(const data::BinaryClassInfo& info)
+  : m_data(0),
+    m_refs(0)
+{
+  RINGER_DEBUG2("Wrapping " << info.size << " mapped patterns of size "
+		<< info.pattern_size << " in a SimplePatternSet.");
+  //a matrix that does not own its data, freed as any other by GSL
+  m_data = static_cast<data::FeatureMatrix*>
+    (std::malloc(sizeof(data::FeatureMatrix)));
+  *m_data = RINGER_GSL_MATRIX(view_array)(info.data, info.size,
+					  info.pattern_size).matrix;
+}
+
 data::SimplePatternSet::SimplePatternSet(const SimplePatternSet& other)
-  : PatternSet(), m_data(0)
+  : PatternSet(), m_data(0), m_refs(0)
 {
   RINGER_DEBUG2("Building SimplePatternSet from"
 		<< " another SimplePatternSet (copy construct).");
-  m_data = gsl_matrix_alloc(other.m_data->size1, other.m_data->size2);
-  gsl_matrix_memcpy(m_data, other.m_data);
+  share(other);
 }
 
 data::SimplePatternSet::SimplePatternSet(const SimplePatternSet& other,
 					 const std::vector<size_t>& pats)
-  : m_data(0)
+  : m_data(0),
+    m_refs(0)
 {
   RINGER_DEBUG2("Building SimplePatternSet from selected patterns of another"
 		<< " SimplePatternSet (kind-of-copy construct).");
-  m_data = gsl_matrix_alloc(pats.size(), other.m_data->size2);
+  m_data = RINGER_GSL_MATRIX(alloc)(pats.size(), other.m_data->size2);
   if (!m_data) {
     RINGER_DEBUG1("Allocation of internal matrix failed. Exception thrown.");
     throw RINGER_EXCEPTION("Failed internal matrix allocation");
@@ -90,13 +123,14 @@ data::SimplePatternSet::SimplePatternSet(const SimplePatternSet& other,
 		<< ", for " << pats.size() << " patterns and with "
 		<< other.m_data->size2 << " features per pattern.");
   for (unsigned int i=0; i<pats.size(); ++i)
-    gsl_matrix_set_row(m_data, i, 
-		       &gsl_matrix_row(other.m_data, pats[i]).vector);
+    RINGER_GSL_MATRIX(set_row)(m_data, i, 
+		       &RINGER_GSL_MATRIX(row)(other.m_data, pats[i]).vector);
   RINGER_DEBUG2("The new SimplePatternSet has " <<pats.size()<< " patterns.");
 }
 
 data::SimplePatternSet::SimplePatternSet(const std::vector<Pattern*>& pats)
-  : m_data(0)
+  : m_data(0),
+    m_refs(0)
 {
   //check all patterns first
   size_t std_size = pats[0]->size();
@@ -109,15 +143,69 @@ data::SimplePatternSet::SimplePatternSet(const std::vector<Pattern*>& pats)
 
   //Build
   RINGER_DEBUG2("Building SimplePatternSet from selected patterns.");
-  m_data = gsl_matrix_alloc(pats.size(), std_size);
+  m_data = RINGER_GSL_MATRIX(alloc)(pats.size(), std_size);
   for (unsigned int i=0; i<pats.size(); ++i)
-    gsl_matrix_set_row(m_data, i, pats[i]->m_vector);
+    RINGER_GSL_MATRIX(set_row)(m_data, i, pats[i]->m_vector);
   RINGER_DEBUG2("The new SimplePatternSet has " <<pats.size()<< " patterns.");
 }
 
 data::SimplePatternSet::~SimplePatternSet()
 {
-  if (m_data) gsl_matrix_free(m_data);
+  release();
+}
+
+bool data::SimplePatternSet::shared (void) const
+{
+  pthread_mutex_lock(&s_refs_lock);
+  bool retval = m_refs && *m_refs > 1;
+  pthread_mutex_unlock(&s_refs_lock);
+  return retval;
+}
+
+void data::SimplePatternSet::detach (void)
+{
+  if (!shared()) return;
+  RINGER_DEBUG2("Unsharing a SimplePatternSet with " << size() 
+		<< " patterns before changing it.");
+  data::FeatureMatrix* copy = 
+    RINGER_GSL_MATRIX(alloc)(m_data->size1, m_data->size2);
+  RINGER_GSL_MATRIX(memcpy)(copy, m_data);
+  reset(copy);
+}
+
+void data::SimplePatternSet::share (const data::SimplePatternSet& other)
+{
+  if (m_data == other.m_data) return;
+  release();
+  pthread_mutex_lock(&s_refs_lock);
+  if (!other.m_refs) other.m_refs = new size_t(1);
+  ++*other.m_refs;
+  pthread_mutex_unlock(&s_refs_lock);
+  m_data = other.m_data;
+  m_refs = other.m_refs;
+}
+
+void data::SimplePatternSet::release (void)
+{
+  if (!m_data) return;
+  bool last = true;
+  if (m_refs) {
+    pthread_mutex_lock(&s_refs_lock);
+    last = (--*m_refs == 0);
+    pthread_mutex_unlock(&s_refs_lock);
+  }
+  if (last) {
+    RINGER_GSL_MATRIX(free)(m_data);
+    delete m_refs;
+  }
+  m_data = 0;
+  m_refs = 0;
+}
+
+void data::SimplePatternSet::reset (data::FeatureMatrix* m)
+{
+  release();
+  m_data = m;
 }
 
 size_t data::SimplePatternSet::size () const
@@ -139,7 +227,7 @@ const data::Pattern data::SimplePatternSet::pattern (const size_t& pos) const
 		  << ". Exception thrown.");
     throw RINGER_EXCEPTION("SimplePatternSet out of (pattern) range");
   }
-  return gsl_matrix_row(m_data, pos);
+  return RINGER_GSL_MATRIX(row)(m_data, pos);
 }
 
 const data::Ensemble data::SimplePatternSet::ensemble (const size_t& pos) const
@@ -151,7 +239,7 @@ const data::Ensemble data::SimplePatternSet::ensemble (const size_t& pos) const
 		  << ". Exception thrown.");
     throw RINGER_EXCEPTION("SimplePatternSet out of (ensemble) range");
   }
-  return gsl_matrix_column(m_data, pos);
+  return RINGER_GSL_MATRIX(column)(m_data, pos);
 }
 
 void data::SimplePatternSet::set_pattern (const size_t& pos, 
@@ -171,8 +259,9 @@ void data::SimplePatternSet::set_pattern (const size_t& pos,
 		  << ". Exception thrown.");
     throw RINGER_EXCEPTION("Different sizes in copy operation.");
   }
-  gsl_vector_view view = gsl_matrix_row(m_data, pos);
-  gsl_vector_memcpy(&view.vector, pat.m_vector);
+  detach();
+  data::FeatureVectorView view = RINGER_GSL_MATRIX(row)(m_data, pos);
+  RINGER_GSL_VECTOR(memcpy)(&view.vector, pat.m_vector);
   return;
 }
 
@@ -192,8 +281,9 @@ void data::SimplePatternSet::set_ensemble (const size_t& pos,
 		  << ens.size() << ". Exception thrown.");
     throw RINGER_EXCEPTION("Different sizes in copy operation.");
   }
-  gsl_vector_view view = gsl_matrix_column(m_data, pos);
-  gsl_vector_memcpy(&view.vector, ens.m_vector);
+  detach();
+  data::FeatureVectorView view = RINGER_GSL_MATRIX(column)(m_data, pos);
+  RINGER_GSL_VECTOR(memcpy)(&view.vector, ens.m_vector);
   return;
 }
 
@@ -206,38 +296,38 @@ void data::SimplePatternSet::erase_pattern (const size_t& pos)
 		  << " patterns. Exception thrown.");
     throw RINGER_EXCEPTION("Unexisting pattern");
   }
-  gsl_matrix* new_data = gsl_matrix_alloc(m_data->size1-1, m_data->size2);
+  data::FeatureMatrix* new_data =
+    RINGER_GSL_MATRIX(alloc)(m_data->size1-1, m_data->size2);
   if (pos != 0 && pos != m_data->size1-1) {
     //copy before and after removal point
-    gsl_matrix_const_view before = 
-      gsl_matrix_const_submatrix(m_data, 0, 0, pos, m_data->size2);
-    gsl_matrix_const_view after = 
-      gsl_matrix_const_submatrix(m_data, pos+1, 0, m_data->size1-pos-1, 
+    data::FeatureMatrixConstView before = 
+      RINGER_GSL_MATRIX(const_submatrix)(m_data, 0, 0, pos, m_data->size2);
+    data::FeatureMatrixConstView after = 
+      RINGER_GSL_MATRIX(const_submatrix)(m_data, pos+1, 0, m_data->size1-pos-1, 
 				 m_data->size2);
-    gsl_matrix_view new_before = 
-      gsl_matrix_submatrix(new_data, 0, 0, pos, m_data->size2);
-    gsl_matrix_view new_after = 
-      gsl_matrix_submatrix(new_data, pos, 0, 
+    data::FeatureMatrixView new_before = 
+      RINGER_GSL_MATRIX(submatrix)(new_data, 0, 0, pos, m_data->size2);
+    data::FeatureMatrixView new_after = 
+      RINGER_GSL_MATRIX(submatrix)(new_data, pos, 0, 
 			   m_data->size1-pos-1, m_data->size2);
-    gsl_matrix_memcpy(&new_before.matrix, &before.matrix);
-    gsl_matrix_memcpy(&new_after.matrix, &after.matrix);
+    RINGER_GSL_MATRIX(memcpy)(&new_before.matrix, &before.matrix);
+    RINGER_GSL_MATRIX(memcpy)(&new_after.matrix, &after.matrix);
   }
   else { //in the extremes, it is easier to cut
     if (pos == 0) {
-      gsl_matrix_const_view v = 
-	gsl_matrix_const_submatrix(m_data, 1, 1, 
+      data::FeatureMatrixConstView v = 
+	RINGER_GSL_MATRIX(const_submatrix)(m_data, 1, 1, 
 				   m_data->size1-1, m_data->size2);
-      gsl_matrix_memcpy(new_data, &v.matrix);
+      RINGER_GSL_MATRIX(memcpy)(new_data, &v.matrix);
     }
     if (pos == m_data->size1-1) {
-      gsl_matrix_const_view v = 
-	gsl_matrix_const_submatrix(m_data, 0, 0, 
+      data::FeatureMatrixConstView v = 
+	RINGER_GSL_MATRIX(const_submatrix)(m_data, 0, 0, 
 				   m_data->size1-1, m_data->size2);
-      gsl_matrix_memcpy(new_data, &v.matrix);
+      RINGER_GSL_MATRIX(memcpy)(new_data, &v.matrix);
     }
   }
-  gsl_matrix_free(m_data);
-  m_data = new_data;
+  reset(new_data);
   RINGER_DEBUG3("Pattern " << pos << " was removed from set. "
 		<< "The new number of patterns is " << size() << ".");
   return;
@@ -252,38 +342,38 @@ void data::SimplePatternSet::erase_ensemble (const size_t& pos)
 		  << " ensembles. Exception thrown.");
     throw RINGER_EXCEPTION("Unexisting ensemble");
   }
-  gsl_matrix* new_data = gsl_matrix_alloc(m_data->size1, m_data->size2-1);
+  data::FeatureMatrix* new_data =
+    RINGER_GSL_MATRIX(alloc)(m_data->size1, m_data->size2-1);
   if (pos != 0 && pos != m_data->size2-1) {
     //copy before and after removal point
-    gsl_matrix_const_view before = 
-      gsl_matrix_const_submatrix(m_data, 0, 0, m_data->size1, pos);
-    gsl_matrix_const_view after = 
-      gsl_matrix_const_submatrix(m_data, 0, pos+1, m_data->size1, 
+    data::FeatureMatrixConstView before = 
+      RINGER_GSL_MATRIX(const_submatrix)(m_data, 0, 0, m_data->size1, pos);
+    data::FeatureMatrixConstView after = 
+      RINGER_GSL_MATRIX(const_submatrix)(m_data, 0, pos+1, m_data->size1, 
 				 m_data->size2-pos-1);
-    gsl_matrix_view new_before = 
-      gsl_matrix_submatrix(new_data, 0, 0, m_data->size1, pos);
-    gsl_matrix_view new_after = 
-      gsl_matrix_submatrix(new_data, 0, pos, m_data->size1, 
+    data::FeatureMatrixView new_before = 
+      RINGER_GSL_MATRIX(submatrix)(new_data, 0, 0, m_data->size1, pos);
+    data::FeatureMatrixView new_after = 
+      RINGER_GSL_MATRIX(submatrix)(new_data, 0, pos, m_data->size1, 
 			   m_data->size2-pos-1);
-    gsl_matrix_memcpy(&new_before.matrix, &before.matrix);
-    gsl_matrix_memcpy(&new_after.matrix, &after.matrix);
+    RINGER_GSL_MATRIX(memcpy)(&new_before.matrix, &before.matrix);
+    RINGER_GSL_MATRIX(memcpy)(&new_after.matrix, &after.matrix);
   }
   else { //in the extremes, it is easier to cut
     if (pos == 0) {
-      gsl_matrix_const_view v = 
-	gsl_matrix_const_submatrix(m_data, 0, 1, m_data->size1, 
+      data::FeatureMatrixConstView v = 
+	RINGER_GSL_MATRIX(const_submatrix)(m_data, 0, 1, m_data->size1, 
 				   m_data->size2-1);
-      gsl_matrix_memcpy(new_data, &v.matrix);
+      RINGER_GSL_MATRIX(memcpy)(new_data, &v.matrix);
     }
     if (pos == m_data->size2-1) {
-      gsl_matrix_const_view v = 
-	gsl_matrix_const_submatrix(m_data, 0, 0, m_data->size1, 
+      data::FeatureMatrixConstView v = 
+	RINGER_GSL_MATRIX(const_submatrix)(m_data, 0, 0, m_data->size1, 
 				   m_data->size2-1);
-      gsl_matrix_memcpy(new_data, &v.matrix);
+      RINGER_GSL_MATRIX(memcpy)(new_data, &v.matrix);
     }
   }
-  gsl_matrix_free(m_data);
-  m_data = new_data;
+  reset(new_data);
   RINGER_DEBUG3("Ensemble " << pos << " was removed from set. "
 		<< "The new number of ensembles is " << pattern_size() << ".");
   return;
@@ -302,7 +392,11 @@ data::PatternSet* data::SimplePatternSet::clone
 
 void data::SimplePatternSet::shuffle (void)
 {
-  static data::RandomInteger rnd;
+  shuffle(data::RandomInteger::next_stream());
+}
+
+void data::SimplePatternSet::shuffle (const data::RandomInteger& rnd)
+{
   std::vector<size_t> pos(size());
   rnd.draw(size(), pos);
   data::SimplePatternSet new_order(*this, pos);
@@ -322,13 +416,20 @@ sys::xml_ptr data::SimplePatternSet::dump (sys::xml_ptr any,
     sys::xml_ptr entry = sys::put_element(node, "entry");
     sys::put_attribute_uint(entry, "id", start_id + i);
     const Pattern pat = pattern(i);
-    std::vector<data::Feature> val(pat.size());
+    std::vector<double> val(pat.size());
     for (size_t j=0; j<pat.size(); ++j) val[j] = pat[j];
     sys::put_element_doubles(entry, "feature", val);
   }
   return node;
 }
 
+void data::SimplePatternSet::dump (data::XmlStreamWriter& writer,
+				   const std::string& cname,
+				   const size_t start_id) const
+{
+  writer.write(cname, *this, 0, start_id);
+}
+
 void data::SimplePatternSet::apply_pattern_op (const data::PatternOperator& op)
 {
   RINGER_DEBUG2("Applying PatternOperator to *all* my patterns.");
@@ -347,7 +448,7 @@ void data::SimplePatternSet::apply_pattern_op (const data::PatternOperator& op)
     }
     newset.set_pattern(i, tmp);
   }
-  *this = newset; //copies result
+  *this = newset; //takes over the result, w/o copying
 }
 
 void data::SimplePatternSet::apply_ensemble_op 
@@ -369,7 +470,7 @@ void data::SimplePatternSet::apply_ensemble_op
     }
     newset.set_ensemble(i, tmp);
   }
-  *this = newset; //copies result
+  *this = newset; //takes over the result, w/o copying
 }
 
 std::ostream& data::SimplePatternSet::stream_out (std::ostream& os) const
@@ -404,18 +505,17 @@ data::SimplePatternSet& data::SimplePatternSet::merge
     throw RINGER_EXCEPTION("RHS has a different pattern size."); 
   }
 
-  gsl_matrix* new_data = gsl_matrix_alloc(size() + other.size(),
-					  pattern_size());
-  gsl_matrix_view new_before = gsl_matrix_submatrix(new_data, 0, 0, 
-						    m_data->size1, 
-						    m_data->size2);
-  gsl_matrix_view new_after = gsl_matrix_submatrix(new_data, m_data->size1, 0,
-						   other.size(), 
-						   m_data->size2);  
-  gsl_matrix_memcpy(&new_before.matrix, m_data);
-  gsl_matrix_memcpy(&new_after.matrix, other.m_data);
-  gsl_matrix_free(m_data);
-  m_data = new_data;
+  data::FeatureMatrix* new_data =
+    RINGER_GSL_MATRIX(alloc)(size() + other.size(), pattern_size());
+  data::FeatureMatrixView new_before =
+    RINGER_GSL_MATRIX(submatrix)(new_data, 0, 0, m_data->size1, 
+				 m_data->size2);
+  data::FeatureMatrixView new_after =
+    RINGER_GSL_MATRIX(submatrix)(new_data, m_data->size1, 0, other.size(), 
+				 m_data->size2);  
+  RINGER_GSL_MATRIX(memcpy)(&new_before.matrix, m_data);
+  RINGER_GSL_MATRIX(memcpy)(&new_after.matrix, other.m_data);
+  reset(new_data);
   RINGER_DEBUG3("New SimplePatternSet's contains " << size() << " patterns.");
   return *this;
 }
@@ -425,15 +525,15 @@ data::SimplePatternSet& data::SimplePatternSet::assign
 {
   RINGER_DEBUG2("Reseting SimplePatternSet from selected patterns of another"
 		<< " SimplePatternSet (kind-of-copy construct).");
-  if (m_data->size1 != other.m_data->size1 || 
-      m_data->size2 != other.m_data->size2) {
-    gsl_matrix_free(m_data);
-    m_data = gsl_matrix_alloc(pats.size(), other.m_data->size2);
+  //all rows are overwritten, so a shared matrix is not worth copying
+  if (m_data->size1 != pats.size() || 
+      m_data->size2 != other.m_data->size2 || shared()) {
+    reset(RINGER_GSL_MATRIX(alloc)(pats.size(), other.m_data->size2));
     RINGER_DEBUG1("Reallocated this SimplePatternSet (assign()'ing)...");
   }
   for (unsigned int i=0; i<pats.size(); ++i)
-    gsl_matrix_set_row(m_data, i, 
-		       &gsl_matrix_row(other.m_data, pats[i]).vector);
+    RINGER_GSL_MATRIX(set_row)(m_data, i, 
+		       &RINGER_GSL_MATRIX(row)(other.m_data, pats[i]).vector);
   RINGER_DEBUG2("The new SimplePatternSet has " <<pats.size()<< " patterns.");
   return *this;
 }
@@ -443,12 +543,7 @@ data::SimplePatternSet::operator= (const SimplePatternSet& other)
 {
   RINGER_DEBUG2("Copying SimplePatternSet from another"
 		<< " SimplePatternSet (operator=).");
-  if (m_data->size1 != other.m_data->size1 || 
-      m_data->size2 != other.m_data->size2) {
-    gsl_matrix_free(m_data);
-    m_data = gsl_matrix_alloc(other.m_data->size1, other.m_data->size2);
-  }
-  gsl_matrix_memcpy(m_data, other.m_data);
+  share(other);
   return *this;
 }
 
@@ -465,6 +560,7 @@ data::SimplePatternSet& data::SimplePatternSet::operator-=
 		  << other.m_data->size1 << "," << other.m_data->size2 << "]");
     throw RINGER_EXCEPTION("Different pattern sizes in subtraction");
   }
-  gsl_matrix_sub(m_data, other.m_data);
+  detach();
+  RINGER_GSL_MATRIX(sub)(m_data, other.m_data);
   return *this;
 }
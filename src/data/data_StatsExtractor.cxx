@@ -0,0 +1,261 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/src/StatsExtractor.cxx
+ *
+ * Implements the single pass statistics calculation on Pattern's
+ */
+
+#include "TrigRingerTools/data/StatsExtractor.h"
+#include "TrigRingerTools/sys/ThreadPool.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+#include <cmath>
+#include <string>
+#include <exception>
+
+/**
+ * How many Feature's are reduced at once by add(). A chunk fits the first
+ * level cache, so its second loop does not go back to memory.
+ */
+static const size_t s_chunk = 256;
+
+data::StatsExtractor::StatsExtractor ()
+  : m_count(0),
+    m_sum(0),
+    m_mean(0),
+    m_m2(0),
+    m_min(0),
+    m_max(0)
+{
+}
+
+data::StatsExtractor::StatsExtractor (const data::Pattern& in)
+  : m_count(0),
+    m_sum(0),
+    m_mean(0),
+    m_m2(0),
+    m_min(0),
+    m_max(0)
+{
+  add(in);
+}
+
+data::StatsExtractor::StatsExtractor (const data::PatternSet& set)
+  : m_count(0),
+    m_sum(0),
+    m_mean(0),
+    m_m2(0),
+    m_min(0),
+    m_max(0)
+{
+  add(set);
+}
+
+void data::StatsExtractor::add (const data::Pattern& in)
+{
+  add(in.data(), in.size(), in.stride());
+}
+
+void data::StatsExtractor::add (const data::PatternSet& set)
+{
+  for (size_t i=0; i<set.size(); ++i) add(set.pattern(i));
+}
+
+void data::StatsExtractor::add (const data::Feature* x, const size_t n,
+				const size_t stride)
+{
+  //Each chunk is reduced by two loops without dependencies between
+  //iterations other than the reductions themselves: the first takes the sum
+  //and extrema, the second the squared deviations from the chunk mean. The
+  //chunk is then merged into the running statistics.
+  for (size_t start=0; start<n; start+=s_chunk) {
+    const size_t len = (n-start < s_chunk)? n-start : s_chunk;
+    const data::Feature* c = x + start*stride;
+    double sum = 0;
+    data::Feature min = c[0];
+    data::Feature max = c[0];
+    for (size_t i=0; i<len; ++i) {
+      const data::Feature v = c[i*stride];
+      sum += v;
+      min = (v < min)? v : min;
+      max = (v > max)? v : max;
+    }
+    data::StatsExtractor chunk;
+    chunk.m_count = len;
+    chunk.m_sum = sum;
+    chunk.m_mean = sum / len;
+    chunk.m_min = min;
+    chunk.m_max = max;
+    for (size_t i=0; i<len; ++i) {
+      const double d = c[i*stride] - chunk.m_mean;
+      chunk.m_m2 += d*d;
+    }
+    merge(chunk);
+  }
+}
+
+void data::StatsExtractor::merge (const data::StatsExtractor& other)
+{
+  if (!other.m_count) return;
+  if (!m_count) {
+    *this = other;
+    return;
+  }
+  const double na = m_count;
+  const double nb = other.m_count;
+  const double n = na + nb;
+  const double delta = other.m_mean - m_mean;
+  m_mean += delta * nb / n;
+  m_m2 += other.m_m2 + delta * delta * na * nb / n;
+  m_count += other.m_count;
+  m_sum += other.m_sum;
+  if (other.m_min < m_min) m_min = other.m_min;
+  if (other.m_max > m_max) m_max = other.m_max;
+}
+
+/**
+ * The chunk of a set accumulated by one thread of ensembles()
+ */
+class StatsTask : public sys::Task {
+
+public:
+
+  /**
+   * Builds the task for a chunk of patterns
+   *
+   * @param set The set to accumulate
+   * @param start The first pattern to accumulate
+   * @param end One past the last pattern to accumulate
+   */
+  StatsTask (const data::PatternSet& set, const size_t start,
+	     const size_t end)
+    : stats(), error(), m_set(set), m_start(start), m_end(end) {}
+
+  /**
+   * Accumulates my chunk of the set
+   */
+  virtual void run (void)
+  {
+    try {
+      data::StatsExtractor::ensembles(m_set, m_start, m_end, stats);
+    }
+    catch (const sys::Exception& ex) {
+      error = ex.what();
+    }
+    catch (const std::exception& ex) {
+      error = ex.what();
+    }
+  }
+
+public: //results
+
+  std::vector<data::StatsExtractor> stats; ///< the statistics of my chunk
+  std::string error; ///< what went wrong, if anything
+
+private: //representation
+
+  const data::PatternSet& m_set; ///< the set to accumulate
+  size_t m_start; ///< the first pattern to accumulate
+  size_t m_end; ///< one past the last pattern to accumulate
+
+};
+
+void data::StatsExtractor::ensembles (const data::PatternSet& set,
+				      std::vector<data::StatsExtractor>& stats,
+				      const unsigned int nthreads)
+{
+  size_t njobs = nthreads;
+  if (njobs > set.size()) njobs = set.size();
+  if (njobs <= 1) {
+    ensembles(set, 0, set.size(), stats);
+    return;
+  }
+  std::vector<StatsTask*> task;
+  size_t chunk = set.size() / njobs;
+  for (size_t k=0; k<njobs; ++k)
+    task.push_back(new StatsTask(set, k*chunk, (k == njobs-1)?
+				 set.size() : (k+1)*chunk));
+  sys::ThreadPool pool(njobs);
+  for (size_t k=0; k<njobs; ++k) pool.submit(task[k]);
+  pool.wait();
+  std::string error;
+  for (size_t k=0; k<njobs; ++k)
+    if (task[k]->error.size()) error = task[k]->error;
+  if (!error.size()) {
+    stats.swap(task[0]->stats);
+    for (size_t k=1; k<njobs; ++k)
+      for (size_t j=0; j<stats.size(); ++j) stats[j].merge(task[k]->stats[j]);
+  }
+  for (size_t k=0; k<njobs; ++k) delete task[k];
+  if (error.size()) {
+    RINGER_DEBUG1("Could not compute ensemble statistics: " << error
+		  << ". Exception thrown.");
+    throw RINGER_EXCEPTION(error);
+  }
+}
+
+void data::StatsExtractor::ensembles (const data::PatternSet& set,
+				      const size_t start, const size_t end,
+				      std::vector<data::StatsExtractor>& stats)
+{
+  const size_t p = set.pattern_size();
+  stats.assign(p, data::StatsExtractor());
+  if (start >= end) return;
+
+  //The accumulators are kept one per array, so the inner loop updates all
+  //ensembles independently (Welford's update) and can be vectorised.
+  std::vector<double> sum(p, 0);
+  std::vector<double> mean(p, 0);
+  std::vector<double> m2(p, 0);
+  std::vector<data::Feature> min(p, 0);
+  const data::Pattern first = set.pattern(start);
+  for (size_t j=0; j<p; ++j) min[j] = first[j];
+  std::vector<data::Feature> max(min);
+  for (size_t i=start; i<end; ++i) {
+    const data::Pattern pat = set.pattern(i);
+    const data::Feature* x = pat.data();
+    const size_t s = pat.stride();
+    const double inv = 1.0 / (i-start+1);
+    for (size_t j=0; j<p; ++j) {
+      const data::Feature v = x[j*s];
+      const double delta = v - mean[j];
+      sum[j] += v;
+      mean[j] += delta * inv;
+      m2[j] += delta * (v - mean[j]);
+      min[j] = (v < min[j])? v : min[j];
+      max[j] = (v > max[j])? v : max[j];
+    }
+  }
+  for (size_t j=0; j<p; ++j) {
+    stats[j].m_count = end - start;
+    stats[j].m_sum = sum[j];
+    stats[j].m_mean = mean[j];
+    stats[j].m_m2 = m2[j];
+    stats[j].m_min = min[j];
+    stats[j].m_max = max[j];
+  }
+}
+
+void data::StatsExtractor::reset (void)
+{
+  *this = data::StatsExtractor();
+}
+
+double data::StatsExtractor::variance (void) const
+{
+  if (m_count < 2) return 0;
+  return m_m2 / (m_count - 1);
+}
+
+double data::StatsExtractor::sd (void) const
+{
+  return std::sqrt(variance());
+}
+
+data::Feature data::StatsExtractor::absmax (void) const
+{
+  data::Feature max = std::fabs(m_max);
+  data::Feature min = std::fabs(m_min);
+  return (min > max)? min : max;
+}
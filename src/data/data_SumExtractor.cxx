@@ -7,13 +7,13 @@
  */
 
 #include "TrigRingerTools/data/SumExtractor.h"
-#include <gsl/gsl_statistics_double.h>
+#include "TrigRingerTools/data/gsl_feature.h"
 
 data::Feature data::SumExtractor::operator() (const data::Pattern& in) const
 {
-  const gsl_vector* v = abuse(in);
+  const data::FeatureVector* v = abuse(in);
   //is there a faster way to do it? Not clear from the GSL info pages
-  return v->size*gsl_stats_mean(v->data, v->stride, v->size);
+  return v->size*RINGER_GSL_STATS(mean)(v->data, v->stride, v->size);
 }
 
 
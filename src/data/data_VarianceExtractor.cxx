@@ -7,13 +7,13 @@
  */
 
 #include "TrigRingerTools/data/VarianceExtractor.h"
-#include <gsl/gsl_statistics_double.h>
+#include "TrigRingerTools/data/gsl_feature.h"
 
 data::Feature data::VarianceExtractor::operator() 
   (const data::Pattern& in) const
 {
-  const gsl_vector* v = abuse(in);
-  return gsl_stats_variance(v->data, v->stride, v->size);
+  const data::FeatureVector* v = abuse(in);
+  return RINGER_GSL_STATS(variance)(v->data, v->stride, v->size);
 }
 
 
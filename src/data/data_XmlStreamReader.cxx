@@ -0,0 +1,299 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/src/XmlStreamReader.cxx
+ *
+ * @brief Implements the streaming reader for XML database files.
+ */
+
+#include "TrigRingerTools/data/XmlStreamReader.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/data/gsl_feature.h"
+#include <cstdlib>
+#include <cstring>
+
+#ifndef XERCES_XML_BACK_END
+
+#include <libxml/xmlreader.h>
+
+/**
+ * Returns the libxml2 reader hidden in the opaque pointer
+ */
+static inline xmlTextReaderPtr reader_cast (void* p)
+{ return static_cast<xmlTextReaderPtr>(p); }
+
+/**
+ * Tells if the reader is at an element start tag with the given name
+ *
+ * @param r The reader
+ * @param name The element name to look for
+ */
+static bool is_start (xmlTextReaderPtr r, const char* name)
+{
+  if (xmlTextReaderNodeType(r) != XML_READER_TYPE_ELEMENT) return false;
+  const xmlChar* local = xmlTextReaderConstLocalName(r);
+  return local && !std::strcmp((const char*)local, name);
+}
+
+/**
+ * Reads an attribute of the current element as a string
+ *
+ * @param r The reader
+ * @param name The attribute name
+ */
+static std::string get_attribute (xmlTextReaderPtr r, const char* name)
+{
+  xmlChar* value = xmlTextReaderGetAttribute(r, (const xmlChar*)name);
+  if (!value) {
+    RINGER_DEBUG1("Attribute \"" << name << "\" is missing. Exception thrown.");
+    throw RINGER_EXCEPTION("Missing attribute in XML database entry");
+  }
+  std::string retval((const char*)value);
+  xmlFree(value);
+  return retval;
+}
+
+/**
+ * Advances the reader by one node
+ *
+ * @param r The reader
+ *
+ * @return <code>true</code> if there is a new node, <code>false</code> at
+ * the end of the document.
+ */
+static bool advance (xmlTextReaderPtr r)
+{
+  int ret = xmlTextReaderRead(r);
+  if (ret < 0) {
+    RINGER_DEBUG1("Error while reading XML database. Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot parse XML database file");
+  }
+  return ret == 1;
+}
+
+/**
+ * Makes sure the block can hold at least the given number of elements,
+ * growing it geometrically. The block data is malloc'ed by GSL, so it can
+ * be grown in place by realloc, without the extra copy of a std::vector.
+ *
+ * @param b The block to grow
+ * @param n The number of elements that should fit in the block
+ */
+static void reserve (data::FeatureBlock* b, size_t n)
+{
+  if (n <= b->size) return;
+  size_t size = b->size + b->size/2;
+  if (size < n) size = n;
+  data::Feature* data = static_cast<data::Feature*>
+    (std::realloc(b->data, size*sizeof(data::Feature)));
+  if (!data) {
+    RINGER_DEBUG1("Cannot grow feature storage to " << size
+		  << " elements. Exception thrown.");
+    throw RINGER_EXCEPTION("Not enough memory to load XML database");
+  }
+  b->data = data;
+  b->size = size;
+}
+
+data::XmlStreamReader::XmlStreamReader (const std::string& filename,
+					const std::string& schema,
+					sys::Reporter* reporter)
+  : m_filename(filename),
+    m_reader(0),
+    m_reporter(reporter)
+{
+  xmlTextReaderPtr r = xmlReaderForFile(filename.c_str(), 0,
+					XML_PARSE_NOBLANKS);
+  if (!r) {
+    RINGER_WARN(m_reporter, "Could not open file \"" << filename << "\"."
+		<< " Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot parse file");
+  }
+  if (xmlTextReaderSchemaValidate(r, schema.c_str()) != 0) {
+    xmlFreeTextReader(r);
+    RINGER_WARN(m_reporter, "Schema \"" << schema
+		<< "\" failed to compile. Exception thrown.");
+    throw RINGER_EXCEPTION("Schema cannot be parsed");
+  }
+  m_reader = r;
+  RINGER_DEBUG2("Streaming XML database from \"" << filename << "\".");
+}
+
+data::XmlStreamReader::~XmlStreamReader()
+{
+  xmlFreeTextReader(reader_cast(m_reader));
+}
+
+data::Header* data::XmlStreamReader::header (void)
+{
+  xmlTextReaderPtr r = reader_cast(m_reader);
+  while (!is_start(r, "header")) {
+    if (!advance(r)) {
+      RINGER_DEBUG1("No header in \"" << m_filename
+		    << "\". Exception thrown.");
+      throw RINGER_EXCEPTION("XML database has no header");
+    }
+  }
+  //the header is tiny, so it is expanded and read as a normal DOM node
+  xmlNodePtr node = xmlTextReaderExpand(r);
+  if (!node) {
+    RINGER_DEBUG1("Cannot expand the header of \"" << m_filename
+		  << "\". Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot parse XML database header");
+  }
+  data::Header* retval = new data::Header(node);
+  if (xmlTextReaderNext(r) < 0) {
+    delete retval;
+    RINGER_DEBUG1("Error after the header of \"" << m_filename
+		  << "\". Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot parse XML database file");
+  }
+  return retval;
+}
+
+bool data::XmlStreamReader::next_class (std::string& name)
+{
+  xmlTextReaderPtr r = reader_cast(m_reader);
+  while (!is_start(r, "class")) {
+    if (!advance(r)) {
+      if (xmlTextReaderIsValid(r) != 1)
+	RINGER_WARN(m_reporter, "Validation of \"" << m_filename
+		    << "\" failed.");
+      return false;
+    }
+  }
+  name = get_attribute(r, "name");
+  return true;
+}
+
+void data::XmlStreamReader::read
+(data::SimplePatternSet& set,
+ std::vector<data::RoIPatternSet::RoIAttribute>* attr)
+{
+  xmlTextReaderPtr r = reader_cast(m_reader);
+  if (!is_start(r, "class") || xmlTextReaderIsEmptyElement(r)) {
+    RINGER_DEBUG1("There are no entries to read in \"" << m_filename
+		  << "\". Exception thrown.");
+    throw RINGER_EXCEPTION("XML database class has no entries");
+  }
+  if (attr) attr->clear();
+
+  const int depth = xmlTextReaderDepth(r);
+  data::FeatureBlock* block = RINGER_GSL_BLOCK(alloc)(1024);
+  size_t used = 0; ///< features already in the block
+  size_t entries = 0; ///< entries already read
+  size_t std_size = 0; ///< the size of every entry
+  bool in_feature = false;
+
+  try {
+    while (advance(r)) {
+      int type = xmlTextReaderNodeType(r);
+      if (type == XML_READER_TYPE_END_ELEMENT) {
+	if (xmlTextReaderDepth(r) == depth) break; //end of class
+	if (in_feature) {
+	  in_feature = false;
+	  size_t size = used - entries*std_size;
+	  if (entries == 0) std_size = size;
+	  if (size != std_size || size == 0) {
+	    RINGER_DEBUG1("Pattern[" << entries << "] has " << size
+			  << " features, but the rest has " << std_size
+			  << ". Exception thrown.");
+	    throw RINGER_EXCEPTION
+	      ("Pattern has a different pattern than the rest");
+	  }
+	  ++entries;
+	}
+      }
+      else if (is_start(r, "feature")) {
+	if (xmlTextReaderIsEmptyElement(r)) { //there will be no end tag
+	  RINGER_DEBUG1("Pattern[" << entries << "] has no features."
+			<< " Exception thrown.");
+	  throw RINGER_EXCEPTION("Pattern has no features");
+	}
+	in_feature = true;
+      }
+      else if (attr && (is_start(r, "roientry") || is_start(r, "entry"))) {
+	data::RoIPatternSet::RoIAttribute a;
+	a.lvl1_id = std::strtoul(get_attribute(r, "lvl1_id").c_str(), 0, 10);
+	a.roi_id = std::strtoul(get_attribute(r, "roi_id").c_str(), 0, 10);
+	a.eta = std::strtod(get_attribute(r, "eta").c_str(), 0);
+	a.phi = std::strtod(get_attribute(r, "phi").c_str(), 0);
+	attr->push_back(a);
+      }
+      else if (in_feature && (type == XML_READER_TYPE_TEXT ||
+			      type == XML_READER_TYPE_SIGNIFICANT_WHITESPACE)) {
+	//converts the text straight into the block, w/o temporaries
+	const char* p = (const char*)xmlTextReaderConstValue(r);
+	char* end = 0;
+	for (double v = std::strtod(p, &end); end != p;
+	     v = std::strtod(p, &end)) {
+	  reserve(block, used+1);
+	  block->data[used++] = v;
+	  p = end;
+	}
+      }
+    }
+    if (entries == 0) {
+      RINGER_DEBUG1("There are no entries to read in \"" << m_filename
+		    << "\". Exception thrown.");
+      throw RINGER_EXCEPTION("XML database class has no entries");
+    }
+    if (attr && attr->size() != entries) {
+      RINGER_DEBUG1("Read " << attr->size() << " RoI attributes for "
+		    << entries << " entries. Exception thrown.");
+      throw RINGER_EXCEPTION("XML database entries without RoI attributes");
+    }
+  }
+  catch (...) {
+    RINGER_GSL_BLOCK(free)(block);
+    throw;
+  }
+
+  //gives back the slack and hands the storage over to the set
+  data::Feature* data = static_cast<data::Feature*>
+    (std::realloc(block->data, used*sizeof(data::Feature)));
+  if (data) block->data = data;
+  block->size = used;
+  data::FeatureMatrix* m =
+    RINGER_GSL_MATRIX(alloc_from_block)(block, 0, entries, std_size, std_size);
+  m->owner = 1; //the matrix frees the block
+  set.reset(m);
+  RINGER_DEBUG2("Streamed " << entries << " patterns of size " << std_size
+		<< " from \"" << m_filename << "\".");
+}
+
+#else /* XERCES_XML_BACK_END */
+
+data::XmlStreamReader::XmlStreamReader (const std::string& filename,
+					const std::string&,
+					sys::Reporter* reporter)
+  : m_filename(filename),
+    m_reader(0),
+    m_reporter(reporter)
+{
+  RINGER_DEBUG1("Streaming XML databases requires libxml2. Exception thrown.");
+  throw RINGER_EXCEPTION("Streaming XML reader not available with Xerces");
+}
+
+data::XmlStreamReader::~XmlStreamReader()
+{
+}
+
+data::Header* data::XmlStreamReader::header (void)
+{
+  return 0;
+}
+
+bool data::XmlStreamReader::next_class (std::string&)
+{
+  return false;
+}
+
+void data::XmlStreamReader::read
+(data::SimplePatternSet&,
+ std::vector<data::RoIPatternSet::RoIAttribute>*)
+{
+}
+
+#endif /* XERCES_XML_BACK_END */
@@ -0,0 +1,273 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file data/src/XmlStreamWriter.cxx
+ *
+ * @brief Implements the streaming writer for XML database files.
+ */
+
+#include "TrigRingerTools/data/XmlStreamWriter.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/util.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <limits>
+
+#ifndef XERCES_XML_BACK_END
+
+#include <libxml/xmlwriter.h>
+#include "TrigRingerTools/sys/libxml2_Codec.h"
+
+/**
+ * Returns the libxml2 writer hidden in the opaque pointer
+ */
+static inline xmlTextWriterPtr writer_cast (void* p)
+{ return static_cast<xmlTextWriterPtr>(p); }
+
+/**
+ * Checks the return value of a libxml2 writer call
+ *
+ * @param ret What the call returned
+ */
+static inline void check (int ret)
+{
+  if (ret < 0) {
+    RINGER_DEBUG1("Error while writing XML database. Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot write XML database file");
+  }
+}
+
+/**
+ * Checks what snprintf() returned, so truncated or failed numbers are never
+ * written
+ *
+ * @param n What snprintf() returned
+ * @param size The size of the buffer given to snprintf()
+ *
+ * @return The number of characters written, without the final null
+ */
+static size_t checked (const int n, const size_t size)
+{
+  if (n < 0 || (size_t)n >= size) {
+    RINGER_DEBUG1("Cannot format a number for the XML database."
+		  << " Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot format number for XML database");
+  }
+  return n;
+}
+
+/**
+ * Formats a real number with as few digits as it takes to read it back
+ * exactly: most numbers only need the digits the type guarantees, the
+ * others get all the digits that can make a difference.
+ *
+ * @param buf Where to put the number
+ * @param size The size of the buffer
+ * @param value The number to format
+ *
+ * @return The number of characters written, without the final null
+ */
+template <class T>
+static size_t format_real (char* buf, const size_t size, const T& value)
+{
+  const int shortest = std::numeric_limits<T>::digits10;
+  const int longest = 2 + std::numeric_limits<T>::digits * 30103 / 100000;
+  size_t n = checked(std::snprintf(buf, size, "%.*g", shortest,
+				   (double)value), size);
+  if ((T)std::strtod(buf, 0) != value)
+    n = checked(std::snprintf(buf, size, "%.*g", longest, (double)value),
+		size);
+  return n;
+}
+
+/**
+ * Writes a text element, transcoding the text to UTF-8
+ *
+ * @param w The writer
+ * @param name The element name
+ * @param content The element text
+ */
+static void put_text (xmlTextWriterPtr w, const char* name,
+		      const std::string& content)
+{
+  sys::ustring text = sys::default_codec.transcode(content);
+  check(xmlTextWriterWriteElement(w, (const xmlChar*)name, text.c_str()));
+}
+
+/**
+ * Writes a numeric attribute
+ *
+ * @param w The writer
+ * @param name The attribute name
+ * @param value The attribute value
+ */
+static void put_attribute (xmlTextWriterPtr w, const char* name,
+			   const unsigned long value)
+{
+  char buf[32];
+  checked(std::snprintf(buf, sizeof(buf), "%lu", value), sizeof(buf));
+  check(xmlTextWriterWriteAttribute(w, (const xmlChar*)name,
+				    (const xmlChar*)buf));
+}
+
+/**
+ * Writes a real attribute, with the digits it takes to read it back
+ *
+ * @param w The writer
+ * @param name The attribute name
+ * @param value The attribute value
+ */
+static void put_attribute (xmlTextWriterPtr w, const char* name,
+			   const double& value)
+{
+  char buf[32];
+  format_real(buf, sizeof(buf), value);
+  check(xmlTextWriterWriteAttribute(w, (const xmlChar*)name,
+				    (const xmlChar*)buf));
+}
+
+data::XmlStreamWriter::XmlStreamWriter (const std::string& filename,
+					const data::Header& header,
+					sys::Reporter* reporter)
+  : m_filename(filename),
+    m_writer(0),
+    m_buffer(),
+    m_reporter(reporter)
+{
+  RINGER_DEBUG2("Checking existence of \"" << filename << "\" first.");
+  if (!sys::backup(filename)) {
+    RINGER_DEBUG1("Cannot backup \"" << filename << "\". Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot backup existing XML database file");
+  }
+  xmlTextWriterPtr w = xmlNewTextWriterFilename(filename.c_str(), 0);
+  if (!w) {
+    RINGER_WARN(m_reporter, "Could not open file \"" << filename << "\""
+		<< " for writing. Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot write XML database file");
+  }
+  m_writer = w;
+  try {
+    xmlTextWriterSetIndent(w, 1);
+    xmlTextWriterSetIndentString(w, (const xmlChar*)"  ");
+    check(xmlTextWriterStartDocument(w, 0, "UTF-8", 0));
+    check(xmlTextWriterStartElement(w, (const xmlChar*)"database"));
+    check(xmlTextWriterWriteAttribute(w, (const xmlChar*)"version",
+				      (const xmlChar*)"0.1"));
+    check(xmlTextWriterStartElement(w, (const xmlChar*)"header"));
+    put_text(w, "author", header.author());
+    put_text(w, "name", header.name());
+    put_text(w, "version", header.version());
+    time_t created = header.created();
+    put_text(w, "created", sys::timetoiso8601(&created));
+    time_t now = time(0);
+    put_text(w, "lastSaved", sys::timetoiso8601(&now));
+    if (std::string(header.comment()).length())
+      put_text(w, "comment", header.comment());
+    check(xmlTextWriterEndElement(w)); //header
+    check(xmlTextWriterStartElement(w, (const xmlChar*)"data"));
+  }
+  catch (...) {
+    xmlFreeTextWriter(w);
+    throw;
+  }
+  RINGER_DEBUG2("Streaming XML database to \"" << filename << "\".");
+}
+
+data::XmlStreamWriter::~XmlStreamWriter()
+{
+  if (m_writer) xmlFreeTextWriter(writer_cast(m_writer));
+}
+
+void data::XmlStreamWriter::write
+(const std::string& cname, const data::SimplePatternSet& set,
+ const std::vector<data::RoIPatternSet::RoIAttribute>* attr,
+ const size_t start_id)
+{
+  xmlTextWriterPtr w = writer_cast(m_writer);
+  if (!w) {
+    RINGER_DEBUG1("Writing class \"" << cname << "\" to closed file \""
+		  << m_filename << "\". Exception thrown.");
+    throw RINGER_EXCEPTION("XML database file already closed");
+  }
+  check(xmlTextWriterStartElement(w, (const xmlChar*)"class"));
+  check(xmlTextWriterWriteAttribute
+	(w, (const xmlChar*)"name",
+	 sys::default_codec.transcode(cname).c_str()));
+  const char* entry = attr? "roientry" : "entry";
+  char buf[32];
+  for (size_t i=0; i<set.size(); ++i) {
+    check(xmlTextWriterStartElement(w, (const xmlChar*)entry));
+    put_attribute(w, "id", (unsigned long)(start_id + i));
+    if (attr) {
+      put_attribute(w, "lvl1_id", (unsigned long)(*attr)[i].lvl1_id);
+      put_attribute(w, "roi_id", (unsigned long)(*attr)[i].roi_id);
+      put_attribute(w, "eta", (*attr)[i].eta);
+      put_attribute(w, "phi", (*attr)[i].phi);
+    }
+    //formats all features at once, there is nothing to escape in numbers
+    const data::Pattern pat = set.pattern(i);
+    const data::Feature* f = pat.data();
+    m_buffer.clear();
+    for (size_t j=0; j<pat.size(); ++j) {
+      if (j) m_buffer.append(1, ' ');
+      m_buffer.append(buf, format_real(buf, sizeof(buf), f[j*pat.stride()]));
+    }
+    check(xmlTextWriterStartElement(w, (const xmlChar*)"feature"));
+    check(xmlTextWriterWriteRaw(w, (const xmlChar*)m_buffer.c_str()));
+    check(xmlTextWriterEndElement(w)); //feature
+    check(xmlTextWriterEndElement(w)); //entry
+  }
+  check(xmlTextWriterEndElement(w)); //class
+  RINGER_DEBUG2("Streamed class \"" << cname << "\" with " << set.size()
+		<< " entries to \"" << m_filename << "\".");
+}
+
+bool data::XmlStreamWriter::close (void)
+{
+  xmlTextWriterPtr w = writer_cast(m_writer);
+  if (!w) return false;
+  //closes data and database
+  bool ok = xmlTextWriterEndDocument(w) >= 0;
+  xmlFreeTextWriter(w); //flushes and closes the file
+  m_writer = 0;
+  if (!ok) {
+    RINGER_WARN(m_reporter, "Could not finish writing \"" << m_filename
+		<< "\".");
+    return false;
+  }
+  RINGER_DEBUG2("File \"" << m_filename << "\" was saved.");
+  return true;
+}
+
+#else /* XERCES_XML_BACK_END */
+
+data::XmlStreamWriter::XmlStreamWriter (const std::string& filename,
+					const data::Header&,
+					sys::Reporter* reporter)
+  : m_filename(filename),
+    m_writer(0),
+    m_buffer(),
+    m_reporter(reporter)
+{
+  RINGER_DEBUG1("Streaming XML databases requires libxml2. Exception thrown.");
+  throw RINGER_EXCEPTION("Streaming XML writer not available with Xerces");
+}
+
+data::XmlStreamWriter::~XmlStreamWriter()
+{
+}
+
+void data::XmlStreamWriter::write
+(const std::string&, const data::SimplePatternSet&,
+ const std::vector<data::RoIPatternSet::RoIAttribute>*, const size_t)
+{
+}
+
+bool data::XmlStreamWriter::close (void)
+{
+  return false;
+}
+
+#endif /* XERCES_XML_BACK_END */
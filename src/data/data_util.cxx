@@ -7,25 +7,30 @@
  */
 
 #include "TrigRingerTools/data/util.h"
-#include "TrigRingerTools/data/MeanExtractor.h"
-#include "TrigRingerTools/data/MaxExtractor.h"
-#include "TrigRingerTools/data/MinExtractor.h"
+#include "TrigRingerTools/data/StatsExtractor.h"
+#include "TrigRingerTools/sys/ThreadPool.h"
 #include "TrigRingerTools/sys/Exception.h"
 #include "TrigRingerTools/sys/debug.h"
-#include <gsl/gsl_pow_int.h>
 #include <cmath>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <string>
+#include <exception>
 
 data::Feature data::mean_square (const data::PatternSet& p)
 {
-  data::MeanExtractor mean;
-  data::Pattern tmp(p.pattern_size());
-  data::Feature retval = 0;
+  double retval = 0; //whole set sums need double, even with float Features
   for (size_t i=0; i<p.size(); ++i) {
-    tmp = p.pattern(i);
-    tmp.apply(gsl_pow_2);
-    retval += mean(tmp);
+    const data::Pattern tmp = p.pattern(i);
+    const data::Feature* x = tmp.data();
+    const size_t stride = tmp.stride();
+    for (size_t j=0; j<tmp.size(); ++j) retval += x[j*stride] * x[j*stride];
   }
-  retval /= (p.size()*p.pattern_size());
+  //each Pattern has always added its own mean square to the sum, so the
+  //pattern size divides it twice, keeping the MSE values seen so far
+  const double psize = p.pattern_size();
+  retval /= (p.size()*psize*psize);
   return retval;
 }
 
@@ -36,63 +41,253 @@ data::Feature data::root_mean_square (const data::PatternSet& p)
 
 data::Feature data::abs_mean (const data::PatternSet& p)
 {
-  data::MeanExtractor mean;
-  data::Pattern tmp(p.pattern_size());
-  data::Feature retval = 0;
+  double retval = 0;
   for (size_t i=0; i<p.size(); ++i) {
-    tmp = p.pattern(i);
-    tmp.apply(fabs);
-    retval += mean(tmp);
+    const data::Pattern tmp = p.pattern(i);
+    const data::Feature* x = tmp.data();
+    const size_t stride = tmp.stride();
+    for (size_t j=0; j<tmp.size(); ++j) retval += fabs(x[j*stride]);
   }
-  retval /= (p.size());
+  retval /= (p.size()*p.pattern_size());
   return retval;
 }
 
-double data::sp (const data::PatternSet& output, 
-		 const data::PatternSet& target,
-		 double& eff1, double& eff2, double& thres)
+/**
+ * The range of patterns whose errors one thread of data::error() accumulates
+ */
+class ErrorTask : public sys::Task {
+
+public:
+
+  /**
+   * Builds the task for a range of patterns
+   *
+   * @param output The output set
+   * @param target The target set
+   * @param start The first pattern to consider
+   * @param end One past the last pattern to consider
+   */
+  ErrorTask (const data::PatternSet& output, const data::PatternSet& target,
+	     const size_t start, const size_t end)
+    : square(0), absolute(0), error(), m_output(output), m_target(target),
+      m_start(start), m_end(end) {}
+
+  /**
+   * Accumulates the square and absolute errors of my patterns, in a single
+   * pass.
+   */
+  virtual void run (void)
+  {
+    try {
+      for (size_t i=m_start; i<m_end; ++i) {
+	const data::Pattern o = m_output.pattern(i);
+	const data::Pattern t = m_target.pattern(i);
+	const data::Feature* po = o.data();
+	const data::Feature* pt = t.data();
+	const size_t so = o.stride();
+	const size_t st = t.stride();
+	for (size_t j=0; j<o.size(); ++j) {
+	  double e = pt[j*st] - po[j*so];
+	  square += e*e;
+	  absolute += fabs(e);
+	}
+      }
+    }
+    catch (const sys::Exception& ex) {
+      error = ex.what();
+    }
+    catch (const std::exception& ex) {
+      error = ex.what();
+    }
+  }
+
+public: //results
+
+  double square; ///< the accumulated square error
+  double absolute; ///< the accumulated absolute error
+  std::string error; ///< what went wrong, if anything
+
+private: //representation
+
+  const data::PatternSet& m_output; ///< the output set
+  const data::PatternSet& m_target; ///< the target set
+  size_t m_start; ///< the first pattern to consider
+  size_t m_end; ///< one past the last pattern to consider
+
+};
+
+void data::error (const data::PatternSet& output,
+		  const data::PatternSet& target,
+		  double& mse, double& mae, const unsigned int nthreads)
+{
+  if (output.size() != target.size() || 
+      output.pattern_size() != target.pattern_size()) {
+    RINGER_DEBUG1("The output set (" << output.size() << "x" 
+		  << output.pattern_size() << ") and the target set ("
+		  << target.size() << "x" << target.pattern_size() 
+		  << ") have different dimensions. Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot calculate the error of different sets");
+  }
+  size_t njobs = nthreads;
+  if (njobs > output.size()) njobs = output.size();
+  if (njobs == 0) njobs = 1;
+  std::vector<ErrorTask*> task;
+  size_t chunk = output.size() / njobs;
+  for (size_t k=0; k<njobs; ++k)
+    task.push_back(new ErrorTask(output, target, k*chunk, (k == njobs-1)?
+				 output.size() : (k+1)*chunk));
+  if (njobs == 1) task[0]->run();
+  else {
+    sys::ThreadPool pool(njobs);
+    for (size_t k=0; k<njobs; ++k) pool.submit(task[k]);
+    pool.wait();
+  }
+  double square = 0;
+  double absolute = 0;
+  std::string error;
+  for (size_t k=0; k<njobs; ++k) {
+    square += task[k]->square;
+    absolute += task[k]->absolute;
+    if (task[k]->error.size()) error = task[k]->error;
+    delete task[k];
+  }
+  if (error.size()) {
+    RINGER_DEBUG1("Could not calculate the error: " << error
+		  << ". Exception thrown.");
+    throw RINGER_EXCEPTION(error);
+  }
+  //the MSE is the mean_square() of the error set, which has always been
+  //divided by the pattern size once more
+  const double n = output.size()*output.pattern_size();
+  mse = square/(n*output.pattern_size());
+  mae = absolute/n;
+}
+
+double data::mse (const data::PatternSet& output, 
+		  const data::PatternSet& target, const unsigned int nthreads)
+{
+  double mse, mae;
+  data::error(output, target, mse, mae, nthreads);
+  return mse;
+}
+
+double data::rmse (const data::PatternSet& output, 
+		   const data::PatternSet& target, const unsigned int nthreads)
+{
+  return sqrt(data::mse(output, target, nthreads));
+}
+
+double data::mae (const data::PatternSet& output, 
+		  const data::PatternSet& target, const unsigned int nthreads)
+{
+  double mse, mae;
+  data::error(output, target, mse, mae, nthreads);
+  return mae;
+}
+
+/**
+ * Collects the (output, class) pairs of an SP/ROC computation, sorted by
+ * increasing output value. The class split is done at the middle of the
+ * target range: targets above it belong to class 2.
+ *
+ * @param output The output of the network
+ * @param target The target of the network
+ * @param sorted The place where to put the sorted pairs
+ * @param n1 The number of events of class 1
+ * @param n2 The number of events of class 2
+ */
+static void sort_outputs (const data::PatternSet& output,
+			  const data::PatternSet& target,
+			  std::vector<std::pair<data::Feature, bool> >& sorted,
+			  size_t& n1, size_t& n2)
 {
-  const double SCAN_STEP = 0.001; //1 per thousand of the target delta
   if (output.pattern_size() > 1 || target.pattern_size() > 1) {
     RINGER_DEBUG1("I can only calculate the SP product if the pattern sizes"
 		  " of `output' and `target' are equal to 1. Exception"
 		  " thrown.");
     throw RINGER_EXCEPTION("Cannot calculate SP product");
   }
+  if (output.size() != target.size()) {
+    RINGER_DEBUG1("The number of patterns in `output' (" << output.size()
+		  << ") and `target' (" << target.size() << ") differ."
+		  << " Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot calculate SP product");
+  }
   const data::Pattern o = output.ensemble(0);
   const data::Pattern t = target.ensemble(0);
-  data::MinExtractor minima;
-  data::Feature min = minima(t);
-  data::MaxExtractor maxima;
-  data::Feature max = maxima(t);
-  data::Feature step = (max-min)*SCAN_STEP;
-  data::Feature middle = (max+min)/2;
+  const data::StatsExtractor range(t);
+  data::Feature middle = (range.max()+range.min())/2;
+  sorted.clear();
+  sorted.reserve(t.size());
+  n1 = n2 = 0;
+  for (size_t j = 0; j < t.size(); ++j) {
+    bool class2 = (t[j] > middle);
+    if (class2) ++n2;
+    else ++n1;
+    sorted.push_back(std::make_pair(o[j], class2));
+  }
+  std::sort(sorted.begin(), sorted.end());
+}
+
+double data::sp (const data::PatternSet& output, 
+		 const data::PatternSet& target,
+		 double& eff1, double& eff2, double& thres)
+{
+  std::vector<std::pair<data::Feature, bool> > sorted;
+  size_t n1, n2;
+  sort_outputs(output, target, sorted, n1, n2);
   double sp = 0;
-  for (data::Feature i = min; i <= max; i += step) {
-    unsigned int success1 = 0;
-    unsigned int failure1 = 0;
-    unsigned int success2 = 0;
-    unsigned int failure2 = 0;
-    for (unsigned int j = 0; j < t.size(); ++j) {
-      if (t[j] > middle) {
-	if (o[j] >= i) ++success2;
-	else ++failure2;
-      }
-      else {
-	if (o[j] < i) ++success1;
-	else ++failure1;
+  if (n1 == 0 || n2 == 0) {
+    RINGER_DEBUG1("One of the classes has no events. The SP product is"
+		  " null.");
+    return sp;
+  }
+  //Sweeps every distinct output value as threshold: events below it are
+  //assigned to class 1 and events at or above it, to class 2.
+  size_t below1 = 0; //class 1 events below the current threshold
+  size_t below2 = 0; //class 2 events below the current threshold
+  for (size_t k = 0; k < sorted.size(); ++k) {
+    if (k == 0 || sorted[k].first != sorted[k-1].first) {
+      double temp_eff1 = ((double)below1)/n1;
+      double temp_eff2 = ((double)(n2 - below2))/n2;
+      double temp_sp = (temp_eff1 + temp_eff2) * (temp_eff1 * temp_eff2);
+      if (temp_sp > sp) {
+	sp = temp_sp;
+	eff1 = temp_eff1;
+	eff2 = temp_eff2;
+	thres = sorted[k].first;
       }
     }
-    //calculates the SP product for this threshold
-    double temp_eff1 = ((double)success1)/(success1 + failure1);
-    double temp_eff2 = ((double)success2)/(success2 + failure2);
-    double temp_sp = (temp_eff1 + temp_eff2) * (temp_eff1 * temp_eff2);
-    if (temp_sp > sp) {
-      sp = temp_sp;
-      eff1 = temp_eff1;
-      eff2 = temp_eff2;
-      thres = i;
-    }
+    if (sorted[k].second) ++below2;
+    else ++below1;
   }
   return sp;
 }
+
+void data::roc (const data::PatternSet& output, 
+		const data::PatternSet& target,
+		std::vector<double>& eff1, std::vector<double>& eff2,
+		std::vector<double>& thres)
+{
+  std::vector<std::pair<data::Feature, bool> > sorted;
+  size_t n1, n2;
+  sort_outputs(output, target, sorted, n1, n2);
+  eff1.clear();
+  eff2.clear();
+  thres.clear();
+  if (n1 == 0 || n2 == 0) {
+    RINGER_DEBUG1("One of the classes has no events. The ROC is empty.");
+    return;
+  }
+  size_t below1 = 0;
+  size_t below2 = 0;
+  for (size_t k = 0; k < sorted.size(); ++k) {
+    if (k == 0 || sorted[k].first != sorted[k-1].first) {
+      eff1.push_back(((double)below1)/n1);
+      eff2.push_back(((double)(n2 - below2))/n2);
+      thres.push_back(sorted[k].first);
+    }
+    if (sorted[k].second) ++below2;
+    else ++below1;
+  }
+}
@@ -0,0 +1,143 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/src/AsyncEvaluator.cxx
+ *
+ * Implements the background evaluation of networks being trained
+ */
+
+#include "TrigRingerTools/network/AsyncEvaluator.h"
+#include "TrigRingerTools/config/Network.h"
+#include "TrigRingerTools/data/util.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include <exception>
+
+network::Evaluation::Evaluation (const network::BatchTrainer& net,
+				 const size_t epoch,
+				 const data::SimplePatternSet& test,
+				 const data::SimplePatternSet& test_target,
+				 const data::SimplePatternSet& train,
+				 const data::SimplePatternSet& target,
+				 const bool classify)
+  : epoch(epoch),
+    test_mse(0),
+    test_sp(0),
+    test_eff1(0),
+    test_eff2(0),
+    test_thres(0),
+    train_mse(0),
+    train_sp(0),
+    train_eff1(0),
+    train_eff2(0),
+    train_thres(0),
+    error(),
+    m_net(net),
+    m_neuron(),
+    m_synapse(),
+    m_test(test),
+    m_test_target(test_target),
+    m_train(train),
+    m_target(target),
+    m_classify(classify)
+{
+  net.dump(m_neuron, m_synapse);
+}
+
+network::Evaluation::~Evaluation ()
+{
+}
+
+void network::Evaluation::run (void)
+{
+  try {
+    data::SimplePatternSet output(m_test_target);
+    m_net.run(m_test, output);
+    test_mse = data::mse(output, m_test_target);
+    if (m_classify)
+      test_sp = data::sp(output, m_test_target, test_eff1, test_eff2,
+			 test_thres);
+    output = m_target;
+    m_net.run(m_train, output);
+    train_mse = data::mse(output, m_target);
+    if (m_classify)
+      train_sp = data::sp(output, m_target, train_eff1, train_eff2,
+			  train_thres);
+  }
+  catch (const sys::Exception& ex) {
+    error = ex.what();
+  }
+  catch (const std::exception& ex) {
+    error = ex.what();
+  }
+}
+
+void network::Evaluation::save (const std::string& file,
+				const config::Header* header,
+				sys::Reporter* reporter) const
+{
+  RINGER_DEBUG3("Saving network state of epoch " << epoch << " at file \""
+		<< file << "\".");
+  std::vector<config::Neuron> neurons(m_neuron);
+  std::vector<config::Synapse> synapses(m_synapse);
+  std::vector<config::Neuron*> neuron_config;
+  for (size_t i=0; i<neurons.size(); ++i) neuron_config.push_back(&neurons[i]);
+  std::vector<config::Synapse*> synapse_config;
+  for (size_t k=0; k<synapses.size(); ++k)
+    synapse_config.push_back(&synapses[k]);
+  config::Network new_config(header, synapse_config, neuron_config, reporter);
+  if (!new_config.save(file)) {
+    RINGER_WARN(reporter, "I could not save network state in \""
+		<< file << "\". Exception thrown.");
+    throw RINGER_EXCEPTION("couldn't save network state");
+  }
+  RINGER_DEBUG3("Network state saved.");
+}
+
+network::AsyncEvaluator::AsyncEvaluator
+(const data::SimplePatternSet& test, const data::SimplePatternSet& test_target,
+ const data::SimplePatternSet& train, const data::SimplePatternSet& target,
+ const bool classify, const size_t backlog)
+  : m_test(test),
+    m_test_target(test_target),
+    m_train(train),
+    m_target(target),
+    m_classify(classify),
+    m_backlog(backlog? backlog : 1),
+    m_pool(1),
+    m_pending()
+{
+}
+
+network::AsyncEvaluator::~AsyncEvaluator ()
+{
+  m_pool.wait();
+  for (size_t i=0; i<m_pending.size(); ++i) delete m_pending[i];
+}
+
+void network::AsyncEvaluator::submit (const network::BatchTrainer& net,
+				      const size_t epoch)
+{
+  if (m_pool.pending() >= m_backlog) {
+    RINGER_DEBUG2("Waiting for " << m_pool.pending() << " evaluations before"
+		  << " evaluating epoch " << epoch << ".");
+    m_pool.wait();
+  }
+  m_pending.push_back(new network::Evaluation(net, epoch, m_test,
+					      m_test_target, m_train,
+					      m_target, m_classify));
+  m_pool.submit(m_pending.back());
+}
+
+network::Evaluation* network::AsyncEvaluator::next (const bool block)
+{
+  if (m_pending.empty()) return 0;
+  //there is a single thread, so evaluations finish in submission order
+  if (m_pool.pending() == m_pending.size()) {
+    if (!block) return 0;
+    m_pool.wait();
+  }
+  network::Evaluation* retval = m_pending.front();
+  m_pending.pop_front();
+  return retval;
+}
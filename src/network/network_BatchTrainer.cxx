@@ -0,0 +1,537 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/src/BatchTrainer.cxx
+ *
+ * Implements the layer-wise, mini-batch back propagation trainer
+ */
+
+#include "TrigRingerTools/network/BatchTrainer.h"
+#include "TrigRingerTools/network/SynapseBackProp.h"
+#include "TrigRingerTools/network/SynapseRProp.h"
+#include "TrigRingerTools/config/SynapseBackProp.h"
+#include "TrigRingerTools/config/SynapseRProp.h"
+#include "TrigRingerTools/config/Network.h"
+#include "TrigRingerTools/data/gsl_feature.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include <gsl/gsl_blas.h>
+#include <ctime>
+#include <exception>
+
+/**
+ * How many patterns of a mini-batch are propagated together, as in
+ * CompiledNetwork. This is also the smallest share given to a thread.
+ */
+static const size_t s_block = 256;
+
+/**
+ * The weights of unweighted mini-batches, where every pattern counts as 1
+ */
+static const std::vector<double> s_unweighted;
+
+/**
+ * The part of a mini-batch trained by one thread, with all the buffers it
+ * needs, so that threads do not share anything they write to.
+ */
+class network::BatchTrainer::Share : public sys::Task {
+
+public:
+
+  /**
+   * Builds an empty share
+   *
+   * @param trainer The trainer this share works for
+   */
+  Share (const network::BatchTrainer& trainer)
+    : input(0), target(0), pats(0), weight(0), start(0), end(0), work(),
+      error(),
+      block(), gradient(), delta_sum(), sse(0), failure(),
+      m_trainer(trainer) {}
+
+  /**
+   * Accumulates the gradients of my patterns
+   */
+  virtual void run (void)
+  {
+    failure.clear();
+    try {
+      m_trainer.accumulate(*this);
+    }
+    catch (const sys::Exception& ex) {
+      failure = ex.what();
+    }
+    catch (const std::exception& ex) {
+      failure = ex.what();
+    }
+  }
+
+public: //what to do
+
+  const data::SimplePatternSet* input; ///< the training patterns
+  const data::SimplePatternSet* target; ///< the training targets
+  const std::vector<size_t>* pats; ///< the positions of the mini-batch
+  const std::vector<double>* weight; ///< of each position, if not all 1
+  size_t start; ///< the first position of my share
+  size_t end; ///< one past the last position of my share
+
+public: //buffers and results
+
+  std::vector<data::Feature> work; ///< the neuron values of a block
+  std::vector<data::Feature> error; ///< the errors, laid out as work
+  std::vector<data::Feature> block; ///< the weight gradients of a block
+  std::vector<std::vector<double> > gradient; ///< per layer
+  std::vector<std::vector<double> > delta_sum; ///< per layer
+  double sse; ///< the sum of the squared errors
+  std::string failure; ///< what went wrong, if anything
+
+private: //representation
+
+  const network::BatchTrainer& m_trainer; ///< who I work for
+
+};
+
+/**
+ * Returns the derivative of an activation function, as
+ * strategy::NeuronBackProp does, from its output.
+ *
+ * @param af The activation function
+ * @param y The output of the neuron
+ */
+static inline data::Feature derivative
+(const config::NeuronBackProp::ActivationFunction af, data::Feature y)
+{
+  switch (af) {
+  case config::NeuronBackProp::TANH:
+    return 1 - y*y;
+  case config::NeuronBackProp::SIGMOID:
+    return y * (1 - y);
+  default: //LINEAR
+    break;
+  }
+  return 1;
+}
+
+network::BatchTrainer::BatchTrainer (const std::string& config,
+				     sys::Reporter* reporter,
+				     const unsigned int nthreads)
+  : CompiledNetwork(),
+    m_reporter(reporter),
+    m_header(0),
+    m_neuron(),
+    m_synapse_config(),
+    m_teacher(),
+    m_bias_weight(),
+    m_gradient(),
+    m_delta_sum(),
+    m_threads(nthreads? nthreads : 1),
+    m_pool(0),
+    m_share()
+{
+  RINGER_REPORT(reporter, "Loading network configuration...");
+  config::Network net(config, reporter);
+  m_header = new config::Header(*net.header());
+  for (std::vector<config::Neuron*>::const_iterator it =
+	 net.neurons().begin(); it != net.neurons().end(); ++it)
+    m_neuron.push_back(**it);
+  for (std::vector<config::Synapse*>::const_iterator it =
+	 net.synapses().begin(); it != net.synapses().end(); ++it)
+    m_synapse_config.push_back(**it);
+  setup();
+  RINGER_REPORT(reporter, "Compiled network \"" << net.header()->name()
+		<< "\" for training in " << m_layer.size() << " layer(s).");
+}
+
+network::BatchTrainer::BatchTrainer (const network::Network& net,
+				     sys::Reporter* reporter,
+				     const unsigned int nthreads)
+  : CompiledNetwork(),
+    m_reporter(reporter),
+    m_header(0),
+    m_neuron(),
+    m_synapse_config(),
+    m_teacher(),
+    m_bias_weight(),
+    m_gradient(),
+    m_delta_sum(),
+    m_threads(nthreads? nthreads : 1),
+    m_pool(0),
+    m_share()
+{
+  net.dump(m_neuron, m_synapse_config);
+  setup();
+}
+
+network::BatchTrainer::~BatchTrainer ()
+{
+  delete m_pool;
+  for (size_t k=0; k<m_share.size(); ++k) delete m_share[k];
+  for (size_t k=0; k<m_teacher.size(); ++k) delete m_teacher[k];
+  delete m_header;
+}
+
+void network::BatchTrainer::setup (void)
+{
+  std::vector<const config::Neuron*> neurons;
+  for (size_t i=0; i<m_neuron.size(); ++i) neurons.push_back(&m_neuron[i]);
+  std::vector<const config::Synapse*> synapses;
+  for (size_t k=0; k<m_synapse_config.size(); ++k)
+    synapses.push_back(&m_synapse_config[k]);
+  compile(neurons, synapses);
+
+  //each weight must belong to a single synapse to be trained on its own
+  std::vector<std::vector<bool> > taken(m_layer.size());
+  for (size_t l=0; l<m_layer.size(); ++l)
+    taken[l].assign(m_layer[l].weight.size(), false);
+  m_bias_weight.assign(synapses.size(), 0);
+  for (size_t k=0; k<synapses.size(); ++k) {
+    const synapse_t& place = m_synapse[k];
+    if (place.bias) {
+      m_bias_weight[k] = synapses[k]->weight();
+      continue;
+    }
+    size_t pos = place.row*m_layer[place.layer].width + place.column;
+    if (taken[place.layer][pos]) {
+      RINGER_DEBUG1("Synapse " << synapses[k]->id() << " connects the same"
+		    << " neurons as another synapse and cannot be trained in"
+		    << " batch. Exception thrown.");
+      throw RINGER_EXCEPTION("Parallel synapses in network");
+    }
+    taken[place.layer][pos] = true;
+  }
+
+  for (size_t k=0; k<synapses.size(); ++k) {
+    switch (synapses[k]->strategy()) {
+    case config::SYNAPSE_BACKPROP:
+      m_teacher.push_back
+	(new strategy::SynapseBackProp(synapses[k]->parameters()));
+      break;
+    case config::SYNAPSE_RPROP:
+      m_teacher.push_back
+	(new strategy::SynapseRProp(synapses[k]->parameters()));
+      break;
+    default:
+      RINGER_DEBUG1("Unknown strategy type \"" << synapses[k]->strategy()
+		    << "\" for synapse " << synapses[k]->id()
+		    << "! Exception thrown.");
+      throw RINGER_EXCEPTION("Unknown strategy type");
+    }
+  }
+
+  m_gradient.resize(m_layer.size());
+  m_delta_sum.resize(m_layer.size());
+  if (m_threads > 1) m_pool = new sys::ThreadPool(m_threads);
+}
+
+void network::BatchTrainer::back_propagate (Share& share,
+					    const size_t n) const
+{
+  const data::Feature* values = &share.work[0];
+  data::Feature* error = &share.error[0];
+  for (size_t l=m_layer.size(); l>0; --l) {
+    const layer_t& layer = m_layer[l-1];
+    std::vector<double>& delta_sum = share.delta_sum[l-1];
+
+    //the local gradients replace the errors of this layer
+    for (size_t r=0; r<n; ++r) {
+      const data::Feature* y = values + r*m_values + layer.first;
+      data::Feature* e = error + r*m_values + layer.first;
+      for (size_t j=0; j<layer.size; ++j) {
+	e[j] *= derivative(layer.af[j], y[j]);
+	delta_sum[j] += e[j];
+      }
+    }
+    if (!layer.width || !layer.size) continue;
+
+    data::FeatureMatrixView d =
+      RINGER_GSL_MATRIX(view_array_with_tda)(error + layer.first, n,
+					     layer.size, m_values);
+    //the weight gradients of the block: deltas (transposed) times the
+    //layer inputs, added to the share sums at double precision
+    data::FeatureMatrixConstView x =
+      RINGER_GSL_MATRIX(const_view_array_with_tda)(values + layer.from, n,
+						   layer.width, m_values);
+    data::FeatureMatrixView g =
+      RINGER_GSL_MATRIX(view_array)(&share.block[0], layer.size,
+				    layer.width);
+    RINGER_GSL_BLAS(gemm)(CblasTrans, CblasNoTrans, 1, &d.matrix, &x.matrix,
+			  0, &g.matrix);
+    std::vector<double>& gradient = share.gradient[l-1];
+    for (size_t i=0; i<gradient.size(); ++i) gradient[i] += share.block[i];
+    //the errors fed backward, with the weights before this update
+    data::FeatureMatrixConstView w =
+      RINGER_GSL_MATRIX(const_view_array)(&layer.weight[0], layer.size,
+					  layer.width);
+    data::FeatureMatrixView b =
+      RINGER_GSL_MATRIX(view_array_with_tda)(error + layer.from, n,
+					     layer.width, m_values);
+    RINGER_GSL_BLAS(gemm)(CblasNoTrans, CblasNoTrans, 1, &d.matrix,
+			  &w.matrix, 1, &b.matrix);
+  }
+}
+
+void network::BatchTrainer::accumulate (Share& share) const
+{
+  share.gradient.resize(m_layer.size());
+  share.delta_sum.resize(m_layer.size());
+  for (size_t l=0; l<m_layer.size(); ++l) {
+    share.gradient[l].assign(m_layer[l].weight.size(), 0);
+    share.delta_sum[l].assign(m_layer[l].size, 0);
+    if (share.block.size() < m_layer[l].weight.size())
+      share.block.resize(m_layer[l].weight.size());
+  }
+  share.sse = 0;
+  if (share.work.size() < s_block*m_values)
+    share.work.resize(s_block*m_values);
+  if (share.error.size() < s_block*m_values)
+    share.error.resize(s_block*m_values);
+  data::Feature* values = &share.work[0];
+  const std::vector<size_t>& pats = *share.pats;
+  for (size_t start=share.start; start<share.end; start+=s_block) {
+    const size_t n = (share.end-start < s_block)? share.end-start : s_block;
+    for (size_t r=0; r<n; ++r)
+      normalise(share.input->pattern(pats[start+r]), values + r*m_values);
+    propagate(values, n);
+    for (size_t r=0; r<n; ++r) {
+      const data::Feature* y = values + r*m_values;
+      data::Feature* e = &share.error[r*m_values];
+      for (size_t i=0; i<m_values; ++i) e[i] = 0;
+      const data::Pattern t = share.target->pattern(pats[start+r]);
+      const double w = share.weight? (*share.weight)[pats[start+r]] : 1;
+      for (size_t i=0; i<output_size(); ++i) {
+	e[m_output[i]] = t[i] - y[m_output[i]];
+	share.sse += w * e[m_output[i]] * e[m_output[i]];
+	if (share.weight) e[m_output[i]] *= w;
+      }
+    }
+    back_propagate(share, n);
+  }
+}
+
+double network::BatchTrainer::gradient (const data::SimplePatternSet& data,
+				       const data::SimplePatternSet& target,
+				       const std::vector<size_t>& pats)
+{
+  return gradient(data, target, pats, s_unweighted);
+}
+
+double network::BatchTrainer::gradient (const data::SimplePatternSet& data,
+				       const data::SimplePatternSet& target,
+				       const std::vector<size_t>& pats,
+				       const std::vector<double>& weight)
+{
+  if (weight.size() && weight.size() < data.size()) {
+    RINGER_DEBUG1("I cannot weigh " << data.size() << " Pattern's with "
+		  << weight.size() << " weights. Exception thrown.");
+    throw RINGER_EXCEPTION("Too few pattern weights");
+  }
+  if (data.pattern_size() < input_size() ||
+      target.pattern_size() < output_size()) {
+    RINGER_DEBUG1("I cannot train a network with " << input_size()
+		  << " inputs and " << output_size() << " outputs with"
+		  << " Pattern's of " << data.pattern_size() << " features"
+		  << " and targets of " << target.pattern_size()
+		  << " features. Exception thrown.");
+    throw RINGER_EXCEPTION("Training patterns too short");
+  }
+
+  //split the mini-batch in shares of at least one block
+  size_t nshares = (pats.size() + s_block - 1) / s_block;
+  if (nshares > m_threads) nshares = m_threads;
+  if (!nshares) nshares = 1; //an empty share gives zero gradients
+  while (m_share.size() < nshares) m_share.push_back(new Share(*this));
+  const size_t chunk = pats.size() / nshares;
+  for (size_t k=0; k<nshares; ++k) {
+    m_share[k]->input = &data;
+    m_share[k]->target = &target;
+    m_share[k]->pats = &pats;
+    m_share[k]->weight = weight.size()? &weight : 0;
+    m_share[k]->start = k*chunk;
+    m_share[k]->end = (k == nshares-1)? pats.size() : (k+1)*chunk;
+  }
+  if (nshares == 1) m_share[0]->run();
+  else {
+    for (size_t k=0; k<nshares; ++k) m_pool->submit(m_share[k]);
+    m_pool->wait();
+  }
+  for (size_t k=0; k<nshares; ++k) {
+    if (m_share[k]->failure.size()) {
+      RINGER_DEBUG1("Training share " << k << " failed: "
+		    << m_share[k]->failure << ". Exception thrown.");
+      throw RINGER_EXCEPTION(m_share[k]->failure);
+    }
+  }
+
+  //sums the partial gradients, always in the same order
+  double sse = 0;
+  for (size_t l=0; l<m_layer.size(); ++l) {
+    m_gradient[l].assign(m_layer[l].weight.size(), 0);
+    m_delta_sum[l].assign(m_layer[l].size, 0);
+    for (size_t k=0; k<nshares; ++k) {
+      const std::vector<double>& gradient = m_share[k]->gradient[l];
+      for (size_t i=0; i<gradient.size(); ++i) m_gradient[l][i] += gradient[i];
+      const std::vector<double>& delta_sum = m_share[k]->delta_sum[l];
+      for (size_t j=0; j<delta_sum.size(); ++j)
+	m_delta_sum[l][j] += delta_sum[j];
+    }
+  }
+  for (size_t k=0; k<nshares; ++k) sse += m_share[k]->sse;
+  return sse;
+}
+
+void network::BatchTrainer::derivatives
+(const double total, std::vector<data::Feature>& deriv) const
+{
+  deriv.resize(m_synapse.size());
+  for (size_t k=0; k<m_synapse.size(); ++k) {
+    const synapse_t& place = m_synapse[k];
+    if (place.bias)
+      deriv[k] = place.value * m_delta_sum[place.layer][place.row] / total;
+    else {
+      size_t pos = place.row*m_layer[place.layer].width + place.column;
+      deriv[k] = m_gradient[place.layer][pos] / total;
+    }
+  }
+}
+
+void network::BatchTrainer::weights (std::vector<data::Feature>& weight) const
+{
+  weight.resize(m_synapse.size());
+  for (size_t k=0; k<m_synapse.size(); ++k) {
+    const synapse_t& place = m_synapse[k];
+    const layer_t& layer = m_layer[place.layer];
+    if (place.bias) weight[k] = m_bias_weight[k];
+    else weight[k] = layer.weight[place.row*layer.width + place.column];
+  }
+}
+
+void network::BatchTrainer::set_weights
+(const std::vector<data::Feature>& weight)
+{
+  for (size_t l=0; l<m_layer.size(); ++l)
+    m_layer[l].bias.assign(m_layer[l].size, 0);
+  for (size_t k=0; k<m_synapse.size(); ++k) {
+    const synapse_t& place = m_synapse[k];
+    layer_t& layer = m_layer[place.layer];
+    if (place.bias) {
+      m_bias_weight[k] = weight[k];
+      layer.bias[place.row] += place.value * m_bias_weight[k];
+    }
+    else layer.weight[place.row*layer.width + place.column] = weight[k];
+  }
+}
+
+void network::BatchTrainer::train (const data::SimplePatternSet& data,
+				   const data::SimplePatternSet& target,
+				   const std::vector<size_t>& pats)
+{
+  RINGER_DEBUG3("(BATCH-SELECTED) Training compiled network with "
+		<< pats.size() << " Patterns");
+  if (!pats.size()) return;
+  gradient(data, target, pats);
+  std::vector<data::Feature> deriv;
+  derivatives(pats.size(), deriv);
+
+  //let each synapse strategy decide on its change, from the mean gradient
+  std::vector<data::Feature> weight;
+  weights(weight);
+  for (size_t k=0; k<m_synapse.size(); ++k)
+    weight[k] += m_teacher[k]->teach(deriv[k]);
+  set_weights(weight);
+  RINGER_DEBUG3("Network trained.");
+}
+
+void network::BatchTrainer::train (const data::SimplePatternSet& data,
+				   const data::SimplePatternSet& target,
+				   unsigned int epoch)
+{
+  train(data, target, epoch, data::RandomInteger::next_stream());
+}
+
+void network::BatchTrainer::train (const data::SimplePatternSet& data,
+				   const data::SimplePatternSet& target,
+				   unsigned int epoch,
+				   const data::RandomInteger& rnd)
+{
+  RINGER_DEBUG3("(BATCH-RANDOM) Training compiled network with "
+		<< epoch << " Patterns");
+  std::vector<size_t> pats(epoch);
+  rnd.draw(data.size(), pats); //get random positions
+  train(data, target, pats);
+}
+
+void network::BatchTrainer::dump (std::vector<config::Neuron>& neurons,
+				  std::vector<config::Synapse>& synapses) const
+{
+  neurons = m_neuron;
+  synapses.clear();
+  for (size_t k=0; k<m_synapse_config.size(); ++k) {
+    const config::Synapse& config = m_synapse_config[k];
+    const synapse_t& place = m_synapse[k];
+    const layer_t& layer = m_layer[place.layer];
+    data::Feature weight = m_bias_weight[k];
+    if (!place.bias) weight = layer.weight[place.row*layer.width+place.column];
+    switch (config.strategy()) {
+    case config::SYNAPSE_BACKPROP:
+      {
+	const strategy::SynapseBackProp* teacher =
+	  dynamic_cast<const strategy::SynapseBackProp*>(m_teacher[k]);
+	config::SynapseBackProp tmp = teacher->dump();
+	synapses.push_back(config::Synapse(config.id(), config.from(),
+					   config.to(), weight,
+					   config.strategy(), &tmp));
+      }
+      break;
+    case config::SYNAPSE_RPROP:
+      {
+	const strategy::SynapseRProp* teacher =
+	  dynamic_cast<const strategy::SynapseRProp*>(m_teacher[k]);
+	config::SynapseRProp tmp = teacher->dump();
+	synapses.push_back(config::Synapse(config.id(), config.from(),
+					   config.to(), weight,
+					   config.strategy(), &tmp));
+      }
+      break;
+    default:
+      RINGER_DEBUG1("I cannot dump a configuration based on a unexisting"
+		    << " strategy type = " << config.strategy()
+		    << ". Exception thrown.");
+      throw RINGER_EXCEPTION("Unknown strategy type");
+    }
+  }
+}
+
+bool network::BatchTrainer::save (const std::string& file,
+				  const config::Header* header) const
+{
+  RINGER_DEBUG3("Saving network state at file \"" << file << "\".");
+  std::vector<config::Neuron> neurons;
+  std::vector<config::Synapse> synapses;
+  dump(neurons, synapses);
+  std::vector<config::Neuron*> neuron_config;
+  for (size_t i=0; i<neurons.size(); ++i) neuron_config.push_back(&neurons[i]);
+  std::vector<config::Synapse*> synapse_config;
+  for (size_t k=0; k<synapses.size(); ++k)
+    synapse_config.push_back(&synapses[k]);
+
+  //check for the header business
+  bool header_allocated = false;
+  const config::Header* touse = 0;
+  if (header) touse = header;
+  else if (m_header) touse = m_header;
+  else { //build a dummy header
+    touse = new config::Header("UNSET AUTHOR", "UNSET NAME", "0.0", time(0),
+			       "UNSET COMMENT");
+    header_allocated = true;
+  }
+  config::Network new_config(touse, synapse_config, neuron_config, m_reporter);
+  if (header_allocated) delete touse;
+
+  if (!new_config.save(file)) {
+    RINGER_WARN(m_reporter, "I could not save network state in \""
+		<< file << "\". Exception thrown.");
+    throw RINGER_EXCEPTION("couldn't save network state");
+  }
+  RINGER_DEBUG3("Network state saved.");
+  return true;
+}
@@ -0,0 +1,504 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/src/CompiledNetwork.cxx
+ *
+ * Implements the layered, read-only version of a Network
+ */
+
+#include "TrigRingerTools/network/CompiledNetwork.h"
+#include "TrigRingerTools/network/activation.h"
+#include "TrigRingerTools/data/gsl_feature.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/util.h"
+#include <gsl/gsl_blas.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cctype>
+#include <map>
+#include <deque>
+
+/**
+ * How many patterns of a set are propagated together. The neuron values of
+ * a block should fit the cache, while being large enough for the matrix
+ * products to be efficient.
+ */
+static const size_t s_block = 256;
+
+network::CompiledNetwork::CompiledNetwork (const std::string& config,
+					   sys::Reporter* reporter)
+  : m_subtract(),
+    m_divide(),
+    m_layer(),
+    m_output(),
+    m_synapse(),
+    m_values(0),
+    m_work()
+{
+  RINGER_REPORT(reporter, "Loading network configuration...");
+  config::Network net(config, reporter);
+  std::vector<const config::Neuron*> neurons(net.neurons().begin(),
+					     net.neurons().end());
+  std::vector<const config::Synapse*> synapses(net.synapses().begin(),
+					       net.synapses().end());
+  compile(neurons, synapses);
+  RINGER_REPORT(reporter, "Compiled network \"" << net.header()->name()
+		<< "\" in " << m_layer.size() << " layer(s).");
+}
+
+network::CompiledNetwork::CompiledNetwork (const config::Network& config)
+  : m_subtract(),
+    m_divide(),
+    m_layer(),
+    m_output(),
+    m_synapse(),
+    m_values(0),
+    m_work()
+{
+  std::vector<const config::Neuron*> neurons(config.neurons().begin(),
+					     config.neurons().end());
+  std::vector<const config::Synapse*> synapses(config.synapses().begin(),
+					       config.synapses().end());
+  compile(neurons, synapses);
+}
+
+network::CompiledNetwork::CompiledNetwork (const network::Network& net)
+  : m_subtract(),
+    m_divide(),
+    m_layer(),
+    m_output(),
+    m_synapse(),
+    m_values(0),
+    m_work()
+{
+  std::vector<config::Neuron> neuron_config;
+  std::vector<config::Synapse> synapse_config;
+  net.dump(neuron_config, synapse_config);
+  std::vector<const config::Neuron*> neurons;
+  for (size_t i=0; i<neuron_config.size(); ++i)
+    neurons.push_back(&neuron_config[i]);
+  std::vector<const config::Synapse*> synapses;
+  for (size_t i=0; i<synapse_config.size(); ++i)
+    synapses.push_back(&synapse_config[i]);
+  compile(neurons, synapses);
+}
+
+network::CompiledNetwork::CompiledNetwork ()
+  : m_subtract(),
+    m_divide(),
+    m_layer(),
+    m_output(),
+    m_synapse(),
+    m_values(0),
+    m_work()
+{
+}
+
+network::CompiledNetwork::~CompiledNetwork ()
+{
+}
+
+void network::CompiledNetwork::compile
+(const std::vector<const config::Neuron*>& neurons,
+ const std::vector<const config::Synapse*>& synapses)
+{
+  const size_t n = neurons.size();
+  std::map<unsigned int, size_t> index; //neuron id -> position in neurons
+  for (size_t i=0; i<n; ++i) {
+    if (index.find(neurons[i]->id()) != index.end()) {
+      RINGER_DEBUG1("Found doubled neuron id " << neurons[i]->id()
+		    << " while compiling network. Exception thrown.");
+      throw RINGER_EXCEPTION("Duplicated neuron id");
+    }
+    index[neurons[i]->id()] = i;
+  }
+
+  //find out which neurons feed which, leaving the biases aside
+  std::vector<std::vector<size_t> > feeds(n);
+  std::vector<size_t> pending(n, 0);
+  for (size_t k=0; k<synapses.size(); ++k) {
+    std::map<unsigned int, size_t>::const_iterator from =
+      index.find(synapses[k]->from());
+    std::map<unsigned int, size_t>::const_iterator to =
+      index.find(synapses[k]->to());
+    if (from == index.end() || to == index.end()) {
+      RINGER_DEBUG1("Synapse " << synapses[k]->id() << " connects unexisting"
+		    << " neurons. Exception thrown.");
+      throw RINGER_EXCEPTION("Unconfigured neuron in synapse.");
+    }
+    config::NeuronType type = neurons[to->second]->type();
+    if (type != config::HIDDEN && type != config::OUTPUT) {
+      RINGER_DEBUG1("Synapse " << synapses[k]->id() << " ends at neuron "
+		    << synapses[k]->to() << ", which takes no input."
+		    << " Exception thrown.");
+      throw RINGER_EXCEPTION("Synapse to input or bias neuron.");
+    }
+    if (neurons[from->second]->type() == config::BIAS) continue;
+    feeds[from->second].push_back(to->second);
+    ++pending[to->second];
+  }
+
+  //sort in layers: the depth of a neuron is its longest path from an input
+  std::vector<size_t> depth(n, 0);
+  std::deque<size_t> ready;
+  size_t expected = 0;
+  for (size_t i=0; i<n; ++i) {
+    config::NeuronType type = neurons[i]->type();
+    if (type == config::BIAS) continue;
+    ++expected;
+    if (type == config::HIDDEN || type == config::OUTPUT) depth[i] = 1;
+    if (!pending[i]) ready.push_back(i);
+  }
+  size_t max_depth = 0;
+  size_t sorted = 0;
+  while (!ready.empty()) {
+    size_t i = ready.front();
+    ready.pop_front();
+    ++sorted;
+    if (depth[i] > max_depth) max_depth = depth[i];
+    for (size_t k=0; k<feeds[i].size(); ++k) {
+      size_t j = feeds[i][k];
+      if (depth[j] < depth[i]+1) depth[j] = depth[i]+1;
+      if (--pending[j] == 0) ready.push_back(j);
+    }
+  }
+  if (sorted != expected) {
+    RINGER_DEBUG1("The network has feedback loops and cannot be compiled."
+		  << " Exception thrown.");
+    throw RINGER_EXCEPTION("Network is not feed-forward");
+  }
+
+  //place the neuron values: the inputs as run() takes them, then the layers
+  std::vector<size_t> position(n, 0);
+  m_subtract.clear();
+  m_divide.clear();
+  for (size_t i=0; i<n; ++i) {
+    if (neurons[i]->type() != config::INPUT) continue;
+    position[i] = m_subtract.size();
+    m_subtract.push_back(neurons[i]->subtract());
+    m_divide.push_back(neurons[i]->divide());
+  }
+  for (size_t i=0; i<n; ++i) {
+    if (neurons[i]->type() != config::INPUTNONORM) continue;
+    position[i] = m_subtract.size();
+    m_subtract.push_back(0);
+    m_divide.push_back(1);
+  }
+  m_values = m_subtract.size();
+  m_layer.assign(max_depth, layer_t());
+  for (size_t d=1; d<=max_depth; ++d) {
+    layer_t& layer = m_layer[d-1];
+    layer.first = m_values;
+    for (size_t i=0; i<n; ++i) {
+      config::NeuronType type = neurons[i]->type();
+      if (depth[i] != d || (type != config::HIDDEN && type != config::OUTPUT))
+	continue;
+      const config::NeuronBackProp* params =
+	dynamic_cast<const config::NeuronBackProp*>(neurons[i]->parameters());
+      if (neurons[i]->strategy() != config::NEURON_BACKPROP || !params) {
+	RINGER_DEBUG1("Neuron " << neurons[i]->id() << " has an unknown"
+		      << " strategy. Exception thrown.");
+	throw RINGER_EXCEPTION("Unknown strategy for neurons");
+      }
+      layer.af.push_back(params->activation_function());
+      layer.accuracy.push_back(params->accuracy());
+      position[i] = m_values++;
+    }
+    layer.size = m_values - layer.first;
+  }
+
+  //the inputs of each layer span from its first to its last source
+  for (size_t l=0; l<m_layer.size(); ++l) {
+    m_layer[l].from = m_layer[l].first;
+    m_layer[l].width = 0;
+  }
+  for (size_t k=0; k<synapses.size(); ++k) {
+    size_t from = index[synapses[k]->from()];
+    if (neurons[from]->type() == config::BIAS) continue;
+    layer_t& layer = m_layer[depth[index[synapses[k]->to()]]-1];
+    if (!layer.width) {
+      layer.from = position[from];
+      layer.width = 1;
+      continue;
+    }
+    size_t end = layer.from + layer.width;
+    if (position[from] < layer.from) layer.from = position[from];
+    if (position[from]+1 > end) end = position[from]+1;
+    layer.width = end - layer.from;
+  }
+  for (size_t l=0; l<m_layer.size(); ++l) {
+    m_layer[l].weight.assign(m_layer[l].size*m_layer[l].width, 0);
+    m_layer[l].bias.assign(m_layer[l].size, 0);
+  }
+  m_synapse.assign(synapses.size(), synapse_t());
+  for (size_t k=0; k<synapses.size(); ++k) {
+    size_t from = index[synapses[k]->from()];
+    size_t to = index[synapses[k]->to()];
+    synapse_t& place = m_synapse[k];
+    place.layer = depth[to]-1;
+    layer_t& layer = m_layer[place.layer];
+    place.row = position[to] - layer.first;
+    place.bias = (neurons[from]->type() == config::BIAS);
+    place.column = 0;
+    place.value = 0;
+    data::Feature weight = synapses[k]->weight();
+    if (place.bias) {
+      place.value = neurons[from]->bias();
+      layer.bias[place.row] += place.value * weight;
+    }
+    else {
+      place.column = position[from] - layer.from;
+      layer.weight[place.row*layer.width + place.column] += weight;
+    }
+  }
+
+  m_output.clear();
+  for (size_t i=0; i<n; ++i)
+    if (neurons[i]->type() == config::OUTPUT) m_output.push_back(position[i]);
+  RINGER_DEBUG2("Compiled network with " << input_size() << " inputs, "
+		<< m_layer.size() << " layers and " << output_size()
+		<< " outputs.");
+}
+
+void network::CompiledNetwork::propagate (data::Feature* values,
+					  const size_t n) const
+{
+  for (std::vector<layer_t>::const_iterator l = m_layer.begin();
+       l != m_layer.end(); ++l) {
+    for (size_t r=0; r<n; ++r) {
+      data::Feature* y = values + r*m_values + l->first;
+      for (size_t j=0; j<l->size; ++j) y[j] = l->bias[j];
+    }
+    if (l->width && l->size) {
+      data::FeatureMatrixConstView w =
+	RINGER_GSL_MATRIX(const_view_array)(&l->weight[0], l->size, l->width);
+      if (n == 1) {
+	data::FeatureVectorConstView x =
+	  RINGER_GSL_VECTOR(const_view_array)(values + l->from, l->width);
+	data::FeatureVectorView y =
+	  RINGER_GSL_VECTOR(view_array)(values + l->first, l->size);
+	RINGER_GSL_BLAS(gemv)(CblasNoTrans, 1, &w.matrix, &x.vector, 1,
+			      &y.vector);
+      }
+      else {
+	data::FeatureMatrixConstView x =
+	  RINGER_GSL_MATRIX(const_view_array_with_tda)(values + l->from, n,
+						       l->width, m_values);
+	data::FeatureMatrixView y =
+	  RINGER_GSL_MATRIX(view_array_with_tda)(values + l->first, n,
+						 l->size, m_values);
+	RINGER_GSL_BLAS(gemm)(CblasNoTrans, CblasTrans, 1, &x.matrix,
+			      &w.matrix, 1, &y.matrix);
+      }
+    }
+    //neighbours with the same activation are activated together
+    for (size_t j=0; j<l->size;) {
+      size_t end = j+1;
+      while (end < l->size && l->af[end] == l->af[j] &&
+	     l->accuracy[end] == l->accuracy[j]) ++end;
+      for (size_t r=0; r<n; ++r)
+	strategy::activate(l->af[j], l->accuracy[j],
+			   values + r*m_values + l->first + j, end-j);
+      j = end;
+    }
+  }
+}
+
+void network::CompiledNetwork::normalise (const data::Pattern& input,
+					  data::Feature* values) const
+{
+  for (size_t i=0; i<input_size(); ++i)
+    values[i] = (input[i] - m_subtract[i]) / m_divide[i];
+}
+
+void network::CompiledNetwork::run (const data::Pattern& input,
+				    data::Pattern& output) const
+{
+  if (input.size() < input_size()) {
+    RINGER_DEBUG1("I cannot run a Pattern with " << input.size()
+		  << " features through a network with " << input_size()
+		  << " inputs. Exception thrown.");
+    throw RINGER_EXCEPTION("Input pattern too short");
+  }
+  if (output.size() != output_size()) output = data::Pattern(output_size(), 0);
+  if (m_work.size() < m_values) m_work.resize(m_values);
+  data::Feature* values = &m_work[0];
+  normalise(input, values);
+  propagate(values, 1);
+  for (size_t i=0; i<output_size(); ++i) output[i] = values[m_output[i]];
+}
+
+void network::CompiledNetwork::run (const data::SimplePatternSet& input,
+				    data::SimplePatternSet& output) const
+{
+  RINGER_DEBUG3("Running " << input.size() << " pattern(s) through compiled"
+		<< " network.");
+  if (input.pattern_size() < input_size()) {
+    RINGER_DEBUG1("I cannot run Pattern's with " << input.pattern_size()
+		  << " features through a network with " << input_size()
+		  << " inputs. Exception thrown.");
+    throw RINGER_EXCEPTION("Input patterns too short");
+  }
+  if (output.size() != input.size() ||
+      output.pattern_size() != output_size())
+    output = data::SimplePatternSet(input.size(), output_size(), 0);
+  if (m_work.size() < s_block*m_values) m_work.resize(s_block*m_values);
+  data::Feature* values = &m_work[0];
+  data::Pattern result(output_size());
+  for (size_t start=0; start<input.size(); start+=s_block) {
+    const size_t n =
+      (input.size()-start < s_block)? input.size()-start : s_block;
+    for (size_t r=0; r<n; ++r)
+      normalise(input.pattern(start+r), values + r*m_values);
+    propagate(values, n);
+    for (size_t r=0; r<n; ++r) {
+      const data::Feature* x = values + r*m_values;
+      for (size_t i=0; i<output_size(); ++i) result[i] = x[m_output[i]];
+      output.set_pattern(start+r, result);
+    }
+  }
+  RINGER_DEBUG3("Ran " << input.size() << " pattern(s) through compiled"
+		<< " network.");
+}
+
+bool network::CompiledNetwork::cxx (const std::string& filename,
+				    const std::string& name) const
+{
+  RINGER_DEBUG2("Trying to generate C++ code for the network at \""
+		<< filename << "\".");
+  if (sys::exists(filename)) sys::backup(filename);
+  std::ofstream os(filename.c_str());
+  if (!os) {
+    RINGER_DEBUG1("I cannot write C++ code at \"" << filename
+		  << "\". Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot open C++ file to write");
+  }
+  std::string guard;
+  for (size_t i=0; i<name.size(); ++i) guard += toupper(name[i]);
+  const std::string qualifier = guard + "_CONSTEXPR";
+  guard += "_H";
+  const size_t inputs = input_size();
+
+  os << "//Generated from a TrigRingerTools network, do not edit." << std::endl
+     << "//" << inputs << " inputs, " << m_layer.size() << " layers and "
+     << output_size() << " outputs." << std::endl
+     << std::endl
+     << "#ifndef " << guard << std::endl
+     << "#define " << guard << std::endl
+     << std::endl
+     << "#include <cmath>" << std::endl
+     << "#include <cstddef>" << std::endl
+     << std::endl
+     << "#if __cplusplus >= 201103L" << std::endl
+     << "#define " << qualifier << " constexpr" << std::endl
+     << "#else" << std::endl
+     << "#define " << qualifier << " const" << std::endl
+     << "#endif" << std::endl
+     << std::endl
+     << "namespace " << name << " {" << std::endl
+     << std::endl
+     << "  static " << qualifier << " std::size_t inputs = " << inputs
+     << ";" << std::endl
+     << "  static " << qualifier << " std::size_t outputs = "
+     << output_size() << ";" << std::endl;
+  os << std::setprecision(17);
+
+  //the layers reading inputs get the normalisation folded in
+  std::vector<std::vector<double> > weight(m_layer.size());
+  std::vector<std::vector<double> > bias(m_layer.size());
+  for (size_t l=0; l<m_layer.size(); ++l) {
+    const layer_t& layer = m_layer[l];
+    weight[l].assign(layer.weight.begin(), layer.weight.end());
+    bias[l].assign(layer.bias.begin(), layer.bias.end());
+    for (size_t j=0; j<layer.size; ++j)
+      for (size_t c=0; c<layer.width && layer.from+c < inputs; ++c) {
+	double& w = weight[l][j*layer.width + c];
+	w /= m_divide[layer.from+c];
+	bias[l][j] -= w * m_subtract[layer.from+c];
+      }
+    os << std::endl << "  //layer " << l+1 << ": " << layer.size
+       << " neurons reading ";
+    if (layer.width) os << "values " << layer.from << " to "
+			<< layer.from + layer.width - 1 << std::endl;
+    else os << "no values" << std::endl;
+    if (layer.width) {
+      os << "  static " << qualifier << " double w" << l+1 << "["
+	 << layer.size << "][" << layer.width << "] = {" << std::endl;
+      for (size_t j=0; j<layer.size; ++j) {
+	os << "    {";
+	for (size_t c=0; c<layer.width; ++c) {
+	  if (c) os << ((c%4)? ", " : ",\n     ");
+	  os << weight[l][j*layer.width + c];
+	}
+	os << ((j+1<layer.size)? "}," : "}") << std::endl;
+      }
+      os << "  };" << std::endl;
+    }
+    os << "  static " << qualifier << " double b" << l+1 << "["
+       << layer.size << "] = {";
+    for (size_t j=0; j<layer.size; ++j) {
+      if (j) os << ((j%4)? ", " : ",\n    ");
+      os << bias[l][j];
+    }
+    os << "};" << std::endl;
+  }
+
+  os << std::endl
+     << "  /**" << std::endl
+     << "   * Runs a pattern, not normalised, through the network" << std::endl
+     << "   */" << std::endl
+     << "  template <typename T>" << std::endl
+     << "  inline void run (const T* input, T* output)" << std::endl
+     << "  {" << std::endl
+     << "    double v[" << m_values - inputs << "];" << std::endl;
+  for (size_t l=0; l<m_layer.size(); ++l) {
+    const layer_t& layer = m_layer[l];
+    for (size_t j=0; j<layer.size; ++j) {
+      os << "    v[" << layer.first - inputs + j << "] = b" << l+1 << "["
+	 << j << "]";
+      for (size_t c=0; c<layer.width; ++c) {
+	if (weight[l][j*layer.width + c] == 0) continue;
+	const size_t p = layer.from + c;
+	os << std::endl << "      + w" << l+1 << "[" << j << "][" << c
+	   << "] * ";
+	if (p < inputs) os << "input[" << p << "]";
+	else os << "v[" << p - inputs << "]";
+      }
+      os << ";" << std::endl;
+      std::ostringstream oss;
+      oss << "v[" << layer.first - inputs + j << "]";
+      const std::string v = oss.str();
+      switch (layer.af[j]) {
+      case config::NeuronBackProp::TANH:
+	os << "    " << v << " = std::tanh(" << v << ");" << std::endl;
+	break;
+      case config::NeuronBackProp::SIGMOID:
+	os << "    " << v << " = 1 / (1 + std::exp(-" << v << "));"
+	   << std::endl;
+	break;
+      default: //LINEAR
+	break;
+      }
+    }
+  }
+  for (size_t i=0; i<output_size(); ++i)
+    os << "    output[" << i << "] = T(v[" << m_output[i] - inputs << "]);"
+       << std::endl;
+  os << "  }" << std::endl
+     << std::endl
+     << "}" << std::endl
+     << std::endl
+     << "#undef " << qualifier << std::endl
+     << std::endl
+     << "#endif /* " << guard << " */" << std::endl;
+  os.close();
+  if (!os) {
+    RINGER_DEBUG1("Error while writing \"" << filename << "\".");
+    return false;
+  }
+  RINGER_DEBUG2("C++ code for the network was saved at \"" << filename
+		<< "\".");
+  return true;
+}
@@ -21,8 +21,6 @@
 #include "TrigRingerTools/config/SynapseRProp.h"
 #include "TrigRingerTools/config/type.h"
 
-static data::RandomInteger rnd; //default initializer, do it once
-
 /**
  * Creates a new synapse based on strategy types and parameters. The returned
  * value should be deleted by yourself.
@@ -34,7 +32,7 @@ static data::RandomInteger rnd; //default initializer, do it once
 network::Synapse* create_lms_synapse (const config::SynapseStrategyType& type,
                                       const config::Parameter* params)
 {
-  data::Feature weight = rnd.draw(RAND_MAX);
+  data::Feature weight = data::RandomInteger::next_stream().draw(RAND_MAX);
   weight -= ((data::Feature)RAND_MAX)/2;
   weight /= 10*((data::Feature)RAND_MAX)/2;
   return new network::Synapse(weight, type, params);
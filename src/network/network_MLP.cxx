@@ -16,8 +16,6 @@
 #include "TrigRingerTools/sys/Exception.h"
 #include "TrigRingerTools/data/RandomInteger.h"
 
-static data::RandomInteger rnd; //default initializer, do it once
-
 /**
  * Creates a new synapse based on strategy types and parameters. The returned
  * value should be deleted by yourself.
@@ -29,7 +27,7 @@ static data::RandomInteger rnd; //default initializer, do it once
 network::Synapse* create_synapse (const config::SynapseStrategyType& type,
 				  const config::Parameter* params, const unsigned *id)
 {
-  data::Feature weight = rnd.draw(RAND_MAX);
+  data::Feature weight = data::RandomInteger::next_stream().draw(RAND_MAX);
   weight -= ((data::Feature)RAND_MAX)/2;
   weight /= 10*((data::Feature)RAND_MAX)/2;
   return new network::Synapse(weight, type, params, id);
@@ -22,11 +22,6 @@
 
 #include <fstream>
 
-/**
- * A static random integer generator
- */
-static data::RandomInteger static_rnd;
-
 network::Network::Network (const std::string& config, 
 			   sys::Reporter* reporter)
   : m_config(0),
@@ -182,6 +177,30 @@ bool network::Network::save (const std::string& file,
   return true;
 }
 
+void network::Network::dump (std::vector<config::Neuron>& neurons,
+			     std::vector<config::Synapse>& synapses) const
+{
+  neurons.clear();
+  synapses.clear();
+  for (std::vector<InputNeuron*>::const_iterator it = m_input.begin();
+       it != m_input.end(); ++it) neurons.push_back((*it)->dump());
+  for (std::vector<InputNeuronNoNorm*>::const_iterator it = 
+	 m_inputnonorm.begin(); it != m_inputnonorm.end(); ++it)
+    neurons.push_back((*it)->dump());
+  for (std::vector<BiasNeuron*>::const_iterator it = m_bias.begin();
+       it != m_bias.end(); ++it) neurons.push_back((*it)->dump());
+  for (std::map<unsigned int, Neuron*>::const_iterator it =
+	 m_neuron.begin(); it != m_neuron.end(); ++it) {
+    config::Neuron tmp = it->second->dump();
+    if (tmp.type() == config::HIDDEN) neurons.push_back(tmp);
+  }
+  for (std::vector<OutputNeuron*>::const_iterator it = m_output.begin();
+       it != m_output.end(); ++it) neurons.push_back((*it)->dump());
+  for (std::map<unsigned int, Synapse*>::const_iterator it =
+	 m_synapse.begin(); it != m_synapse.end(); ++it)
+    synapses.push_back(it->second->dump());
+}
+
 bool network::Network::dot (const std::string& filename) const
 {
   RINGER_DEBUG2("Trying to build a dot representation at \"" 
@@ -319,13 +338,30 @@ void network::Network::train (const data::SimplePatternSet& data,
 void network::Network::train (const data::SimplePatternSet& data,
 			      const data::SimplePatternSet& target,
 			      unsigned int epoch)
+{
+  train(data, target, epoch, data::RandomInteger::next_stream());
+}
+
+void network::Network::train (const data::SimplePatternSet& data,
+			      const data::SimplePatternSet& target,
+			      unsigned int epoch,
+			      const data::RandomInteger& rnd)
 {
   RINGER_DEBUG3("(BATCH-RANDOM) Training network with " 
 		<< epoch << " Patterns");
   std::vector<size_t> pats(epoch);
-  static_rnd.draw(data.size(), pats); //get random positions
+  rnd.draw(data.size(), pats); //get random positions
+  train(data, target, pats);
+}
+
+void network::Network::train (const data::SimplePatternSet& data,
+			      const data::SimplePatternSet& target,
+			      const std::vector<size_t>& pats)
+{
+  RINGER_DEBUG3("(BATCH-SELECTED) Training network with " 
+		<< pats.size() << " Patterns");
   data::SimplePatternSet input(data, pats); //get patterns for this iteration
-  data::SimplePatternSet output(epoch, m_output.size()); //empty
+  data::SimplePatternSet output(pats.size(), m_output.size()); //empty
   run(input, output); //set network state
   data::SimplePatternSet error(target, pats);
   error -= output; // calculates the error for this iteration
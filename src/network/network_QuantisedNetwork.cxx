@@ -0,0 +1,561 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/src/QuantisedNetwork.cxx
+ *
+ * Implements the fixed-point version of a CompiledNetwork
+ */
+
+#include "TrigRingerTools/network/QuantisedNetwork.h"
+#include "TrigRingerTools/network/activation.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include <fstream>
+#include <cstring>
+#include <cmath>
+
+/**
+ * The activation tables cover arguments from minus to plus this value.
+ * Both tanh and the sigmoid are within 2e-14 of their limits there.
+ */
+static const double s_range = 16.0;
+
+/**
+ * How many table entries there are per unit of the argument
+ */
+static const size_t s_steps = 64;
+
+/**
+ * How many intervals each table has; there is one more entry
+ */
+static const size_t s_intervals = 2 * 16 * 64;
+
+/**
+ * Table positions are fixed point numbers with this many fractional bits
+ */
+static const unsigned int s_fraction = 32;
+
+/**
+ * How many of the fractional bits are used for interpolation
+ */
+static const unsigned int s_interpolation = 16;
+
+/**
+ * Biases are clamped to this many units, so table positions fit in 64 bits
+ */
+static const double s_bias_limit = 65536.0;
+
+/**
+ * The magic string that starts every quantised network file
+ */
+static const char s_magic[8] = { 'R', 'I', 'N', 'G', 'Q', 'N', 'T', 0 };
+
+/**
+ * Written as is, so the reader can detect foreign byte orders
+ */
+static const uint32_t s_byte_order = 0x01020304;
+
+/**
+ * The current version of the file layout
+ */
+static const uint32_t s_version = 1;
+
+/**
+ * The fixed size header at the start of the file. It is followed by the
+ * input normalisation (subtract, then divide, as doubles), the layers and
+ * the outputs.
+ */
+typedef struct file_header_t {
+  char magic[8]; ///< s_magic
+  uint32_t byte_order; ///< s_byte_order, in the writer byte order
+  uint32_t version; ///< s_version
+  uint32_t bits; ///< bits of the weights and values
+  uint32_t reserved; ///< zero, keeps the rest aligned
+  uint64_t inputs; ///< number of inputs
+  uint64_t layers; ///< number of layers
+  uint64_t outputs; ///< number of outputs
+  uint64_t values; ///< number of neuron values
+  uint64_t entries; ///< number of entries in each activation table
+  double range; ///< the tables cover arguments in [-range, +range]
+  double input_scale; ///< the value of one unit of the inputs
+} file_header_t;
+
+/**
+ * The description of a layer. It is followed by the offsets (int64_t) and
+ * the table (uint32_t) of each neuron, the weights (int8_t or int16_t) and
+ * the tables (int16_t).
+ */
+typedef struct file_layer_t {
+  uint64_t first; ///< where the outputs go, in the neuron values
+  uint64_t size; ///< how many neurons there are
+  uint64_t from; ///< the first neuron value read
+  uint64_t width; ///< how many neuron values are read
+  uint64_t tables; ///< how many activation tables there are
+  int64_t multiplier; ///< weighted sum to table position
+  double scale; ///< the value of one unit of the outputs
+} file_layer_t;
+
+/**
+ * Rounds to the nearest integer, halves away from zero
+ *
+ * @param v The value to round
+ */
+static inline double nearest (const double v)
+{
+  return (v < 0)? std::ceil(v - 0.5) : std::floor(v + 0.5);
+}
+
+/**
+ * Rounds to the nearest integer within a symmetric range
+ *
+ * @param v The value to round
+ * @param max The largest magnitude allowed
+ */
+static inline double saturate (const double v, const double max)
+{
+  const double r = nearest(v);
+  return (r > max)? max : ((r < -max)? -max : r);
+}
+
+/**
+ * Writes an array to a file, as is
+ *
+ * @param os The stream to write to
+ * @param v The array to write
+ */
+template <typename T>
+static void put (std::ostream& os, const std::vector<T>& v)
+{
+  if (v.size())
+    os.write(reinterpret_cast<const char*>(&v[0]), v.size()*sizeof(T));
+}
+
+/**
+ * Reads an array from a file, as is
+ *
+ * @param is The stream to read from
+ * @param v Where to put the array
+ * @param n How many elements to read
+ * @param length The length of the file, so garbage sizes are not allocated
+ *
+ * @return <code>true</code> if all elements were read
+ */
+template <typename T>
+static bool get (std::istream& is, std::vector<T>& v, const uint64_t n,
+		 const uint64_t length)
+{
+  if (n > length / sizeof(T)) return false;
+  v.resize(n);
+  if (n) is.read(reinterpret_cast<char*>(&v[0]), n*sizeof(T));
+  return is.good();
+}
+
+network::QuantisedNetwork::QuantisedNetwork
+(const network::CompiledNetwork& net, const unsigned int bits,
+ const data::SimplePatternSet& calibration)
+  : m_bits(bits),
+    m_input_scale(1),
+    m_subtract(net.m_subtract),
+    m_divide(net.m_divide),
+    m_layer(net.m_layer.size()),
+    m_output(net.m_output),
+    m_output_scale(),
+    m_values(net.m_values),
+    m_work8(),
+    m_work16()
+{
+  if (bits != 8 && bits != 16) {
+    RINGER_DEBUG1("I cannot quantise networks to " << bits << " bits."
+		  << " Exception thrown.");
+    throw RINGER_EXCEPTION("Networks can only be quantised to 8 or 16 bits");
+  }
+  const double qmax = (bits == 8)? 127 : 32767;
+
+  //the input scale covers the largest normalised input seen
+  double largest = 0;
+  for (size_t i=0; i<calibration.size(); ++i) {
+    const data::Pattern p = calibration.pattern(i);
+    if (p.size() < input_size()) {
+      RINGER_DEBUG1("I cannot calibrate with Pattern's of " << p.size()
+		    << " features a network with " << input_size()
+		    << " inputs. Exception thrown.");
+      throw RINGER_EXCEPTION("Calibration patterns too short");
+    }
+    for (size_t k=0; k<input_size(); ++k) {
+      const double x = std::fabs((p[k] - m_subtract[k]) / m_divide[k]);
+      if (x > largest) largest = x;
+    }
+  }
+  m_input_scale = ((largest > 0)? largest : 1) / qmax;
+
+  //the scale of every neuron value, to fold into the weights that read it
+  std::vector<double> value_scale(m_values, m_input_scale);
+  for (size_t l=0; l<m_layer.size(); ++l) {
+    const network::CompiledNetwork::layer_t& source = net.m_layer[l];
+    layer_t& layer = m_layer[l];
+    layer.first = source.first;
+    layer.size = source.size;
+    layer.from = source.from;
+    layer.width = source.width;
+
+    //one table per activation function used, in this layer scale
+    double range = 0;
+    std::vector<config::NeuronBackProp::ActivationFunction> functions;
+    layer.table.assign(layer.size, 0);
+    for (size_t j=0; j<layer.size; ++j) {
+      size_t t = 0;
+      while (t < functions.size() && functions[t] != source.af[j]) ++t;
+      if (t == functions.size()) functions.push_back(source.af[j]);
+      layer.table[j] = t;
+      const double r =
+	(source.af[j] == config::NeuronBackProp::LINEAR)? s_range : 1;
+      if (r > range) range = r;
+    }
+    layer.scale = ((range > 0)? range : 1) / qmax;
+    std::vector<data::Feature> argument(s_intervals+1);
+    layer.tables.assign(functions.size(), std::vector<int16_t>());
+    for (size_t t=0; t<functions.size(); ++t) {
+      for (size_t i=0; i<=s_intervals; ++i)
+	argument[i] = -s_range + double(i)/s_steps;
+      std::vector<data::Feature> y(argument);
+      strategy::activate(functions[t], config::NeuronBackProp::EXACT, &y[0],
+			 y.size());
+      layer.tables[t].resize(y.size());
+      for (size_t i=0; i<y.size(); ++i)
+	layer.tables[t][i] = int16_t(saturate(y[i] / layer.scale, qmax));
+    }
+
+    //the weights read values of different scales, then share one
+    std::vector<double> weight(source.weight.size());
+    double wmax = 0;
+    for (size_t j=0; j<layer.size; ++j)
+      for (size_t c=0; c<layer.width; ++c) {
+	const size_t k = j*layer.width + c;
+	weight[k] = source.weight[k] * value_scale[layer.from + c];
+	if (std::fabs(weight[k]) > wmax) wmax = std::fabs(weight[k]);
+      }
+    const double wscale = ((wmax > 0)? wmax : 1) / qmax;
+    if (bits == 8) layer.weight8.resize(weight.size());
+    else layer.weight16.resize(weight.size());
+    for (size_t k=0; k<weight.size(); ++k) {
+      const double q = saturate(weight[k] / wscale, qmax);
+      if (bits == 8) layer.weight8[k] = int8_t(q);
+      else layer.weight16[k] = int16_t(q);
+    }
+
+    //the weighted sums and biases become positions in the tables
+    const double unit = std::ldexp(double(s_steps), s_fraction);
+    layer.multiplier = int64_t(nearest(wscale * unit));
+    layer.offset.resize(layer.size);
+    for (size_t j=0; j<layer.size; ++j) {
+      double bias = source.bias[j];
+      if (bias > s_bias_limit) bias = s_bias_limit;
+      if (bias < -s_bias_limit) bias = -s_bias_limit;
+      layer.offset[j] = int64_t(nearest((bias + s_range) * unit));
+    }
+    check(layer);
+    for (size_t j=0; j<layer.size; ++j)
+      value_scale[layer.first + j] = layer.scale;
+  }
+  for (size_t i=0; i<m_output.size(); ++i)
+    m_output_scale.push_back(value_scale[m_output[i]]);
+
+  if (bits == 8) m_work8.resize(m_values);
+  else m_work16.resize(m_values);
+  RINGER_DEBUG2("Quantised network to " << bits << " bits, with "
+		<< input_size() << " inputs, " << m_layer.size()
+		<< " layers and " << output_size() << " outputs.");
+}
+
+network::QuantisedNetwork::QuantisedNetwork (const std::string& file,
+					     sys::Reporter* reporter)
+  : m_bits(0),
+    m_input_scale(1),
+    m_subtract(),
+    m_divide(),
+    m_layer(),
+    m_output(),
+    m_output_scale(),
+    m_values(0),
+    m_work8(),
+    m_work16()
+{
+  RINGER_REPORT(reporter, "Loading quantised network from \"" << file
+		<< "\"...");
+  std::ifstream is(file.c_str(), std::ios_base::in|std::ios_base::binary);
+  if (!is) {
+    RINGER_WARN(reporter, "Could not open file \"" << file << "\"."
+		<< " Exception thrown.");
+    throw RINGER_EXCEPTION("Cannot open quantised network file");
+  }
+  is.seekg(0, std::ios_base::end);
+  const uint64_t length = is.tellg();
+  is.seekg(0, std::ios_base::beg);
+
+  file_header_t fh;
+  std::memset(&fh, 0, sizeof(fh));
+  is.read(reinterpret_cast<char*>(&fh), sizeof(fh));
+  std::string error;
+  if (!is || std::memcmp(fh.magic, s_magic, sizeof(s_magic)))
+    error = "Not a quantised network file";
+  else if (fh.byte_order != s_byte_order)
+    error = "Quantised network file written with a different byte order";
+  else if (fh.version != s_version)
+    error = "Unsupported quantised network file version";
+  else if ((fh.bits != 8 && fh.bits != 16) || fh.range != s_range ||
+	   fh.entries != s_intervals+1)
+    error = "Quantised network file with unsupported quantisation";
+
+  std::vector<double> normalisation;
+  if (error.empty() && (!get(is, normalisation, 2*fh.inputs, length) ||
+			fh.values < fh.inputs))
+    error = "Truncated quantised network file";
+  if (error.empty()) {
+    m_bits = fh.bits;
+    m_input_scale = fh.input_scale;
+    m_values = fh.values;
+    for (size_t i=0; i<fh.inputs; ++i) {
+      m_subtract.push_back(normalisation[i]);
+      m_divide.push_back(normalisation[fh.inputs + i]);
+    }
+    if (fh.layers > length / sizeof(file_layer_t))
+      error = "Truncated quantised network file";
+    else m_layer.resize(fh.layers);
+  }
+  size_t computed = input_size(); //values computed so far
+  for (size_t l=0; error.empty() && l<m_layer.size(); ++l) {
+    layer_t& layer = m_layer[l];
+    file_layer_t fl;
+    is.read(reinterpret_cast<char*>(&fl), sizeof(fl));
+    if (!is) {
+      error = "Truncated quantised network file";
+      break;
+    }
+    layer.first = fl.first;
+    layer.size = fl.size;
+    layer.from = fl.from;
+    layer.width = fl.width;
+    layer.multiplier = fl.multiplier;
+    layer.scale = fl.scale;
+    if (fl.first != computed || fl.size > fh.values - fl.first ||
+	fl.from > fl.first || fl.width > fl.first - fl.from ||
+	fl.multiplier < 0) {
+      error = "Quantised network file with inconsistent layers";
+      break;
+    }
+    computed += layer.size;
+    bool ok = get(is, layer.offset, layer.size, length) &&
+      get(is, layer.table, layer.size, length);
+    if (m_bits == 8)
+      ok = ok && get(is, layer.weight8, layer.size*layer.width, length);
+    else
+      ok = ok && get(is, layer.weight16, layer.size*layer.width, length);
+    if (ok && fl.tables <= length / sizeof(int16_t)) {
+      layer.tables.resize(fl.tables);
+      for (size_t t=0; ok && t<layer.tables.size(); ++t)
+	ok = get(is, layer.tables[t], fh.entries, length);
+    }
+    else ok = false;
+    if (!ok) {
+      error = "Truncated quantised network file";
+      break;
+    }
+    for (size_t j=0; j<layer.size; ++j)
+      if (layer.table[j] >= layer.tables.size())
+	error = "Quantised network file with inconsistent layers";
+    if (error.empty()) {
+      try {
+	check(layer);
+      }
+      catch (const sys::Exception&) {
+	error = "Quantised network file with too wide layers";
+      }
+    }
+  }
+  if (error.empty() && computed != m_values)
+    error = "Quantised network file with inconsistent layers";
+  std::vector<uint64_t> output;
+  if (error.empty() && (!get(is, output, fh.outputs, length) ||
+			!get(is, m_output_scale, fh.outputs, length)))
+    error = "Truncated quantised network file";
+  for (size_t i=0; error.empty() && i<output.size(); ++i) {
+    if (output[i] >= m_values)
+      error = "Quantised network file with inconsistent outputs";
+    m_output.push_back(output[i]);
+  }
+  if (!error.empty()) {
+    RINGER_WARN(reporter, "File \"" << file << "\": " << error << "."
+		<< " Exception thrown.");
+    throw RINGER_EXCEPTION(error.c_str());
+  }
+
+  if (m_bits == 8) m_work8.resize(m_values);
+  else m_work16.resize(m_values);
+  RINGER_REPORT(reporter, "Loaded " << m_bits << "-bit network with "
+		<< m_layer.size() << " layer(s).");
+}
+
+network::QuantisedNetwork::~QuantisedNetwork ()
+{
+}
+
+void network::QuantisedNetwork::check (layer_t& layer) const
+{
+  //the largest weighted sum possible must fit the accumulator
+  if (m_bits == 8 && layer.width > 0x7fffffff / (127*127)) {
+    RINGER_DEBUG1("A layer reading " << layer.width << " values cannot be"
+		  << " accumulated in 32 bits. Exception thrown.");
+    throw RINGER_EXCEPTION("Layer too wide for 8-bit quantisation");
+  }
+  //beyond the limit, the table position saturates anyway
+  const int64_t bound = int64_t(1) << 61;
+  layer.limit = layer.multiplier? bound / layer.multiplier : bound;
+}
+
+template <typename W, typename A, typename Acc>
+void network::QuantisedNetwork::propagate (std::vector<W> layer_t::* weight,
+					   A* values) const
+{
+  const int64_t last = (int64_t(s_intervals) << s_fraction) - 1;
+  const unsigned int shift = s_fraction - s_interpolation;
+  const int64_t mask = (int64_t(1) << s_interpolation) - 1;
+  for (std::vector<layer_t>::const_iterator l = m_layer.begin();
+       l != m_layer.end(); ++l) {
+    const A* x = values + l->from;
+    A* y = values + l->first;
+    for (size_t j=0; j<l->size; ++j) {
+      const W* w = l->width? &(((*l).*weight)[j*l->width]) : 0;
+      Acc sum = 0;
+      for (size_t c=0; c<l->width; ++c) sum += Acc(w[c]) * Acc(x[c]);
+      int64_t acc = sum;
+      if (acc > l->limit) acc = l->limit;
+      if (acc < -l->limit) acc = -l->limit;
+      int64_t position = acc * l->multiplier + l->offset[j];
+      if (position < 0) position = 0;
+      if (position > last) position = last;
+      const int16_t* t = &l->tables[l->table[j]][position >> s_fraction];
+      const int64_t fraction = (position >> shift) & mask;
+      y[j] = A(t[0] + (((t[1] - t[0]) * fraction) >> s_interpolation));
+    }
+  }
+}
+
+template <typename A>
+void network::QuantisedNetwork::quantise (const data::Pattern& input,
+					  A* values) const
+{
+  const double qmax = (m_bits == 8)? 127 : 32767;
+  for (size_t i=0; i<input_size(); ++i)
+    values[i] = A(saturate((input[i] - m_subtract[i]) /
+			   m_divide[i] / m_input_scale, qmax));
+}
+
+void network::QuantisedNetwork::evaluate (const data::Pattern& input,
+					  data::Pattern& output) const
+{
+  if (m_bits == 8) {
+    int8_t* values = &m_work8[0];
+    quantise(input, values);
+    propagate<int8_t, int8_t, int32_t>(&layer_t::weight8, values);
+    for (size_t i=0; i<output_size(); ++i)
+      output[i] = values[m_output[i]] * m_output_scale[i];
+  }
+  else {
+    int16_t* values = &m_work16[0];
+    quantise(input, values);
+    propagate<int16_t, int16_t, int64_t>(&layer_t::weight16, values);
+    for (size_t i=0; i<output_size(); ++i)
+      output[i] = values[m_output[i]] * m_output_scale[i];
+  }
+}
+
+void network::QuantisedNetwork::run (const data::Pattern& input,
+				     data::Pattern& output) const
+{
+  if (input.size() < input_size()) {
+    RINGER_DEBUG1("I cannot run a Pattern with " << input.size()
+		  << " features through a network with " << input_size()
+		  << " inputs. Exception thrown.");
+    throw RINGER_EXCEPTION("Input pattern too short");
+  }
+  if (output.size() != output_size()) output = data::Pattern(output_size(), 0);
+  evaluate(input, output);
+}
+
+void network::QuantisedNetwork::run (const data::SimplePatternSet& input,
+				     data::SimplePatternSet& output) const
+{
+  RINGER_DEBUG3("Running " << input.size() << " pattern(s) through quantised"
+		<< " network.");
+  if (input.pattern_size() < input_size()) {
+    RINGER_DEBUG1("I cannot run Pattern's with " << input.pattern_size()
+		  << " features through a network with " << input_size()
+		  << " inputs. Exception thrown.");
+    throw RINGER_EXCEPTION("Input patterns too short");
+  }
+  if (output.size() != input.size() ||
+      output.pattern_size() != output_size())
+    output = data::SimplePatternSet(input.size(), output_size(), 0);
+  data::Pattern result(output_size());
+  for (size_t i=0; i<input.size(); ++i) {
+    evaluate(input.pattern(i), result);
+    output.set_pattern(i, result);
+  }
+  RINGER_DEBUG3("Ran " << input.size() << " pattern(s) through quantised"
+		<< " network.");
+}
+
+bool network::QuantisedNetwork::save (const std::string& file) const
+{
+  file_header_t fh;
+  std::memset(&fh, 0, sizeof(fh));
+  std::memcpy(fh.magic, s_magic, sizeof(s_magic));
+  fh.byte_order = s_byte_order;
+  fh.version = s_version;
+  fh.bits = m_bits;
+  fh.inputs = input_size();
+  fh.layers = m_layer.size();
+  fh.outputs = output_size();
+  fh.values = m_values;
+  fh.entries = s_intervals+1;
+  fh.range = s_range;
+  fh.input_scale = m_input_scale;
+
+  std::ofstream os(file.c_str(), std::ios_base::out|
+		   std::ios_base::trunc|std::ios_base::binary);
+  if (!os) {
+    RINGER_DEBUG1("Cannot open \"" << file << "\" for writing.");
+    return false;
+  }
+  os.write(reinterpret_cast<const char*>(&fh), sizeof(fh));
+  std::vector<double> normalisation(m_subtract.begin(), m_subtract.end());
+  normalisation.insert(normalisation.end(), m_divide.begin(), m_divide.end());
+  put(os, normalisation);
+  for (size_t l=0; l<m_layer.size(); ++l) {
+    const layer_t& layer = m_layer[l];
+    file_layer_t fl;
+    std::memset(&fl, 0, sizeof(fl));
+    fl.first = layer.first;
+    fl.size = layer.size;
+    fl.from = layer.from;
+    fl.width = layer.width;
+    fl.tables = layer.tables.size();
+    fl.multiplier = layer.multiplier;
+    fl.scale = layer.scale;
+    os.write(reinterpret_cast<const char*>(&fl), sizeof(fl));
+    put(os, layer.offset);
+    put(os, layer.table);
+    if (m_bits == 8) put(os, layer.weight8);
+    else put(os, layer.weight16);
+    for (size_t t=0; t<layer.tables.size(); ++t) put(os, layer.tables[t]);
+  }
+  std::vector<uint64_t> output(m_output.begin(), m_output.end());
+  put(os, output);
+  put(os, m_output_scale);
+  if (!os) {
+    RINGER_DEBUG1("Error while writing \"" << file << "\".");
+    return false;
+  }
+  RINGER_DEBUG2("Quantised network \"" << file << "\" was saved.");
+  return true;
+}
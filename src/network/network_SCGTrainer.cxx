@@ -0,0 +1,215 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/src/SCGTrainer.cxx
+ *
+ * Implements the scaled conjugate gradient trainer
+ */
+
+#include "TrigRingerTools/network/SCGTrainer.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include <cmath>
+
+/**
+ * How far, relative to the length of the direction, the gradient is taken
+ * again to estimate the curvature
+ */
+static const double s_sigma = 1e-4;
+
+/**
+ * The initial scale
+ */
+static const double s_lambda = 1e-6;
+
+/**
+ * The weights of unweighted runs, where every pattern counts the same
+ */
+static const std::vector<double> s_unweighted;
+
+/**
+ * Returns the dot product of two vectors
+ *
+ * @param a The first vector
+ * @param b The second vector
+ */
+static double dot (const std::vector<double>& a, const std::vector<double>& b)
+{
+  double retval = 0;
+  for (size_t k=0; k<a.size(); ++k) retval += a[k]*b[k];
+  return retval;
+}
+
+network::SCGTrainer::SCGTrainer (const std::string& config,
+				 sys::Reporter* reporter,
+				 const unsigned int nthreads)
+  : BatchTrainer(config, reporter, nthreads),
+    m_pats(),
+    m_pattern_weight(),
+    m_total(0),
+    m_weight(),
+    m_residual(),
+    m_direction(),
+    m_error(0),
+    m_delta(0),
+    m_lambda(s_lambda),
+    m_lambda_bar(0),
+    m_success(true),
+    m_iteration(0)
+{
+}
+
+network::SCGTrainer::SCGTrainer (const network::Network& net,
+				 sys::Reporter* reporter,
+				 const unsigned int nthreads)
+  : BatchTrainer(net, reporter, nthreads),
+    m_pats(),
+    m_pattern_weight(),
+    m_total(0),
+    m_weight(),
+    m_residual(),
+    m_direction(),
+    m_error(0),
+    m_delta(0),
+    m_lambda(s_lambda),
+    m_lambda_bar(0),
+    m_success(true),
+    m_iteration(0)
+{
+}
+
+network::SCGTrainer::~SCGTrainer ()
+{
+}
+
+void network::SCGTrainer::reset (void)
+{
+  m_pats.clear();
+}
+
+double network::SCGTrainer::evaluate (const data::SimplePatternSet& data,
+				      const data::SimplePatternSet& target,
+				      const std::vector<size_t>& pats,
+				      const std::vector<double>& weight,
+				      std::vector<double>& deriv)
+{
+  std::vector<data::Feature> tmp(weight.begin(), weight.end());
+  set_weights(tmp);
+  double sse = gradient(data, target, pats, m_pattern_weight);
+  derivatives(m_total, tmp);
+  deriv.assign(tmp.begin(), tmp.end());
+  return sse / (2 * m_total);
+}
+
+void network::SCGTrainer::train (const data::SimplePatternSet& data,
+				 const data::SimplePatternSet& target,
+				 const std::vector<size_t>& pats)
+{
+  train(data, target, pats, s_unweighted);
+}
+
+void network::SCGTrainer::train (const data::SimplePatternSet& data,
+				 const data::SimplePatternSet& target,
+				 const std::vector<size_t>& pats,
+				 const std::vector<double>& weight)
+{
+  RINGER_DEBUG3("(SCG) Training compiled network with " << pats.size()
+		<< " Patterns");
+  if (!pats.size()) return;
+  //a different error function, starts over from the current weights
+  if (m_pats.empty() || m_pats != pats || m_pattern_weight != weight) {
+    m_pats.clear(); //until the run is set up
+    m_pattern_weight = weight;
+    m_total = pats.size();
+    if (weight.size()) {
+      m_total = 0;
+      for (size_t i=0; i<pats.size(); ++i)
+	if (pats[i] < weight.size()) m_total += weight[pats[i]];
+    }
+    if (m_total <= 0) {
+      RINGER_DEBUG1("The " << pats.size() << " Pattern's to train with"
+		    << " weigh nothing. Exception thrown.");
+      throw RINGER_EXCEPTION("Training patterns without weight");
+    }
+    std::vector<data::Feature> tmp;
+    weights(tmp);
+    m_weight.assign(tmp.begin(), tmp.end());
+    m_error = evaluate(data, target, pats, m_weight, m_residual);
+    m_direction = m_residual;
+    m_lambda = s_lambda;
+    m_lambda_bar = 0;
+    m_success = true;
+    m_iteration = 0;
+    m_pats = pats;
+  }
+
+  const double pp = dot(m_direction, m_direction);
+  if (pp == 0) {
+    RINGER_DEBUG2("The error gradient is zero, nothing to train.");
+    return;
+  }
+
+  //the curvature along the direction, if it changed
+  std::vector<double> point(m_weight.size());
+  std::vector<double> residual;
+  if (m_success) {
+    const double sigma = s_sigma / std::sqrt(pp);
+    for (size_t k=0; k<point.size(); ++k)
+      point[k] = m_weight[k] + sigma*m_direction[k];
+    evaluate(data, target, pats, point, residual);
+    m_delta = 0;
+    for (size_t k=0; k<point.size(); ++k)
+      m_delta += m_direction[k] * (m_residual[k] - residual[k]) / sigma;
+  }
+
+  //scales the curvature, and makes it positive if it is not
+  m_delta += (m_lambda - m_lambda_bar) * pp;
+  if (m_delta <= 0) {
+    m_lambda_bar = 2 * (m_lambda - m_delta/pp);
+    m_delta = -m_delta + m_lambda*pp;
+    m_lambda = m_lambda_bar;
+  }
+
+  const double mu = dot(m_direction, m_residual);
+  if (mu <= 0) { //not a descent direction any more, starts over
+    RINGER_DEBUG2("Restarting from the steepest descent direction.");
+    //the curvature probe may have moved the network, goes back
+    std::vector<data::Feature> tmp(m_weight.begin(), m_weight.end());
+    set_weights(tmp);
+    m_direction = m_residual;
+    m_success = true;
+    return;
+  }
+  const double alpha = mu / m_delta;
+  for (size_t k=0; k<point.size(); ++k)
+    point[k] = m_weight[k] + alpha*m_direction[k];
+  const double error = evaluate(data, target, pats, point, residual);
+
+  //compares the error reduction to the one expected from the curvature
+  const double comparison = 2 * m_delta * (m_error - error) / (mu*mu);
+  if (comparison >= 0) {
+    m_weight = point;
+    m_error = error;
+    ++m_iteration;
+    if (m_iteration % m_weight.size() == 0) m_direction = residual;
+    else {
+      const double beta = (dot(residual, residual) -
+			   dot(residual, m_residual)) / mu;
+      for (size_t k=0; k<m_direction.size(); ++k)
+	m_direction[k] = residual[k] + beta*m_direction[k];
+    }
+    m_residual = residual;
+    m_lambda_bar = 0;
+    m_success = true;
+    if (comparison >= 0.75) m_lambda /= 4;
+  }
+  else { //goes back to where it was
+    std::vector<data::Feature> tmp(m_weight.begin(), m_weight.end());
+    set_weights(tmp);
+    m_lambda_bar = m_lambda;
+    m_success = false;
+  }
+  if (comparison < 0.25) m_lambda += m_delta * (1 - comparison) / pp;
+  RINGER_DEBUG2("SCG step " << (m_success? "taken" : "rejected")
+		<< ", error = " << m_error << ", scale = " << m_lambda);
+}
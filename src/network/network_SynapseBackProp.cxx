@@ -41,6 +41,7 @@ strategy::SynapseBackProp::SynapseBackProp (const config::Parameter* config)
   m_lrate = bpparams->learning_rate();
   m_momentum = bpparams->momentum();
   m_decay = bpparams->learning_rate_decay();
+  m_prev_delta = bpparams->previous_delta();
   //checks on ranges are performed at XML configuration parsing!
   RINGER_DEBUG3("Instantiated with Learning Rate = " << m_lrate
 	      << ", Momentum = " << m_momentum << " and LR Decay = "
@@ -52,7 +53,12 @@ data::Feature strategy::SynapseBackProp::teach (const data::Ensemble& input,
 {
   RINGER_DEBUG3("SynapseBackProp::teach called.");
   data::MeanExtractor mean;
-  data::Feature delta = m_lrate * mean(lesson * input);
+  return teach(mean(lesson * input));
+}
+
+data::Feature strategy::SynapseBackProp::teach (const data::Feature& deriv)
+{
+  data::Feature delta = m_lrate * deriv;
   RINGER_DEBUG2("Calculating synaptic weight adjustment with change = "
 		<< delta << ", learning rate = " << m_lrate
 		<< ", momentum = " << m_momentum
@@ -75,5 +81,5 @@ data::Feature strategy::SynapseBackProp::teach (const data::Ensemble& input,
 
 config::SynapseBackProp strategy::SynapseBackProp::dump (void) const
 {
-  return config::SynapseBackProp(m_lrate, m_momentum, m_decay);
+  return config::SynapseBackProp(m_lrate, m_momentum, m_decay, m_prev_delta);
 }
@@ -44,6 +44,8 @@ strategy::SynapseRProp::SynapseRProp (const config::Parameter* config)
   const config::SynapseRProp* rpparams =
     dynamic_cast<const config::SynapseRProp*>(config);
   m_weight_update = rpparams->weight_update();
+  m_prev_delta = rpparams->previous_delta();
+  m_prev_deriv = rpparams->previous_derivative();
   //checks on ranges are performed at XML configuration parsing!
   RINGER_DEBUG3("Instantiated with Weight update = " << m_weight_update);
 }
@@ -53,7 +55,11 @@ data::Feature strategy::SynapseRProp::teach (const data::Ensemble& input,
 {
   RINGER_DEBUG3("SynapseRProp::teach called.");
   data::MeanExtractor mean;
-  data::Feature deriv = mean(lesson * input);
+  return teach(mean(lesson * input));
+}
+
+data::Feature strategy::SynapseRProp::teach (const data::Feature& deriv)
+{
   RINGER_DEBUG1("Calculating synaptic weight adjustment with change = "
                 << deriv << ", weight update = " << m_weight_update
                 << ", previous derivative = " << m_prev_deriv
@@ -83,5 +89,5 @@ data::Feature strategy::SynapseRProp::teach (const data::Ensemble& input,
 
 config::SynapseRProp strategy::SynapseRProp::dump (void) const
 {
-  return config::SynapseRProp(m_weight_update);
+  return config::SynapseRProp(m_weight_update, m_prev_delta, m_prev_deriv);
 }
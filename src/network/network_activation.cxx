@@ -0,0 +1,158 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file network/src/activation.cxx
+ *
+ * Implements the activation functions of back propagation neurons, with
+ * their fast approximations.
+ */
+
+#include "TrigRingerTools/network/activation.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+/**
+ * The inputs of the approximated exponential are clamped to this range. At
+ * its ends, tanh and the sigmoid are already as close to their limits as a
+ * double can show.
+ */
+static const double s_exp_limit = 80.0;
+
+/**
+ * Adding this to a double rounds it to an integer, which lands in the low
+ * bits of the mantissa (1.5 * 2^52)
+ */
+static const double s_round = 6755399441055744.0;
+
+static const double s_log2e = 1.4426950408889634074; ///< 1/ln(2)
+static const double s_ln2_hi = 6.93145751953125e-1; ///< ln(2), 1st part
+static const double s_ln2_lo = 1.42860682030941723212e-6; ///< 2nd part
+
+/**
+ * The Taylor polynomial of the exponential, up to a given degree, in
+ * Horner's form
+ *
+ * @param r Where to evaluate the polynomial
+ */
+template <int degree> static inline double taylor_exp (const double r);
+
+template <> inline double taylor_exp<4> (const double r)
+{
+  return 1 + r*(1 + r*(1./2 + r*(1./6 + r*(1./24))));
+}
+
+template <> inline double taylor_exp<7> (const double r)
+{
+  return 1 + r*(1 + r*(1./2 + r*(1./6 + r*(1./24 + r*(1./120 + r*(1./720
+	 + r*(1./5040)))))));
+}
+
+/**
+ * Computes the exponential of a value by writing it as @f$ 2^k e^r @f$,
+ * with @f$ |r| \le ln(2)/2 @f$. The power of two is built directly in the
+ * bits of a double and @f$ e^r @f$ is the Taylor polynomial of the given
+ * degree. The relative error is below 6e-5 for a degree of 4 and below
+ * 8e-9 for a degree of 7.
+ *
+ * @param x The value to exponentiate
+ */
+template <int degree> static inline double fast_exp (double x)
+{
+  x = (x > s_exp_limit)? s_exp_limit : x;
+  x = (x < -s_exp_limit)? -s_exp_limit : x;
+  const double k = x*s_log2e + s_round;
+  const double n = k - s_round;
+  const double r = (x - n*s_ln2_hi) - n*s_ln2_lo;
+  uint64_t bits;
+  std::memcpy(&bits, &k, sizeof(bits));
+  bits = (bits + 1023) << 52;
+  double scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return taylor_exp<degree>(r) * scale;
+}
+
+/**
+ * Applies the approximated hyperbolic tangent, @f$ 1 - 2/(e^{2x}+1) @f$
+ *
+ * @param x The values to activate
+ * @param n How many values there are
+ */
+template <int degree> static void fast_tanh (data::Feature* x, const size_t n)
+{
+  for (size_t i=0; i<n; ++i) x[i] = 1 - 2 / (fast_exp<degree>(2*x[i]) + 1);
+}
+
+/**
+ * Applies the approximated sigmoid, @f$ 1/(1+e^{-x}) @f$
+ *
+ * @param x The values to activate
+ * @param n How many values there are
+ */
+template <int degree> static void fast_sigmoid (data::Feature* x,
+						const size_t n)
+{
+  for (size_t i=0; i<n; ++i) x[i] = 1 / (1 + fast_exp<degree>(-x[i]));
+}
+
+void strategy::activate (const config::NeuronBackProp::ActivationFunction af,
+			 const config::NeuronBackProp::Accuracy accuracy,
+			 data::Feature* x, const size_t n)
+{
+  switch (af) {
+  case config::NeuronBackProp::TANH:
+    switch (accuracy) {
+    case config::NeuronBackProp::FINE:
+      fast_tanh<7>(x, n);
+      break;
+    case config::NeuronBackProp::COARSE:
+      fast_tanh<4>(x, n);
+      break;
+    default: //EXACT
+      for (size_t i=0; i<n; ++i) x[i] = tanh(x[i]);
+      break;
+    }
+    break;
+  case config::NeuronBackProp::SIGMOID:
+    switch (accuracy) {
+    case config::NeuronBackProp::FINE:
+      fast_sigmoid<7>(x, n);
+      break;
+    case config::NeuronBackProp::COARSE:
+      fast_sigmoid<4>(x, n);
+      break;
+    default: //EXACT
+      for (size_t i=0; i<n; ++i) x[i] = 1 / (1+std::exp(-x[i]));
+      break;
+    }
+    break;
+  case config::NeuronBackProp::LINEAR:
+    break;
+  default:
+    RINGER_DEBUG1("Unknown Activation Function type (" << af << ")."
+		  << " Exception thrown.");
+    throw RINGER_EXCEPTION("unknown activation function type");
+  }
+}
+
+void strategy::derive (const config::NeuronBackProp::ActivationFunction af,
+		       data::Feature* y, const size_t n)
+{
+  switch (af) {
+  case config::NeuronBackProp::TANH:
+    for (size_t i=0; i<n; ++i) y[i] = 1 - y[i]*y[i];
+    break;
+  case config::NeuronBackProp::SIGMOID:
+    for (size_t i=0; i<n; ++i) y[i] = y[i] * (1 - y[i]);
+    break;
+  case config::NeuronBackProp::LINEAR:
+    for (size_t i=0; i<n; ++i) y[i] = 1;
+    break;
+  default:
+    RINGER_DEBUG1("Unknown Activation Function type (" << af << ")."
+		  << " Exception thrown.");
+    throw RINGER_EXCEPTION("unknown activation function type");
+  }
+}
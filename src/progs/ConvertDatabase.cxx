@@ -0,0 +1,88 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file ConvertDatabase.cxx
+ *
+ * Implements the body shared by the database converters.
+ */
+
+#include "ConvertDatabase.h"
+#include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/data/DatabaseFile.h"
+#include "TrigRingerTools/sys/LocalReporter.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/util.h"
+#include "TrigRingerTools/sys/OptParser.h"
+
+typedef struct param_t {
+  std::string input; ///< the name of the input file
+  std::string output; ///< the name of the output file
+} param_t;
+
+/**
+ * Checks and validates program options.
+ *
+ * @param p The parameters, already parsed
+ * @param extension The extension of the output file, if none was given
+ */
+static bool checkopt (param_t& par, const std::string& extension)
+{
+  if (!par.input.size()) {
+    RINGER_DEBUG1("I cannot work without an input file. Exception thrown.");
+    throw RINGER_EXCEPTION("No input file specified");
+  }
+  if (!sys::exists(par.input)) {
+    RINGER_DEBUG1("Input file " << par.input << " doesn't exist.");
+    throw RINGER_EXCEPTION("Input file doesn't exist");
+  }
+  if (!par.output.size()) {
+    par.output = sys::stripname(par.input) + extension;
+    RINGER_DEBUG1("Setting output file to " << par.output);
+  }
+  RINGER_DEBUG1("Command line options have been validated.");
+  return true;
+}
+
+int convert_database (int argc, char** argv, const std::string& from,
+		      const std::string& to, const std::string& extension)
+{
+  sys::Reporter *reporter = new sys::LocalReporter();
+
+  param_t par = { "", "" };
+  sys::OptParser opt_parser(argv[0]);
+  opt_parser.add_option("input", 'i', par.input,
+			"the name of the input " + from + " database");
+  opt_parser.add_option("output", 'o', par.output,
+			"the name of the output " + to + " database");
+  opt_parser.parse(argc, argv);
+
+  try {
+    if (!checkopt(par, extension))
+      RINGER_FATAL(reporter, "Terminating execution.");
+  }
+  catch (sys::Exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter, "I can't handle that exception. Aborting.");
+  }
+
+  try {
+    data::Database<data::RoIPatternSet>* db =
+      data::open_database<data::RoIPatternSet>(par.input, reporter);
+    if (!data::save_database(par.output, data::database_header(*db),
+			     db->data(), reporter))
+      RINGER_FATAL(reporter, "Could not write \"" << par.output << "\".");
+    RINGER_REPORT(reporter, "Wrote " << db->size() << " classes to \""
+		  << par.output << "\".");
+    delete db;
+  }
+  catch (sys::Exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter, "I cannot cope with the exception at"
+		 << " the top-level. Aborting...");
+  }
+
+  RINGER_REPORT(reporter, "Finished successfully. Bye.");
+  delete reporter;
+  return 0;
+}
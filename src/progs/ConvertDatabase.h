@@ -0,0 +1,30 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file ConvertDatabase.h
+ *
+ * Declares the body shared by the database converters, xml2bin and bin2xml.
+ */
+
+#ifndef CONVERTDATABASE_H
+#define CONVERTDATABASE_H
+
+#include <string>
+
+/**
+ * Parses the command line of a database converter, reads the input
+ * database, in whichever format it is, and writes it to the output file,
+ * in the binary format if its name ends in ".bin" and as XML otherwise.
+ *
+ * @param argc The number of command line arguments
+ * @param argv The command line arguments
+ * @param from The name of the input format, for the help messages
+ * @param to The name of the output format, for the help messages
+ * @param extension The extension of the output file, if none is given
+ *
+ * @return The exit status of the program
+ */
+int convert_database (int argc, char** argv, const std::string& from,
+		      const std::string& to, const std::string& extension);
+
+#endif /* CONVERTDATABASE_H */
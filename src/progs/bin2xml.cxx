@@ -0,0 +1,15 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file bin2xml.cxx
+ *
+ * Converts a binary database file, as written by xml2bin, back into an XML
+ * database.
+ */
+
+#include "ConvertDatabase.h"
+
+int main (int argc, char** argv)
+{
+  return convert_database(argc, argv, "binary", "XML", ".xml");
+}
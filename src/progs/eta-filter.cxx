@@ -154,12 +154,21 @@ int main (int argc, char** argv)
 		   " events. Please, reconsider your input file.");
     }
 
+    //splits both classes in all eta bins at once
+    std::vector<double> edges;
+    for (double eta_start = -2.5; eta_start < 2.51; eta_start += par.eta)
+      edges.push_back(eta_start);
+    edges.push_back(edges.back() + par.eta);
+    std::vector<std::vector<size_t> > ebins, jbins;
+    db.data("electron")->partition(edges, ebins);
+    db.data("jet")->partition(edges, jbins);
+
     size_t order = 0; ///< defines the dumping ording
-    for (double eta_start = -2.5; eta_start < 2.51; eta_start += par.eta) {
+    for (size_t b = 0; b < ebins.size(); ++b) {
+      const double eta_start = edges[b];
       //build output data sets for electrons
-      data::RoIPatternSet electrons(*db.data("electron"), 
-				    eta_start, eta_start+par.eta);
-      data::RoIPatternSet jets(*db.data("jet"), eta_start, eta_start+par.eta);
+      data::RoIPatternSet electrons(*db.data("electron"), ebins[b]);
+      data::RoIPatternSet jets(*db.data("jet"), jbins[b]);
     
       //dump new databases at specified locations
       std::map<std::string, data::RoIPatternSet*> new_data;
@@ -170,11 +179,16 @@ int main (int argc, char** argv)
 	      << eta_start << " but smaller than " << eta_start+par.eta << ".";
       data::Header header("Andre DOS ANJOS", "Filtered database on eta",
 			  "1.0", time(0), comment.str());
-      data::DatabaseXml<data::RoIPatternSet> new_db(&header, new_data, reporter);
       std::ostringstream filename;
       filename << par.prefix << "-" << std::setw(2) << std::setfill('0') 
 	       << order << ".xml";
-      new_db.save(filename.str());
+      if (!data::DatabaseXml<data::RoIPatternSet>::write(filename.str(),
+							 &header, new_data,
+							 reporter)) {
+	RINGER_DEBUG1("Could not save \"" << filename.str() << "\"."
+		      << " Exception thrown.");
+	throw RINGER_EXCEPTION("Could not save the filtered database");
+      }
       RINGER_REPORT(reporter, "Saved new database " << filename.str());
       ++order;
     }
@@ -12,9 +12,12 @@
 #include "TrigRingerTools/data/Database.h"
 #include "TrigRingerTools/data/DatabaseXml.h"
 #include "TrigRingerTools/data/NormalizationOperator.h"
+#include "TrigRingerTools/data/BalancedSampler.h"
 #include "TrigRingerTools/data/util.h"
 #include "TrigRingerTools/data/SumExtractor.h"
 #include "TrigRingerTools/network/LMS.h"
+#include "TrigRingerTools/network/BatchTrainer.h"
+#include "TrigRingerTools/network/AsyncEvaluator.h"
 #include "TrigRingerTools/sys/LocalReporter.h"
 #include "TrigRingerTools/sys/Exception.h"
 #include "TrigRingerTools/sys/debug.h"
@@ -41,7 +44,7 @@ typedef struct param_t {
   long int epoch; ///< each epoch size
   bool msestop; ///< use MSE product stop criteria instead of SP stabilisation
   long int stopiter; ///< number of iterations w/o variance to stop
-  data::Feature stopthres; ///< the threshold to consider for stopping
+  double stopthres; ///< the threshold to consider for stopping
   long int sample; ///< the sample interval for MSE or SP
   long int hardstop; ///< where to hard stop the training
 } param_t;
@@ -190,12 +193,13 @@ int main (int argc, char** argv)
   traindb.class_names(cnames);
   RINGER_DEBUG1("Test set size is " << testdb.size());
 
-  //tune input DB's for size/randomness
-  data::Database<data::RoIPatternSet> 
-    traindb2(traindb); //save original train database
-  traindb.normalise();
-  data::NormalizationOperator norm_op(traindb);
-  RINGER_DEBUG1("Train set size is " << traindb2.size());
+  //calculate the normalization factor based on the train set, counting
+  //every class the same, whatever its size
+  data::NormalizationOperator norm_op(traindb, true);
+  //classes are balanced while sampling, the database is not inflated
+  data::BalancedSampler sampler(traindb);
+  std::vector<size_t> pats(par.epoch);
+  RINGER_DEBUG1("Train set size is " << traindb.size());
   
   //checks db size
   if (traindb.size() < 2) {
@@ -211,25 +215,17 @@ int main (int argc, char** argv)
   }
 
   //Builds the LMS network
-  network::LMS net(traindb.pattern_size(), norm_op.mean(), norm_op.stddev(),
-                   reporter);
+  network::LMS lms(traindb.pattern_size(), norm_op.mean(), norm_op.stddev(),
+		   reporter);
+  //trains with matrix products, from the LMS weights
+  network::BatchTrainer net(lms, reporter);
 
   data::RoIPatternSet train(1, 1);
   traindb.merge(train);
-  RINGER_REPORT(reporter, "Normalised train set size is " << train.size());
-  data::RoIPatternSet train2(1, 1);
-  traindb2.merge(train2);
-  RINGER_REPORT(reporter, "Original train set size is " << train2.size());
-  RINGER_DEBUG1("Train set size is " << train.size());
+  RINGER_REPORT(reporter, "Train set size is " << train.size());
   data::RoIPatternSet target(1, 1);
   traindb.merge_target(true, -1, +1, target);
-  RINGER_REPORT(reporter, "Normalized train target set size is " 
-		<< target.size());
-  data::RoIPatternSet target2(1, 1);
-  traindb2.merge_target(true, -1, +1, target2);
-  RINGER_REPORT(reporter, "Original train target set size is "
-		<< target2.size());
-  RINGER_DEBUG1("Train target set size is " << target.size());
+  RINGER_REPORT(reporter, "Train target set size is " << target.size());
   data::RoIPatternSet test(1, 1);
   testdb.merge(test);
   RINGER_DEBUG1("Test set size is " << test.size());
@@ -242,12 +238,16 @@ int main (int argc, char** argv)
     mseevo << "epoch test-mse train-mse" << "\n";
     sys::Plain spevo(par.spevo, std::ios_base::trunc|std::ios_base::out);
     spevo << "epoch test-sp train-sp" << "\n";
-    data::SimplePatternSet output(target2.simple());
     config::Header net_header("Andre DOS ANJOS", par.output, "1.0", time(0),
                               "Start set");
     net.save(par.startnet, &net_header);
     unsigned int stopnow = par.stopiter;
 
+    //Evaluates snapshots of the network in the background, while training
+    network::AsyncEvaluator evaluator(test.simple(), test_target.simple(),
+				      train.simple(), target.simple(),
+				      traindb.size() == 2);
+
     //Trains until the MSE or SP product stabilizes
     double val = 1;
     double var = 1;
@@ -255,83 +255,84 @@ int main (int argc, char** argv)
     double prev = 0; //previous
     size_t i = 0;
     double best_val = val;
-    while (stopnow) {
-      net.train(train.simple(), target.simple(), par.epoch);
-      --par.hardstop;
-      if (!par.hardstop) {
-        RINGER_REPORT(reporter, "Hard-stop limit has been reached. Stopping"
-                      << " the training session by force.");
-        stopnow = 0;
-        continue;
+    while (stopnow || evaluator.pending()) {
+      if (stopnow) {
+	sampler.draw(pats);
+	net.train(train.simple(), target.simple(), pats);
+	--par.hardstop;
+	if (!par.hardstop) {
+	  RINGER_REPORT(reporter, "Hard-stop limit has been reached. Stopping"
+			<< " the training session by force.");
+	  stopnow = 0;
+	}
+	else {
+	  //time to check performance
+	  if (i%par.sample == 0) evaluator.submit(net, i);
+	  ++i; //go to next epoch
+	}
+      }
+
+      //evaluations come back in epoch order, all of them once stopped
+      network::Evaluation* ev = evaluator.next(!stopnow);
+      if (!ev) continue;
+      if (ev->error.size()) {
+	std::string error = ev->error;
+	delete ev;
+	throw RINGER_EXCEPTION(error.c_str());
+      }
+      {
+	//test set analysis
+	mseevo << (unsigned int)ev->epoch << " " << ev->test_mse;
+	spevo << (unsigned int)ev->epoch << " " << ev->test_sp;
+	prev = val;
+	if (!par.msestop) val = ev->test_sp;
+	else val = ev->test_mse;
+	var = std::fabs(val-prev)/prev;
+	bool savenet = false;
+	if (!par.msestop) { //the greater, the better
+	  if (val > best_val) {
+	    best_val = val;
+	    savenet = true;
+	  }
+	}
+	else {
+	  if (var < best_val) {
+	    best_val = val;
+	    savenet = true;
+	  }
+	}
+	if (savenet) { //save the network of that epoch because it is the best
+	  //save result
+	  RINGER_REPORT(reporter, "Saving best network so far at \""
+			<< par.bestnet << "\"...");
+	  config::Header best_header("Andre DOS ANJOS", par.output, 
+				     "1.0", time(0), "Trained network");
+	  ev->save(par.bestnet, &best_header, reporter);
+	}
       }
-      
-      if (i%par.sample == 0) { //time to check performance
-        double eff1, eff2, thres;
-        double eff1_test, eff2_test, thres_test;
-        {
-          //test set analysis
-          output = test_target.simple();
-          net.run(test.simple(), output);
-          double sp_val;
-          if (traindb.size() == 2)
-            sp_val = data::sp(output, test_target, eff1_test, eff2_test, thres_test);
-          double mse_val = data::mse(output, test_target.simple());
-          mseevo << (unsigned int)i << " " << mse_val;
-          spevo << (unsigned int)i << " " << sp_val;
-          prev = val;
-          if (!par.msestop) val = sp_val;
-          else val = mse_val;
-          var = std::fabs(val-prev)/prev;
-          bool savenet = false;
-          if (!par.msestop) { //the greater, the better
-            if (val > best_val) {
-              best_val = val;
-              savenet = true;
-            }
-          }
-          else {
-            if (var < best_val) {
-              best_val = val;
-              savenet = true;
-            }
-          }
-          if (savenet) { //save the current network because it is the best
-            //save result
-            RINGER_REPORT(reporter, "Saving best network so far at \""
-                          << par.bestnet << "\"...");
-            config::Header best_header("Andre DOS ANJOS", par.output, 
-                                      "1.0", time(0), "Trained network");
-            net.save(par.bestnet, &best_header);
-          }
-        }
-        {
-          //train set analysis
-          net.run(train2.simple(), output);
-          double sp_val;
-          if (traindb.size() == 2) 
-            sp_val = data::sp(output, target2, eff1, eff2, thres);
-          double mse_val = data::mse(output, target2.simple());
-          mseevo << " " << mse_val << "\n";
-          spevo << " " << sp_val << "\n";
-        }
-        if (var < par.stopthres) {
-          --stopnow;
-          RINGER_REPORT(reporter, "Detected possible stop in " << stopnow
-                        << " more iterations.");
-        }
-        else stopnow = par.stopiter;
-        if (!par.msestop) {
-          RINGER_REPORT(reporter, "[epoch " << i << "/test] SP = " << val
-                        << " (variation = " << var << ") (for threshold=" 
-                        << thres_test << " -> " << cnames[0]
-                        << " eff=" << eff1_test*100 << "% and " << cnames[1]
-                        << " eff=" << eff2_test*100 << "%)");
-        }
-        else RINGER_REPORT(reporter, "[epoch " << i << "] MSE = " << val
-                           << " (variation = " << var << ")");
+      {
+	//train set analysis
+	mseevo << " " << ev->train_mse << "\n";
+	spevo << " " << ev->train_sp << "\n";
       }
-      
-      ++i; //go to next epoch
+      if (stopnow) {
+	if (var < par.stopthres) {
+	  --stopnow;
+	  RINGER_REPORT(reporter, "Detected possible stop in " << stopnow
+			<< " more iterations.");
+	}
+	else stopnow = par.stopiter;
+      }
+      if (!par.msestop) {
+	RINGER_REPORT(reporter, "[epoch " << ev->epoch << "/test] SP = " << val
+		      << " (variation = " << var << ") (for threshold=" 
+		      << ev->test_thres << " -> " << cnames[0]
+		      << " eff=" << ev->test_eff1*100 << "% and " << cnames[1]
+		      << " eff=" << ev->test_eff2*100 << "%)");
+      }
+      else RINGER_REPORT(reporter, "[epoch " << ev->epoch << "] MSE = " << val
+			 << " (variation = " << var << ")");
+      delete ev;
     }
     
     //save result
@@ -346,16 +347,16 @@ int main (int argc, char** argv)
     
     //reload the best network saved so far.
     network::Network bestnet(par.endnet, reporter);
-    data::SimplePatternSet simple_train_output(target2.simple());
-    bestnet.run(train2.simple(), simple_train_output);
-    data::RoIPatternSet train_output(simple_train_output, train2.attributes());
-    double mse_train = data::mse(train_output, target2);
+    data::SimplePatternSet simple_train_output(target.simple());
+    bestnet.run(train.simple(), simple_train_output);
+    data::RoIPatternSet train_output(simple_train_output, train.attributes());
+    double mse_train = data::mse(train_output, target);
     double sp_train = 0;
     double train_eff1 = 0;
     double train_eff2 = 0;
     double train_thres = 0;
     if (traindb.size() == 2) 
-      sp_train = data::sp(train_output, target2, train_eff1, train_eff2, 
+      sp_train = data::sp(train_output, target, train_eff1, train_eff2, 
 			  train_thres);
     data::SimplePatternSet simple_test_output(target.simple());
     bestnet.run(test.simple(), simple_test_output);
@@ -373,10 +374,10 @@ int main (int argc, char** argv)
     data::Ensemble train_energies(train_output.size(), 0);
     data::SumExtractor add;
     for (size_t i = 0; i < train_output.size(); ++i) {
-      train_energies[i] = add(train2.pattern(i));
+      train_energies[i] = add(train.pattern(i));
     }
     train_energy.set_ensemble(0, train_energies);
-    train_energy.set_attribute(train2.attributes());
+    train_energy.set_attribute(train.attributes());
 
     data::RoIPatternSet test_energy(test_output.size(), 1);
     data::Ensemble test_energies(test_output.size(), 0);
@@ -388,7 +389,7 @@ int main (int argc, char** argv)
 
     std::map<std::string, data::RoIPatternSet*> data;
     data["train-output"] = &train_output;
-    data["train-target"] = &target2;
+    data["train-target"] = &target;
     data["train-energy"] = &train_energy;
     data["test-output"] = &test_output;
     data["test-target"] = &test_target;
@@ -402,8 +403,12 @@ int main (int argc, char** argv)
     comment << ".";
     data::Header header("Andre DOS ANJOS", par.output, "1.0", time(0),
 			comment.str());
-    data::DatabaseXml<data::RoIPatternSet> output_db(&header, data, reporter);
-    output_db.save(par.output);
+    if (!data::DatabaseXml<data::RoIPatternSet>::write(par.output, &header,
+						       data, reporter)) {
+      RINGER_DEBUG1("Could not save \"" << par.output << "\"."
+		    << " Exception thrown.");
+      throw RINGER_EXCEPTION("Could not save the network output");
+    }
     RINGER_REPORT(reporter, "Network output saved to \"" << par.output
 		  << "\".");
 
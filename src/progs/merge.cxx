@@ -197,7 +197,11 @@ int main (int argc, char** argv)
     data::DatabaseXml<data::RoIPatternSet> dump(&h, db_data, reporter);
     RINGER_REPORT(reporter, "Dumping merged database into \"" << par.output
 		  << "\".");
-    dump.save(par.output);
+    if (!dump.save(par.output)) {
+      RINGER_DEBUG1("Could not save \"" << par.output << "\"."
+		    << " Exception thrown.");
+      throw RINGER_EXCEPTION("Could not save the merged database");
+    }
   }
 
   catch (sys::Exception& ex) {
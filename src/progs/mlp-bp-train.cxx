@@ -12,11 +12,15 @@
 #include "TrigRingerTools/data/RoIPatternSet.h"
 #include "TrigRingerTools/data/Database.h"
 #include "TrigRingerTools/data/DatabaseXml.h"
+#include "TrigRingerTools/data/DatabaseFile.h"
 #include "TrigRingerTools/data/DatabaseRoot.h"
 #include "TrigRingerTools/data/NormalizationOperator.h"
+#include "TrigRingerTools/data/BalancedSampler.h"
 #include "TrigRingerTools/data/util.h"
 #include "TrigRingerTools/data/SumExtractor.h"
 #include "TrigRingerTools/network/MLP.h"
+#include "TrigRingerTools/network/BatchTrainer.h"
+#include "TrigRingerTools/network/AsyncEvaluator.h"
 #include "TrigRingerTools/sys/LocalReporter.h"
 #include "TrigRingerTools/sys/Exception.h"
 #include "TrigRingerTools/sys/debug.h"
@@ -51,15 +55,16 @@ typedef struct param_t {
   std::string energy; ///< where to save the energies of the clusters
   long int nhidden; ///< number of hidden neurons
   long int epoch; ///< each epoch size
-  data::Feature lrate; ///< learning rate to use
-  data::Feature lrdecay; ///< learning rate decay
-  data::Feature momentum; ///< momentum
+  double lrate; ///< learning rate to use
+  double lrdecay; ///< learning rate decay
+  double momentum; ///< momentum
   bool msestop; ///< use MSE product stop criteria instead of SP stabilisation
   bool compress; ///< if I should use compressed or extended output 
   long int stopiter; ///< number of iterations w/o variance to stop
-  data::Feature stopthres; ///< the threshold to consider for stopping
+  double stopthres; ///< the threshold to consider for stopping
   long int sample; ///< the sample interval for MSE or SP
   long int hardstop; ///< where to hard stop the training
+  long int nthreads; ///< number of threads to train with
 } param_t;
 
 /**
@@ -171,6 +176,10 @@ bool checkopt (param_t& par, sys::Reporter* reporter)
 		  << " Please provide me a hardstop.");
     throw RINGER_EXCEPTION("No hardstop parameter specified.");
   }
+  if (par.nthreads <= 0) {
+    RINGER_DEBUG1("Trying to set the number of threads to " << par.nthreads);
+    throw RINGER_EXCEPTION("The number of threads should be > 0");
+  }
   RINGER_DEBUG1("Command line options have been validated.");
   return true;
 }
@@ -183,10 +192,10 @@ int main (int argc, char** argv)
                   std::vector<std::string>(0),
                   false, "", "", "", "", "", "", "",
                   4, 50, 0.1, 1.0, 0.01, false, true,
-                  50, 0.001, 10, 10000 };
+                  50, 0.001, 10, 10000, 1 };
 		  
   sys::OptParser opt_parser(argv[0]);
-  // Only 4 letters available now: q, v, h, f
+  // Only 3 letters available now: q, v, h
   opt_parser.add_option
     ("rclasses", 'a', par.rclasses,
      "Name of the classes to use with ROOT files.");
@@ -207,7 +216,7 @@ int main (int argc, char** argv)
      "where to write the last network");
   opt_parser.add_option
     ("best-net", 'g', par.bestnet, 
-     "where to write the best network");
+     "where to write the best network (binary if it ends in .bin)");
   opt_parser.add_option
     ("energy", 'j', par.energy,
      "the name of the output file for transverse energies of input clusters");
@@ -252,7 +261,11 @@ int main (int argc, char** argv)
      "should compress the output, e.g. 2 classes -> 1 output for the network");
   opt_parser.add_option
     ("input-xml", 'x', par.xml,
-     "should use XML files as input database");
+     "should use XML (or binary) files as input database");
+  opt_parser.add_option
+    ("threads", 'f', par.nthreads,
+     "how many threads should share the patterns of each epoch (and of the"
+     " normalisation statistics)");
   opt_parser.parse(argc, argv);
 
   try {
@@ -268,9 +281,9 @@ int main (int argc, char** argv)
   std::vector<std::string> cnames;
   data::Database<data::RoIPatternSet> *traindb = 0, *testdb = 0;
   if (par.xml) {
-    RINGER_DEBUG1("Using input from XML file.");
-    traindb = new data::DatabaseXml<data::RoIPatternSet>(par.traindb[0], reporter);
-    testdb = new data::DatabaseXml<data::RoIPatternSet>(par.testdb[0], reporter);
+    RINGER_DEBUG1("Using input from XML (or binary) file.");
+    traindb = data::open_database<data::RoIPatternSet>(par.traindb[0], reporter);
+    testdb = data::open_database<data::RoIPatternSet>(par.testdb[0], reporter);
   } else {
     RINGER_DEBUG1("Using input from ROOT file.");
     std::map<const std::string, const data::RootClassInfo> rootTrain;
@@ -291,17 +304,13 @@ int main (int argc, char** argv)
     traindb->class_names(cnames);
     RINGER_DEBUG1("Test set size is " << testdb->size());
   
-    //tune input DB's for size/randomness
-    data::Database<data::RoIPatternSet> 
-      traindb2(*traindb); //save original train database
-    RINGER_DEBUG1("Original train database saved.");
-
-    traindb->normalise();
-    //calculate the normalization factor based on the train set, but only after
-    //size normalization
-    RINGER_DEBUG1("Train DB Normalization.");
-    data::NormalizationOperator norm_op(*traindb);
-    RINGER_DEBUG1("Train set size is " << traindb2.size());
+    //calculate the normalization factor based on the train set, counting
+    //every class the same, whatever its size
+    data::NormalizationOperator norm_op(*traindb, true, par.nthreads);
+    //classes are balanced while sampling, the database is not inflated
+    data::BalancedSampler sampler(*traindb);
+    std::vector<size_t> pats(par.epoch);
+    RINGER_DEBUG1("Train set size is " << traindb->size());
 
     //checks db size
     if (traindb->size() < 2) {
@@ -328,29 +337,21 @@ int main (int argc, char** argv)
     std::vector<bool> biaslayer(2, true);
     unsigned int nout = traindb->size();
     if (par.compress) nout = lrint(std::ceil(log2(traindb->size())));
-    network::MLP net(traindb->pattern_size(), hlayer, nout,
+    network::MLP mlp(traindb->pattern_size(), hlayer, nout,
 		     biaslayer, nstrat, nsparam, nstrat, nsparam,
 		     sstrat, ssparam, norm_op.mean(), norm_op.stddev(), 
 		     reporter);
+    //trains layer by layer, with matrix products, from the MLP weights
+    network::BatchTrainer net(mlp, reporter, par.nthreads);
 
-    data::RoIPatternSet train(1, 1);
-    traindb->merge(train);
-    RINGER_REPORT(reporter, "Normalised train set size is " << train.size());
-    data::RoIPatternSet train2(1, 1);
-    traindb2.merge(train2);
-    RINGER_REPORT(reporter, "Original train set size is " << train2.size());
-    RINGER_DEBUG1("Train set size is " << train.size());
+    data::RoIPatternSet train_buffer(1, 1);
+    const data::RoIPatternSet& train = data::merged(*traindb, train_buffer);
+    RINGER_REPORT(reporter, "Train set size is " << train.size());
     data::RoIPatternSet target(1, 1);
     traindb->merge_target(par.compress, -1, +1, target);
-    RINGER_REPORT(reporter, "Normalized train target set size is " 
-		  << target.size());
-    data::RoIPatternSet target2(1, 1);
-    traindb2.merge_target(par.compress, -1, +1, target2);
-    RINGER_REPORT(reporter, "Original train target set size is "
-		  << target2.size());
-    RINGER_DEBUG1("Train target set size is " << target.size());
-    data::RoIPatternSet test(1, 1);
-    testdb->merge(test);
+    RINGER_REPORT(reporter, "Train target set size is " << target.size());
+    data::RoIPatternSet test_buffer(1, 1);
+    const data::RoIPatternSet& test = data::merged(*testdb, test_buffer);
     RINGER_DEBUG1("Test set size is " << test.size());
     data::RoIPatternSet test_target(1, 1);
     testdb->merge_target(par.compress, -1, +1, test_target);
@@ -361,12 +362,16 @@ int main (int argc, char** argv)
       mseevo << "epoch test-mse train-mse" << "\n";
       sys::Plain spevo(par.spevo, std::ios_base::trunc|std::ios_base::out);
       spevo << "epoch test-sp train-sp" << "\n";
-      data::SimplePatternSet output(target2.simple());
       config::Header net_header("Andre DOS ANJOS", par.output, "1.0", time(0),
 				"Start set");
       net.save(par.startnet, &net_header);
       unsigned int stopnow = par.stopiter;
 
+      //Evaluates snapshots of the network in the background, while training
+      network::AsyncEvaluator evaluator(test.simple(), test_target.simple(),
+					train.simple(), target.simple(),
+					traindb->size() == 2);
+
       //Trains until the MSE or SP product stabilizes
       double val = 1;
       double var = 1;
@@ -374,83 +379,84 @@ int main (int argc, char** argv)
       double prev = 0; //previous
       size_t i = 0;
       double best_val = val;
-      while (stopnow) {
-	net.train(train.simple(), target.simple(), par.epoch);
-	--par.hardstop;
-	if (!par.hardstop) {
-	  RINGER_REPORT(reporter, "Hard-stop limit has been reached. Stopping"
-			<< " the training session by force.");
-	  stopnow = 0;
-	  continue;
+      while (stopnow || evaluator.pending()) {
+	if (stopnow) {
+	  sampler.draw(pats);
+	  net.train(train.simple(), target.simple(), pats);
+	  --par.hardstop;
+	  if (!par.hardstop) {
+	    RINGER_REPORT(reporter, "Hard-stop limit has been reached. Stopping"
+			  << " the training session by force.");
+	    stopnow = 0;
+	  }
+	  else {
+	    //time to check performance
+	    if (i%par.sample == 0) evaluator.submit(net, i);
+	    ++i; //go to next epoch
+	  }
 	}
 
-	if (i%par.sample == 0) { //time to check performance
-	  double eff1, eff2, thres;
-	  double eff1_test, eff2_test, thres_test;
-	  {
-	    //test set analysis
-	    output = test_target.simple();
-	    net.run(test.simple(), output);
-	    double sp_val;
-	    if (traindb->size() == 2)
-	      sp_val = data::sp(output, test_target, eff1_test, eff2_test, thres_test);
-	    double mse_val = data::mse(output, test_target.simple());
-	    mseevo << (unsigned int)i << " " << mse_val;
-	    spevo << (unsigned int)i << " " << sp_val;
-	    prev = val;
-	    if (!par.msestop) val = sp_val;
-	    else val = mse_val;
-	    var = std::fabs(val-prev)/prev;
-	    bool savenet = false;
-	    if (!par.msestop) { //the greater, the better
-	      if (val > best_val) {
-		best_val = val;
-		savenet = true;
-	      }
-	    }
-	    else {
-	      if (var < best_val) {
-		best_val = val;
-		savenet = true;
-	      }
+	//evaluations come back in epoch order, all of them once stopped
+	network::Evaluation* ev = evaluator.next(!stopnow);
+	if (!ev) continue;
+	if (ev->error.size()) {
+	  std::string error = ev->error;
+	  delete ev;
+	  throw RINGER_EXCEPTION(error.c_str());
+	}
+	{
+	  //test set analysis
+	  mseevo << (unsigned int)ev->epoch << " " << ev->test_mse;
+	  spevo << (unsigned int)ev->epoch << " " << ev->test_sp;
+	  prev = val;
+	  if (!par.msestop) val = ev->test_sp;
+	  else val = ev->test_mse;
+	  var = std::fabs(val-prev)/prev;
+	  bool savenet = false;
+	  if (!par.msestop) { //the greater, the better
+	    if (val > best_val) {
+	      best_val = val;
+	      savenet = true;
 	    }
-	    if (savenet) { //save the current network because it is the best
-	      //save result
-	      RINGER_REPORT(reporter, "Saving best network so far at \""
-			    << par.bestnet << "\"...");
-	      config::Header end_header("Andre DOS ANJOS", par.output, 
-					"1.0", time(0), "Trained network");
-	      net.save(par.bestnet, &end_header);
+	  }
+	  else {
+	    if (var < best_val) {
+	      best_val = val;
+	      savenet = true;
 	    }
 	  }
-	  {
-	    //train set analysis
-	    net.run(train2.simple(), output);
-	    double sp_val;
-	    if (traindb->size() == 2) 
-	      sp_val = data::sp(output, target2, eff1, eff2, thres);
-	    double mse_val = data::mse(output, target2.simple());
-	    mseevo << " " << mse_val << "\n";
-	    spevo << " " << sp_val << "\n";
+	  if (savenet) { //save the network of that epoch because it is the best
+	    //save result
+	    RINGER_REPORT(reporter, "Saving best network so far at \""
+			  << par.bestnet << "\"...");
+	    config::Header end_header("Andre DOS ANJOS", par.output, 
+				      "1.0", time(0), "Trained network");
+	    ev->save(par.bestnet, &end_header, reporter);
 	  }
+	}
+	{
+	  //train set analysis
+	  mseevo << " " << ev->train_mse << "\n";
+	  spevo << " " << ev->train_sp << "\n";
+	}
+	if (stopnow) {
 	  if (var < par.stopthres) {
 	    --stopnow;
 	    RINGER_REPORT(reporter, "Detected possible stop in " << stopnow
 			  << " more iterations.");
 	  }
 	  else stopnow = par.stopiter;
-	  if (!par.msestop) {
-	    RINGER_REPORT(reporter, "[epoch " << i << "/test] SP = " << val
-			  << " (variation = " << var << ") (for threshold=" 
-			  << thres_test << " -> " << cnames[0]
-			  << " eff=" << eff1_test*100 << "% and " << cnames[1]
-			  << " eff=" << eff2_test*100 << "%)");
-	  }
-	  else RINGER_REPORT(reporter, "[epoch " << i << "] MSE = " << val
-			     << " (variation = " << var << ")");
 	}
-
-	++i; //go to next epoch
+	if (!par.msestop) {
+	  RINGER_REPORT(reporter, "[epoch " << ev->epoch << "/test] SP = " << val
+			<< " (variation = " << var << ") (for threshold=" 
+			<< ev->test_thres << " -> " << cnames[0]
+			<< " eff=" << ev->test_eff1*100 << "% and " << cnames[1]
+			<< " eff=" << ev->test_eff2*100 << "%)");
+	}
+	else RINGER_REPORT(reporter, "[epoch " << ev->epoch << "] MSE = " << val
+			   << " (variation = " << var << ")");
+	delete ev;
       }
 
       //save result
@@ -465,16 +471,16 @@ int main (int argc, char** argv)
     
       //reload the best network saved so far.
       network::Network bestnet(par.endnet, reporter);
-      data::SimplePatternSet simple_train_output(target2.simple());
-      bestnet.run(train2.simple(), simple_train_output);
-      data::RoIPatternSet train_output(simple_train_output, train2.attributes());
-      double mse_train = data::mse(train_output, target2);
+      data::SimplePatternSet simple_train_output(target.simple());
+      bestnet.run(train.simple(), simple_train_output);
+      data::RoIPatternSet train_output(simple_train_output, train.attributes());
+      double mse_train = data::mse(train_output, target);
       double sp_train = 0;
       double train_eff1 = 0;
       double train_eff2 = 0;
       double train_thres = 0;
       if (traindb->size() == 2) 
-	sp_train = data::sp(train_output, target2, train_eff1, train_eff2, 
+	sp_train = data::sp(train_output, target, train_eff1, train_eff2, 
 			    train_thres);
       data::SimplePatternSet simple_test_output(target.simple());
       bestnet.run(test.simple(), simple_test_output);
@@ -492,10 +498,10 @@ int main (int argc, char** argv)
       data::Ensemble train_energies(train_output.size(), 0);
       data::SumExtractor add;
       for (size_t i = 0; i < train_output.size(); ++i) {
-	train_energies[i] = add(train2.pattern(i));
+	train_energies[i] = add(train.pattern(i));
       }
       train_energy.set_ensemble(0, train_energies);
-      train_energy.set_attribute(train2.attributes());
+      train_energy.set_attribute(train.attributes());
 
       data::RoIPatternSet test_energy(test_output.size(), 1);
       data::Ensemble test_energies(test_output.size(), 0);
@@ -507,7 +513,7 @@ int main (int argc, char** argv)
 
       std::map<std::string, data::RoIPatternSet*> data;
       data["train-output"] = &train_output;
-      data["train-target"] = &target2;
+      data["train-target"] = &target;
       data["train-energy"] = &train_energy;
       data["test-output"] = &test_output;
       data["test-target"] = &test_target;
@@ -524,8 +530,12 @@ int main (int argc, char** argv)
       comment << ".";
       data::Header header("Andre DOS ANJOS", par.output, "1.0", time(0),
 			  comment.str());
-      data::DatabaseXml<data::RoIPatternSet> output_db(&header, data, reporter);
-      output_db.save(par.output);
+      if (!data::DatabaseXml<data::RoIPatternSet>::write(par.output, &header,
+							 data, reporter)) {
+	RINGER_DEBUG1("Could not save \"" << par.output << "\"."
+		      << " Exception thrown.");
+	throw RINGER_EXCEPTION("Could not save the network output");
+      }
       RINGER_REPORT(reporter, "Network output saved to \"" << par.output
 		    << "\".");
 
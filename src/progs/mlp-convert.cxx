@@ -0,0 +1,42 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file mlp-convert.cxx
+ *
+ * Converts a network between the XML and the binary formats.
+ */
+
+#include "TrigRingerTools/config/Network.h"
+#include "TrigRingerTools/sys/LocalReporter.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/util.h"
+#include "TrigRingerTools/sys/debug.h"
+
+int main (int argc, char** argv)
+{
+  sys::Reporter *reporter = new sys::LocalReporter();
+  if (argc != 3) RINGER_FATAL(reporter, "usage: " << argv[0]
+			      << " <network-file> <output-file>"
+			      << " (binary if it ends in .bin, XML otherwise)");
+  try {
+    if (!sys::exists(argv[1])) {
+      RINGER_DEBUG1("Network file " << argv[1] << " doesn't exist.");
+      throw RINGER_EXCEPTION("Network file doesn't exist");
+    }
+    config::Network net(argv[1], reporter);
+    if (!net.save(argv[2])) {
+      RINGER_DEBUG1("Could not save \"" << argv[2] << "\". Exception thrown.");
+      throw RINGER_EXCEPTION("Could not save network");
+    }
+    RINGER_REPORT(reporter, "Network with " << net.neurons().size()
+		  << " neurons and " << net.synapses().size()
+		  << " synapses was written to \"" << argv[2] << "\".");
+  }
+  catch (sys::Exception& e) {
+    RINGER_EXCEPT(reporter, e.what());
+    RINGER_FATAL(reporter,
+		 "I caught an exception, I'm sorry but I have to exit. Bye.");
+  }
+
+  delete reporter;
+}
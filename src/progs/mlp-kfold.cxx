@@ -0,0 +1,331 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file mlp-kfold.cxx
+ *
+ * Cross-validates an MLP on a database using k folds. Each fold gets its own
+ * network, trained on the remaining folds and tested on itself. The folds
+ * are just lists of positions in the merged database, so no data is copied
+ * for splitting, and they are trained concurrently on a pool of threads.
+ */
+
+#include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/data/Database.h"
+#include "TrigRingerTools/data/DatabaseFile.h"
+#include "TrigRingerTools/data/NormalizationOperator.h"
+#include "TrigRingerTools/data/BalancedSampler.h"
+#include "TrigRingerTools/data/KFold.h"
+#include "TrigRingerTools/data/RandomInteger.h"
+#include "TrigRingerTools/data/util.h"
+#include "TrigRingerTools/network/MLP.h"
+#include "TrigRingerTools/sys/LocalReporter.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/util.h"
+#include "TrigRingerTools/sys/OptParser.h"
+#include "TrigRingerTools/sys/ThreadPool.h"
+#include "TrigRingerTools/config/NeuronBackProp.h"
+#include "TrigRingerTools/config/SynapseRProp.h"
+#include "TrigRingerTools/config/type.h"
+#include "TrigRingerTools/config/Header.h"
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <sstream>
+
+typedef struct param_t {
+  std::string db; ///< database to use for cross-validation
+  std::string prefix; ///< prefix for the network files of each fold
+  long int nfolds; ///< number of folds
+  long int nhidden; ///< number of hidden neurons
+  long int epoch; ///< each epoch size
+  long int nepochs; ///< number of epochs to train each fold
+  long int nthreads; ///< number of threads to use
+  long int seed; ///< the random seed, 0 to use the time
+  bool compress; ///< if I should use compressed or extended output
+} param_t;
+
+/**
+ * Checks and validates program options.
+ *
+ * @param p The parameters, already parsed
+ * @param reporter The reporter to use when reporting problems to the user
+ */
+bool checkopt (param_t& par, sys::Reporter* reporter)
+{
+  if (!par.db.size()) {
+    RINGER_DEBUG1("No DB file given! Throwing...");
+    throw RINGER_EXCEPTION("Database file not given.");
+  }
+  if (!sys::exists(par.db)) {
+    RINGER_DEBUG1("Database file " << par.db << " doesn't exist.");
+    throw RINGER_EXCEPTION("Database file doesn't exist");
+  }
+  if (par.nfolds < 2) {
+    RINGER_DEBUG1("I cannot cross-validate with " << par.nfolds
+		  << " folds. Exception thrown.");
+    throw RINGER_EXCEPTION("The number of folds should be >= 2");
+  }
+  if (par.nhidden <= 0) {
+    RINGER_DEBUG1("I cannot work with 0 hidden neurons. Exception thrown.");
+    throw RINGER_EXCEPTION("No number of hidden neurons specified");
+  }
+  if (par.epoch <= 0 || par.nepochs <= 0) {
+    RINGER_DEBUG1("I cannot train with epoch size " << par.epoch
+		  << " during " << par.nepochs << " epochs.");
+    throw RINGER_EXCEPTION("Epoch size and number should be > 0");
+  }
+  if (par.seed < 0) {
+    RINGER_DEBUG1("Trying to set the random seed to " << par.seed);
+    throw RINGER_EXCEPTION("The random seed should be >= 0");
+  }
+  if (par.nthreads <= 0) {
+    RINGER_DEBUG1("Trying to set the number of threads to " << par.nthreads);
+    throw RINGER_EXCEPTION("The number of threads should be > 0");
+  }
+  if (!par.prefix.size()) {
+    par.prefix = sys::stripname(par.db);
+    RINGER_DEBUG1("Setting network prefix to " << par.prefix);
+  }
+  RINGER_DEBUG1("Command line options have been validated.");
+  return true;
+}
+
+/**
+ * Trains and tests the network of a single fold.
+ */
+class FoldTask : public sys::Task {
+
+public:
+
+  /**
+   * Builds a new fold task. None of the parameters are copied.
+   *
+   * @param net The network to train for this fold
+   * @param input The merged database
+   * @param target The merged targets
+   * @param kfold The fold definitions
+   * @param fold The fold this task takes care of
+   * @param par The program parameters
+   */
+  FoldTask (network::Network* net, const data::RoIPatternSet& input,
+	    const data::RoIPatternSet& target, const data::KFold& kfold,
+	    const size_t fold, const param_t& par)
+    : mse(0), sp(0), eff1(0), eff2(0), thres(0), error(),
+      m_net(net), m_input(input), m_target(target), m_kfold(kfold),
+      m_fold(fold), m_par(par), m_rnd(data::RandomInteger().stream(fold)) {}
+
+  /**
+   * Trains the network with a class-balanced sampling of the training
+   * positions and evaluates it on the testing positions. Every epoch is
+   * sampled from its own stream of the fold generator, so the results do
+   * not depend on how the folds are scheduled.
+   */
+  virtual void run (void)
+  {
+    try {
+      data::BalancedSampler sampler = m_kfold.sampler(m_fold);
+      std::vector<size_t> pats(m_par.epoch);
+      for (long int i=0; i<m_par.nepochs; ++i) {
+	sampler.draw(pats, m_rnd.stream(i));
+	m_net->train(m_input.simple(), m_target.simple(), pats);
+      }
+      m_kfold.test(m_fold, pats);
+      data::SimplePatternSet test(m_input.simple(), pats);
+      data::SimplePatternSet test_target(m_target.simple(), pats);
+      data::SimplePatternSet output(test_target);
+      m_net->run(test, output);
+      mse = data::mse(output, test_target);
+      if (m_target.pattern_size() == 1)
+	sp = data::sp(output, test_target, eff1, eff2, thres);
+    }
+    catch (const sys::Exception& ex) {
+      error = ex.what();
+    }
+    catch (const std::exception& ex) {
+      error = ex.what();
+    }
+  }
+
+public: //results
+
+  double mse; ///< the test MSE
+  double sp; ///< the test SP product, for 2 classes
+  double eff1; ///< the test efficiency for the first class
+  double eff2; ///< the test efficiency for the second class
+  double thres; ///< the threshold for the best SP
+  std::string error; ///< what went wrong, if anything
+
+private: //representation
+
+  network::Network* m_net; ///< the network to train
+  const data::RoIPatternSet& m_input; ///< the merged database
+  const data::RoIPatternSet& m_target; ///< the merged targets
+  const data::KFold& m_kfold; ///< the fold definitions
+  size_t m_fold; ///< my fold
+  const param_t& m_par; ///< the program parameters
+  data::RandomInteger m_rnd; ///< my generator, a stream of the process seed
+
+};
+
+int main (int argc, char** argv)
+{
+  sys::Reporter *reporter = new sys::LocalReporter();
+
+  param_t par = { "", "", 10, 4, 50, 1000, 1, 0, true };
+  sys::OptParser opt_parser(argv[0]);
+  opt_parser.add_option
+    ("hard-stop", 'b', par.nepochs,
+     "number of epochs to train the network of each fold");
+  opt_parser.add_option
+    ("epoch", 'c', par.epoch,
+     "how many entries per training step should I use");
+  opt_parser.add_option
+    ("db", 'd', par.db,
+     "location of the database to use for cross-validation (XML or binary)");
+  opt_parser.add_option
+    ("folds", 'k', par.nfolds,
+     "the number of folds to split the database in");
+  opt_parser.add_option
+    ("prefix", 'p', par.prefix,
+     "the prefix of the network file saved for each fold");
+  opt_parser.add_option
+    ("hidden", 'r', par.nhidden,
+     "how many hidden neurons should I use for the network");
+  opt_parser.add_option
+    ("seed", 's', par.seed,
+     "the random seed, so results can be reproduced (default: the time)");
+  opt_parser.add_option
+    ("threads", 't', par.nthreads,
+     "how many folds should be trained at the same time");
+  opt_parser.add_option
+    ("compress-output", 'z', par.compress,
+     "should compress the output, e.g. 2 classes -> 1 output for the network");
+  opt_parser.parse(argc, argv);
+
+  try {
+    if (!checkopt(par, reporter))
+      RINGER_FATAL(reporter, "Terminating execution.");
+  }
+  catch (sys::Exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter, "I can't handle that exception. Aborting.");
+  }
+  if (par.seed) data::RandomInteger::set_seed(par.seed);
+  RINGER_REPORT(reporter, "Using random seed " << data::RandomInteger::seed()
+		<< ".");
+
+  //loads the DB, a binary database is mapped and read in place
+  data::Database<data::RoIPatternSet>* dbfile =
+    data::open_database<data::RoIPatternSet>(par.db, reporter);
+  data::Database<data::RoIPatternSet>& db = *dbfile;
+  std::vector<std::string> cnames;
+  db.class_names(cnames);
+
+  //checks db size
+  if (db.size() < 2) {
+    RINGER_FATAL(reporter, "The database you loaded contains only 1 class of"
+		 " events. Please, reconsider your input file.");
+  }
+
+  std::vector<network::Network*> net;
+  std::vector<FoldTask*> task;
+  try {
+    data::RoIPatternSet input_buffer(1, 1);
+    const data::RoIPatternSet& input = data::merged(db, input_buffer);
+    data::RoIPatternSet target(1, 1);
+    db.merge_target(par.compress, -1, +1, target);
+    data::KFold kfold(db, par.nfolds);
+    RINGER_REPORT(reporter, "Cross-validating " << input.size()
+		  << " patterns in " << kfold.folds() << " folds.");
+
+    //networks are built one after the other, because the neuron identifier
+    //generator is shared
+    std::vector<size_t> hlayer(1, par.nhidden);
+    config::NeuronStrategyType nstrat = config::NEURON_BACKPROP;
+    config::NeuronBackProp::ActivationFunction actfun =
+      config::NeuronBackProp::TANH;
+    config::Parameter* nsparam = new config::NeuronBackProp(actfun);
+    config::SynapseStrategyType sstrat = config::SYNAPSE_RPROP;
+    config::Parameter* ssparam = new config::SynapseRProp(0.1);
+    std::vector<bool> biaslayer(2, true);
+    unsigned int nout = db.size();
+    if (par.compress) nout = lrint(std::ceil(log2(db.size())));
+    for (size_t f=0; f<kfold.folds(); ++f) {
+      //normalisation only sees the training part of the fold
+      std::vector<double> w;
+      kfold.sampler(f).weights(w);
+      data::NormalizationOperator norm_op(input, w);
+      net.push_back(new network::MLP(db.pattern_size(), hlayer, nout,
+				     biaslayer, nstrat, nsparam, nstrat,
+				     nsparam, sstrat, ssparam,
+				     norm_op.mean(), norm_op.stddev(),
+				     reporter));
+      task.push_back(new FoldTask(net[f], input, target, kfold, f, par));
+    }
+    delete nsparam;
+    delete ssparam;
+
+    {
+      sys::ThreadPool pool(par.nthreads);
+      for (size_t f=0; f<task.size(); ++f) pool.submit(task[f]);
+      pool.wait();
+    }
+
+    double mse_sum = 0;
+    double sp_sum = 0;
+    size_t good = 0;
+    for (size_t f=0; f<task.size(); ++f) {
+      if (task[f]->error.size()) {
+	RINGER_WARN(reporter, "Fold " << f << " failed: " << task[f]->error);
+	continue;
+      }
+      std::ostringstream oss;
+      oss << par.prefix << ".fold" << f << ".xml";
+      config::Header header("Andre DOS ANJOS", oss.str(), "1.0", time(0),
+			    "Cross-validated network");
+      net[f]->save(oss.str(), &header);
+      if (db.size() == 2 && par.compress) {
+	RINGER_REPORT(reporter, "[fold " << f << "] MSE = " << task[f]->mse
+		      << ", SP = " << task[f]->sp << " (for threshold="
+		      << task[f]->thres << " -> " << cnames[0] << " eff="
+		      << task[f]->eff1*100 << "% and " << cnames[1] << " eff="
+		      << task[f]->eff2*100 << "%)");
+      }
+      else RINGER_REPORT(reporter, "[fold " << f << "] MSE = "
+			 << task[f]->mse);
+      mse_sum += task[f]->mse;
+      sp_sum += task[f]->sp;
+      ++good;
+    }
+    if (good) {
+      RINGER_REPORT(reporter, "Average test MSE over " << good << " folds = "
+		    << mse_sum/good);
+      if (db.size() == 2 && par.compress)
+	RINGER_REPORT(reporter, "Average test SP over " << good
+		      << " folds = " << sp_sum/good);
+    }
+  }
+  catch (const sys::Exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter,
+		 "This was a top-level catch for a RINGER exception, "
+	       << "I have to exit, bye.");
+  }
+  catch (const std::exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter, "This was a top-level catch for a std exception, "
+	       << "I have to exit, bye.");
+  }
+  catch (...) {
+    RINGER_FATAL(reporter,
+		 "This was a top-level catch for a unknown exception, "
+		 << "I have to exit, bye.");
+  }
+
+  for (size_t f=0; f<task.size(); ++f) delete task[f];
+  for (size_t f=0; f<net.size(); ++f) delete net[f];
+  delete dbfile;
+  delete reporter;
+}
@@ -0,0 +1,221 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file mlp-quantise.cxx
+ *
+ * Exports a trained neural network as a fixed-point network, with 8 or 16
+ * bit weights, and reports how much its discrimination changes on a
+ * validation database.
+ */
+
+#include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/data/Database.h"
+#include "TrigRingerTools/data/DatabaseXml.h"
+#include "TrigRingerTools/data/util.h"
+#include "TrigRingerTools/network/CompiledNetwork.h"
+#include "TrigRingerTools/network/QuantisedNetwork.h"
+#include "TrigRingerTools/sys/LocalReporter.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/util.h"
+#include "TrigRingerTools/sys/OptParser.h"
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <sstream>
+
+typedef struct param_t {
+  std::string db; ///< database to use for validation
+  std::string calibration; ///< database to choose the input scale from
+  std::string net; ///< name of the neural net file
+  std::string output; ///< where to save the quantised network
+  long int bits; ///< how many bits the weights and values have
+} param_t;
+
+/**
+ * Checks and validates program options.
+ *
+ * @param p The parameters, already parsed
+ * @param reporter The reporter to use when reporting problems to the user
+ */
+bool checkopt (param_t& par, sys::Reporter* reporter)
+{
+  if (!par.db.size()) {
+    RINGER_DEBUG1("No DB file given! Throwing...");
+    throw RINGER_EXCEPTION("Database file not given.");
+  }
+  if (!sys::exists(par.db)) {
+    RINGER_DEBUG1("Database file " << par.db << " doesn't exist.");
+    throw RINGER_EXCEPTION("Database file doesn't exist");
+  }
+  if (par.calibration.size() && !sys::exists(par.calibration)) {
+    RINGER_DEBUG1("Database file " << par.calibration << " doesn't exist.");
+    throw RINGER_EXCEPTION("Calibration database file doesn't exist");
+  }
+  if (!par.net.size()) {
+    RINGER_DEBUG1("I cannot work without a network file. Exception thrown.");
+    throw RINGER_EXCEPTION("No network file specified");
+  }
+  if (par.bits != 8 && par.bits != 16) {
+    RINGER_DEBUG1("Trying to quantise to " << par.bits << " bits.");
+    throw RINGER_EXCEPTION("The number of bits should be 8 or 16");
+  }
+  if (!par.output.size()) {
+    std::ostringstream oss;
+    oss << sys::stripname(par.net) << ".q" << par.bits << ".bin";
+    par.output = oss.str();
+    RINGER_DEBUG1("Setting output file name to " << par.output);
+  }
+  RINGER_DEBUG1("Command line options have been validated.");
+  return true;
+}
+
+/**
+ * The figures of merit of a network on the validation database
+ */
+typedef struct merit_t {
+  double mse; ///< the mean square error
+  double sp; ///< the SP product, for 2 classes
+  double eff1; ///< the efficiency for the first class
+  double eff2; ///< the efficiency for the second class
+  double thres; ///< the threshold for the above
+} merit_t;
+
+/**
+ * Evaluates the outputs of a network against their targets.
+ *
+ * @param output The network outputs
+ * @param target The targets
+ * @param classify If the SP product should be computed
+ */
+merit_t evaluate (const data::SimplePatternSet& output,
+		  const data::SimplePatternSet& target, bool classify)
+{
+  merit_t m = { 0, 0, 0, 0, 0 };
+  m.mse = data::mse(output, target);
+  if (classify) m.sp = data::sp(output, target, m.eff1, m.eff2, m.thres);
+  return m;
+}
+
+int main (int argc, char** argv)
+{
+  sys::Reporter *reporter = new sys::LocalReporter();
+
+  param_t par = { "", "", "", "", 16 };
+  sys::OptParser opt_parser(argv[0]);
+  opt_parser.add_option
+    ("bits", 'b', par.bits,
+     "how many bits the weights and neuron values should have (8 or 16)");
+  opt_parser.add_option
+    ("calibration", 'c', par.calibration,
+     "database to choose the input scale from (default: the validation db)");
+  opt_parser.add_option
+    ("db", 'd', par.db,
+     "location of the database to validate the quantised network with");
+  opt_parser.add_option
+    ("net", 'n', par.net,
+     "where to read the trained network");
+  opt_parser.add_option
+    ("output", 'o', par.output,
+     "where to write the quantised network (default: net-name.q<bits>.bin)");
+  opt_parser.parse(argc, argv);
+
+  try {
+    if (!checkopt(par, reporter))
+      RINGER_FATAL(reporter, "Terminating execution.");
+  }
+  catch (sys::Exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter, "I can't handle that exception. Aborting.");
+  }
+
+  try {
+    //loads the DB
+    data::DatabaseXml<data::RoIPatternSet> db(par.db, reporter);
+    std::vector<std::string> cnames;
+    db.class_names(cnames);
+    data::RoIPatternSet input(1, 1);
+    db.merge(input);
+
+    //loads the Network
+    network::CompiledNetwork net(par.net, reporter);
+    data::RoIPatternSet target(1, 1);
+    db.merge_target(net.output_size() < db.size(), -1, +1, target);
+    const bool classify = (db.size() == 2 && net.output_size() == 1);
+
+    //quantises it
+    network::QuantisedNetwork* qnet = 0;
+    if (par.calibration.size()) {
+      data::DatabaseXml<data::RoIPatternSet> cdb(par.calibration, reporter);
+      data::RoIPatternSet calibration(1, 1);
+      cdb.merge(calibration);
+      qnet = new network::QuantisedNetwork(net, par.bits,
+					   calibration.simple());
+    }
+    else qnet = new network::QuantisedNetwork(net, par.bits, input.simple());
+    RINGER_REPORT(reporter, "Quantised network to " << par.bits
+		  << " bits, one unit of the normalised inputs is "
+		  << qnet->input_scale() << ".");
+    if (!qnet->save(par.output)) {
+      delete qnet;
+      throw RINGER_EXCEPTION("Cannot save quantised network");
+    }
+    RINGER_REPORT(reporter, "Quantised network saved to \"" << par.output
+		  << "\".");
+
+    //compares both networks on the validation data
+    data::SimplePatternSet foutput(input.size(), net.output_size());
+    net.run(input.simple(), foutput);
+    data::SimplePatternSet qoutput(input.size(), qnet->output_size());
+    qnet->run(input.simple(), qoutput);
+    delete qnet;
+    merit_t fmerit = evaluate(foutput, target.simple(), classify);
+    merit_t qmerit = evaluate(qoutput, target.simple(), classify);
+    RINGER_REPORT(reporter, "Float network: MSE = " << fmerit.mse);
+    RINGER_REPORT(reporter, par.bits << "-bit network: MSE = "
+		  << qmerit.mse);
+    if (classify) {
+      RINGER_REPORT(reporter, "Float network: SP = " << fmerit.sp
+		    << " (for threshold=" << fmerit.thres << " -> "
+		    << cnames[0] << " eff=" << fmerit.eff1*100 << "% and "
+		    << cnames[1] << " eff=" << fmerit.eff2*100 << "%)");
+      RINGER_REPORT(reporter, par.bits << "-bit network: SP = " << qmerit.sp
+		    << " (for threshold=" << qmerit.thres << " -> "
+		    << cnames[0] << " eff=" << qmerit.eff1*100 << "% and "
+		    << cnames[1] << " eff=" << qmerit.eff2*100 << "%)");
+      RINGER_REPORT(reporter, "SP changed by " << qmerit.sp - fmerit.sp
+		    << ", " << cnames[0] << " eff by "
+		    << (qmerit.eff1 - fmerit.eff1)*100 << "% and "
+		    << cnames[1] << " eff by "
+		    << (qmerit.eff2 - fmerit.eff2)*100 << "%.");
+    }
+    double largest = 0;
+    for (size_t i=0; i<foutput.size(); ++i) {
+      const data::Pattern f = foutput.pattern(i);
+      const data::Pattern q = qoutput.pattern(i);
+      for (size_t j=0; j<f.size(); ++j)
+	if (std::fabs(q[j] - f[j]) > largest) largest = std::fabs(q[j] - f[j]);
+    }
+    RINGER_REPORT(reporter, "Outputs differ by " << data::mae(qoutput, foutput)
+		  << " on average and by at most " << largest << ".");
+  }
+  catch (const sys::Exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter,
+		 "This was a top-level catch for a RINGER exception, "
+	       << "I have to exit, bye.");
+  }
+  catch (const std::exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter, "This was a top-level catch for a std exception, "
+	       << "I have to exit, bye.");
+  }
+  catch (...) {
+    RINGER_FATAL(reporter,
+		 "This was a top-level catch for a unknown exception, "
+		 << "I have to exit, bye.");
+  }
+
+  delete reporter;
+}
@@ -43,7 +43,7 @@ typedef struct param_t {
   std::string traindb; ///< database to use for training
   std::string testdb; ///< database to use for testing
   std::string out; ///< where to save the test set relevance
-  data::Feature trainperc; ///< default amount of data to use for tranining
+  double trainperc; ///< default amount of data to use for tranining
   std::string net; ///< the network file
 } param_t;
 
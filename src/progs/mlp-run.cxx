@@ -10,7 +10,7 @@
 #include "TrigRingerTools/data/Database.h"
 #include "TrigRingerTools/data/DatabaseXml.h"
 #include "TrigRingerTools/data/util.h"
-#include "TrigRingerTools/network/MLP.h"
+#include "TrigRingerTools/network/CompiledNetwork.h"
 #include "TrigRingerTools/sys/LocalReporter.h"
 #include "TrigRingerTools/sys/Exception.h"
 #include "TrigRingerTools/sys/debug.h"
@@ -136,7 +136,7 @@ int main (int argc, char** argv)
 
   //loads the Network
   RINGER_REPORT(reporter, "Loading network \"" << par.net << "\"...");
-  network::Network net(par.net, reporter);
+  network::CompiledNetwork net(par.net, reporter);
   
   try {
     std::map<std::string, data::RoIPatternSet*> outdb_data;
@@ -161,7 +161,11 @@ int main (int argc, char** argv)
 			comment.str());
     data::DatabaseXml<data::RoIPatternSet> 
       output_db(&header, outdb_data, reporter);
-    output_db.save(par.output);
+    if (!output_db.save(par.output)) {
+      RINGER_DEBUG1("Could not save \"" << par.output << "\"."
+		    << " Exception thrown.");
+      throw RINGER_EXCEPTION("Could not save the network outputs");
+    }
     RINGER_REPORT(reporter, "All network outputs were saved to \"" 
 		  << par.output << "\".");
     //print summary:
@@ -0,0 +1,458 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file mlp-sweep.cxx
+ *
+ * Trains MLP's for a grid of configurations (hidden neurons, epoch sizes and
+ * random seeds) on the same databases and reports the best one. The
+ * databases are loaded and normalised once, then shared, read-only, by all
+ * trainings, which run concurrently on a pool of threads.
+ */
+
+#include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/data/Database.h"
+#include "TrigRingerTools/data/DatabaseFile.h"
+#include "TrigRingerTools/data/NormalizationOperator.h"
+#include "TrigRingerTools/data/BalancedSampler.h"
+#include "TrigRingerTools/data/RandomInteger.h"
+#include "TrigRingerTools/data/util.h"
+#include "TrigRingerTools/network/MLP.h"
+#include "TrigRingerTools/network/BatchTrainer.h"
+#include "TrigRingerTools/sys/LocalReporter.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+#include "TrigRingerTools/sys/util.h"
+#include "TrigRingerTools/sys/OptParser.h"
+#include "TrigRingerTools/sys/ThreadPool.h"
+#include "TrigRingerTools/config/Network.h"
+#include "TrigRingerTools/config/NeuronBackProp.h"
+#include "TrigRingerTools/config/SynapseRProp.h"
+#include "TrigRingerTools/config/type.h"
+#include "TrigRingerTools/config/Header.h"
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <sstream>
+
+typedef struct param_t {
+  std::string traindb; ///< database to use for training
+  std::string testdb; ///< database to use for testing
+  std::string bestnet; ///< name of the best neural net file
+  std::vector<std::string> hidden; ///< numbers of hidden neurons to try
+  std::vector<std::string> epoch; ///< epoch sizes to try
+  std::vector<std::string> seed; ///< random seeds to try
+  bool msestop; ///< use MSE product stop criteria instead of SP stabilisation
+  bool compress; ///< if I should use compressed or extended output
+  long int stopiter; ///< number of iterations w/o variance to stop
+  double stopthres; ///< the threshold to consider for stopping
+  long int sample; ///< the sample interval for MSE or SP
+  long int hardstop; ///< where to hard stop the training
+  long int nthreads; ///< number of networks to train at the same time
+} param_t;
+
+/**
+ * Converts a list of strings from the command line into positive integers.
+ *
+ * @param list The strings to convert
+ * @param what What the list is about, for error messages
+ * @param value Where to put the integers
+ */
+void positive (const std::vector<std::string>& list, const std::string& what,
+	       std::vector<long int>& value)
+{
+  value.clear();
+  for (size_t i=0; i<list.size(); ++i) {
+    char* end = 0;
+    long int v = std::strtol(list[i].c_str(), &end, 10);
+    if (*end || v <= 0) {
+      RINGER_DEBUG1("\"" << list[i] << "\" is not a valid " << what
+		    << ". Exception thrown.");
+      throw RINGER_EXCEPTION("Sweep values should be integers > 0, \""
+			     + list[i] + "\" is not a valid " + what);
+    }
+    value.push_back(v);
+  }
+  if (value.empty()) {
+    RINGER_DEBUG1("No " << what << " to sweep. Exception thrown.");
+    throw RINGER_EXCEPTION("No " + what + " to sweep");
+  }
+}
+
+/**
+ * Checks and validates program options.
+ *
+ * @param p The parameters, already parsed
+ */
+bool checkopt (param_t& par)
+{
+  if (!par.traindb.size()) {
+    RINGER_DEBUG1("No train DB file given! Throwing...");
+    throw RINGER_EXCEPTION("Train Database file not given.");
+  }
+  if (!par.testdb.size()) {
+    RINGER_DEBUG1("No test DB file given! Throwing...");
+    throw RINGER_EXCEPTION("Test Database file not given.");
+  }
+  if (!sys::exists(par.traindb)) {
+    RINGER_DEBUG1("Train Database file " << par.traindb << " doesn't exist.");
+    throw RINGER_EXCEPTION("Train Database file doesn't exist");
+  }
+  if (!sys::exists(par.testdb)) {
+    RINGER_DEBUG1("Test Database file " << par.testdb << " doesn't exist.");
+    throw RINGER_EXCEPTION("Test Database file doesn't exist");
+  }
+  if (par.sample <= 0) {
+    RINGER_DEBUG1("Trying to set the sampling interval to " << par.sample);
+    throw RINGER_EXCEPTION("The sampling interval should be > 0");
+  }
+  if (par.stopthres <= 0) {
+    RINGER_DEBUG1("I cannot use a stop threshold less than zero");
+    throw RINGER_EXCEPTION("Stop threshold is less than zero");
+  }
+  if (par.stopiter <= 0) {
+    RINGER_DEBUG1("I cannot wait " << par.stopiter << " cycles to stop.");
+    throw RINGER_EXCEPTION("Cycles to stop should be > 0");
+  }
+  if (par.hardstop <= 0) {
+    RINGER_DEBUG1("I cannot work with an unbound network training."
+		  << " Please provide me a hardstop.");
+    throw RINGER_EXCEPTION("No hardstop parameter specified.");
+  }
+  if (par.nthreads <= 0) {
+    RINGER_DEBUG1("Trying to set the number of threads to " << par.nthreads);
+    throw RINGER_EXCEPTION("The number of threads should be > 0");
+  }
+  if (!par.bestnet.size()) {
+    par.bestnet = sys::stripname(par.traindb) + ".sweep.xml";
+    RINGER_DEBUG1("Setting best net file name to " << par.bestnet);
+  }
+  RINGER_DEBUG1("Command line options have been validated.");
+  return true;
+}
+
+/**
+ * Trains and tests the network of a single configuration.
+ */
+class SweepTask : public sys::Task {
+
+public:
+
+  /**
+   * Builds a new sweep task. None of the parameters are copied.
+   *
+   * @param net The network to train for this configuration
+   * @param train The merged training database
+   * @param target The merged training targets
+   * @param test The merged testing database
+   * @param test_target The merged testing targets
+   * @param sampler The class-balanced sampler of the training database, which
+   * is copied, so concurrent tasks do not share it
+   * @param epoch How many patterns to train with at each epoch
+   * @param seed The random seed of this configuration
+   * @param par The program parameters
+   */
+  SweepTask (network::BatchTrainer* net, const data::RoIPatternSet& train,
+	     const data::RoIPatternSet& target, const data::RoIPatternSet& test,
+	     const data::RoIPatternSet& test_target,
+	     const data::BalancedSampler& sampler, const long int epoch,
+	     const long int seed, const param_t& par)
+    : best(0), epochs(0), mse(0), sp(0), eff1(0), eff2(0), thres(0),
+      neurons(), synapses(), error(),
+      m_net(net), m_train(train), m_target(target), m_test(test),
+      m_test_target(test_target), m_sampler(sampler), m_epoch(epoch),
+      m_par(par), m_rnd(data::RandomInteger(seed).stream(0)) {}
+
+  /**
+   * Trains the network like mlp-train does, until the test SP (or MSE)
+   * stabilises or the hard stop is reached, and keeps the state of the
+   * network when it was at its best. Every epoch is sampled from its own
+   * stream of the configuration seed, so configurations with the same seed
+   * see the same sequence of patterns.
+   */
+  virtual void run (void)
+  {
+    try {
+      std::vector<size_t> pats(m_epoch);
+      data::SimplePatternSet output(m_test_target.simple());
+      const bool classify = (m_test_target.pattern_size() == 1);
+      long int stopnow = m_par.stopiter;
+      double val = 1;
+      double prev = 0;
+      bool first = true;
+      for (long int i=0; stopnow && i<m_par.hardstop; ++i) {
+	m_sampler.draw(pats, m_rnd.stream(i));
+	m_net->train(m_train.simple(), m_target.simple(), pats);
+	epochs = i+1;
+	if (i%m_par.sample) continue;
+	m_net->run(m_test.simple(), output);
+	double e1 = 0, e2 = 0, th = 0, sp_val = 0;
+	if (classify) sp_val = data::sp(output, m_test_target, e1, e2, th);
+	double mse_val = data::mse(output, m_test_target.simple());
+	prev = val;
+	val = m_par.msestop? mse_val : sp_val;
+	double var = std::fabs(val-prev)/prev;
+	bool better = m_par.msestop? (val < mse) : (val > sp);
+	if (first || better) {
+	  first = false;
+	  best = i;
+	  mse = mse_val;
+	  sp = sp_val;
+	  eff1 = e1;
+	  eff2 = e2;
+	  thres = th;
+	  m_net->dump(neurons, synapses);
+	}
+	if (var < m_par.stopthres) --stopnow;
+	else stopnow = m_par.stopiter;
+      }
+    }
+    catch (const sys::Exception& ex) {
+      error = ex.what();
+    }
+    catch (const std::exception& ex) {
+      error = ex.what();
+    }
+  }
+
+public: //results
+
+  long int best; ///< the epoch of the best test result
+  long int epochs; ///< how many epochs were trained
+  double mse; ///< the best test MSE, or the test MSE at the best SP
+  double sp; ///< the best test SP product, for 2 classes
+  double eff1; ///< the test efficiency for the first class
+  double eff2; ///< the test efficiency for the second class
+  double thres; ///< the threshold for the best SP
+  std::vector<config::Neuron> neurons; ///< the best network neurons
+  std::vector<config::Synapse> synapses; ///< the best network synapses
+  std::string error; ///< what went wrong, if anything
+
+private: //representation
+
+  network::BatchTrainer* m_net; ///< the network to train
+  const data::RoIPatternSet& m_train; ///< the merged training database
+  const data::RoIPatternSet& m_target; ///< the merged training targets
+  const data::RoIPatternSet& m_test; ///< the merged testing database
+  const data::RoIPatternSet& m_test_target; ///< the merged testing targets
+  data::BalancedSampler m_sampler; ///< my own copy of the training sampler
+  long int m_epoch; ///< the epoch size
+  const param_t& m_par; ///< the program parameters
+  data::RandomInteger m_rnd; ///< my generator, from my seed
+
+};
+
+int main (int argc, char** argv)
+{
+  sys::Reporter *reporter = new sys::LocalReporter();
+
+  param_t par = { "", "", "", std::vector<std::string>(1, "4"),
+		  std::vector<std::string>(1, "50"), std::vector<std::string>(),
+		  false, true, 50, 0.001, 10, 10000, 1 };
+  sys::OptParser opt_parser(argv[0]);
+  opt_parser.add_option
+    ("hard-stop", 'b', par.hardstop,
+     "number of epochs after which to hard stop each training session");
+  opt_parser.add_option
+    ("epoch", 'c', par.epoch,
+     "the numbers of entries per training step to try");
+  opt_parser.add_option
+    ("traindb", 'd', par.traindb,
+     "location of the database to use for training (XML or binary)");
+  opt_parser.add_option
+    ("threads", 'f', par.nthreads,
+     "how many networks should be trained at the same time");
+  opt_parser.add_option
+    ("best-net", 'g', par.bestnet,
+     "where to write the best network of the sweep");
+  opt_parser.add_option
+    ("stop-iteration", 'i', par.stopiter,
+     "how many times to wait for non-variation to be considered a stop sign");
+  opt_parser.add_option
+    ("sample-interval", 'n', par.sample,
+     "when to sample the training process for the MSE or SP");
+  opt_parser.add_option
+    ("hidden", 'r', par.hidden,
+     "the numbers of hidden neurons to try");
+  opt_parser.add_option
+    ("seed", 's', par.seed,
+     "the random seeds to try (default: one seed, from the time)");
+  opt_parser.add_option
+    ("mse-stop", 't', par.msestop,
+     "if I should use MSE stop criteria instead of SP (default)");
+  opt_parser.add_option
+    ("testdb", 'u', par.testdb,
+     "location of the database to use for testing (XML or binary)");
+  opt_parser.add_option
+    ("stop-threshold", 'w', par.stopthres,
+     "the stop threshold to consider for flagging a potential stop");
+  opt_parser.add_option
+    ("compress-output", 'z', par.compress,
+     "should compress the output, e.g. 2 classes -> 1 output for the network");
+  opt_parser.parse(argc, argv);
+
+  std::vector<long int> hidden;
+  std::vector<long int> epoch;
+  std::vector<long int> seed;
+  try {
+    if (!checkopt(par))
+      RINGER_FATAL(reporter, "Terminating execution.");
+    if (par.seed.empty()) {
+      std::ostringstream oss;
+      oss << data::RandomInteger::seed();
+      par.seed.push_back(oss.str());
+    }
+    positive(par.hidden, "number of hidden neurons", hidden);
+    positive(par.epoch, "epoch size", epoch);
+    positive(par.seed, "random seed", seed);
+  }
+  catch (sys::Exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter, "I can't handle that exception. Aborting.");
+  }
+
+  //loads the DB's, once for all configurations. Binary databases are
+  //mapped and read in place.
+  data::Database<data::RoIPatternSet>* trainfile =
+    data::open_database<data::RoIPatternSet>(par.traindb, reporter);
+  data::Database<data::RoIPatternSet>& traindb = *trainfile;
+  data::Database<data::RoIPatternSet>* testfile =
+    data::open_database<data::RoIPatternSet>(par.testdb, reporter);
+  data::Database<data::RoIPatternSet>& testdb = *testfile;
+  std::vector<std::string> cnames;
+  traindb.class_names(cnames);
+
+  //checks db size
+  if (traindb.size() < 2) {
+    RINGER_FATAL(reporter, "The database you loaded contains only 1 class of"
+		 " events. Please, reconsider your input file.");
+  }
+  if (traindb.size() > 2 && !par.msestop) {
+    RINGER_FATAL(reporter, "I cannot use the SP product with in a multi"
+		 "-class scenario. Please, either re-program me or reconsider"
+		 " your options.");
+  }
+
+  std::vector<network::BatchTrainer*> net;
+  std::vector<SweepTask*> task;
+  std::vector<std::string> label;
+  try {
+    data::NormalizationOperator norm_op(traindb, true, par.nthreads);
+    data::BalancedSampler sampler(traindb);
+    data::RoIPatternSet train_buffer(1, 1);
+    const data::RoIPatternSet& train = data::merged(traindb, train_buffer);
+    data::RoIPatternSet target(1, 1);
+    traindb.merge_target(par.compress, -1, +1, target);
+    data::RoIPatternSet test_buffer(1, 1);
+    const data::RoIPatternSet& test = data::merged(testdb, test_buffer);
+    data::RoIPatternSet test_target(1, 1);
+    testdb.merge_target(par.compress, -1, +1, test_target);
+
+    //networks are built one after the other, because the neuron identifier
+    //generator is shared. The initial weights only depend on the seed.
+    config::NeuronStrategyType nstrat = config::NEURON_BACKPROP;
+    config::NeuronBackProp::ActivationFunction actfun =
+      config::NeuronBackProp::TANH;
+    config::Parameter* nsparam = new config::NeuronBackProp(actfun);
+    config::SynapseStrategyType sstrat = config::SYNAPSE_RPROP;
+    config::Parameter* ssparam = new config::SynapseRProp(0.1);
+    std::vector<bool> biaslayer(2, true);
+    unsigned int nout = traindb.size();
+    if (par.compress) nout = lrint(std::ceil(log2(traindb.size())));
+    for (size_t h=0; h<hidden.size(); ++h)
+      for (size_t e=0; e<epoch.size(); ++e)
+	for (size_t s=0; s<seed.size(); ++s) {
+	  data::RandomInteger::set_seed(seed[s]);
+	  std::vector<size_t> hlayer(1, hidden[h]);
+	  network::MLP mlp(traindb.pattern_size(), hlayer, nout,
+			   biaslayer, nstrat, nsparam, nstrat, nsparam,
+			   sstrat, ssparam, norm_op.mean(), norm_op.stddev(),
+			   reporter);
+	  net.push_back(new network::BatchTrainer(mlp, reporter));
+	  task.push_back(new SweepTask(net.back(), train, target, test,
+				       test_target, sampler, epoch[e],
+				       seed[s], par));
+	  std::ostringstream oss;
+	  oss << "hidden=" << hidden[h] << " epoch=" << epoch[e]
+	      << " seed=" << seed[s];
+	  label.push_back(oss.str());
+	}
+    delete nsparam;
+    delete ssparam;
+    RINGER_REPORT(reporter, "Training " << task.size() << " configurations"
+		  << " on " << par.nthreads << " thread(s).");
+
+    {
+      sys::ThreadPool pool(par.nthreads);
+      for (size_t k=0; k<task.size(); ++k) pool.submit(task[k]);
+      pool.wait();
+    }
+
+    size_t winner = task.size();
+    for (size_t k=0; k<task.size(); ++k) {
+      if (task[k]->error.size()) {
+	RINGER_WARN(reporter, "[" << label[k] << "] failed: "
+		    << task[k]->error);
+	continue;
+      }
+      if (!par.msestop) {
+	RINGER_REPORT(reporter, "[" << label[k] << "] SP = " << task[k]->sp
+		      << " at epoch " << task[k]->best << "/"
+		      << task[k]->epochs << " (for threshold="
+		      << task[k]->thres << " -> " << cnames[0] << " eff="
+		      << task[k]->eff1*100 << "% and " << cnames[1] << " eff="
+		      << task[k]->eff2*100 << "%), MSE = " << task[k]->mse);
+      }
+      else RINGER_REPORT(reporter, "[" << label[k] << "] MSE = "
+			 << task[k]->mse << " at epoch " << task[k]->best
+			 << "/" << task[k]->epochs);
+      if (winner == task.size() ||
+	  (par.msestop && task[k]->mse < task[winner]->mse) ||
+	  (!par.msestop && task[k]->sp > task[winner]->sp)) winner = k;
+    }
+    if (winner == task.size())
+      throw RINGER_EXCEPTION("All configurations failed");
+
+    if (!par.msestop) {
+      RINGER_REPORT(reporter, "Best configuration is " << label[winner]
+		    << ", with SP = " << task[winner]->sp);
+    }
+    else RINGER_REPORT(reporter, "Best configuration is " << label[winner]
+		       << ", with MSE = " << task[winner]->mse);
+    std::vector<config::Neuron*> neurons;
+    for (size_t i=0; i<task[winner]->neurons.size(); ++i)
+      neurons.push_back(&task[winner]->neurons[i]);
+    std::vector<config::Synapse*> synapses;
+    for (size_t i=0; i<task[winner]->synapses.size(); ++i)
+      synapses.push_back(&task[winner]->synapses[i]);
+    config::Header header("Andre DOS ANJOS", par.bestnet, "1.0", time(0),
+			  "Best network of sweep, " + label[winner]);
+    config::Network best(&header, synapses, neurons, reporter);
+    if (!best.save(par.bestnet))
+      throw RINGER_EXCEPTION("Cannot save the best network");
+    RINGER_REPORT(reporter, "Best network saved to \"" << par.bestnet
+		  << "\".");
+  }
+  catch (const sys::Exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter,
+		 "This was a top-level catch for a RINGER exception, "
+	       << "I have to exit, bye.");
+  }
+  catch (const std::exception& ex) {
+    RINGER_EXCEPT(reporter, ex.what());
+    RINGER_FATAL(reporter, "This was a top-level catch for a std exception, "
+	       << "I have to exit, bye.");
+  }
+  catch (...) {
+    RINGER_FATAL(reporter,
+		 "This was a top-level catch for a unknown exception, "
+		 << "I have to exit, bye.");
+  }
+
+  for (size_t k=0; k<task.size(); ++k) delete task[k];
+  for (size_t k=0; k<net.size(); ++k) delete net[k];
+  delete testfile;
+  delete trainfile;
+  delete reporter;
+}
@@ -11,10 +11,15 @@
 #include "TrigRingerTools/data/RoIPatternSet.h"
 #include "TrigRingerTools/data/Database.h"
 #include "TrigRingerTools/data/DatabaseXml.h"
+#include "TrigRingerTools/data/DatabaseFile.h"
 #include "TrigRingerTools/data/NormalizationOperator.h"
+#include "TrigRingerTools/data/BalancedSampler.h"
 #include "TrigRingerTools/data/util.h"
 #include "TrigRingerTools/data/SumExtractor.h"
 #include "TrigRingerTools/network/MLP.h"
+#include "TrigRingerTools/network/BatchTrainer.h"
+#include "TrigRingerTools/network/SCGTrainer.h"
+#include "TrigRingerTools/network/AsyncEvaluator.h"
 #include "TrigRingerTools/sys/LocalReporter.h"
 #include "TrigRingerTools/sys/Exception.h"
 #include "TrigRingerTools/sys/debug.h"
@@ -39,6 +44,7 @@ typedef struct param_t {
   std::string bestnet; ///< name of the best neural net file
   std::string mseevo; ///< where to save the neural network MSE evolution
   std::string spevo; ///< where to save the neural network SP evolution
+  std::string roc; ///< where to save the ROC of the best network, test set
   std::string output; ///< where to save the last output after training
   std::string energy; ///< where to save the energies of the clusters
   long int nhidden; ///< number of hidden neurons
@@ -46,9 +52,11 @@ typedef struct param_t {
   bool msestop; ///< use MSE product stop criteria instead of SP stabilisation
   bool compress; ///< if I should use compressed or extended output 
   long int stopiter; ///< number of iterations w/o variance to stop
-  data::Feature stopthres; ///< the threshold to consider for stopping
+  double stopthres; ///< the threshold to consider for stopping
   long int sample; ///< the sample interval for MSE or SP
   long int hardstop; ///< where to hard stop the training
+  long int nthreads; ///< number of threads to train with
+  std::string trainer; ///< the training method, "rprop" or "scg"
 } param_t;
 
 /**
@@ -107,6 +115,10 @@ bool checkopt (param_t& par, sys::Reporter* reporter)
     par.spevo = sys::stripname(par.traindb) + ".sp.txt";
     RINGER_DEBUG1("Setting SP evolution file name to " << par.spevo);
   }
+  if (!par.roc.size()) {
+    par.roc = sys::stripname(par.traindb) + ".roc.txt";
+    RINGER_DEBUG1("Setting ROC file name to " << par.roc);
+  }
   if (!par.output.size()) {
     par.output = sys::stripname(par.traindb) + ".out.xml";
     RINGER_DEBUG1("Setting output file name to " << par.output);
@@ -125,6 +137,15 @@ bool checkopt (param_t& par, sys::Reporter* reporter)
 		  << " Please provide me a hardstop.");
     throw RINGER_EXCEPTION("No hardstop parameter specified.");
   }
+  if (par.nthreads <= 0) {
+    RINGER_DEBUG1("Trying to set the number of threads to " << par.nthreads);
+    throw RINGER_EXCEPTION("The number of threads should be > 0");
+  }
+  if (par.trainer != "rprop" && par.trainer != "scg") {
+    RINGER_DEBUG1("Unknown training method \"" << par.trainer
+		  << "\". Exception thrown.");
+    throw RINGER_EXCEPTION("The trainer should be \"rprop\" or \"scg\"");
+  }
   RINGER_DEBUG1("Command line options have been validated.");
   return true;
 }
@@ -133,24 +154,25 @@ int main (int argc, char** argv)
 {
   sys::Reporter *reporter = new sys::LocalReporter();
 
-  param_t par = { "", "", "", "", "", "", "", "", "",
-                  4, 50, false, true, 50, 0.001, 10, 10000 };
+  param_t par = { "", "", "", "", "", "", "", "", "", "",
+                  4, 50, false, true, 50, 0.001, 10, 10000, 1, "rprop" };
   sys::OptParser opt_parser(argv[0]);
   opt_parser.add_option
     ("hard-stop", 'b', par.hardstop,
      "number of epochs after which to hard stop the training session");
   opt_parser.add_option
     ("epoch", 'c', par.epoch,
-     "how many entries per training step should I use");
+     "how many entries per training step should I use (rprop only, scg"
+     " always uses the whole train set)");
   opt_parser.add_option
     ("traindb", 'd', par.traindb,
-     "location of the database to use for training");
+     "location of the database to use for training (XML or binary)");
   opt_parser.add_option
     ("end-net", 'e', par.endnet, 
      "where to write the last network");
   opt_parser.add_option
     ("best-net", 'g', par.bestnet, 
-     "where to write the best network");
+     "where to write the best network (binary if it ends in .bin)");
   opt_parser.add_option
     ("energy", 'j', par.energy,
      "the name of the output file for transverse energies of input clusters");
@@ -169,6 +191,9 @@ int main (int argc, char** argv)
   opt_parser.add_option
     ("sp-evolution", 'p', par.spevo,
      "where to write the SP evolution data, during training");
+  opt_parser.add_option
+    ("roc", 'q', par.roc,
+     "where to write the ROC of the best network on the test set (2 classes)");
   opt_parser.add_option
     ("hidden", 'r', par.nhidden,
      "how many hidden neurons should I use for the network");
@@ -180,10 +205,18 @@ int main (int argc, char** argv)
      "if I should use MSE stop criteria instead of SP (default)");
   opt_parser.add_option
     ("testdb", 'u', par.testdb,
-     "location of the database to use for testing");
+     "location of the database to use for testing (XML or binary)");
   opt_parser.add_option
     ("stop-threshold", 'w', par.stopthres,
      "the stop threshold to consider for flagging a potential stop");
+  opt_parser.add_option
+    ("threads", 'f', par.nthreads,
+     "how many threads should share the patterns of each epoch (and of the"
+     " normalisation statistics)");
+  opt_parser.add_option
+    ("trainer", 'a', par.trainer,
+     "rprop (default) trains each synapse on its own, scg moves all weights"
+     " at once (scaled conjugate gradient) over the whole train set");
   opt_parser.add_option
     ("compress-output", 'z', par.compress,
      "should compress the output, e.g. 2 classes -> 1 output for the network");
@@ -198,21 +231,24 @@ int main (int argc, char** argv)
     RINGER_FATAL(reporter, "I can't handle that exception. Aborting.");
   }
 
-  //loads the DB
-  data::DatabaseXml<data::RoIPatternSet> traindb(par.traindb, reporter);
-  data::DatabaseXml<data::RoIPatternSet> testdb(par.testdb, reporter);
+  //loads the DB, binary databases are mapped and read in place
+  data::Database<data::RoIPatternSet>* trainfile =
+    data::open_database<data::RoIPatternSet>(par.traindb, reporter);
+  data::Database<data::RoIPatternSet>& traindb = *trainfile;
+  data::Database<data::RoIPatternSet>* testfile =
+    data::open_database<data::RoIPatternSet>(par.testdb, reporter);
+  data::Database<data::RoIPatternSet>& testdb = *testfile;
   std::vector<std::string> cnames;
   traindb.class_names(cnames);
   RINGER_DEBUG1("Test set size is " << testdb.size());
   
-  //tune input DB's for size/randomness
-  data::Database<data::RoIPatternSet> 
-    traindb2(traindb); //save original train database
-  traindb.normalise();
-  //calculate the normalization factor based on the train set, but only after
-  //size normalization
-  data::NormalizationOperator norm_op(traindb);
-  RINGER_DEBUG1("Train set size is " << traindb2.size());
+  //calculate the normalization factor based on the train set, counting
+  //every class the same, whatever its size
+  data::NormalizationOperator norm_op(traindb, true, par.nthreads);
+  //classes are balanced while sampling, the database is not inflated
+  data::BalancedSampler sampler(traindb);
+  std::vector<size_t> pats(par.epoch);
+  RINGER_DEBUG1("Train set size is " << traindb.size());
 
   //checks db size
   if (traindb.size() < 2) {
@@ -239,29 +275,34 @@ int main (int argc, char** argv)
   std::vector<bool> biaslayer(2, true);
   unsigned int nout = traindb.size();
   if (par.compress) nout = lrint(std::ceil(log2(traindb.size())));
-  network::MLP net(traindb.pattern_size(), hlayer, nout,
+  network::MLP mlp(traindb.pattern_size(), hlayer, nout,
 		   biaslayer, nstrat, nsparam, nstrat, nsparam,
 		   sstrat, ssparam, norm_op.mean(), norm_op.stddev(), 
 		   reporter);
+  //trains layer by layer, with matrix products, from the MLP weights
+  network::BatchTrainer* trainer = 0;
+  network::SCGTrainer* scg = 0;
+  if (par.trainer == "scg")
+    trainer = scg = new network::SCGTrainer(mlp, reporter, par.nthreads);
+  else trainer = new network::BatchTrainer(mlp, reporter, par.nthreads);
+  network::BatchTrainer& net = *trainer;
+  //the conjugate directions are built for a single error function, the one
+  //of the whole train set, with every class weighted to count the same
+  std::vector<double> balance;
+  if (scg) {
+    pats.resize(sampler.size());
+    for (size_t k=0; k<pats.size(); ++k) pats[k] = k;
+    sampler.weights(balance);
+  }
 
-  data::RoIPatternSet train(1, 1);
-  traindb.merge(train);
-  RINGER_REPORT(reporter, "Normalised train set size is " << train.size());
-  data::RoIPatternSet train2(1, 1);
-  traindb2.merge(train2);
-  RINGER_REPORT(reporter, "Original train set size is " << train2.size());
-  RINGER_DEBUG1("Train set size is " << train.size());
+  data::RoIPatternSet train_buffer(1, 1);
+  const data::RoIPatternSet& train = data::merged(traindb, train_buffer);
+  RINGER_REPORT(reporter, "Train set size is " << train.size());
   data::RoIPatternSet target(1, 1);
   traindb.merge_target(par.compress, -1, +1, target);
-  RINGER_REPORT(reporter, "Normalized train target set size is " 
-		<< target.size());
-  data::RoIPatternSet target2(1, 1);
-  traindb2.merge_target(par.compress, -1, +1, target2);
-  RINGER_REPORT(reporter, "Original train target set size is "
-		<< target2.size());
-  RINGER_DEBUG1("Train target set size is " << target.size());
-  data::RoIPatternSet test(1, 1);
-  testdb.merge(test);
+  RINGER_REPORT(reporter, "Train target set size is " << target.size());
+  data::RoIPatternSet test_buffer(1, 1);
+  const data::RoIPatternSet& test = data::merged(testdb, test_buffer);
   RINGER_DEBUG1("Test set size is " << test.size());
   data::RoIPatternSet test_target(1, 1);
   testdb.merge_target(par.compress, -1, +1, test_target);
@@ -272,12 +313,16 @@ int main (int argc, char** argv)
     mseevo << "epoch test-mse train-mse" << "\n";
     sys::Plain spevo(par.spevo, std::ios_base::trunc|std::ios_base::out);
     spevo << "epoch test-sp train-sp" << "\n";
-    data::SimplePatternSet output(target2.simple());
     config::Header net_header("Andre DOS ANJOS", par.output, "1.0", time(0),
 			      "Start set");
     net.save(par.startnet, &net_header);
     unsigned int stopnow = par.stopiter;
 
+    //Evaluates snapshots of the network in the background, while training
+    network::AsyncEvaluator evaluator(test.simple(), test_target.simple(),
+				      train.simple(), target.simple(),
+				      traindb.size() == 2);
+
     //Trains until the MSE or SP product stabilizes
     double val = 1;
     double var = 1;
@@ -285,83 +330,89 @@ int main (int argc, char** argv)
     double prev = 0; //previous
     size_t i = 0;
     double best_val = val;
-    while (stopnow) {
-      net.train(train.simple(), target.simple(), par.epoch);
-      --par.hardstop;
-      if (!par.hardstop) {
-	RINGER_REPORT(reporter, "Hard-stop limit has been reached. Stopping"
-		      << " the training session by force.");
-	stopnow = 0;
-	continue;
+    bool saved_best = false; //if a best network was saved at all
+    while (stopnow || evaluator.pending()) {
+      if (stopnow) {
+	if (scg) scg->train(train.simple(), target.simple(), pats, balance);
+	else {
+	  sampler.draw(pats);
+	  net.train(train.simple(), target.simple(), pats);
+	}
+	--par.hardstop;
+	if (!par.hardstop) {
+	  RINGER_REPORT(reporter, "Hard-stop limit has been reached. Stopping"
+			<< " the training session by force.");
+	  stopnow = 0;
+	}
+	else {
+	  //time to check performance
+	  if (i%par.sample == 0) evaluator.submit(net, i);
+	  ++i; //go to next epoch
+	}
       }
 
-      if (i%par.sample == 0) { //time to check performance
-	double eff1, eff2, thres;
-	double eff1_test, eff2_test, thres_test;
-	{
-	  //test set analysis
-	  output = test_target.simple();
-	  net.run(test.simple(), output);
-	  double sp_val;
-	  if (traindb.size() == 2)
-	    sp_val = data::sp(output, test_target, eff1_test, eff2_test, thres_test);
-	  double mse_val = data::mse(output, test_target.simple());
-	  mseevo << (unsigned int)i << " " << mse_val;
-	  spevo << (unsigned int)i << " " << sp_val;
-	  prev = val;
-	  if (!par.msestop) val = sp_val;
-	  else val = mse_val;
-	  var = std::fabs(val-prev)/prev;
-	  bool savenet = false;
-	  if (!par.msestop) { //the greater, the better
-	    if (val > best_val) {
-	      best_val = val;
-	      savenet = true;
-	    }
-	  }
-	  else {
-	    if (var < best_val) {
-	      best_val = val;
-	      savenet = true;
-	    }
+      //evaluations come back in epoch order, all of them once stopped
+      network::Evaluation* ev = evaluator.next(!stopnow);
+      if (!ev) continue;
+      if (ev->error.size()) {
+	std::string error = ev->error;
+	delete ev;
+	throw RINGER_EXCEPTION(error.c_str());
+      }
+      {
+	//test set analysis
+	mseevo << (unsigned int)ev->epoch << " " << ev->test_mse;
+	spevo << (unsigned int)ev->epoch << " " << ev->test_sp;
+	prev = val;
+	if (!par.msestop) val = ev->test_sp;
+	else val = ev->test_mse;
+	var = std::fabs(val-prev)/prev;
+	bool savenet = false;
+	if (!par.msestop) { //the greater, the better
+	  if (val > best_val) {
+	    best_val = val;
+	    savenet = true;
 	  }
-	  if (savenet) { //save the current network because it is the best
-	    //save result
-	    RINGER_REPORT(reporter, "Saving best network so far at \""
-			  << par.bestnet << "\"...");
-	    config::Header end_header("Andre DOS ANJOS", par.output, 
-				      "1.0", time(0), "Trained network");
-	    net.save(par.bestnet, &end_header);
+	}
+	else {
+	  if (var < best_val) {
+	    best_val = val;
+	    savenet = true;
 	  }
 	}
-	{
-	  //train set analysis
-	  net.run(train2.simple(), output);
-	  double sp_val;
-	  if (traindb.size() == 2) 
-	    sp_val = data::sp(output, target2, eff1, eff2, thres);
-	  double mse_val = data::mse(output, target2.simple());
-	  mseevo << " " << mse_val << "\n";
-	  spevo << " " << sp_val << "\n";
+	if (savenet) { //save the network of that epoch because it is the best
+	  //save result
+	  RINGER_REPORT(reporter, "Saving best network so far at \""
+			<< par.bestnet << "\"...");
+	  config::Header end_header("Andre DOS ANJOS", par.output, 
+				    "1.0", time(0), "Trained network");
+	  ev->save(par.bestnet, &end_header, reporter);
+	  saved_best = true;
 	}
+      }
+      {
+	//train set analysis
+	mseevo << " " << ev->train_mse << "\n";
+	spevo << " " << ev->train_sp << "\n";
+      }
+      if (stopnow) {
 	if (var < par.stopthres) {
 	  --stopnow;
 	  RINGER_REPORT(reporter, "Detected possible stop in " << stopnow
 			<< " more iterations.");
 	}
 	else stopnow = par.stopiter;
-	if (!par.msestop) {
-	  RINGER_REPORT(reporter, "[epoch " << i << "/test] SP = " << val
-			<< " (variation = " << var << ") (for threshold=" 
-			<< thres_test << " -> " << cnames[0]
-			<< " eff=" << eff1_test*100 << "% and " << cnames[1]
-			<< " eff=" << eff2_test*100 << "%)");
-	}
-	else RINGER_REPORT(reporter, "[epoch " << i << "] MSE = " << val
-			   << " (variation = " << var << ")");
       }
-
-      ++i; //go to next epoch
+      if (!par.msestop) {
+	RINGER_REPORT(reporter, "[epoch " << ev->epoch << "/test] SP = " << val
+		      << " (variation = " << var << ") (for threshold=" 
+		      << ev->test_thres << " -> " << cnames[0]
+		      << " eff=" << ev->test_eff1*100 << "% and " << cnames[1]
+		      << " eff=" << ev->test_eff2*100 << "%)");
+      }
+      else RINGER_REPORT(reporter, "[epoch " << ev->epoch << "] MSE = " << val
+			 << " (variation = " << var << ")");
+      delete ev;
     }
 
     //save result
@@ -374,18 +425,22 @@ int main (int argc, char** argv)
     RINGER_REPORT(reporter,
 		  "Saving training and testing outputs and targets.");
     
-    //reload the best network saved so far.
-    network::Network bestnet(par.endnet, reporter);
-    data::SimplePatternSet simple_train_output(target2.simple());
-    bestnet.run(train2.simple(), simple_train_output);
-    data::RoIPatternSet train_output(simple_train_output, train2.attributes());
-    double mse_train = data::mse(train_output, target2);
+    //reload the best network saved, or the last one if none was
+    const std::string& bestfile = saved_best? par.bestnet : par.endnet;
+    if (!saved_best)
+      RINGER_REPORT(reporter, "No best network was saved, the outputs and"
+		    << " the ROC are those of the last network.");
+    network::Network bestnet(bestfile, reporter);
+    data::SimplePatternSet simple_train_output(target.simple());
+    bestnet.run(train.simple(), simple_train_output);
+    data::RoIPatternSet train_output(simple_train_output, train.attributes());
+    double mse_train = data::mse(train_output, target);
     double sp_train = 0;
     double train_eff1 = 0;
     double train_eff2 = 0;
     double train_thres = 0;
     if (traindb.size() == 2) 
-      sp_train = data::sp(train_output, target2, train_eff1, train_eff2, 
+      sp_train = data::sp(train_output, target, train_eff1, train_eff2, 
 			  train_thres);
     data::SimplePatternSet simple_test_output(target.simple());
     bestnet.run(test.simple(), simple_test_output);
@@ -397,16 +452,26 @@ int main (int argc, char** argv)
     double test_thres = 0;
     if (traindb.size() == 2) sp_test = data::sp(test_output, test_target,
                                                 test_eff1, test_eff2, test_thres);
+    if (traindb.size() == 2) {
+      std::vector<double> eff1, eff2, thres;
+      data::roc(test_output, test_target, eff1, eff2, thres);
+      sys::Plain roc(par.roc, std::ios_base::trunc|std::ios_base::out);
+      roc << "threshold " << cnames[0] << "-eff " << cnames[1] << "-eff\n";
+      for (size_t k = 0; k < thres.size(); ++k)
+	roc << thres[k] << " " << eff1[k] << " " << eff2[k] << "\n";
+      RINGER_REPORT(reporter, "ROC of the best network on the test set saved"
+		    << " to \"" << par.roc << "\".");
+    }
 
     //energy estimations
     data::RoIPatternSet train_energy(train_output.size(), 1);
     data::Ensemble train_energies(train_output.size(), 0);
     data::SumExtractor add;
     for (size_t i = 0; i < train_output.size(); ++i) {
-      train_energies[i] = add(train2.pattern(i));
+      train_energies[i] = add(train.pattern(i));
     }
     train_energy.set_ensemble(0, train_energies);
-    train_energy.set_attribute(train2.attributes());
+    train_energy.set_attribute(train.attributes());
 
     data::RoIPatternSet test_energy(test_output.size(), 1);
     data::Ensemble test_energies(test_output.size(), 0);
@@ -418,7 +483,7 @@ int main (int argc, char** argv)
 
     std::map<std::string, data::RoIPatternSet*> data;
     data["train-output"] = &train_output;
-    data["train-target"] = &target2;
+    data["train-target"] = &target;
     data["train-energy"] = &train_energy;
     data["test-output"] = &test_output;
     data["test-target"] = &test_target;
@@ -432,8 +497,12 @@ int main (int argc, char** argv)
     comment << ".";
     data::Header header("Andre DOS ANJOS", par.output, "1.0", time(0),
 			comment.str());
-    data::DatabaseXml<data::RoIPatternSet> output_db(&header, data, reporter);
-    output_db.save(par.output);
+    if (!data::DatabaseXml<data::RoIPatternSet>::write(par.output, &header,
+						       data, reporter)) {
+      RINGER_DEBUG1("Could not save \"" << par.output << "\"."
+		    << " Exception thrown.");
+      throw RINGER_EXCEPTION("Could not save the network output");
+    }
     RINGER_REPORT(reporter, "Network output saved to \"" << par.output
 		  << "\".");
 
@@ -472,6 +541,9 @@ int main (int argc, char** argv)
 		 << "I have to exit, bye.");
   }
   
+  delete trainer;
+  delete testfile;
+  delete trainfile;
   delete reporter;
 }
 
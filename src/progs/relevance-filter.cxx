@@ -253,7 +253,11 @@ int main (int argc, char** argv)
     RINGER_REPORT(reporter, "The resulting ensemble size after cutting is " 
 		  << db.data("electron")->pattern_size() << ".");
     //save db
-    db.save(par.output);
+    if (!db.save(par.output)) {
+      RINGER_DEBUG1("Could not save \"" << par.output << "\"."
+		    << " Exception thrown.");
+      throw RINGER_EXCEPTION("Could not save the filtered database");
+    }
     RINGER_REPORT(reporter, "Saved new database with name " << par.output
 		  << ".");
     
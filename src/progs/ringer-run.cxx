@@ -22,9 +22,10 @@
 #include "TrigRingerTools/sys/util.h"
 #include "TrigRingerTools/sys/OptParser.h"
 #include "TrigRingerTools/data/RoIPatternSet.h"
+#include "TrigRingerTools/data/PatternArena.h"
 #include "TrigRingerTools/data/Database.h"
 #include "TrigRingerTools/data/DatabaseXml.h"
-#include "TrigRingerTools/network/MLP.h"
+#include "TrigRingerTools/network/CompiledNetwork.h"
 #include <iostream>
 #include <popt.h>
 #include <cstdio>
@@ -150,7 +151,7 @@ int main (int argc, char** argv)
 
   //loads the Network
   RINGER_REPORT(reporter, "Loading network \"" << par.net << "\"...");
-  network::Network net(par.net, reporter);
+  network::CompiledNetwork net(par.net, reporter);
   
   //start processing
   std::string bname = sys::stripname(par.roidump);
@@ -186,9 +187,15 @@ int main (int argc, char** argv)
     struct timeval start_time, peak_time, ring_time, norm_time, net_time;
     data::RoIPatternSet timedb(roidump.size(), 4);
 
+    //the per-RoI temporaries are reused, so the loop does not allocate
+    data::PatternArena arena;
+    data::Pattern these_rings(nrings);
+    data::Pattern net_output(net.output_size());
+
     size_t i=0;
     for (std::vector<const roiformat::RoI*>::const_iterator
 	   it=rois.begin(); it!=rois.end(); ++it) {
+      arena.reset();
       RINGER_REPORT(reporter, "RoI -> L1Id #" << (*it)->lvl1_id() 
 		    << " - RoI #" << (*it)->roi_id());
       gettimeofday(&start_time, 0);
@@ -199,21 +206,16 @@ int main (int argc, char** argv)
       rbuild::build_rings(reporter, *it, rset, ok, eta, phi, 
 			  par.eta_window, par.phi_window);
       gettimeofday(&ring_time, 0);
-      rbuild::normalize_rings(reporter, rset);
+      rbuild::normalize_rings(reporter, rset, &arena);
       gettimeofday(&norm_time, 0);
 
       //extra "magic" to place the entry at the output DB
-      bool rings_not_init = true;
-      data::Pattern these_rings(1);
-      data::Pattern net_output(1);
+      size_t k = 0;
       for (std::vector<rbuild::RingSet>::iterator 
 	     jt=rset.begin(); jt!=rset.end(); ++jt) {
 	//Now store the values as a data::Pattern before returning
-	if (rings_not_init) {
-	  these_rings = jt->pattern();
-	  rings_not_init = false;
-	}
-	else these_rings.append(jt->pattern());
+	const data::Pattern& p = jt->pattern();
+	for (size_t j=0; j<p.size(); ++j) these_rings[k++] = p[j];
       } //for each RingSet (third iteration)
 
       //pass the normalized patternset through the network
@@ -244,7 +246,11 @@ int main (int argc, char** argv)
     std::map<std::string, data::RoIPatternSet*> psmap;
     psmap[bname] = &outdb;
     data::DatabaseXml<data::RoIPatternSet> db(&h, psmap, reporter);
-    db.save(par.output);
+    if (!db.save(par.output)) {
+      RINGER_DEBUG1("Could not save \"" << par.output << "\"."
+		    << " Exception thrown.");
+      throw RINGER_EXCEPTION("Could not save the ringer output");
+    }
     RINGER_REPORT(reporter, "Output file \"" << par.output
 		  << "\" was correctly saved and closed.");
 
@@ -256,7 +262,11 @@ int main (int argc, char** argv)
       std::map<std::string, data::RoIPatternSet*> tpsmap;
       tpsmap[bname] = &timedb;
       data::DatabaseXml<data::RoIPatternSet> tdb(&h, tpsmap, reporter);
-      tdb.save(par.timings);
+      if (!tdb.save(par.timings)) {
+	RINGER_DEBUG1("Could not save \"" << par.timings << "\"."
+		      << " Exception thrown.");
+	throw RINGER_EXCEPTION("Could not save the timings");
+      }
       RINGER_REPORT(reporter, "Timings file \"" << par.timings
 		    << "\" was correctly saved and closed.");
     }
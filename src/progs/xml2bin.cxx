@@ -0,0 +1,15 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file xml2bin.cxx
+ *
+ * Converts an XML database into a binary database file, that can be mapped
+ * in memory with data::DatabaseBinary.
+ */
+
+#include "ConvertDatabase.h"
+
+int main (int argc, char** argv)
+{
+  return convert_database(argc, argv, "XML", "binary", ".bin");
+}
@@ -0,0 +1,59 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file xml2cxx.cxx
+ *
+ * Builds a self-contained C++ header that runs a network.
+ */
+
+#include "TrigRingerTools/network/CompiledNetwork.h"
+#include "TrigRingerTools/sys/LocalReporter.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/util.h"
+#include "TrigRingerTools/sys/debug.h"
+#include <cctype>
+#include <string>
+
+/**
+ * Turns a name into a valid C++ identifier, replacing whatever is not a
+ * letter, a digit or an underscore by an underscore.
+ *
+ * @param name The name to convert
+ */
+std::string identifier (const std::string& name)
+{
+  std::string retval;
+  for (size_t i=0; i<name.size(); ++i)
+    retval += (isalnum(name[i]) || name[i] == '_')? name[i] : '_';
+  if (retval.empty() || isdigit(retval[0])) retval = "net_" + retval;
+  return retval;
+}
+
+int main (int argc, char** argv)
+{
+  sys::Reporter *reporter = new sys::LocalReporter();
+  if (argc != 3 && argc != 4) RINGER_FATAL(reporter, "usage: " << argv[0]
+			      << " <network-file> <header-file> [namespace]");
+  try {
+    if (!sys::exists(argv[1])) {
+      RINGER_DEBUG1("Network file " << argv[1] << " doesn't exist.");
+      throw RINGER_EXCEPTION("Network file doesn't exist");
+    }
+    std::string name = identifier((argc == 4)? argv[3] :
+				  sys::stripname(argv[2]));
+    network::CompiledNetwork net(argv[1], reporter);
+    if (!net.cxx(argv[2], name)) {
+      RINGER_DEBUG1("Could not write \"" << argv[2] << "\". Exception thrown.");
+      throw RINGER_EXCEPTION("Could not write network code");
+    }
+    RINGER_REPORT(reporter, "Network code was written to \"" << argv[2]
+		  << "\", in namespace \"" << name << "\".");
+  }
+  catch (sys::Exception& e) {
+    RINGER_EXCEPT(reporter, e.what());
+    RINGER_FATAL(reporter,
+		 "I caught an exception, I'm sorry but I have to exit. Bye.");
+  }
+
+  delete reporter;
+}
@@ -11,9 +11,7 @@
  */
 
 #include "TrigRingerTools/rbuild/util.h"
-#include "TrigRingerTools/data/SumExtractor.h"
-#include "TrigRingerTools/data/MaxExtractor.h"
-#include "TrigRingerTools/data/MinExtractor.h"
+#include "TrigRingerTools/data/StatsExtractor.h"
 #include "TrigRingerTools/sys/debug.h"
 #include "TrigRingerTools/sys/Reporter.h"
 
@@ -37,10 +35,12 @@
  * @param rings The calculated ring values one wishes to normalise
  * @param stop_energy The threshold to judge when to stop this normalisation
  * strategy and start using the total layer energy instead, in MeV.
+ * @param arena Where to take the temporary normalisation vector from
  */
 void rbuild::sequential (sys::Reporter* /*reporter*/,
 			 data::Pattern& rings, 
-			 const data::Feature& stop_energy)
+			 const data::Feature& stop_energy,
+			 data::PatternArena* arena)
 {
 
   //if the ENERGY_THRESHOLD is greater than `stop', use stop instead.
@@ -55,9 +55,11 @@ void rbuild::sequential (sys::Reporter* /*reporter*/,
     stop = rbuild::ENERGY_THRESHOLD;
   }
 
-  data::Pattern norm(rings.size(), 0);
-  data::SumExtractor sum;
-  norm[0] = std::fabs(sum(rings));
+  data::PatternArena local(rings.size());
+  data::Pattern norm(rings.size(), arena? *arena : local, 0);
+  //sum and extrema are taken from the same traversal of the rings
+  const data::StatsExtractor stats(rings);
+  norm[0] = std::fabs(stats.sum());
   //if the sum is less than stop, apply layer normalisation to all rings
   if (norm[0] < stop) {
     //if the normalization factor is smaller than stop, I have to verify if it
@@ -65,13 +67,8 @@ void rbuild::sequential (sys::Reporter* /*reporter*/,
     //verify if the sum is smaller than the layer maxima, if that is the case,
     //I have to reconsider the normalization factor to a more reasonable
     //value, e.g. the layer absolute maximum
-    data::MaxExtractor mxex;
-    data::MinExtractor mnex;
-    data::Feature max = mxex(rings);
-    data::Feature min = mnex(rings);
-    if (norm[0] < max) {
-      data::Feature new_norm = std::fabs(max);
-      if (std::fabs(min) > new_norm) new_norm = std::fabs(min);
+    if (norm[0] < stats.max()) {
+      data::Feature new_norm = stats.absmax();
       RINGER_DEBUG1("Replacing normalization factor ring-sum (" 
 		  << norm[0] << " MeV) by layer absolute maxima (" 
 		  << new_norm << " MeV)");
@@ -205,9 +202,11 @@ void rbuild::build_rings(sys::Reporter* /*reporter*/,
  *
  * @param reporter A system-wide reporter to use
  * @param rset The ring set configuration to use for creating the rings
+ * @param arena Where to take temporaries from
  */
 void rbuild::normalize_rings(sys::Reporter* reporter,
-			     std::vector<rbuild::RingSet>& rset)
+			     std::vector<rbuild::RingSet>& rset,
+			     data::PatternArena* arena)
 {
   //at this point, I have all ring sets, separated
   double emsection = 0; // energy at e.m. section
@@ -238,7 +237,7 @@ void rbuild::normalize_rings(sys::Reporter* reporter,
         }
       break;
       case rbuild::RingConfig::SEQUENTIAL:
-        sequential(reporter, jt->pattern());
+        sequential(reporter, jt->pattern(), 100.0, arena);
       break;
       default: //do nothing
       break;
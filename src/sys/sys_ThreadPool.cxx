@@ -0,0 +1,99 @@
+//Dear emacs, this is -*- c++ -*-
+
+/**
+ * @file sys/src/ThreadPool.cxx
+ *
+ * @brief Implements the POSIX thread pool.
+ */
+
+#include "TrigRingerTools/sys/ThreadPool.h"
+#include "TrigRingerTools/sys/Exception.h"
+#include "TrigRingerTools/sys/debug.h"
+
+sys::ThreadPool::ThreadPool (const unsigned int nthreads)
+  : m_thread(),
+    m_queue(),
+    m_running(0),
+    m_stop(false)
+{
+  pthread_mutex_init(&m_lock, 0);
+  pthread_cond_init(&m_work, 0);
+  pthread_cond_init(&m_done, 0);
+  unsigned int n = nthreads? nthreads : 1;
+  for (unsigned int i=0; i<n; ++i) {
+    pthread_t thread;
+    if (pthread_create(&thread, 0, sys::ThreadPool::work, this) != 0) {
+      RINGER_DEBUG1("Could only start " << m_thread.size() << " out of "
+		    << n << " worker threads.");
+      break;
+    }
+    m_thread.push_back(thread);
+  }
+  if (m_thread.empty()) {
+    RINGER_DEBUG1("I could not start any worker thread. Exception thrown.");
+    pthread_cond_destroy(&m_done);
+    pthread_cond_destroy(&m_work);
+    pthread_mutex_destroy(&m_lock);
+    throw RINGER_EXCEPTION("Cannot start thread pool");
+  }
+  RINGER_DEBUG2("Thread pool started with " << m_thread.size() 
+		<< " worker(s).");
+}
+
+sys::ThreadPool::~ThreadPool()
+{
+  wait();
+  pthread_mutex_lock(&m_lock);
+  m_stop = true;
+  pthread_cond_broadcast(&m_work);
+  pthread_mutex_unlock(&m_lock);
+  for (size_t i=0; i<m_thread.size(); ++i) pthread_join(m_thread[i], 0);
+  pthread_cond_destroy(&m_done);
+  pthread_cond_destroy(&m_work);
+  pthread_mutex_destroy(&m_lock);
+  RINGER_DEBUG2("Thread pool stopped.");
+}
+
+void sys::ThreadPool::submit (sys::Task* task)
+{
+  pthread_mutex_lock(&m_lock);
+  m_queue.push_back(task);
+  pthread_cond_signal(&m_work);
+  pthread_mutex_unlock(&m_lock);
+}
+
+void sys::ThreadPool::wait (void)
+{
+  pthread_mutex_lock(&m_lock);
+  while (!m_queue.empty() || m_running) pthread_cond_wait(&m_done, &m_lock);
+  pthread_mutex_unlock(&m_lock);
+}
+
+size_t sys::ThreadPool::pending (void)
+{
+  pthread_mutex_lock(&m_lock);
+  size_t retval = m_queue.size() + m_running;
+  pthread_mutex_unlock(&m_lock);
+  return retval;
+}
+
+void* sys::ThreadPool::work (void* pool)
+{
+  sys::ThreadPool* self = static_cast<sys::ThreadPool*>(pool);
+  pthread_mutex_lock(&self->m_lock);
+  while (true) {
+    while (self->m_queue.empty() && !self->m_stop)
+      pthread_cond_wait(&self->m_work, &self->m_lock);
+    if (self->m_queue.empty()) break; //stop was requested
+    sys::Task* task = self->m_queue.front();
+    self->m_queue.pop_front();
+    ++self->m_running;
+    pthread_mutex_unlock(&self->m_lock);
+    task->run();
+    pthread_mutex_lock(&self->m_lock);
+    --self->m_running;
+    pthread_cond_broadcast(&self->m_done);
+  }
+  pthread_mutex_unlock(&self->m_lock);
+  return 0;
+}